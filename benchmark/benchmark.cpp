@@ -1,9 +1,32 @@
+#include "aggregate.hpp"
 #include "buffer.hpp"
+#include "cbor.hpp"
+#include "columns.hpp"
+#include "concurrent.hpp"
+#include "csv.hpp"
+#include "document.hpp"
 #include "json.hpp"
+#include "msgpack.hpp"
+#include "ndjson.hpp"
+#include "lite3/ring.hpp"
+#include "patch.hpp"
+#include "query.hpp"
+#include "utils/hex.hpp"
+#include "yyjson.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <random>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 // Helper to pre-generate data
@@ -145,6 +168,1159 @@ void benchmark_json_deserialization() {
   std::chrono::duration<double> diff = end - start;
   std::cout << "benchmark_json_deserialization (large string, 100 iters): "
             << diff.count() << " s" << std::endl;
+
+  // Same document parsed into one reused Buffer.
+  lite3cpp::Buffer reused;
+  start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < 100; ++i)
+    lite3cpp::lite3_json::parse_json_into(large_json_str, reused);
+  end = std::chrono::high_resolution_clock::now();
+  diff = end - start;
+  std::cout << "benchmark_json_deserialization (parse_json_into, 100 iters): "
+            << diff.count() << " s" << std::endl;
+}
+
+// Per-message parsing of small frames, as a network handler would: a fresh
+// Buffer from a std::string copy per message, against parse_json_into
+// reusing one Buffer and the parser state.
+void benchmark_json_parse_into() {
+  std::vector<std::string> frames;
+  for (int i = 0; i < 64; ++i)
+    frames.push_back("{\"op\":\"put\",\"id\":" + std::to_string(i * 7919) +
+                     ",\"key\":\"user:" + std::to_string(i) +
+                     "\",\"ttl\":3600,\"tags\":[\"a\",\"b\"],"
+                     "\"meta\":{\"src\":\"edge\",\"w\":0.5}}");
+  constexpr int messages = 200000;
+
+  int64_t checksum = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < messages; ++i) {
+    std::string_view frame = frames[i % frames.size()];
+    lite3cpp::Buffer doc =
+        lite3cpp::lite3_json::from_json_string(std::string(frame));
+    if (doc.size() != 0)
+      checksum += doc.get_i64(0, "id");
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> fresh = end - start;
+
+  lite3cpp::Buffer doc;
+  start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < messages; ++i) {
+    const std::string &frame = frames[i % frames.size()];
+    lite3cpp::lite3_json::parse_json_into(frame, doc);
+    checksum += doc.get_i64(0, "id");
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> reused = end - start;
+
+  std::cout << "benchmark_json_parse_into: from_json_string "
+            << fresh.count() * 1e9 / messages << " ns/msg, parse_json_into "
+            << reused.count() * 1e9 / messages << " ns/msg" << std::endl;
+  if (checksum == 0)
+    std::cerr << "benchmark_json_parse_into: no ids read" << std::endl;
+}
+
+// Runs `threads` readers doing `reads` lookups each while one writer keeps
+// updating values in place; returns aggregate reads per second.
+template <typename ReadFn, typename WriteFn>
+double run_read_scaling(int threads, int reads, ReadFn read_fn,
+                        WriteFn write_fn) {
+  std::atomic<bool> stop{false};
+  std::atomic<int64_t> checksum{0};
+  std::thread writer([&] {
+    int64_t i = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      write_fn(i++);
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  });
+
+  std::vector<std::thread> readers;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    readers.emplace_back([&, t] {
+      int64_t sink = 0;
+      for (int i = 0; i < reads; ++i)
+        sink += read_fn((i * 7919 + t) % 10000);
+      checksum.fetch_add(sink, std::memory_order_relaxed);
+    });
+  }
+  for (auto &r : readers)
+    r.join();
+  auto end = std::chrono::high_resolution_clock::now();
+  stop.store(true);
+  writer.join();
+
+  std::chrono::duration<double> diff = end - start;
+  return static_cast<double>(threads) * reads / diff.count();
+}
+
+void benchmark_concurrent_read_scaling() {
+  BenchmarkData data(10000);
+  lite3cpp::Buffer seed;
+  seed.reserve(10 * 1024 * 1024);
+  seed.init_object();
+  for (int i = 0; i < 10000; ++i)
+    seed.set_i64(0, data.keys[i], i);
+
+  lite3cpp::ConcurrentBuffer concurrent(seed);
+  lite3cpp::Buffer locked = seed;
+  std::shared_mutex lock;
+
+  constexpr int reads = 200000;
+  for (int threads = 1; threads <= 64; threads *= 2) {
+    double seqlock = run_read_scaling(
+        threads, reads,
+        [&](int k) {
+          return concurrent.read([&](const lite3cpp::Buffer &b) {
+            return b.get_i64(0, data.keys[k]);
+          });
+        },
+        [&](int64_t i) {
+          concurrent.write([&](lite3cpp::Buffer &b) {
+            b.set_i64(0, data.keys[i % 10000], i);
+          });
+        });
+    double rwlock = run_read_scaling(
+        threads, reads,
+        [&](int k) {
+          std::shared_lock<std::shared_mutex> guard(lock);
+          return locked.get_i64(0, data.keys[k]);
+        },
+        [&](int64_t i) {
+          std::unique_lock<std::shared_mutex> guard(lock);
+          locked.set_i64(0, data.keys[i % 10000], i);
+        });
+    std::cout << "benchmark_concurrent_read_scaling: threads=" << threads
+              << " seqlock=" << seqlock / 1e6 << " Mops/s"
+              << " shared_mutex=" << rwlock / 1e6 << " Mops/s" << std::endl;
+  }
+  std::cout << "benchmark_concurrent_read_scaling: read retries="
+            << concurrent.read_retries() << std::endl;
+}
+
+// Routes keys through rings of increasing size. "map" is the former
+// std::map-based ring, kept here as the baseline.
+void benchmark_ring_routing() {
+  constexpr int replicas = 100;
+  constexpr int lookups = 1000000;
+  BenchmarkData data(10000);
+  // Visit keys in a scattered order: FNV-1a maps consecutive key names to
+  // nearby ring positions, which would flatter branchy searches.
+  std::vector<std::string_view> keys;
+  for (size_t i = 0; i < data.keys.size(); ++i)
+    keys.push_back(data.keys[(i * 7919) % data.keys.size()]);
+  std::vector<lite3::NodeID> routed(keys.size());
+
+  for (int nodes : {10, 100, 1000}) {
+    std::map<uint64_t, lite3::NodeID> map_ring;
+    lite3::ConsistentHash sorted(replicas);
+    lite3::ConsistentHash eytzinger(replicas,
+                                    lite3::ConsistentHash::Layout::Eytzinger);
+    for (int n = 0; n < nodes; ++n) {
+      for (int i = 0; i < replicas; ++i)
+        map_ring[lite3::fnv1a_64(std::to_string(n) + ":" +
+                                 std::to_string(i))] = n;
+      sorted.add_node(n);
+      eytzinger.add_node(n);
+    }
+
+    uint64_t sink = 0;
+    auto time = [&](auto &&fn) {
+      auto start = std::chrono::high_resolution_clock::now();
+      fn();
+      auto end = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double> diff = end - start;
+      return lookups / diff.count() / 1e6;
+    };
+    double map_rate = time([&] {
+      for (int i = 0; i < lookups; ++i) {
+        auto it = map_ring.lower_bound(lite3::fnv1a_64(keys[i % keys.size()]));
+        sink += it == map_ring.end() ? map_ring.begin()->second : it->second;
+      }
+    });
+    auto single = [&](const lite3::ConsistentHash &ring) {
+      return time([&] {
+        for (int i = 0; i < lookups; ++i)
+          sink += ring.get_node(keys[i % keys.size()]);
+      });
+    };
+    auto batch = [&](const lite3::ConsistentHash &ring) {
+      return time([&] {
+        for (int i = 0; i < lookups; i += static_cast<int>(keys.size())) {
+          ring.get_nodes(keys, routed);
+          sink += routed[i % routed.size()];
+        }
+      });
+    };
+    double sorted_rate = single(sorted);
+    double sorted_batch = batch(sorted);
+    double eyt_rate = single(eytzinger);
+    double eyt_batch = batch(eytzinger);
+
+    std::cout << "benchmark_ring_routing: vnodes=" << sorted.size()
+              << " map=" << map_rate << " sorted=" << sorted_rate
+              << " sorted_batch=" << sorted_batch << " eytzinger=" << eyt_rate
+              << " eytzinger_batch=" << eyt_batch << " Mlookups/s"
+              << " (checksum " << sink << ")" << std::endl;
+  }
+}
+
+// Zipf-skewed request stream against 100 nodes: each request holds one unit
+// of load on its node while it is among the last `in_flight` requests.
+// Reports the mean of max/mean node load over the run and the acquire cost
+// for plain routing and for several load bounds.
+void benchmark_ring_bounded_load() {
+  constexpr int nodes = 100;
+  constexpr int distinct_keys = 100000;
+  constexpr int requests = 1000000;
+  constexpr size_t in_flight = 2000;
+
+  BenchmarkData data(distinct_keys);
+  std::vector<double> cdf(distinct_keys);
+  double total = 0;
+  for (int i = 0; i < distinct_keys; ++i)
+    cdf[i] = total += 1.0 / std::pow(i + 1, 1.1);
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<double> uniform(0.0, total);
+  std::vector<int> stream(requests);
+  for (auto &k : stream)
+    k = static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(),
+                                          uniform(rng)) -
+                         cdf.begin());
+
+  for (double epsilon : {-1.0, 1.0, 0.5, 0.25, 0.1}) {
+    lite3::ConsistentHash ring(100);
+    for (int n = 0; n < nodes; ++n)
+      ring.add_node(n);
+    if (epsilon >= 0)
+      ring.set_load_bound(epsilon);
+
+    std::vector<lite3::NodeID> window(in_flight);
+    std::vector<uint64_t> loads(nodes, 0);
+    double skew_sum = 0;
+    int samples = 0;
+    std::chrono::duration<double> routing{0};
+    for (int i = 0; i < requests; ++i) {
+      size_t w = i % in_flight;
+      if (i >= static_cast<int>(in_flight)) {
+        ring.release(window[w]);
+        --loads[window[w]];
+      }
+      auto start = std::chrono::high_resolution_clock::now();
+      window[w] = ring.acquire(data.keys[stream[i]]);
+      routing += std::chrono::high_resolution_clock::now() - start;
+      ++loads[window[w]];
+      if (i >= static_cast<int>(in_flight) && i % 1000 == 0) {
+        uint64_t max = *std::max_element(loads.begin(), loads.end());
+        skew_sum += max / (static_cast<double>(in_flight) / nodes);
+        ++samples;
+      }
+    }
+    std::cout << "benchmark_ring_bounded_load: epsilon=";
+    if (epsilon < 0)
+      std::cout << "none";
+    else
+      std::cout << epsilon;
+    std::cout << " max/mean=" << skew_sum / samples
+              << " acquire=" << routing.count() / requests * 1e9 << " ns"
+              << std::endl;
+  }
+}
+
+// Two versions of a 10k-member document differing in 1% of the members.
+// Compares serializing both versions to JSON (the input of a text diff)
+// against the native diff, and times applying the resulting patch.
+void benchmark_buffer_diff() {
+  constexpr int members = 10000;
+  BenchmarkData data(members);
+  lite3cpp::Buffer before;
+  before.init_object();
+  for (int i = 0; i < members; ++i) {
+    size_t doc = before.set_obj(0, data.keys[i]);
+    before.set_i64(doc, "version", 1);
+    before.set_str(doc, "body", data.values[i]);
+  }
+  lite3cpp::Buffer after = before;
+  for (int i = 0; i < members; i += 100)
+    after.set_i64(after.get_obj(0, data.keys[i]), "version", 2);
+  for (int i = 50; i < members; i += 200)
+    after.remove(0, data.keys[i]);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  std::string a = lite3cpp::lite3_json::to_json_string(before, 0);
+  std::string b = lite3cpp::lite3_json::to_json_string(after, 0);
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> text = end - start;
+
+  start = std::chrono::high_resolution_clock::now();
+  lite3cpp::Patch patch = lite3cpp::diff(before, after);
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> native = end - start;
+
+  lite3cpp::Buffer target = before;
+  start = std::chrono::high_resolution_clock::now();
+  lite3cpp::apply_merge_patch(target, patch);
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> apply = end - start;
+
+  std::cout << "benchmark_buffer_diff: to_json x2 " << text.count()
+            << " s, diff " << native.count() << " s (" << patch.ops.size()
+            << " ops), apply " << apply.count() << " s" << std::endl;
+}
+
+// Grafts a 200-member config object under 1000 tenant keys, once through
+// copy_subtree and once by iterating the source and re-inserting each member.
+void benchmark_copy_subtree() {
+  constexpr int fields = 200;
+  constexpr int tenants = 1000;
+  BenchmarkData data(tenants > fields ? tenants : fields);
+  lite3cpp::Buffer src;
+  src.init_object();
+  size_t config = src.set_obj(0, "config");
+  for (int i = 0; i < fields; ++i) {
+    if (i % 2)
+      src.set_i64(config, data.keys[i], i);
+    else
+      src.set_str(config, data.keys[i], data.values[i]);
+  }
+
+  lite3cpp::Buffer grafted;
+  grafted.init_object();
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int t = 0; t < tenants; ++t)
+    grafted.copy_subtree(0, data.keys[t], src, config);
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> block = end - start;
+
+  lite3cpp::Buffer rebuilt;
+  rebuilt.init_object();
+  start = std::chrono::high_resolution_clock::now();
+  for (int t = 0; t < tenants; ++t) {
+    size_t dst = rebuilt.set_obj(0, data.keys[t]);
+    for (auto it = src.begin(config); it != src.end(config); ++it) {
+      if (it->value_type == lite3cpp::Type::Int64)
+        rebuilt.set_i64(dst, it->key, src.get_i64(config, it->key));
+      else
+        rebuilt.set_str(dst, it->key, src.get_str(config, it->key));
+    }
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> reinsert = end - start;
+
+  std::cout << "benchmark_copy_subtree: copy_subtree " << block.count()
+            << " s, iterate+set " << reinsert.count() << " s" << std::endl;
+}
+
+// JSON egress of a mixed document (strings, integers, doubles, nested
+// records) through to_json_string, write_json into a reused string and
+// write_json into a sink.
+void benchmark_json_writer() {
+  constexpr int records = 20000;
+  BenchmarkData data(records);
+  lite3cpp::Buffer buffer;
+  buffer.init_object();
+  for (int i = 0; i < records; ++i) {
+    size_t rec = buffer.set_obj(0, data.keys[i]);
+    buffer.set_str(rec, "name", data.values[i]);
+    buffer.set_str(rec, "note", "line one\nline \"two\" with a longer tail");
+    buffer.set_i64(rec, "id", i);
+    buffer.set_f64(rec, "score", i * 0.37);
+  }
+
+  constexpr int rounds = 20;
+  std::string out;
+  size_t bytes = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r)
+    bytes += lite3cpp::lite3_json::to_json_string(buffer, 0).size();
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> fresh = end - start;
+
+  start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    out.clear();
+    lite3cpp::lite3_json::write_json(buffer, 0, out);
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> reused = end - start;
+
+  size_t streamed = 0;
+  start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r)
+    lite3cpp::lite3_json::write_json(
+        buffer, 0, [&](std::string_view chunk) { streamed += chunk.size(); });
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> sink = end - start;
+
+  double mb = bytes / 1e6;
+  std::cout << "benchmark_json_writer: " << bytes / rounds
+            << " bytes, to_json_string " << mb / fresh.count()
+            << " MB/s, write_json " << mb / reused.count()
+            << " MB/s, sink " << mb / sink.count() << " MB/s" << std::endl;
+}
+
+// Tracks live and peak bytes of a yyjson document.
+struct CountingAllocator {
+  size_t live = 0;
+  size_t peak = 0;
+
+  static void *alloc(void *ctx, size_t size) {
+    auto *self = static_cast<CountingAllocator *>(ctx);
+    auto *p = static_cast<size_t *>(std::malloc(size + sizeof(size_t) * 2));
+    if (!p)
+      return nullptr;
+    *p = size;
+    self->live += size;
+    self->peak = std::max(self->peak, self->live);
+    return p + 2;
+  }
+  static void *resize(void *ctx, void *ptr, size_t old_size, size_t size) {
+    void *p = alloc(ctx, size);
+    if (p && ptr) {
+      std::memcpy(p, ptr, std::min(old_size, size));
+      release(ctx, ptr);
+    }
+    return p;
+  }
+  static void release(void *ctx, void *ptr) {
+    if (!ptr)
+      return;
+    auto *p = static_cast<size_t *>(ptr) - 2;
+    static_cast<CountingAllocator *>(ctx)->live -= *p;
+    std::free(p);
+  }
+};
+
+// Array of records sized to about `target` bytes of JSON text.
+std::string make_json_payload(size_t target) {
+  std::string json = "[";
+  for (int i = 0; json.size() < target; ++i) {
+    if (i)
+      json += ',';
+    json += "{\"id\":" + std::to_string(i) + ",\"name\":\"user" +
+            std::to_string(i) + "\",\"score\":" + std::to_string(i * 0.37) +
+            ",\"active\":" + (i % 2 ? "true" : "false") +
+            ",\"note\":\"line one\\nline \\\"two\\\"\",\"tags\":[\"a\",\"b\"," +
+            std::to_string(i % 10) + "]}";
+  }
+  return json + "]";
+}
+
+void benchmark_json_parse() {
+  for (size_t target : {10 * 1024, 100 * 1024, 500 * 1024}) {
+    std::string json = make_json_payload(target);
+    int rounds = static_cast<int>(std::max<size_t>(20, 50000000 / json.size()));
+
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t yy_buffer = 0;
+    for (int r = 0; r < rounds; ++r)
+      yy_buffer = lite3cpp::lite3_json::from_json_string(json).capacity();
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> yy = end - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t direct_buffer = 0;
+    for (int r = 0; r < rounds; ++r)
+      direct_buffer = lite3cpp::lite3_json::parse_json(json).capacity();
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> direct = end - start;
+
+    // The yyjson path holds its DOM and the Buffer it is copied into at the
+    // same time; the direct path only ever holds the Buffer.
+    CountingAllocator counter;
+    yyjson_alc alc = {CountingAllocator::alloc, CountingAllocator::resize,
+                      CountingAllocator::release, &counter};
+    yyjson_doc *doc =
+        yyjson_read_opts(json.data(), json.size(), 0, &alc, nullptr);
+    yyjson_doc_free(doc);
+
+    double mb = static_cast<double>(json.size()) * rounds / 1e6;
+    std::cout << "benchmark_json_parse: " << json.size() / 1024
+              << " KB, from_json_string " << mb / yy.count()
+              << " MB/s (peak " << (counter.peak + yy_buffer) / 1024
+              << " KB), parse_json " << mb / direct.count() << " MB/s (peak "
+              << direct_buffer / 1024 << " KB)" << std::endl;
+  }
+}
+
+void benchmark_json_bytes_policy() {
+  // String-heavy records: mostly text, some hex-looking ids, one marked
+  // binary field each.
+  std::string json = "[";
+  std::vector<std::string> strings;
+  for (int i = 0; i < 20000; ++i) {
+    char id[32];
+    snprintf(id, sizeof(id), "%08x", i * 2654435761u);
+    std::string rec[] = {"user" + std::to_string(i), "Some longer description text",
+                         "active", id, "hex:deadbeef", "b64:3q2+7w=="};
+    json += i ? ",[" : "[";
+    for (size_t k = 0; k < std::size(rec); ++k) {
+      json += (k ? ",\"" : "\"") + rec[k] + "\"";
+      strings.push_back(rec[k]);
+    }
+    json += "]";
+  }
+  json += "]";
+
+  // Cost of recognising Bytes alone: the old throwing decode against the
+  // policy check, over the same strings.
+  auto start = std::chrono::high_resolution_clock::now();
+  size_t hits = 0;
+  for (const std::string &s : strings) {
+    try {
+      hits += lite3cpp::utils::hex_decode(s).size() != 0;
+    } catch (const std::runtime_error &) {
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> throwing = end - start;
+  lite3cpp::lite3_json::ImportPolicy heuristic;
+  std::vector<std::byte> scratch;
+  hits = 0;
+  start = std::chrono::high_resolution_clock::now();
+  for (const std::string &s : strings)
+    hits += heuristic.decode_bytes(s, scratch);
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> checked = end - start;
+  std::cout << "benchmark_json_bytes_policy: detect " << strings.size()
+            << " strings, throwing " << throwing.count() * 1e3
+            << " ms, non-throwing " << checked.count() * 1e3 << " ms ("
+            << hits << " hits)" << std::endl;
+
+  constexpr int rounds = 10;
+  const std::pair<const char *, lite3cpp::lite3_json::BytesEncoding>
+      policies[] = {{"none", lite3cpp::lite3_json::BytesEncoding::None},
+                    {"prefixed", lite3cpp::lite3_json::BytesEncoding::Prefixed},
+                    {"hex", lite3cpp::lite3_json::BytesEncoding::Hex}};
+  double mb = static_cast<double>(json.size()) * rounds / 1e6;
+  for (const auto &[name, encoding] : policies) {
+    lite3cpp::lite3_json::ImportPolicy policy{encoding};
+    start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; ++r)
+      lite3cpp::lite3_json::from_json_string(json, policy);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> yy = end - start;
+    start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; ++r)
+      lite3cpp::lite3_json::parse_json(json, policy);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> direct = end - start;
+    std::cout << "benchmark_json_bytes_policy: " << name
+              << ", from_json_string " << mb / yy.count()
+              << " MB/s, parse_json " << mb / direct.count() << " MB/s"
+              << std::endl;
+  }
+}
+
+void benchmark_json_bytes_export() {
+  // Hash- and thumbnail-sized blobs.
+  lite3cpp::Buffer buffer;
+  buffer.init_array();
+  std::mt19937 rng(7);
+  size_t blob_bytes = 0;
+  for (int i = 0; i < 64; ++i) {
+    std::vector<std::byte> blob(size_t(4096) << (i % 5));
+    for (auto &b : blob)
+      b = static_cast<std::byte>(rng());
+    blob_bytes += blob.size();
+    buffer.arr_append_bytes(0, blob);
+  }
+
+  // The per-byte snprintf loop the yyjson exporter used.
+  constexpr int rounds = 20;
+  auto start = std::chrono::high_resolution_clock::now();
+  size_t naive_bytes = 0;
+  for (int r = 0; r < rounds; ++r) {
+    for (uint32_t i = 0; i < 64; ++i) {
+      auto blob = buffer.arr_get_bytes(0, i);
+      std::string hex;
+      char tmp[3];
+      for (std::byte b : blob) {
+        snprintf(tmp, sizeof(tmp), "%02x", static_cast<unsigned>(b));
+        hex += tmp;
+      }
+      naive_bytes += hex.size();
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> naive = end - start;
+
+  std::string out;
+  start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    out.clear();
+    lite3cpp::lite3_json::write_json(buffer, 0, out);
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> hex = end - start;
+
+  lite3cpp::lite3_json::WriteOptions b64{
+      lite3cpp::lite3_json::BytesEncoding::Prefixed};
+  start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    out.clear();
+    lite3cpp::lite3_json::write_json(buffer, 0, out, b64);
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> base64 = end - start;
+
+  double ns = 1e9 / (static_cast<double>(blob_bytes) * rounds);
+  std::cout << "benchmark_json_bytes_export: " << blob_bytes / 1024
+            << " KB of blobs, snprintf " << naive.count() * ns
+            << " ns/byte, hex " << hex.count() * ns << " ns/byte, base64 "
+            << base64.count() * ns << " ns/byte" << std::endl;
+  if (naive_bytes != 2 * blob_bytes * rounds)
+    std::cerr << "benchmark_json_bytes_export: size mismatch" << std::endl;
+}
+
+void benchmark_ndjson_ingest() {
+  std::string text;
+  for (int i = 0; text.size() < 64 * 1024 * 1024; ++i)
+    text += "{\"ts\":" + std::to_string(1700000000 + i) +
+            ",\"level\":\"info\",\"user\":\"user" + std::to_string(i % 997) +
+            "\",\"latency\":" + std::to_string(i % 1000 * 0.25) +
+            ",\"msg\":\"request handled\",\"tags\":[\"api\",\"v2\"]}\n";
+  double mb = text.size() / 1e6;
+
+  // The per-line loop this replaces.
+  auto start = std::chrono::high_resolution_clock::now();
+  size_t lines = 0;
+  for (size_t pos = 0; pos < text.size();) {
+    size_t nl = text.find('\n', pos);
+    lite3cpp::lite3_json::from_json_string(text.substr(pos, nl - pos));
+    pos = nl + 1;
+    ++lines;
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> serial = end - start;
+  std::cout << "benchmark_ndjson_ingest: " << lines << " records, "
+            << "from_json_string per line " << mb / serial.count() << " MB/s"
+            << std::endl;
+
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  double base = 0;
+  for (unsigned threads = 1; threads <= cores; threads *= 2) {
+    for (bool ordered : {true, false}) {
+      lite3cpp::lite3_json::IngestOptions options;
+      options.threads = threads;
+      options.ordered = ordered;
+      std::atomic<uint64_t> checksum{0};
+      start = std::chrono::high_resolution_clock::now();
+      lite3cpp::lite3_json::ingest_ndjson(
+          std::string_view(text),
+          [&](uint64_t, lite3cpp::Buffer &doc) {
+            checksum.fetch_add(doc.get_i64(0, "ts"),
+                               std::memory_order_relaxed);
+          },
+          options);
+      end = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double> d = end - start;
+      double rate = mb / d.count();
+      if (threads == 1 && ordered)
+        base = rate;
+      std::cout << "benchmark_ndjson_ingest: " << threads << " threads, "
+                << (ordered ? "ordered " : "unordered ") << rate
+                << " MB/s (x" << rate / base << ")" << std::endl;
+    }
+    if (threads < cores && threads * 2 > cores)
+      threads = cores / 2;
+  }
+
+  start = std::chrono::high_resolution_clock::now();
+  lite3cpp::Buffer folded = lite3cpp::lite3_json::fold_ndjson(text);
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> fold = end - start;
+  std::cout << "benchmark_ndjson_ingest: fold into one array "
+            << mb / fold.count() << " MB/s, " << folded.size() / 1024 / 1024
+            << " MB buffer" << std::endl;
+}
+
+void benchmark_json_parse_parallel() {
+  std::string json = make_json_payload(64 * 1024 * 1024);
+  double mb = json.size() / 1e6;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  lite3cpp::Buffer serial = lite3cpp::lite3_json::parse_json(json);
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> d = end - start;
+  double base = mb / d.count();
+  std::cout << "benchmark_json_parse_parallel: " << json.size() / 1024 / 1024
+            << " MB array, parse_json " << base << " MB/s" << std::endl;
+
+  start = std::chrono::high_resolution_clock::now();
+  lite3cpp::lite3_json::from_json_string(json);
+  end = std::chrono::high_resolution_clock::now();
+  d = end - start;
+  std::cout << "benchmark_json_parse_parallel: from_json_string "
+            << mb / d.count() << " MB/s" << std::endl;
+
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned threads = 1; threads <= cores; threads *= 2) {
+    lite3cpp::lite3_json::ParallelOptions options;
+    options.threads = threads;
+    start = std::chrono::high_resolution_clock::now();
+    lite3cpp::Buffer parallel =
+        lite3cpp::lite3_json::parse_json_parallel(json, options);
+    end = std::chrono::high_resolution_clock::now();
+    d = end - start;
+    double rate = mb / d.count();
+    std::cout << "benchmark_json_parse_parallel: " << threads << " threads "
+              << rate << " MB/s (x" << rate / base << ")" << std::endl;
+    if (parallel.get_str(parallel.arr_get_obj(0, 123456), "name") !=
+        serial.get_str(serial.arr_get_obj(0, 123456), "name"))
+      std::cerr << "benchmark_json_parse_parallel: mismatch" << std::endl;
+    if (threads < cores && threads * 2 > cores)
+      threads = cores / 2;
+  }
+}
+
+// Writing a large document to a file descriptor, against building the
+// whole text in memory first.
+void benchmark_json_sink_output() {
+  lite3cpp::Buffer buffer =
+      lite3cpp::lite3_json::parse_json(make_json_payload(128 * 1024 * 1024));
+
+  auto start = std::chrono::high_resolution_clock::now();
+  std::string text = lite3cpp::lite3_json::to_json_string(buffer, 0);
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> whole = end - start;
+  double mb = text.size() / 1e6;
+  size_t held = text.capacity();
+  text = std::string();
+  std::cout << "benchmark_json_sink_output: to_json_string "
+            << mb / whole.count() << " MB/s, " << held / 1024 / 1024 << " MB held" << std::endl;
+
+  std::FILE *null = std::fopen("/dev/null", "wb");
+  if (!null)
+    throw std::runtime_error("cannot open /dev/null");
+  lite3cpp::lite3_json::FdSink sink(fileno(null));
+  for (unsigned indent : {0u, 2u}) {
+    lite3cpp::lite3_json::WriteOptions options;
+    options.indent = indent;
+    start = std::chrono::high_resolution_clock::now();
+    lite3cpp::lite3_json::write_json(buffer, 0, sink, 64 * 1024, options);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> d = end - start;
+    std::cout << "benchmark_json_sink_output: FdSink "
+              << (indent ? "pretty " : "compact ") << mb / d.count()
+              << " MB/s, 64 KB held" << std::endl;
+  }
+  std::fclose(null);
+}
+
+// Wide records of which a consumer reads a few fields: full parse against
+// a schema projection.
+void benchmark_json_projection() {
+  std::vector<std::string> frames;
+  for (int f = 0; f < 32; ++f) {
+    std::string json = "{";
+    for (int i = 0; i < 200; ++i) {
+      if (i)
+        json += ',';
+      json += "\"field_" + std::to_string(i) + "\":";
+      if (i % 4 == 0)
+        json += std::to_string(f * 1000 + i);
+      else if (i % 4 == 1)
+        json += "\"value " + std::to_string(i) + "\"";
+      else if (i % 4 == 2)
+        json += "[1.5,2.5,{\"x\":\"" + std::to_string(f) + "\"}]";
+      else
+        json += "{\"a\":true,\"b\":null,\"c\":\"nested\"}";
+    }
+    frames.push_back(json + "}");
+  }
+  lite3cpp::lite3_json::Schema schema;
+  for (int i = 0; i < 200; i += 14)
+    schema.field("/field_" + std::to_string(i),
+                 i % 4 == 0 ? lite3cpp::lite3_json::FieldType::Int64
+                            : lite3cpp::lite3_json::FieldType::Any);
+  constexpr int messages = 20000;
+
+  int64_t checksum = 0;
+  lite3cpp::lite3_json::Parser parser;
+  lite3cpp::Buffer doc;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < messages; ++i) {
+    parser.parse_into(frames[i % frames.size()], doc);
+    checksum += doc.get_i64(0, "field_0");
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> full = end - start;
+
+  start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < messages; ++i) {
+    parser.parse_into(frames[i % frames.size()], doc, schema);
+    checksum += doc.get_i64(0, "field_0");
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> projected = end - start;
+
+  std::cout << "benchmark_json_projection: full "
+            << full.count() * 1e6 / messages << " us/msg, 15 of 200 fields "
+            << projected.count() * 1e6 / messages << " us/msg, "
+            << doc.size() << " bytes kept" << std::endl;
+  if (checksum == 0)
+    std::cerr << "benchmark_json_projection: no fields read" << std::endl;
+}
+
+// A three-field JSON Patch on a 10000-user document, applied in place
+// against the round trip through text it replaces.
+void benchmark_json_patch() {
+  constexpr int users = 10000;
+  constexpr int rounds = 200;
+  BenchmarkData data(users);
+  lite3cpp::Buffer doc;
+  doc.init_object();
+  size_t list = doc.set_arr(0, "users");
+  for (int i = 0; i < users; ++i) {
+    size_t user = doc.arr_append_obj(list);
+    doc.set_str(user, "name", data.keys[i]);
+    doc.set_str(user, "bio", data.values[i]);
+    doc.set_i64(user, "visits", i);
+  }
+  std::string patch =
+      R"([{"op":"test","path":"/users/4321/visits","value":4321},)"
+      R"({"op":"replace","path":"/users/4321/visits","value":4322},)"
+      R"({"op":"add","path":"/users/17/role","value":"admin"},)"
+      R"({"op":"add","path":"/users/9000/bio","value":"updated"}])";
+  lite3cpp::Buffer parsed = lite3cpp::lite3_json::parse_json(patch);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    lite3cpp::Buffer text_doc = lite3cpp::lite3_json::parse_json(
+        lite3cpp::lite3_json::to_json_string(doc, 0));
+    lite3cpp::apply_json_patch(text_doc, parsed);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> round_trip = end - start;
+
+  // The test op keeps every round seeing the original value.
+  lite3cpp::Buffer target = doc;
+  start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    target.set_i64(target.arr_get_obj(target.get_arr(0, "users"), 4321),
+                   "visits", 4321);
+    lite3cpp::apply_json_patch(target, parsed);
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> native = end - start;
+
+  std::cout << "benchmark_json_patch: round trip "
+            << round_trip.count() * 1e6 / rounds << " us/patch, in place "
+            << native.count() * 1e6 / rounds << " us/patch ("
+            << doc.size() / 1024 << " KB document)" << std::endl;
+}
+
+// Encode and decode throughput of MessagePack against JSON on the same
+// document, and the MessagePack -> JSON text -> buffer path it replaces.
+void benchmark_msgpack() {
+  lite3cpp::Buffer doc =
+      lite3cpp::lite3_json::parse_json(make_json_payload(32 * 1024 * 1024));
+  constexpr int rounds = 5;
+
+  std::vector<uint8_t> packed;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    packed.clear();
+    lite3cpp::lite3_msgpack::write_msgpack(doc, 0, packed);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> encode = end - start;
+  double mb = packed.size() / 1e6;
+
+  lite3cpp::Buffer out;
+  start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r)
+    lite3cpp::lite3_msgpack::parse_msgpack(packed, out);
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> decode = end - start;
+
+  std::string text = lite3cpp::lite3_json::to_json_string(doc, 0);
+  start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r)
+    lite3cpp::lite3_json::parse_json(
+        lite3cpp::lite3_json::to_json_string(out, 0), out);
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> via_json = end - start;
+
+  std::cout << "benchmark_msgpack: " << mb << " MB packed ("
+            << text.size() / 1e6 << " MB as JSON), encode "
+            << mb * rounds / encode.count() << " MB/s, decode "
+            << mb * rounds / decode.count() << " MB/s; decode "
+            << decode.count() * 1e3 / rounds << " ms vs "
+            << via_json.count() * 1e3 / rounds
+            << " ms through JSON text" << std::endl;
+}
+
+// CBOR encode throughput in hash order and in canonical order, decode
+// throughput, and the CBOR -> JSON text -> buffer path it replaces.
+void benchmark_cbor() {
+  lite3cpp::Buffer doc =
+      lite3cpp::lite3_json::parse_json(make_json_payload(32 * 1024 * 1024));
+  constexpr int rounds = 5;
+
+  auto encode = [&](const lite3cpp::lite3_cbor::WriteOptions &options,
+                    std::vector<uint8_t> &out) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+      out.clear();
+      lite3cpp::lite3_cbor::write_cbor(doc, 0, out, options);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+  };
+  std::vector<uint8_t> encoded;
+  double plain = encode({}, encoded);
+  lite3cpp::lite3_cbor::WriteOptions canonical_options;
+  canonical_options.canonical = true;
+  std::vector<uint8_t> canonical_encoded;
+  double canonical = encode(canonical_options, canonical_encoded);
+  double mb = encoded.size() / 1e6;
+
+  lite3cpp::Buffer out;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r)
+    lite3cpp::lite3_cbor::parse_cbor(encoded, out);
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> decode = end - start;
+
+  start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < rounds; ++r)
+    lite3cpp::lite3_json::parse_json(
+        lite3cpp::lite3_json::to_json_string(out, 0), out);
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> via_json = end - start;
+
+  std::cout << "benchmark_cbor: " << mb << " MB encoded ("
+            << canonical_encoded.size() / 1e6 << " MB canonical), encode "
+            << mb * rounds / plain << " MB/s, canonical "
+            << canonical_encoded.size() / 1e6 * rounds / canonical
+            << " MB/s, decode " << mb * rounds / decode.count()
+            << " MB/s; decode " << decode.count() * 1e3 / rounds
+            << " ms vs " << via_json.count() * 1e3 / rounds
+            << " ms through JSON text" << std::endl;
+}
+
+// Per-record get_* reads of three fields of a 500k-record array against
+// to_columns, plus the scan the columns then allow.
+void benchmark_columns() {
+  lite3cpp::Buffer doc =
+      lite3cpp::lite3_json::parse_json(make_json_payload(64 * 1024 * 1024));
+  size_t rows = static_cast<size_t>(
+      lite3cpp::NodeView(
+          reinterpret_cast<const lite3cpp::PackedNodeLayout *>(doc.data()))
+          .size());
+
+  double score_sum = 0;
+  int64_t id_sum = 0;
+  size_t name_bytes = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (uint32_t i = 0; i < rows; ++i) {
+    size_t rec = doc.arr_get_obj(0, i);
+    id_sum += doc.get_i64(rec, "id");
+    score_sum += doc.get_f64(rec, "score");
+    name_bytes += doc.get_str(rec, "name").size();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> per_record = end - start;
+
+  std::vector<lite3cpp::ColumnSpec> fields = {
+      {"/id", lite3cpp::Type::Int64},
+      {"/score", lite3cpp::Type::Float64},
+      {"/name", lite3cpp::Type::String}};
+  start = std::chrono::high_resolution_clock::now();
+  lite3cpp::Columns cols = lite3cpp::to_columns(doc, 0, fields);
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> columnar = end - start;
+
+  start = std::chrono::high_resolution_clock::now();
+  double column_sum = 0;
+  for (double v : cols.columns[1].f64)
+    column_sum += v;
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> scan = end - start;
+
+  std::cout << "benchmark_columns: " << rows << " records, get_* "
+            << per_record.count() * 1e3 << " ms, to_columns "
+            << columnar.count() * 1e3 << " ms, column sum "
+            << scan.count() * 1e3 << " ms" << std::endl;
+  if (column_sum != score_sum || id_sum == 0 || name_bytes == 0)
+    std::cerr << "benchmark_columns: columns disagree" << std::endl;
+}
+
+// CSV import in rows/sec: serial, on every core, and the per-row path it
+// replaces (a JSON string per row, parsed and copied into the array).
+void benchmark_csv_import() {
+  constexpr int rows = 500000;
+  std::string csv = "id,name,score,active,city\n";
+  for (int i = 0; i < rows; ++i)
+    csv += std::to_string(i) + ",user" + std::to_string(i) + "," +
+           std::to_string(i * 0.37) + "," + (i % 2 ? "true" : "false") +
+           ",\"City " + std::to_string(i % 100) + ", Region\"\n";
+
+  auto rate = [&](unsigned threads) {
+    lite3cpp::lite3_csv::CsvOptions options;
+    options.threads = threads;
+    lite3cpp::Buffer out;
+    auto start = std::chrono::high_resolution_clock::now();
+    lite3cpp::lite3_csv::parse_csv(csv, out, options);
+    auto end = std::chrono::high_resolution_clock::now();
+    return rows / std::chrono::duration<double>(end - start).count();
+  };
+  double serial = rate(1);
+  double parallel = rate(0);
+
+  constexpr int json_rows = 50000;
+  lite3cpp::Buffer doc;
+  doc.init_array();
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < json_rows; ++i) {
+    std::string row = "{\"id\":" + std::to_string(i) + ",\"name\":\"user" +
+                      std::to_string(i) + "\",\"score\":" +
+                      std::to_string(i * 0.37) + ",\"active\":" +
+                      (i % 2 ? "true" : "false") + ",\"city\":\"City " +
+                      std::to_string(i % 100) + ", Region\"}";
+    lite3cpp::Buffer parsed = lite3cpp::lite3_json::parse_json(row);
+    doc.copy_subtree(0, "", parsed, 0);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  double per_row =
+      json_rows / std::chrono::duration<double>(end - start).count();
+
+  std::cout << "benchmark_csv_import: " << csv.size() / 1e6 << " MB, serial "
+            << serial / 1e6 << " M rows/s, all cores " << parallel / 1e6
+            << " M rows/s, JSON per row " << per_row / 1e6 << " M rows/s"
+            << std::endl;
+}
+
+// `active && score > 50000 && name starts with "user1"` over an array of
+// records, as a hand-written loop over Value proxies and as a compiled
+// Query, then the matches projected to {id, name} both ways.
+void benchmark_query() {
+  lite3cpp::Document doc(
+      lite3cpp::lite3_json::parse_json(make_json_payload(64 * 1024 * 1024)));
+  const lite3cpp::Buffer &buf = doc.buffer();
+  uint32_t rows = static_cast<uint32_t>(
+      lite3cpp::NodeView(
+          reinterpret_cast<const lite3cpp::PackedNodeLayout *>(buf.data()))
+          .size());
+
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<uint32_t> by_value;
+  lite3cpp::Array root = doc.root_arr();
+  for (uint32_t i = 0; i < rows; ++i) {
+    lite3cpp::Value rec = root[i];
+    if (static_cast<bool>(rec["active"]) &&
+        static_cast<double>(rec["score"]) > 50000.0 &&
+        static_cast<std::string_view>(rec["name"]).starts_with("user1"))
+      by_value.push_back(i);
+  }
+  lite3cpp::Buffer value_out;
+  value_out.init_array();
+  for (uint32_t i : by_value) {
+    lite3cpp::Value rec = root[i];
+    size_t obj = value_out.arr_append_obj(0);
+    value_out.set_i64(obj, "id", static_cast<int64_t>(rec["id"]));
+    value_out.set_str(obj, "name",
+                      static_cast<std::string_view>(rec["name"]));
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> values = end - start;
+
+  start = std::chrono::high_resolution_clock::now();
+  lite3cpp::Query query(lite3cpp::Filter::eq("/active", true) &&
+                            lite3cpp::Filter::gt("/score", 50000.0) &&
+                            lite3cpp::Filter::starts_with("/name", "user1"),
+                        {"/id", "/name"});
+  std::vector<uint32_t> hits = query.matches(buf, 0);
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> filtered = end - start;
+
+  start = std::chrono::high_resolution_clock::now();
+  lite3cpp::Buffer projected = query.project(buf, 0);
+  end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> project = end - start;
+
+  std::cout << "benchmark_query: " << rows << " records, " << hits.size()
+            << " matches, Value loop + copy " << values.count() * 1e3
+            << " ms, Query::matches " << filtered.count() * 1e3
+            << " ms, Query::project " << project.count() * 1e3 << " ms"
+            << std::endl;
+  if (hits != by_value)
+    std::cerr << "benchmark_query: matches disagree" << std::endl;
+}
+
+// A dashboard rollup over 1M records (total, min, max and mean score, and
+// score per region) three ways: get_* per element, aggregate()/group_by()
+// on the buffer, and the same on columns extracted once.
+void benchmark_aggregate() {
+  constexpr int rows = 1000000;
+  std::string csv = "id,region,score,qty\n";
+  for (int i = 0; i < rows; ++i)
+    csv += std::to_string(i) + ",region" + std::to_string(i % 16) + "," +
+           std::to_string((i % 1000) * 0.25) + "," + std::to_string(i % 100) +
+           "\n";
+  lite3cpp::Buffer doc = lite3cpp::lite3_csv::parse_csv(csv);
+  using lite3cpp::AggOp;
+  using clock = std::chrono::high_resolution_clock;
+  auto ms = [](clock::time_point a, clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+  };
+
+  auto start = clock::now();
+  double sum = 0, lo = 1e300, hi = -1e300;
+  std::unordered_map<std::string, double> by_region;
+  for (uint32_t i = 0; i < rows; ++i) {
+    size_t rec = doc.arr_get_obj(0, i);
+    double score = doc.get_f64(rec, "score");
+    sum += score;
+    lo = std::min(lo, score);
+    hi = std::max(hi, score);
+    by_region[std::string(doc.get_str(rec, "region"))] += score;
+  }
+  double per_element = ms(start, clock::now());
+
+  start = clock::now();
+  double direct_sum = 0;
+  for (AggOp op : {AggOp::Sum, AggOp::Min, AggOp::Max, AggOp::Avg})
+    direct_sum += lite3cpp::aggregate(doc, 0, "/score", op).as_double();
+  double direct = ms(start, clock::now()) / 4;
+  start = clock::now();
+  auto groups = lite3cpp::group_by(doc, 0, "/region", "/score", AggOp::Sum);
+  double direct_groups = ms(start, clock::now());
+
+  start = clock::now();
+  std::vector<lite3cpp::ColumnSpec> fields = {
+      {"/region", lite3cpp::Type::String},
+      {"/score", lite3cpp::Type::Float64}};
+  lite3cpp::Columns cols = lite3cpp::to_columns(doc, 0, fields);
+  double extract = ms(start, clock::now());
+
+  start = clock::now();
+  const lite3cpp::Column &score = *cols.find("/score");
+  double column_sum = 0;
+  for (AggOp op : {AggOp::Sum, AggOp::Min, AggOp::Max, AggOp::Avg})
+    column_sum += lite3cpp::aggregate(score, op).as_double();
+  double columnar = ms(start, clock::now());
+  start = clock::now();
+  auto column_groups =
+      lite3cpp::group_by(cols, "/region", "/score", AggOp::Sum);
+  double grouped = ms(start, clock::now());
+
+  std::cout << "benchmark_aggregate: " << rows << " records, get_* loop "
+            << per_element << " ms; on the buffer: aggregate " << direct
+            << " ms each, group_by " << direct_groups
+            << " ms; to_columns once " << extract
+            << " ms, then all four aggregates " << columnar
+            << " ms, group_by " << grouped << " ms" << std::endl;
+  double expected = sum + lo + hi + sum / rows;
+  if (std::abs(direct_sum - expected) > 1e-6 * expected ||
+      std::abs(column_sum - expected) > 1e-6 * expected ||
+      groups.size() != by_region.size() ||
+      column_groups.size() != by_region.size())
+    std::cerr << "benchmark_aggregate: results disagree" << std::endl;
 }
 
 int main() {
@@ -180,5 +1356,117 @@ int main() {
     std::cerr << "benchmark_json_deserialization failed: " << e.what()
               << std::endl;
   }
+  try {
+    benchmark_json_parse_into();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_json_parse_into failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_concurrent_read_scaling();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_concurrent_read_scaling failed: " << e.what()
+              << std::endl;
+  }
+  try {
+    benchmark_ring_routing();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_ring_routing failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_ring_bounded_load();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_ring_bounded_load failed: " << e.what()
+              << std::endl;
+  }
+  try {
+    benchmark_buffer_diff();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_buffer_diff failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_copy_subtree();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_copy_subtree failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_json_writer();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_json_writer failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_json_parse();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_json_parse failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_json_bytes_policy();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_json_bytes_policy failed: " << e.what()
+              << std::endl;
+  }
+  try {
+    benchmark_json_bytes_export();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_json_bytes_export failed: " << e.what()
+              << std::endl;
+  }
+  try {
+    benchmark_ndjson_ingest();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_ndjson_ingest failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_json_parse_parallel();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_json_parse_parallel failed: " << e.what()
+              << std::endl;
+  }
+  try {
+    benchmark_json_sink_output();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_json_sink_output failed: " << e.what()
+              << std::endl;
+  }
+  try {
+    benchmark_json_projection();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_json_projection failed: " << e.what()
+              << std::endl;
+  }
+  try {
+    benchmark_json_patch();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_json_patch failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_msgpack();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_msgpack failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_cbor();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_cbor failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_columns();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_columns failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_csv_import();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_csv_import failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_query();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_query failed: " << e.what() << std::endl;
+  }
+  try {
+    benchmark_aggregate();
+  } catch (const std::exception &e) {
+    std::cerr << "benchmark_aggregate failed: " << e.what() << std::endl;
+  }
   return 0;
 }
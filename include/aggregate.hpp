@@ -0,0 +1,78 @@
+#ifndef LITE3CPP_AGGREGATE_HPP
+#define LITE3CPP_AGGREGATE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "buffer.hpp"
+#include "columns.hpp"
+
+namespace lite3cpp {
+
+enum class AggOp : uint8_t { Count, Sum, Min, Max, Avg };
+
+// The result of an aggregation. Count gives an Int64. Sum, Min and Max
+// give an Int64 when every value was an Int64 and a Float64 otherwise; Avg
+// always gives a Float64. With nothing to aggregate the type is Null
+// (Count gives 0). An Int64 Sum wraps on overflow, but Float64 sums and
+// averages add the Int64 values without wrapping. NaNs are skipped by Min
+// and Max, which give NaN only when every value was one, and carry through
+// Sum and Avg.
+struct AggValue {
+  Type type = Type::Null;
+  int64_t i64 = 0;
+  double f64 = 0;
+  size_t count = 0; // Values aggregated
+
+  double as_double() const {
+    return type == Type::Int64 ? static_cast<double>(i64) : f64;
+  }
+};
+
+// Aggregates the member at `path` (a JSON Pointer relative to the element,
+// as in ColumnSpec) over the elements of the array whose node is at
+// `array_ofs`, in one walk of the array reading values in place. Null and
+// missing members are skipped; Count counts the rest, whatever their type.
+// Throws lite3cpp::exception for a malformed path, or when a value other
+// ops see is not a number, naming the path and the element.
+AggValue aggregate(const Buffer &buffer, size_t array_ofs,
+                   std::string_view path, AggOp op);
+
+// Same over a column from to_columns(), where the values are contiguous:
+// Int64 and Float64 columns are reduced with SSE2 where available, a
+// validity byte (8 rows) at a time, so repeated rollups over an extracted
+// column cost a pass over its values only. Only Count applies to Bool,
+// String and Bytes columns.
+AggValue aggregate(const Column &column, AggOp op);
+
+// One group of group_by(): the elements whose key member holds the same
+// value. Keys group by type and value, so 1 and 1.0 are separate groups;
+// null and missing keys form one Null group.
+struct Group {
+  Type key_type = Type::Null;
+  int64_t key_i64 = 0;  // Int64 keys, and Bool keys as 0 or 1
+  double key_f64 = 0;   // Float64 keys
+  std::string key_str;  // String and Bytes keys
+  AggValue value;
+};
+
+// Groups the elements of the array at `array_ofs` by the scalar at
+// `key_path` and aggregates `agg_path` within each group, in the same
+// walk. Groups come in order of their first element. Throws as
+// aggregate() does, and when a key is an object or array.
+std::vector<Group> group_by(const Buffer &buffer, size_t array_ofs,
+                            std::string_view key_path,
+                            std::string_view agg_path, AggOp op);
+
+// Same over columns extracted by to_columns(), grouping by the column for
+// `key_path` and aggregating the one for `agg_path`. Throws if either was
+// not extracted.
+std::vector<Group> group_by(const Columns &columns, std::string_view key_path,
+                            std::string_view agg_path, AggOp op);
+
+} // namespace lite3cpp
+
+#endif // LITE3CPP_AGGREGATE_HPP
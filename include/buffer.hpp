@@ -1,8 +1,11 @@
 #ifndef LITE3CPP_BUFFER_HPP
 #define LITE3CPP_BUFFER_HPP
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
@@ -15,15 +18,35 @@
 
 namespace lite3cpp {
 
+class EpochManager;
+class DigestTable;
+struct Patch;
+class Builder;
+
+// Storage pointer and size as published to lock-free readers. A published
+// view is never modified, only replaced.
+struct StorageView {
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+};
+
 class Buffer {
 public:
   Buffer();
   explicit Buffer(size_t initial_size);
   explicit Buffer(std::vector<uint8_t> data);
+  Buffer(const Buffer &other);
+  Buffer(Buffer &&other) noexcept;
+  Buffer &operator=(const Buffer &other);
+  Buffer &operator=(Buffer &&other);
 
   void init_object();
   void init_array();
 
+  // Drops all contents but keeps the allocation, so the buffer can be
+  // rebuilt without touching the allocator.
+  void clear();
+
   void set_null(size_t ofs, std::string_view key);
   void set_bool(size_t ofs, std::string_view key, bool value);
   void set_i64(size_t ofs, std::string_view key, int64_t value);
@@ -34,6 +57,25 @@ public:
   size_t set_obj(size_t ofs, std::string_view key);
   size_t set_arr(size_t ofs, std::string_view key);
 
+  // Copies the object or array whose node is at `src_ofs` in `src` into
+  // member `key` of the object at `dst_ofs`, or appends it to the array at
+  // `dst_ofs` (`key` is then ignored). When the source subtree occupies a
+  // mostly live byte range it is copied as one block and its child and kv
+  // offsets are shifted by the constant distance it moved; otherwise it is
+  // rebuilt entry by entry. Returns the offset of the new node.
+  size_t copy_subtree(size_t dst_ofs, std::string_view key, const Buffer &src,
+                      size_t src_ofs);
+
+  // Removes `key` from the object at `ofs`; returns false when absent. Nodes
+  // are not rebalanced and the entry's bytes stay behind until the buffer is
+  // rebuilt.
+  bool remove(size_t ofs, std::string_view key);
+
+  // Removes element `index` of the array at `ofs` and renumbers the ones
+  // after it; returns false when out of range. Only the nodes holding later
+  // indices are touched (with digests enabled the array is re-hashed).
+  bool arr_remove(size_t ofs, uint32_t index);
+
   void arr_append_null(size_t ofs);
   void arr_append_bool(size_t ofs, bool value);
   void arr_append_i64(size_t ofs, int64_t value);
@@ -61,18 +103,40 @@ public:
   Type arr_get_type(size_t ofs, uint32_t index) const;
   Type get_type(size_t ofs, std::string_view key) const;
 
-  // Access to raw data (read-only)
-  const uint8_t *data() const { return m_data.data(); }
-  size_t size() const { return m_data.size(); }
-  void reserve(size_t capacity) { m_data.reserve(capacity); }
+  // Access to raw data (read-only). Both come from the published view, so
+  // they are safe to call from ConcurrentBuffer readers.
+  const uint8_t *data() const { return view()->data; }
+  size_t size() const { return view()->size; }
+  // Growth stays inside the reserved capacity, so a buffer reserved to its
+  // final size is written without reallocating.
+  void reserve(size_t capacity);
   size_t capacity() const { return m_data.capacity(); }
 
   Iterator begin(size_t ofs) const;
   Iterator end(size_t ofs) const;
 
+  // Merkle digests for anti-entropy (see digest.hpp). Off by default;
+  // enable_digests() hashes the current contents once and every later
+  // set/append keeps them current along the path it already walks.
+  void enable_digests();
+  // Drops the digest table; later writes no longer keep digests.
+  void disable_digests();
+  bool digests_enabled() const { return m_digests.table != nullptr; }
+  // Digest of the object or array whose node is at `ofs`. Equal contents
+  // give equal digests regardless of insertion order or tree shape.
+  uint64_t digest(size_t ofs = 0) const;
+  const DigestTable *digest_table() const { return m_digests.table.get(); }
+
 private:
   friend class Iterator;
   friend class Value;
+  friend class ConcurrentBuffer;
+  friend class Builder;
+  friend Patch diff(const Buffer &from, const Buffer &to);
+  friend void apply_merge_patch(Buffer &target, const Patch &patch);
+  friend std::optional<size_t> resolve_pointer(const Buffer &buffer,
+                                               std::string_view pointer);
+  friend void apply_json_patch(Buffer &target, const Buffer &patch);
 
   // Internal implementation of set operations (C-style logic)
   // Returns the offset of the value data in the buffer
@@ -83,6 +147,15 @@ private:
   // Helper to ensure buffer has enough space for additional bytes + alignment
   // Returns pointer to current data (invalidated on resize)
   void ensure_capacity(size_t required_bytes);
+  // Swaps in `storage` as the raw buffer. The old storage is retired to the
+  // reclaimer when one is attached, and freed otherwise.
+  void replace_storage(std::vector<uint8_t> storage);
+  // Publishes m_data's current pointer and size to readers. Called after
+  // every change to either.
+  void publish();
+  const StorageView *view() const {
+    return m_view.ptr.load(std::memory_order_acquire);
+  }
 
   // Splits a full child node
   void split_child(size_t parent_ofs, int index, size_t child_ofs);
@@ -93,12 +166,89 @@ private:
   // These are kept from the original private section
   void arr_append_impl(size_t ofs, size_t val_len, const void *val_ptr,
                        Type type);
+  // Looks up `key` (an index when `is_array_op`) in the container at `ofs`
+  // and returns its payload, or nullptr when absent. Offsets are resolved
+  // against one snapshot of the storage, returned through `base`, and
+  // checked against its size, so a lookup racing a writer ends in a miss
+  // rather than an out-of-bounds read.
   const std::byte *get_impl(size_t ofs, std::string_view key, uint32_t hash,
-                            Type &type, bool is_array_op = false) const;
-  const std::byte *arr_get_impl(size_t ofs, uint32_t index, Type &type) const;
+                            Type &type, bool is_array_op = false,
+                            const uint8_t **base = nullptr) const;
+  const std::byte *arr_get_impl(size_t ofs, uint32_t index, Type &type,
+                                const uint8_t **base = nullptr) const;
+
+  // Copies the value whose type byte is at `src_vo` in the buffer image `src`
+  // into member `key` of the object at `ofs`, or element `index` of the
+  // array at `ofs` (index == size appends). Containers are copied entry by
+  // entry. `src` must not alias this buffer. Returns the new type offset.
+  size_t copy_value(size_t ofs, std::string_view key, uint32_t index,
+                    const uint8_t *src, size_t src_vo);
+  // Copies every entry of the container whose node is at `src_node` in `src`
+  // into the empty container of the same kind at `ofs`.
+  void copy_entries(size_t ofs, const uint8_t *src, size_t src_node);
+  // As copy_value into the array at `ofs`, but an `index` below its size
+  // inserts before that element instead of overwriting it.
+  size_t arr_insert_value(size_t ofs, uint32_t index, const uint8_t *src,
+                          size_t src_vo);
+  // Replaces the whole document with a copy of the container whose type
+  // byte is at `src_vo` in `src`. Digests stay enabled if they were.
+  void assign_root(const uint8_t *src, size_t src_vo);
+
+  // Removes the entry matching `key`/`hash` (an index for arrays) from the
+  // container at `ofs`; array sizes and later indices are left to the
+  // caller.
+  bool remove_impl(size_t ofs, std::string_view key, uint32_t hash,
+                   bool is_array);
+  // Adds `delta` to the index of every element from `from` on in the array
+  // at `ofs`. Order is kept, so only node hashes change.
+  void arr_renumber(size_t ofs, uint32_t from, int32_t delta);
+
+  // Digest maintenance, only called while digests are enabled.
+  uint64_t digest_rebuild(size_t container_ofs, size_t node_ofs,
+                          bool is_array);
+  void digest_split(size_t node_ofs, size_t sibling_ofs, size_t median_kv,
+                    uint32_t median_hash, bool is_array);
+  void digest_commit(const size_t *path, int path_depth, size_t container_ofs,
+                     size_t kv_ofs, uint32_t key_hash, bool is_array,
+                     uint64_t old_entry);
+  void digest_propagate(const size_t *path, int path_depth,
+                        size_t container_ofs, uint64_t delta);
 
   std::vector<uint8_t> m_data; // The raw buffer
   size_t m_used_size;          // Currently used bytes
+
+  // Set while owned by a ConcurrentBuffer: storage released by growth is
+  // retired here instead of freed, since lock-free readers may still hold it.
+  // Bound to the owning object, so copies and assignments leave it alone.
+  struct ReclaimerRef {
+    EpochManager *ptr = nullptr;
+    ReclaimerRef() = default;
+    ReclaimerRef(const ReclaimerRef &) {}
+    ReclaimerRef &operator=(const ReclaimerRef &) { return *this; }
+  } m_reclaimer;
+
+  // What readers see of m_data. Without a reclaimer there are no concurrent
+  // readers and `local` is updated in place; with one, every change gets a
+  // fresh heap view and the previous one is retired like old storage.
+  struct ViewRef {
+    std::atomic<const StorageView *> ptr{&local};
+    StorageView local;
+    std::unique_ptr<StorageView> shared;
+    ViewRef() = default;
+    ViewRef(const ViewRef &) = delete;
+    ViewRef &operator=(const ViewRef &) = delete;
+  } m_view;
+
+  // Owned digest side table; copies deep-copy it so replicas diverge safely.
+  struct DigestRef {
+    std::unique_ptr<DigestTable> table;
+    DigestRef();
+    DigestRef(const DigestRef &other);
+    DigestRef(DigestRef &&other) noexcept;
+    DigestRef &operator=(const DigestRef &other);
+    DigestRef &operator=(DigestRef &&other) noexcept;
+    ~DigestRef();
+  } m_digests;
 };
 
 } // namespace lite3cpp
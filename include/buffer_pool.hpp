@@ -0,0 +1,35 @@
+#ifndef LITE3CPP_BUFFER_POOL_HPP
+#define LITE3CPP_BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace lite3cpp {
+
+// Free list of Buffers whose allocations are recycled between documents.
+class BufferPool {
+public:
+  explicit BufferPool(size_t max_pooled = 64, size_t initial_capacity = 0);
+
+  // Returns an empty buffer with digests off, reusing a pooled allocation
+  // when available.
+  Buffer acquire();
+
+  // Hands a buffer back for reuse. Buffers beyond max_pooled are freed.
+  void release(Buffer buf);
+
+  size_t pooled() const;
+
+private:
+  mutable std::mutex m_mutex;
+  std::vector<Buffer> m_free;
+  size_t m_max_pooled;
+  size_t m_initial_capacity;
+};
+
+} // namespace lite3cpp
+
+#endif // LITE3CPP_BUFFER_POOL_HPP
@@ -0,0 +1,119 @@
+#ifndef LITE3CPP_BUILDER_HPP
+#define LITE3CPP_BUILDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace lite3cpp {
+
+// Writes a document into a Buffer front to back from a stream of events, as
+// a parser produces them. Entries are appended as they arrive; when a
+// container ends, its members are sorted by (hash, key) and its B-tree is
+// built bottom-up in one pass, so no member costs a descent from the root.
+// Duplicate keys keep the last value, as repeated set_* calls would.
+//
+//   Builder b(buf);
+//   b.begin_object();
+//   b.key("id");
+//   b.add_i64(7);
+//   b.key("tags");
+//   b.begin_array();
+//   b.add_str("a");
+//   b.end();
+//   b.end();
+class Builder {
+public:
+  // Starts a new document in `out`, dropping its contents but keeping its
+  // allocation. Digests, if enabled on `out`, are rebuilt when the root
+  // container ends.
+  explicit Builder(Buffer &out);
+  // A builder not yet bound to a buffer; reset() binds it.
+  Builder() = default;
+
+  // Starts a new document in `out` as the constructor does, keeping the
+  // working memory grown on earlier documents. Also recovers a builder
+  // left mid-document by an exception.
+  void reset(Buffer &out);
+
+  // The first begin_* opens the root; later ones open a value of the
+  // current container.
+  void begin_object();
+  void begin_array();
+  void end();
+
+  // Names the next value of the current object. Keys are limited to 62
+  // bytes by the one-byte key tag.
+  void key(std::string_view key);
+  // Same, with the key's djb2 hash already known.
+  void key(std::string_view key, uint32_t hash);
+
+  void add_null();
+  void add_bool(bool value);
+  void add_i64(int64_t value);
+  void add_f64(double value);
+  void add_str(std::string_view value);
+  void add_bytes(std::span<const std::byte> value);
+
+  // Open containers; 0 once the root has ended.
+  size_t depth() const { return m_frames.size(); }
+
+  // Appends the elements of `parts`, builders of arrays filled in parallel
+  // whose root is still open, to this builder's open array. Each part's
+  // element data is copied as one block on `threads` threads and its
+  // offsets shifted; a part's buffer is released once copied.
+  void splice(std::span<Builder *const> parts, unsigned threads);
+
+private:
+  struct Member {
+    uint32_t hash; // djb2 of the key, or the array index
+    uint32_t kv_ofs;
+  };
+  struct Frame {
+    size_t node_ofs;
+    size_t first_member;
+    bool is_array;
+  };
+
+  // Appends the type byte of the next value (after the pending key in an
+  // object), records the member and reserves `payload` bytes after it.
+  // Returns the offset of the type byte.
+  size_t begin_value(Type type, size_t payload);
+  void begin_container(Type type);
+  void build(size_t node_ofs, Type type, const Member *members, size_t n);
+
+  // Steps of splice(). A part's element data is everything after its root
+  // node.
+  //
+  // Shifts every offset held inside the part's elements by `delta`, in
+  // place, ready for the copy.
+  void relocate_elements(size_t delta);
+  // Bytes reserve_splice() may take for the part, padding included.
+  size_t splice_size() const;
+  // Grows the buffer once to take `bytes` more plus the tree over
+  // `elements` members of the open array.
+  void reserve(size_t bytes, size_t elements);
+  // Reserves room for the part's element data at an offset congruent to
+  // its current one, keeping split nodes aligned. Returns that offset.
+  size_t reserve_splice(const Builder &part);
+  // Copies the data; disjoint parts may be copied concurrently once all
+  // are reserved.
+  void copy_splice(const Builder &part, size_t block);
+  // Appends the part's elements, moved by `delta`, to the open array.
+  void add_spliced(const Builder &part, size_t delta);
+
+  Buffer *m_buf = nullptr;
+  std::vector<Frame> m_frames;
+  std::vector<Member> m_members;
+  size_t m_key_ofs = SIZE_MAX; // Pending key entry, SIZE_MAX if none
+  uint32_t m_key_hash = 0;
+  bool m_rebuild_digests = false;
+};
+
+} // namespace lite3cpp
+
+#endif // LITE3CPP_BUILDER_HPP
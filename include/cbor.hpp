@@ -0,0 +1,56 @@
+#ifndef LITE3CPP_CBOR_HPP
+#define LITE3CPP_CBOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace lite3cpp::lite3_cbor {
+
+struct WriteOptions {
+  // Deterministic encoding (RFC 8949 section 4.2.1): map keys sorted by
+  // their encoded bytes, which for text keys is shortest first, then
+  // bytewise; floats in the shortest of half, single or double that keeps
+  // the value, and every NaN as f97e00. Equal documents then encode to
+  // equal bytes whatever order their keys were set in. Otherwise keys come
+  // out in the buffer's hash order and floats as doubles.
+  bool canonical = false;
+};
+
+// CBOR reads straight into a Buffer through Builder in one pass, with no
+// JSON in between. Integers, byte strings, text strings, arrays, maps,
+// false, true, null and floats map onto Int64, Bytes, String, Array,
+// Object, Bool, Null and Float64; undefined reads as Null and half and
+// single floats widen to Float64. Indefinite-length strings, arrays and
+// maps are accepted. Tags are dropped and their content read as is. Map
+// keys must be text of at most 62 bytes, and integers outside Int64 and
+// other simple values are rejected. As with parse_json, a document whose
+// root is not a map or array leaves `out` empty. Malformed or truncated
+// input throws lite3cpp::exception naming the offset, leaving `out` empty.
+void parse_cbor(std::span<const uint8_t> data, Buffer &out);
+Buffer parse_cbor(std::span<const uint8_t> data);
+
+// Reads the data item at the front of `data`, one of a sequence of
+// concatenated items (RFC 8742), into `out`. Returns the bytes it took, or
+// 0 when `data` ends before the item does and more input is needed (`out`
+// is then empty).
+size_t read_cbor(std::span<const uint8_t> data, Buffer &out);
+
+// Writes the value at `ofs` (0 for the root container, otherwise the
+// offset of a value's type byte) by walking the B-tree directly, with
+// definite lengths and integers and lengths in their shortest form.
+// Returns the bytes written; throws if `out` is too small.
+size_t write_cbor(const Buffer &buffer, size_t ofs, std::span<uint8_t> out,
+                  const WriteOptions &options = {});
+// Appends to `out`, growing it as needed.
+void write_cbor(const Buffer &buffer, size_t ofs, std::vector<uint8_t> &out,
+                const WriteOptions &options = {});
+std::vector<uint8_t> to_cbor(const Buffer &buffer, size_t ofs = 0,
+                             const WriteOptions &options = {});
+
+} // namespace lite3cpp::lite3_cbor
+
+#endif // LITE3CPP_CBOR_HPP
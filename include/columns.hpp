@@ -0,0 +1,76 @@
+#ifndef LITE3CPP_COLUMNS_HPP
+#define LITE3CPP_COLUMNS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace lite3cpp {
+
+// A column to extract from every element of an array of objects. `path` is
+// a JSON Pointer relative to the element ("/ts", "/geo/lat"). `type` is
+// one of Bool, Int64, Float64, String or Bytes; Invalid infers it from the
+// first value that is not null, and an inferred Int64 column becomes
+// Float64 if a Float64 turns up later.
+struct ColumnSpec {
+  std::string path;
+  Type type = Type::Invalid;
+};
+
+// One column laid out as Arrow lays it out: a validity bitmap and values
+// stored contiguously by type. Only the vector for `type` is filled; null
+// rows hold 0 there (or an empty range).
+struct Column {
+  std::string path;
+  // Null when the type was inferred and every row was null or missing.
+  Type type = Type::Null;
+  size_t null_count = 0;
+  // Bit `row % 8` of byte `row / 8` is set when the row holds a value.
+  std::vector<uint8_t> validity;
+  std::vector<int64_t> i64;
+  std::vector<double> f64;
+  std::vector<uint8_t> bools; // One byte per row, 0 or 1
+  // String and Bytes: row i is data[offsets[i], offsets[i + 1]).
+  std::vector<uint32_t> offsets;
+  std::vector<uint8_t> data;
+
+  bool valid(size_t row) const {
+    return (validity[row >> 3] >> (row & 7)) & 1;
+  }
+  std::string_view str(size_t row) const {
+    return {reinterpret_cast<const char *>(data.data()) + offsets[row],
+            offsets[row + 1] - offsets[row]};
+  }
+  std::span<const std::byte> bytes(size_t row) const {
+    return {reinterpret_cast<const std::byte *>(data.data()) + offsets[row],
+            offsets[row + 1] - offsets[row]};
+  }
+};
+
+struct Columns {
+  size_t rows = 0;
+  std::vector<Column> columns; // In the order they were asked for
+
+  // The column for `path`, or nullptr.
+  const Column *find(std::string_view path) const;
+};
+
+// Extracts `fields` from every element of the array whose node is at
+// `array_ofs` (0 for a root array) in one in-order walk of the array's
+// B-tree. Each element's fields are looked up together: their keys are
+// hashed once and sorted, and one descent of the element's tree resolves
+// them all, visiting each node at most once. A missing member, a null, or
+// an element that is not an object gives a null row. Throws
+// lite3cpp::exception for a malformed path or a value that does not fit
+// its column, naming the path and the element.
+Columns to_columns(const Buffer &buffer, size_t array_ofs,
+                   std::span<const ColumnSpec> fields);
+
+} // namespace lite3cpp
+
+#endif // LITE3CPP_COLUMNS_HPP
@@ -0,0 +1,162 @@
+#ifndef LITE3CPP_CONCURRENT_HPP
+#define LITE3CPP_CONCURRENT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace lite3cpp {
+
+// Epoch-based reclamation for storage retired by a growing Buffer.
+//
+// Readers announce the global epoch they observed in a per-reader slot for
+// the duration of a read. The single writer tags retired storage with the
+// epoch current at retirement and frees it once every active slot has moved
+// past that epoch, so no reader can still hold a pointer into it.
+class EpochManager {
+public:
+  static constexpr size_t default_slots = 128;
+
+  explicit EpochManager(size_t slot_count = default_slots);
+  EpochManager(const EpochManager &) = delete;
+  EpochManager &operator=(const EpochManager &) = delete;
+
+  // RAII reader pin. While alive, storage retired after the pin was taken is
+  // kept alive.
+  class Guard {
+  public:
+    Guard(Guard &&other) noexcept : m_slot(std::exchange(other.m_slot, nullptr)) {}
+    Guard(const Guard &) = delete;
+    Guard &operator=(const Guard &) = delete;
+    ~Guard() {
+      if (m_slot)
+        m_slot->store(0, std::memory_order_release);
+    }
+
+  private:
+    friend class EpochManager;
+    explicit Guard(std::atomic<uint64_t> *slot) : m_slot(slot) {}
+    std::atomic<uint64_t> *m_slot;
+  };
+
+  Guard pin();
+
+  // Writer side. Not thread-safe: callers serialize through the writer.
+  void retire(std::vector<uint8_t> storage);
+  void retire(std::unique_ptr<StorageView> view);
+  void collect();
+
+  size_t retired_count() const { return m_retired.size(); }
+
+private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> epoch{0}; // 0 = idle
+  };
+
+  struct Retired {
+    uint64_t epoch;
+    std::vector<uint8_t> storage;
+    std::unique_ptr<StorageView> view;
+  };
+
+  std::unique_ptr<Slot[]> m_slots;
+  size_t m_slot_count;
+  alignas(64) std::atomic<uint64_t> m_global_epoch{1};
+  std::vector<Retired> m_retired;
+};
+
+// Single-writer / multi-reader wrapper around a Buffer.
+//
+// Writers are serialized and bracket each mutation with an odd/even sequence
+// number. Readers take no lock: they run optimistically, then validate that
+// the sequence number did not move and retry otherwise (seqlock). Growth
+// reallocation retires the old storage through an EpochManager, so a reader
+// racing a resize still walks valid memory.
+//
+// Read callbacks may observe a torn buffer before validation fails; they must
+// only call const Buffer accessors and copy out anything they return, because
+// views into the buffer are not guaranteed to outlive the read.
+class ConcurrentBuffer {
+public:
+  ConcurrentBuffer();
+  explicit ConcurrentBuffer(Buffer buf);
+  ~ConcurrentBuffer();
+  ConcurrentBuffer(const ConcurrentBuffer &) = delete;
+  ConcurrentBuffer &operator=(const ConcurrentBuffer &) = delete;
+
+  template <typename F> auto write(F &&fn) {
+    std::lock_guard<std::mutex> lock(m_writer);
+    WriteScope scope(*this);
+    return fn(m_buffer);
+  }
+
+  template <typename F> auto read(F &&fn) const {
+    using Result = std::invoke_result_t<F &, const Buffer &>;
+    auto guard = m_epochs.pin();
+    while (true) {
+      uint64_t begin = m_seq.load(std::memory_order_acquire);
+      if (begin & 1) {
+        std::this_thread::yield();
+        continue;
+      }
+      try {
+        if constexpr (std::is_void_v<Result>) {
+          fn(static_cast<const Buffer &>(m_buffer));
+          if (validate(begin))
+            return;
+        } else {
+          Result result = fn(static_cast<const Buffer &>(m_buffer));
+          if (validate(begin))
+            return result;
+        }
+      } catch (...) {
+        // Torn reads surface as lookup failures; only a validated read may
+        // report its exception to the caller.
+        if (validate(begin))
+          throw;
+      }
+      m_retries.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  uint64_t sequence() const { return m_seq.load(std::memory_order_acquire); }
+  uint64_t read_retries() const {
+    return m_retries.load(std::memory_order_relaxed);
+  }
+  size_t retired_count() const;
+
+  // Frees retired storage no reader can still reach. Writes do this
+  // implicitly; call it after the last write to release memory early.
+  void reclaim();
+
+private:
+  struct WriteScope {
+    ConcurrentBuffer &owner;
+    uint64_t seq;
+    explicit WriteScope(ConcurrentBuffer &o);
+    ~WriteScope();
+  };
+
+  bool validate(uint64_t begin) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return m_seq.load(std::memory_order_relaxed) == begin;
+  }
+
+  Buffer m_buffer;
+  mutable EpochManager m_epochs;
+  mutable std::mutex m_writer;
+  alignas(64) std::atomic<uint64_t> m_seq{0};
+  alignas(64) mutable std::atomic<uint64_t> m_retries{0};
+};
+
+} // namespace lite3cpp
+
+#endif // LITE3CPP_CONCURRENT_HPP
@@ -0,0 +1,54 @@
+#ifndef LITE3CPP_CSV_HPP
+#define LITE3CPP_CSV_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace lite3cpp::lite3_csv {
+
+struct CsvColumn {
+  std::string name;
+  // Bool, Int64, Float64 or String. Invalid infers each field on its own:
+  // true and false become Bool, integers Int64 (Float64 past its range),
+  // other numbers Float64 (an infinity past the range of a double, zero
+  // below it), and anything else String.
+  Type type = Type::Invalid;
+};
+
+struct CsvOptions {
+  char delimiter = ',';
+  // Whether the first record names the columns. Without a header,
+  // `columns` names them in order.
+  bool header = true;
+  // With a header, types for the columns named here; the rest are
+  // inferred. Without one, every column.
+  std::vector<CsvColumn> columns;
+  unsigned threads = 1;       // Parsing workers; 0 uses every core
+  size_t min_chunk = 1 << 20; // Least input per worker
+};
+
+// Reads RFC 4180 CSV into a root array with one object per record, keyed
+// by column name. Column names are hashed once per file and each record's
+// object is built in bulk by Builder. Fields may be quoted, with "" for a
+// quote inside; a quote anywhere else in a field is an error. An empty
+// unquoted field is null, and blank lines are skipped. Records end at \n
+// or \r\n. With more than one thread, input of at least two min_chunk's
+// worth is cut at record boundaries by a quick scan for quotes and
+// newlines, the pieces are parsed concurrently and the partial arrays are
+// spliced as parse_json_parallel does. Throws lite3cpp::exception naming
+// the offset for malformed input, a record with the wrong number of fields
+// or a field that does not convert to its column's type.
+Buffer parse_csv(std::string_view csv, const CsvOptions &options = {});
+// Same, into `out`, reusing its allocation. `out` is left empty if
+// parsing fails.
+void parse_csv(std::string_view csv, Buffer &out,
+               const CsvOptions &options = {});
+
+} // namespace lite3cpp::lite3_csv
+
+#endif // LITE3CPP_CSV_HPP
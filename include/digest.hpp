@@ -0,0 +1,86 @@
+#ifndef LITE3CPP_DIGEST_HPP
+#define LITE3CPP_DIGEST_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "node.hpp"
+
+namespace lite3cpp {
+
+class Buffer;
+
+// Merkle digests over a Buffer, kept in a side table keyed by node offset.
+//
+// Every entry of an object or array hashes to entry_digest(key, value),
+// where a nested container contributes its own digest as its value. A
+// B-tree node stores the wrapping sum of the entry digests in its subtree,
+// so the sum at a container's root node is the container's digest. Sums
+// commute: the digest depends only on the contents, not on insertion order
+// or split history, and an update only adjusts the nodes on its path plus
+// the chain of enclosing containers.
+class DigestTable {
+public:
+  // Where a nested container hangs in its parent: the parent container's
+  // node, the entry's kv offset and its B-tree hash (djb2 or index).
+  struct Link {
+    uint32_t parent;
+    uint32_t kv_ofs;
+    uint32_t hash;
+  };
+
+  uint64_t subtree(size_t node_ofs) const {
+    auto it = m_sums.find(static_cast<uint32_t>(node_ofs));
+    return it == m_sums.end() ? 0 : it->second;
+  }
+  void set_subtree(size_t node_ofs, uint64_t sum) {
+    m_sums[static_cast<uint32_t>(node_ofs)] = sum;
+  }
+  void add_subtree(size_t node_ofs, uint64_t delta) {
+    m_sums[static_cast<uint32_t>(node_ofs)] += delta;
+  }
+
+  const Link *parent(size_t container_ofs) const {
+    auto it = m_parents.find(static_cast<uint32_t>(container_ofs));
+    return it == m_parents.end() ? nullptr : &it->second;
+  }
+  void set_parent(size_t container_ofs, Link link) {
+    m_parents[static_cast<uint32_t>(container_ofs)] = link;
+  }
+
+  void clear() {
+    m_sums.clear();
+    m_parents.clear();
+  }
+
+private:
+  std::unordered_map<uint32_t, uint64_t> m_sums;
+  std::unordered_map<uint32_t, Link> m_parents;
+};
+
+// Digest of the entry at `kv_ofs`. Object entries hash their key; array
+// elements hash `node_hash`, their index. Nested containers read their
+// digest from `table`.
+uint64_t entry_digest(const uint8_t *base, size_t kv_ofs, bool is_array,
+                      uint32_t node_hash, const DigestTable &table);
+
+// Same, with the digest of a nested container value supplied by the caller
+// (used to re-hash a parent entry when the child's digest changes).
+uint64_t entry_digest_with(const uint8_t *base, size_t kv_ofs, bool is_array,
+                           uint32_t node_hash, uint64_t container_digest);
+
+// Compares two digest-enabled buffers and returns the paths of entries that
+// differ: present on one side only, or holding different values. Paths use
+// JSON Pointer syntax ("/users/3/name"); nested containers that differ are
+// descended rather than reported, so only leaves and type changes appear.
+// Subtrees with equal digests are skipped. Where both replicas have the same
+// B-tree shape the walk follows node digests down to the changes; elsewhere
+// it falls back to a merge of the two subtrees' entries.
+std::vector<std::string> diff_digests(const Buffer &a, const Buffer &b);
+
+} // namespace lite3cpp
+
+#endif // LITE3CPP_DIGEST_HPP
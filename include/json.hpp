@@ -2,12 +2,216 @@
 #define LITE3CPP_JSON_HPP
 
 #include "buffer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace lite3cpp::lite3_json {
 
+    // How JSON strings are recognised as Bytes on import.
+    enum class BytesEncoding : uint8_t {
+        None,     // Every string stays a String.
+        Prefixed, // "hex:<hex>" and "b64:<base64>" become Bytes.
+        Hex,      // Any even-length hex string becomes Bytes (the default).
+    };
+
+    struct ImportPolicy {
+        BytesEncoding bytes = BytesEncoding::Hex;
+
+        // Returns true and fills `out` if `s` is to be stored as Bytes.
+        // Never throws on malformed input; such strings stay Strings.
+        bool decode_bytes(std::string_view s, std::vector<std::byte>& out) const;
+    };
+
+    // Type a schema field is converted to on import.
+    enum class FieldType : uint8_t {
+        Any,     // As parse_json would read it
+        Bool,
+        Int64,   // Integers, integral reals and numeric strings
+        Float64, // Numbers and numeric strings
+        String,  // Strings; numbers keep their text
+        Bytes,   // Strings decoded as the policy's encoding (hex if None)
+        Object,
+        Array,
+    };
+
+    // The fields to keep from each document, compiled once into a tree of
+    // keys with their hashes precomputed.
+    class Schema {
+    public:
+        // Compiled form, walked by the parser.
+        struct Node {
+            std::string key;
+            uint32_t hash = 0;      // djb2 of key, as the Buffer stores it
+            bool selected = false;  // Kept whole, converted to type
+            FieldType type = FieldType::Any;
+            std::string path;       // For error messages
+            std::vector<Node> children;
+
+            const Node* find(std::string_view key) const;
+        };
+
+        // Keeps the value at `path`, a JSON Pointer such as "/user/id"
+        // ("~1" escapes '/', "~0" '~'; "" is the whole document). Arrays
+        // are transparent: "/items/id" keeps "id" in every element of
+        // "items". Objects on the way are kept with only the selected
+        // members. Throws lite3cpp::exception on a malformed path.
+        Schema& field(std::string_view path, FieldType type = FieldType::Any);
+
+        const Node& root() const { return m_root; }
+
+    private:
+        Node m_root;
+    };
+
+    // `ofs` is 0 for the root container, otherwise the offset of a value's
+    // type byte (Iterator::value_type::value_offset).
     std::string to_json_string(const Buffer& buffer, size_t ofs);
-    Buffer from_json_string(const std::string& json_str);
+    Buffer from_json_string(const std::string& json_str,
+                            const ImportPolicy& policy = {});
+
+    // Parses `json` in a single pass straight into a Buffer, without a DOM:
+    // each container's B-tree is built in bulk when it closes. Produces the
+    // same document as from_json_string under the same policy (duplicate
+    // keys keep the last value). Throws lite3cpp::exception with the byte
+    // offset on malformed input.
+    Buffer parse_json(std::string_view json, const ImportPolicy& policy = {});
+
+    // Same, into `out`, reusing its allocation. `out` is left empty if
+    // parsing fails.
+    void parse_json(std::string_view json, Buffer& out,
+                    const ImportPolicy& policy = {});
+
+    // Parses only what `schema` selects. Other members are skipped without
+    // being built, checked only for balanced brackets and closed strings.
+    // Selected values are converted to their field type, null is kept for
+    // any type, and keys are stored with the schema's precomputed hashes.
+    // A value that does not convert throws lite3cpp::exception naming the
+    // field and offset.
+    Buffer parse_json_projected(std::string_view json, const Schema& schema,
+                                const ImportPolicy& policy = {});
+
+    // Parser state kept between documents: the Builder's member stacks and
+    // the string unescape scratch. Parsing a stream of similar documents
+    // into the same Buffer allocates nothing once these have grown to
+    // size. Not thread-safe; keep one per thread.
+    class Parser {
+    public:
+        explicit Parser(const ImportPolicy& policy = {});
+        ~Parser();
+        Parser(Parser&&) noexcept;
+        Parser& operator=(Parser&&) noexcept;
+
+        void set_policy(const ImportPolicy& policy);
+
+        // As parse_json: `out` is reset, keeping its capacity, and left
+        // empty if parsing fails.
+        void parse_into(std::span<const char> json, Buffer& out);
+        // As parse_json_projected.
+        void parse_into(std::span<const char> json, Buffer& out,
+                        const Schema& schema);
+
+    private:
+        struct State;
+        std::unique_ptr<State> m_state;
+    };
+
+    // parse_json into `out` through a Parser kept per thread, so a
+    // per-message loop reusing `out` does not allocate in steady state.
+    // Takes any contiguous text, such as a network frame, without a copy.
+    void parse_json_into(std::span<const char> json, Buffer& out,
+                         const ImportPolicy& policy = {});
+
+    struct ParallelOptions {
+        unsigned threads = 0;        // 0 uses every core
+        size_t min_chunk = 1 << 20;  // Least input per slice
+        ImportPolicy policy;
+    };
+
+    // Same as parse_json, but a root array of at least two min_chunk's
+    // worth of text is split at top-level commas by a quick structural
+    // scan and its slices parsed concurrently, each into a partial buffer.
+    // The partial buffers are then spliced into one by copying each as a
+    // block and shifting its offsets, so no element is inserted twice.
+    // Other documents are parsed serially. Malformed input throws as
+    // parse_json does; the offset is that of the earliest failing slice.
+    Buffer parse_json_parallel(std::string_view json,
+                               const ParallelOptions& options = {});
+
+    // Receives consecutive chunks of JSON text.
+    using JsonSink = std::function<void(std::string_view)>;
+
+    // Destination for streamed JSON text. Each write() hands over the next
+    // pieces of text in order; they are only valid during the call.
+    // Failures are reported by throwing.
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+        virtual void write(const std::string_view* pieces, size_t count) = 0;
+    };
+
+    // Writes to a file descriptor, gathering the pieces into one writev.
+    class FdSink : public Sink {
+    public:
+        explicit FdSink(int fd) : m_fd(fd) {}
+        void write(const std::string_view* pieces, size_t count) override;
+
+    private:
+        int m_fd;
+    };
+
+    class StreamSink : public Sink {
+    public:
+        explicit StreamSink(std::ostream& out) : m_out(out) {}
+        void write(const std::string_view* pieces, size_t count) override;
+
+    private:
+        std::ostream& m_out;
+    };
+
+    // Calls `fn` once per piece.
+    class CallbackSink : public Sink {
+    public:
+        explicit CallbackSink(JsonSink fn) : m_fn(std::move(fn)) {}
+        void write(const std::string_view* pieces, size_t count) override;
+
+    private:
+        JsonSink m_fn;
+    };
+
+    struct WriteOptions {
+        // Hex and None write Bytes as bare hex, which BytesEncoding::Hex
+        // reads back; Prefixed writes "b64:<base64>", a third shorter,
+        // which BytesEncoding::Prefixed reads back.
+        BytesEncoding bytes = BytesEncoding::Hex;
+        // Spaces per nesting level, each member on its own line; 0 writes
+        // compact JSON.
+        unsigned indent = 0;
+    };
+
+    // Writes the value at `ofs` as compact JSON by walking the B-tree
+    // directly: no intermediate DOM and no per-string copies. Non-finite
+    // doubles are written as null.
+    void write_json(const Buffer& buffer, size_t ofs, std::string& out,
+                    const WriteOptions& options = {});
+
+    // Same, handing the text to `sink` in chunks of about `chunk_size`
+    // bytes, so the memory used stays about chunk_size whatever the size
+    // of the document. Strings longer than a chunk are passed through
+    // without copying and Bytes are encoded a chunk at a time.
+    void write_json(const Buffer& buffer, size_t ofs, Sink& sink,
+                    size_t chunk_size = 64 * 1024,
+                    const WriteOptions& options = {});
+    void write_json(const Buffer& buffer, size_t ofs, const JsonSink& sink,
+                    size_t chunk_size = 64 * 1024,
+                    const WriteOptions& options = {});
 
 } // namespace lite3cpp::lite3_json
 
@@ -1,19 +1,27 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
-#include <functional>
-#include <map>
-#include <string>
+#include <span>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
 namespace lite3 {
 
 using NodeID = uint32_t;
 
 // FNV-1a Hash (Stable)
-constexpr uint64_t fnv1a_64(std::string_view s) {
-  uint64_t hash = 14695981039346656037ULL;
+constexpr uint64_t fnv1a_64_append(uint64_t hash, std::string_view s) {
   for (char c : s) {
     hash ^= static_cast<uint64_t>(c);
     hash *= 1099511628211ULL;
@@ -21,50 +29,416 @@ constexpr uint64_t fnv1a_64(std::string_view s) {
   return hash;
 }
 
+constexpr uint64_t fnv1a_64(std::string_view s) {
+  return fnv1a_64_append(14695981039346656037ULL, s);
+}
+
+// A slice of the hash space that changes owner between two ring states.
+// Bounds are inclusive; a key moves when first <= fnv1a_64(key) <= last.
+struct RangeMove {
+  uint64_t first;
+  uint64_t last;
+  NodeID from;
+  NodeID to;
+
+  bool contains(uint64_t hash) const { return first <= hash && hash <= last; }
+};
+
+// Finds the move covering `hash` in a list produced by ConsistentHash::diff
+// (sorted, non-overlapping), or nullptr when that position did not move.
+inline const RangeMove *find_move(std::span<const RangeMove> moves,
+                                  uint64_t hash) {
+  auto it = std::upper_bound(
+      moves.begin(), moves.end(), hash,
+      [](uint64_t h, const RangeMove &m) { return h < m.first; });
+  if (it == moves.begin())
+    return nullptr;
+  --it;
+  return hash <= it->last ? &*it : nullptr;
+}
+
+// Consistent hash ring over virtual nodes.
+//
+// The ring is kept as two parallel arrays (sorted hashes, owners) rather than
+// a node-based map, so a lookup touches a handful of cache lines and the
+// search compiles to conditional moves. With Layout::Eytzinger the hashes are
+// additionally stored in BFS order, which keeps the hot top of the search tree
+// packed together and lets lookups prefetch several levels ahead; this pays
+// off once the ring outgrows the L2 cache.
+//
+// Virtual node positions are fnv1a_64("<node>:<replica>"), as before, so
+// routing is unchanged by the layout.
+//
+// Bounded-load mode (consistent hashing with bounded loads) is opt-in via
+// set_load_bound(). acquire() then caps every node at
+// ceil((1 + epsilon) * (total + 1) * capacity / sum_of_capacities) units and
+// spills a key clockwise to the next position whose node has room; release()
+// returns the unit. get_node() stays stateless. Load tracking is not
+// thread-safe; callers serialize acquire/release.
 class ConsistentHash {
 public:
-  ConsistentHash(int replicas = 100) : replicas_(replicas) {}
+  enum class Layout { Sorted, Eytzinger };
+
+  ConsistentHash(int replicas = 100, Layout layout = Layout::Sorted)
+      : replicas_(replicas), layout_(layout) {}
 
   void add_node(NodeID node_id) {
-    for (int i = 0; i < replicas_; ++i) {
-      std::string vnode_key = std::to_string(node_id) + ":" + std::to_string(i);
-      size_t hash = fnv1a_64(vnode_key);
-      ring_[hash] = node_id;
+    std::vector<std::pair<uint64_t, NodeID>> added;
+    added.reserve(static_cast<size_t>(std::max(replicas_, 0)));
+    for (int i = 0; i < replicas_; ++i)
+      added.emplace_back(vnode_hash(node_id, i), node_id);
+    std::sort(added.begin(), added.end());
+
+    // Merge into the existing ring. On a position collision the node added
+    // last owns the position.
+    std::vector<uint64_t> hashes;
+    std::vector<NodeID> owners;
+    hashes.reserve(hashes_.size() + added.size());
+    owners.reserve(hashes_.size() + added.size());
+    size_t a = 0, b = 0;
+    while (a < hashes_.size() || b < added.size()) {
+      bool take_added =
+          a == hashes_.size() ||
+          (b < added.size() && added[b].first <= hashes_[a]);
+      if (take_added) {
+        uint64_t h = added[b].first;
+        if (a < hashes_.size() && hashes_[a] == h)
+          ++a;
+        if (!hashes.empty() && hashes.back() == h)
+          owners.back() = added[b].second;
+        else {
+          hashes.push_back(h);
+          owners.push_back(added[b].second);
+        }
+        ++b;
+      } else {
+        hashes.push_back(hashes_[a]);
+        owners.push_back(owners_[a]);
+        ++a;
+      }
     }
+    hashes_ = std::move(hashes);
+    owners_ = std::move(owners);
+    if (node_slot_.find(node_id) == node_slot_.end()) {
+      node_slot_.emplace(node_id, static_cast<uint32_t>(nodes_.size()));
+      nodes_.push_back({node_id, 1.0, 0});
+      capacity_sum_ += 1.0;
+    }
+    rebuild();
   }
 
   void remove_node(NodeID node_id) {
-    for (auto it = ring_.begin(); it != ring_.end();) {
-      if (it->second == node_id) {
-        it = ring_.erase(it);
-      } else {
-        ++it;
+    size_t out = 0;
+    for (size_t i = 0; i < hashes_.size(); ++i) {
+      if (owners_[i] == node_id)
+        continue;
+      hashes_[out] = hashes_[i];
+      owners_[out] = owners_[i];
+      ++out;
+    }
+    hashes_.resize(out);
+    owners_.resize(out);
+
+    auto slot = node_slot_.find(node_id);
+    if (slot != node_slot_.end()) {
+      // Units held by the removed node are dropped; its keys re-acquire.
+      uint32_t i = slot->second;
+      total_load_ -= nodes_[i].load;
+      capacity_sum_ -= nodes_[i].capacity;
+      node_slot_.erase(slot);
+      if (i + 1 != nodes_.size()) {
+        nodes_[i] = nodes_.back();
+        node_slot_[nodes_[i].id] = i;
       }
+      nodes_.pop_back();
     }
+    rebuild();
   }
 
   NodeID get_node(std::string_view key) const {
-    if (ring_.empty())
+    if (hashes_.empty())
       return 0;
+    return owner_of(fnv1a_64(key));
+  }
+
+  // Routes a batch of keys; out[i] receives the owner of keys[i]. Searches
+  // for several keys run in lockstep so their cache misses overlap.
+  void get_nodes(std::span<const std::string_view> keys,
+                 std::span<NodeID> out) const {
+    size_t count = std::min(keys.size(), out.size());
+    if (hashes_.empty()) {
+      std::fill(out.begin(), out.begin() + count, NodeID{0});
+      return;
+    }
 
-    size_t hash = fnv1a_64(key);
-    auto it = ring_.lower_bound(hash);
+    constexpr size_t lanes = 8;
+    uint64_t h[lanes];
+    for (size_t i = 0; i < count; i += lanes) {
+      size_t m = std::min(lanes, count - i);
+      for (size_t j = 0; j < m; ++j)
+        h[j] = fnv1a_64(keys[i + j]);
+
+      if (layout_ == Layout::Eytzinger) {
+        for (size_t j = 0; j < m; ++j)
+          out[i + j] = owner_of(h[j]);
+        continue;
+      }
 
-    if (it == ring_.end()) {
-      return ring_.begin()->second;
+      // The branchless search runs a fixed number of steps for a given ring
+      // size, so all lanes advance together.
+      const uint64_t *first = hashes_.data();
+      const uint64_t *base[lanes];
+      for (size_t j = 0; j < m; ++j)
+        base[j] = first;
+      for (size_t n = hashes_.size(); n > 1;) {
+        size_t half = n / 2;
+        for (size_t j = 0; j < m; ++j)
+          base[j] = (base[j][half] < h[j]) ? base[j] + half : base[j];
+        n -= half;
+      }
+      for (size_t j = 0; j < m; ++j) {
+        size_t idx = static_cast<size_t>(base[j] - first) + (*base[j] < h[j]);
+        out[i + j] = owners_[idx == hashes_.size() ? 0 : idx];
+      }
     }
-    return it->second;
+  }
+
+  std::vector<NodeID> get_nodes(std::span<const std::string_view> keys) const {
+    std::vector<NodeID> out(keys.size());
+    get_nodes(keys, std::span<NodeID>(out));
+    return out;
   }
 
   bool is_owner(std::string_view key, NodeID self_id) const {
     return get_node(key) == self_id;
   }
 
-  size_t size() const { return ring_.size(); }
+  size_t size() const { return hashes_.size(); }
+  Layout layout() const { return layout_; }
+
+  // Bounded-load mode. A non-negative epsilon enables it; a node with
+  // capacity factor 2 may hold twice the units of a node with factor 1.
+  void set_load_bound(double epsilon) { epsilon_ = epsilon; }
+  void clear_load_bound() { epsilon_ = -1.0; }
+  bool bounded() const { return epsilon_ >= 0.0; }
+
+  void set_capacity(NodeID node_id, double factor) {
+    auto slot = node_slot_.find(node_id);
+    if (slot == node_slot_.end() || !(factor > 0.0))
+      return;
+    capacity_sum_ += factor - nodes_[slot->second].capacity;
+    nodes_[slot->second].capacity = factor;
+  }
+
+  // Routes one unit of load for `key` and records it against the chosen
+  // node. Without a bound this is get_node() plus bookkeeping.
+  NodeID acquire(std::string_view key) {
+    if (hashes_.empty())
+      return 0;
+    size_t i = sorted_index(fnv1a_64(key));
+    if (bounded()) {
+      // Capacity is re-evaluated per call since it scales with total load.
+      // The bounds sum to more than total + 1, so a node with room exists;
+      // the walk is capped at one lap regardless.
+      double scale = (1.0 + epsilon_) * static_cast<double>(total_load_ + 1) /
+                     capacity_sum_;
+      for (size_t step = 0; step < hashes_.size(); ++step) {
+        const NodeState &n = nodes_[pos_slot_[i]];
+        if (static_cast<double>(n.load + 1) <= std::ceil(scale * n.capacity))
+          break;
+        i = run_end_[i]; // Skip the rest of this node's run of positions
+      }
+    }
+    NodeState &n = nodes_[pos_slot_[i]];
+    ++n.load;
+    ++total_load_;
+    return n.id;
+  }
+
+  void release(NodeID node_id) {
+    auto slot = node_slot_.find(node_id);
+    if (slot == node_slot_.end() || nodes_[slot->second].load == 0)
+      return;
+    --nodes_[slot->second].load;
+    --total_load_;
+  }
+
+  uint64_t load(NodeID node_id) const {
+    auto slot = node_slot_.find(node_id);
+    return slot == node_slot_.end() ? 0 : nodes_[slot->second].load;
+  }
+  uint64_t total_load() const { return total_load_; }
+
+  // Hash ranges whose owner differs between `before` and `after`, in hash
+  // order with adjacent ranges of the same (from, to) merged. An empty ring
+  // routes everything to node 0, matching get_node().
+  static std::vector<RangeMove> diff(const ConsistentHash &before,
+                                     const ConsistentHash &after) {
+    std::vector<RangeMove> moves;
+    // Every position of either ring is a breakpoint; between consecutive
+    // breakpoints both rings have a single owner. Walk the union in order.
+    size_t a = 0, b = 0;
+    uint64_t lo = 0;
+    bool done = false;
+    while (!done) {
+      uint64_t hi;
+      bool has_a = a < before.hashes_.size(), has_b = b < after.hashes_.size();
+      if (has_a && (!has_b || before.hashes_[a] <= after.hashes_[b]))
+        hi = before.hashes_[a];
+      else if (has_b)
+        hi = after.hashes_[b];
+      else
+        hi = UINT64_MAX;
+      done = hi == UINT64_MAX;
+
+      // Owner of (previous breakpoint, hi] is the first position >= hi.
+      NodeID from = before.owner_at(a);
+      NodeID to = after.owner_at(b);
+      if (from != to) {
+        if (!moves.empty() && moves.back().last + 1 == lo &&
+            moves.back().from == from && moves.back().to == to)
+          moves.back().last = hi;
+        else
+          moves.push_back({lo, hi, from, to});
+      }
+
+      while (a < before.hashes_.size() && before.hashes_[a] == hi)
+        ++a;
+      while (b < after.hashes_.size() && after.hashes_[b] == hi)
+        ++b;
+      lo = hi + 1;
+    }
+    return moves;
+  }
+
+  // What add_node(node_id) / remove_node(node_id) would move, without
+  // changing this ring.
+  std::vector<RangeMove> plan_add_node(NodeID node_id) const {
+    ConsistentHash next = *this;
+    next.add_node(node_id);
+    return diff(*this, next);
+  }
+
+  std::vector<RangeMove> plan_remove_node(NodeID node_id) const {
+    ConsistentHash next = *this;
+    next.remove_node(node_id);
+    return diff(*this, next);
+  }
 
 private:
+  static uint64_t vnode_hash(NodeID node_id, int replica) {
+    // Hashes "<node_id>:<replica>" without materializing the string.
+    char buf[16];
+    auto r = std::to_chars(buf, buf + sizeof(buf), node_id);
+    uint64_t h = fnv1a_64(std::string_view(buf, static_cast<size_t>(r.ptr - buf)));
+    h = fnv1a_64_append(h, ":");
+    r = std::to_chars(buf, buf + sizeof(buf), replica);
+    return fnv1a_64_append(h,
+                           std::string_view(buf, static_cast<size_t>(r.ptr - buf)));
+  }
+
+  // Owner for sorted index i, where i == size() wraps to the first position.
+  NodeID owner_at(size_t i) const {
+    if (owners_.empty())
+      return 0;
+    return owners_[i == owners_.size() ? 0 : i];
+  }
+
+  static void prefetch(const void *p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char *>(p), _MM_HINT_T0);
+#else
+    (void)p;
+#endif
+  }
+
+  // Index of the first position >= hash in sorted order, wrapping to 0.
+  size_t sorted_index(uint64_t hash) const {
+    const uint64_t *first = hashes_.data();
+    const uint64_t *base = first;
+    for (size_t n = hashes_.size(); n > 1;) {
+      size_t half = n / 2;
+      base = (base[half] < hash) ? base + half : base;
+      n -= half;
+    }
+    size_t idx = static_cast<size_t>(base - first) + (*base < hash);
+    return idx == hashes_.size() ? 0 : idx;
+  }
+
+  NodeID owner_of(uint64_t hash) const {
+    if (layout_ == Layout::Sorted)
+      return owners_[sorted_index(hash)];
+
+    // Eytzinger descent: go right while the node is below the hash, then
+    // undo the trailing right turns to land on the lower bound. k == 0 means
+    // every position is below the hash and the ring wraps.
+    const uint64_t *eyt = eyt_hashes_.data();
+    size_t n = hashes_.size();
+    size_t k = 1;
+    while (k <= n) {
+      if (k * 8 <= n)
+        prefetch(eyt + k * 8);
+      k = 2 * k + (eyt[k] < hash);
+    }
+    k >>= std::countr_one(k) + 1;
+    return k == 0 ? owners_[0] : eyt_owners_[k];
+  }
+
+  void rebuild() {
+    pos_slot_.resize(owners_.size());
+    for (size_t i = 0; i < owners_.size(); ++i)
+      pos_slot_[i] = node_slot_.at(owners_[i]);
+    // run_end_[i]: first position clockwise of i with a different owner.
+    // Runs crossing the wrap point stop at position 0.
+    run_end_.resize(owners_.size());
+    for (size_t i = owners_.size(); i-- > 0;) {
+      size_t next = i + 1 == owners_.size() ? 0 : i + 1;
+      run_end_[i] = static_cast<uint32_t>(
+          next != 0 && owners_[next] == owners_[i] ? run_end_[next] : next);
+    }
+
+    eyt_hashes_.clear();
+    eyt_owners_.clear();
+    if (layout_ != Layout::Eytzinger || hashes_.empty())
+      return;
+    // 1-based BFS order; slot 0 is unused.
+    eyt_hashes_.resize(hashes_.size() + 1);
+    eyt_owners_.resize(hashes_.size() + 1);
+    size_t next = 0;
+    fill_eytzinger(1, next);
+  }
+
+  void fill_eytzinger(size_t k, size_t &next) {
+    if (k > hashes_.size())
+      return;
+    fill_eytzinger(2 * k, next);
+    eyt_hashes_[k] = hashes_[next];
+    eyt_owners_[k] = owners_[next];
+    ++next;
+    fill_eytzinger(2 * k + 1, next);
+  }
+
   int replicas_;
-  std::map<size_t, NodeID> ring_; // Hash -> NodeID
+  Layout layout_;
+  std::vector<uint64_t> hashes_; // Sorted vnode positions
+  std::vector<NodeID> owners_;   // owners_[i] owns hashes_[i]
+  std::vector<uint64_t> eyt_hashes_;
+  std::vector<NodeID> eyt_owners_;
+
+  struct NodeState {
+    NodeID id;
+    double capacity;
+    uint64_t load;
+  };
+  std::vector<NodeState> nodes_;
+  std::unordered_map<NodeID, uint32_t> node_slot_; // NodeID -> nodes_ index
+  std::vector<uint32_t> pos_slot_; // pos_slot_[i]: nodes_ index of owners_[i]
+  std::vector<uint32_t> run_end_;
+  double capacity_sum_ = 0.0;
+  uint64_t total_load_ = 0;
+  double epsilon_ = -1.0; // < 0: unbounded
 };
 
 } // namespace lite3
@@ -0,0 +1,41 @@
+#ifndef LITE3CPP_MSGPACK_HPP
+#define LITE3CPP_MSGPACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace lite3cpp::lite3_msgpack {
+
+// MessagePack reads straight into a Buffer through Builder, with no JSON in
+// between. nil, bool, int, float, str, bin, array and map map onto Null,
+// Bool, Int64, Float64, String, Bytes, Array and Object; float32 widens to
+// Float64. Map keys must be strings of at most 62 bytes, and unsigned
+// integers above INT64_MAX and ext types are rejected. As with parse_json,
+// a document whose root is not a map or array leaves `out` empty.
+// Malformed or truncated input throws lite3cpp::exception naming the
+// offset, leaving `out` empty.
+void parse_msgpack(std::span<const uint8_t> data, Buffer &out);
+Buffer parse_msgpack(std::span<const uint8_t> data);
+
+// Reads the value at the front of `data`, one of a stream of concatenated
+// messages, into `out`. Returns the bytes it took, or 0 when `data` ends
+// before the value does and more input is needed (`out` is then empty).
+size_t read_msgpack(std::span<const uint8_t> data, Buffer &out);
+
+// Writes the value at `ofs` (0 for the root container, otherwise the
+// offset of a value's type byte) by walking the B-tree directly. Integers
+// and lengths take their shortest form; objects come out in the buffer's
+// hash order. Returns the bytes written; throws if `out` is too small.
+size_t write_msgpack(const Buffer &buffer, size_t ofs,
+                     std::span<uint8_t> out);
+// Appends to `out`, growing it as needed.
+void write_msgpack(const Buffer &buffer, size_t ofs, std::vector<uint8_t> &out);
+std::vector<uint8_t> to_msgpack(const Buffer &buffer, size_t ofs = 0);
+
+} // namespace lite3cpp::lite3_msgpack
+
+#endif // LITE3CPP_MSGPACK_HPP
@@ -0,0 +1,54 @@
+#ifndef LITE3CPP_NDJSON_HPP
+#define LITE3CPP_NDJSON_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "buffer.hpp"
+#include "json.hpp"
+
+namespace lite3cpp::lite3_json {
+
+struct IngestOptions {
+  unsigned threads = 0;          // Parsing workers; 0 uses every core
+  size_t chunk_size = 1 << 20;   // Input bytes handed to a worker at a time
+  bool ordered = true;           // Deliver records in input order
+  ImportPolicy policy;
+};
+
+struct IngestStats {
+  uint64_t records = 0;
+  uint64_t bytes = 0;
+};
+
+// Receives one parsed record. `offset` is where its line starts in the
+// input. `doc` belongs to the parsing worker and is reused once the call
+// returns. With ordered delivery calls are made one at a time in input
+// order; otherwise workers call concurrently, in any order.
+using RecordConsumer = std::function<void(uint64_t offset, Buffer &doc)>;
+
+// Parses newline-delimited JSON on a pool of workers. The input is cut at
+// newlines into chunks of about chunk_size bytes, and each worker parses
+// whole chunks with its own Parser and Buffer, reused across records.
+// Blank lines are skipped. The first parse error or consumer exception stops the
+// pipeline and is rethrown here; parse errors name the record's offset.
+IngestStats ingest_ndjson(int fd, const RecordConsumer &consumer,
+                          const IngestOptions &options = {});
+IngestStats ingest_ndjson_file(const std::string &path,
+                               const RecordConsumer &consumer,
+                               const IngestOptions &options = {});
+IngestStats ingest_ndjson(std::string_view text,
+                          const RecordConsumer &consumer,
+                          const IngestOptions &options = {});
+
+// Folds every record, in input order, into one array document. Records
+// are grafted whole with Buffer::copy_subtree; scalar lines are dropped.
+Buffer fold_ndjson(int fd, const IngestOptions &options = {});
+Buffer fold_ndjson(std::string_view text, const IngestOptions &options = {});
+
+} // namespace lite3cpp::lite3_json
+
+#endif // LITE3CPP_NDJSON_HPP
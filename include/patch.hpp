@@ -0,0 +1,74 @@
+#ifndef LITE3CPP_PATCH_HPP
+#define LITE3CPP_PATCH_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "buffer.hpp"
+#include "json.hpp"
+
+namespace lite3cpp {
+
+// One change of a Patch. Paths use JSON Pointer syntax ("/users/3/name",
+// "" for the whole document); array indices equal to the array's size
+// append.
+struct PatchOp {
+  enum class Kind : uint8_t { Set, Remove };
+  Kind kind;
+  std::string path;
+  uint32_t value = 0; // Set: element of Patch::values holding the new value
+};
+
+// Compact edit list produced by diff(). New values are kept in lite3 form in
+// `values`, an array buffer, so applying a patch copies bytes instead of
+// re-encoding them.
+struct Patch {
+  std::vector<PatchOp> ops;
+  Buffer values;
+
+  bool empty() const { return ops.empty(); }
+};
+
+// Structural diff of two buffers. Both trees are walked together in their
+// (hash, key) order, so matching entries pair up merge-join style; equal
+// scalars are skipped with a memcmp of their bytes, and when both buffers
+// have digests enabled, containers with equal digests are skipped whole.
+// Objects are diffed member by member. Arrays are diffed element by element
+// while `to` is at least as long; a shrunk array is replaced as a whole.
+Patch diff(const Buffer &from, const Buffer &to);
+
+// Applies `patch` to `target`: Set copies the value into place, creating or
+// overwriting the member or element; Remove deletes an object member.
+// Throws if a path does not resolve. diff(a, b) applied to a copy of `a`
+// yields a buffer equal in content to `b`.
+void apply_merge_patch(Buffer &target, const Patch &patch);
+
+// Resolves an RFC 6901 JSON Pointer. Returns the offset of the value's type
+// byte, 0 for "" (the root container), or nullopt when nothing is there;
+// array tokens must be indices without leading zeros. Throws if `pointer`
+// is neither empty nor starts with '/'.
+std::optional<size_t> resolve_pointer(const Buffer &buffer,
+                                      std::string_view pointer);
+
+// Applies an RFC 6902 JSON Patch, a JSON array of add/remove/replace/move/
+// copy/test operations, directly to `target`: each operation resolves its
+// pointer and edits the entries there, so the cost follows the patched
+// values rather than the document. Inserting into or removing from an
+// array renumbers the elements after the index. The patch text is read
+// with `policy`, which by default keeps every string a String, so values
+// are tested and stored as written; pass the document's policy to have
+// hex strings read as Bytes like its own were. Throws lite3cpp::exception
+// naming the failing operation; the operations before it stay applied, so
+// patch a copy when the change must be all or nothing.
+void apply_json_patch(Buffer &target, std::string_view patch,
+                      const lite3_json::ImportPolicy &policy = {
+                          lite3_json::BytesEncoding::None});
+// Same, with the patch already parsed into a buffer.
+void apply_json_patch(Buffer &target, const Buffer &patch);
+
+} // namespace lite3cpp
+
+#endif // LITE3CPP_PATCH_HPP
@@ -0,0 +1,144 @@
+#ifndef LITE3CPP_QUERY_HPP
+#define LITE3CPP_QUERY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "buffer.hpp"
+#include "utils/tree_search.hpp"
+
+namespace lite3cpp {
+
+// A constant a Filter compares members against: null, a bool, an integer
+// (held as Int64), a Float64 or a string.
+class Literal {
+public:
+  Literal(std::nullptr_t) : m_type(Type::Null) {}
+  Literal(bool value) : m_type(Type::Bool), m_bool(value) {}
+  template <typename T>
+    requires(std::is_integral_v<T> && !std::is_same_v<T, bool>)
+  Literal(T value) : m_type(Type::Int64), m_i64(static_cast<int64_t>(value)) {}
+  Literal(double value) : m_type(Type::Float64), m_f64(value) {}
+  Literal(std::string_view value) : m_type(Type::String), m_str(value) {}
+  Literal(const char *value) : Literal(std::string_view(value)) {}
+  Literal(const std::string &value) : Literal(std::string_view(value)) {}
+
+  Type type() const { return m_type; }
+
+private:
+  friend class Query;
+
+  Type m_type;
+  bool m_bool = false;
+  int64_t m_i64 = 0;
+  double m_f64 = 0;
+  std::string m_str;
+};
+
+// A condition on the members of an object, named by JSON Pointers relative
+// to it ("/status", "/geo/lat"):
+//
+//   auto active = Filter::eq("/status", "active") &&
+//                 Filter::gt("/score", 0.7);
+//
+// Int64 and Float64 members compare by numeric value, strings bytewise and
+// bools with false before true; a comparison between other types, or with
+// a missing member, is false, except that ne is always the negation of eq
+// and eq(path, nullptr) matches null and missing members alike.
+class Filter {
+public:
+  static Filter eq(std::string_view path, Literal value);
+  static Filter ne(std::string_view path, Literal value);
+  static Filter lt(std::string_view path, Literal value);
+  static Filter le(std::string_view path, Literal value);
+  static Filter gt(std::string_view path, Literal value);
+  static Filter ge(std::string_view path, Literal value);
+  // Equal to one of `values`.
+  static Filter in(std::string_view path, std::vector<Literal> values);
+  // A string starting with `prefix`.
+  static Filter starts_with(std::string_view path, std::string_view prefix);
+
+  friend Filter operator&&(Filter lhs, Filter rhs);
+  friend Filter operator||(Filter lhs, Filter rhs);
+  friend Filter operator!(Filter filter);
+
+private:
+  friend class Query;
+
+  enum class Op : uint8_t { Eq, Ne, Lt, Le, Gt, Ge, In, Prefix, And, Or, Not };
+  struct Node {
+    Op op;
+    std::string path;
+    std::vector<Literal> values;
+    std::shared_ptr<const Node> lhs, rhs;
+  };
+
+  explicit Filter(std::shared_ptr<const Node> node) : m_node(std::move(node)) {}
+
+  std::shared_ptr<const Node> m_node;
+};
+
+// A Filter compiled for scanning arrays of objects, with an optional
+// projection. Every path is split and its members hashed once here; each
+// element then has the filter's first members resolved together by one
+// descent of its B-tree and the condition evaluated on the bytes in place,
+// with no Value proxies, exceptions or allocations per field. `in` lists
+// are sorted once and searched by bisection. Throws lite3cpp::exception for
+// a malformed path, or selected members that would share a name.
+class Query {
+public:
+  // `select` lists the members (JSON Pointers) project() keeps, each under
+  // its last name; empty keeps whole elements.
+  explicit Query(const Filter &where, std::vector<std::string> select = {});
+
+  // Indexes of the elements of the array whose node is at `array_ofs` (0
+  // for a root array) that match, in order. Elements that are not objects
+  // match only conditions that hold for missing members.
+  std::vector<uint32_t> matches(const Buffer &buffer, size_t array_ofs) const;
+
+  // The matching elements, projected, as a root array built in one pass by
+  // Builder. Selected members an element lacks are left out of its object.
+  Buffer project(const Buffer &buffer, size_t array_ofs) const;
+  // Same, into `out`, reusing its allocation.
+  void project(const Buffer &buffer, size_t array_ofs, Buffer &out) const;
+
+private:
+  // The filter flattened in preorder. A step's operands follow it: the
+  // first at the next step, the second at the first's `end`.
+  struct Step {
+    Filter::Op op;
+    uint32_t path = 0; // Into m_where
+    uint32_t end = 0;  // One past the step's subtree
+    Literal value = nullptr;
+    // For In: the literals by type, sorted.
+    std::vector<int64_t> ints;
+    std::vector<double> reals;
+    std::vector<std::string> strings;
+    bool null = false, no = false, yes = false;
+  };
+
+  // -1, 0 or 1 as the value at `vo` (0 for none) orders before, equal to
+  // or after `literal`; 2 when they do not compare.
+  static int compare(const uint8_t *base, size_t vo, const Literal &literal);
+
+  void compile(const Filter::Node &node);
+  bool eval(const uint8_t *base, const size_t *found, uint32_t i) const;
+  bool in(const Step &step, const uint8_t *base, size_t vo) const;
+  template <typename F>
+  void scan(const Buffer &buffer, size_t array_ofs, F &&fn) const;
+
+  std::vector<Step> m_steps;
+  utils::PathSet m_where;
+  utils::PathSet m_select;
+  std::vector<std::string> m_names; // Last member of each selected path
+  std::vector<uint32_t> m_name_hashes;
+};
+
+} // namespace lite3cpp
+
+#endif // LITE3CPP_QUERY_HPP
@@ -0,0 +1,56 @@
+#ifndef LITE3CPP_REBALANCE_HPP
+#define LITE3CPP_REBALANCE_HPP
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "buffer.hpp"
+#include "exception.hpp"
+#include "lite3/ring.hpp"
+
+namespace lite3cpp {
+
+// A key of a lite3 object that changes owner under a membership change.
+struct MovedKey {
+  std::string_view key; // Points into the buffer
+  size_t value_offset;  // Offset of the value's type byte
+  Type type;
+  lite3::NodeID from;
+  lite3::NodeID to;
+};
+
+// Calls fn(const MovedKey&) for every key of the object at `ofs` whose
+// fnv1a_64 position falls inside one of `moves`, as produced by
+// lite3::ConsistentHash::diff / plan_add_node / plan_remove_node. Keys that
+// stay put are skipped, so callers only serialize and ship moved entries.
+template <typename F>
+void for_each_moved_key(const Buffer &buf, size_t ofs,
+                        std::span<const lite3::RangeMove> moves, F &&fn) {
+  if (moves.empty() || buf.size() == 0)
+    return;
+  NodeView node(reinterpret_cast<const PackedNodeLayout *>(buf.data() + ofs));
+  if (node.type() != Type::Object)
+    throw exception("Type mismatch");
+  for (auto it = buf.begin(ofs); it != buf.end(ofs); ++it) {
+    const lite3::RangeMove *move =
+        lite3::find_move(moves, lite3::fnv1a_64(it->key));
+    if (move)
+      fn(MovedKey{it->key, it->value_offset, it->value_type, move->from,
+                  move->to});
+  }
+}
+
+inline std::vector<MovedKey>
+moved_keys(const Buffer &buf, size_t ofs,
+           std::span<const lite3::RangeMove> moves) {
+  std::vector<MovedKey> out;
+  for_each_moved_key(buf, ofs, moves,
+                     [&](const MovedKey &k) { out.push_back(k); });
+  return out;
+}
+
+} // namespace lite3cpp
+
+#endif // LITE3CPP_REBALANCE_HPP
@@ -0,0 +1,166 @@
+#ifndef LITE3CPP_STORE_HPP
+#define LITE3CPP_STORE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "buffer.hpp"
+#include "buffer_pool.hpp"
+#include "lite3/ring.hpp"
+
+namespace lite3cpp {
+
+struct ShardMetrics {
+  size_t documents = 0;
+  size_t bytes = 0; // Sum of document buffer sizes
+  size_t pooled_buffers = 0;
+  uint64_t gets = 0;
+  uint64_t misses = 0;
+  uint64_t puts = 0;
+  uint64_t updates = 0;
+  uint64_t erases = 0;
+};
+
+// In-process document store that partitions a keyspace of Buffers across
+// shards. Keys are routed through a lite3::ConsistentHash ring; each shard
+// owns a reader/writer lock, its documents and a BufferPool, so operations on
+// different shards never contend.
+class Store {
+public:
+  explicit Store(size_t shard_count = 16, int replicas = 100);
+  Store(const Store &) = delete;
+  Store &operator=(const Store &) = delete;
+
+  size_t shard_count() const { return m_shard_count; }
+  size_t shard_of(std::string_view key) const;
+
+  // Empty buffer from the owning shard's pool, for building a document that
+  // will be put() under `key`.
+  Buffer acquire(std::string_view key);
+
+  // Inserts or replaces a document. A replaced buffer returns to the pool.
+  void put(std::string_view key, Buffer doc);
+  bool erase(std::string_view key);
+  bool contains(std::string_view key) const;
+
+  // Runs fn(const Buffer&) under the shard's shared lock. Returns false when
+  // the key is absent.
+  template <typename F> bool get(std::string_view key, F &&fn) const {
+    const Shard &shard = m_shards[shard_of(key)];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    shard.gets.fetch_add(1, std::memory_order_relaxed);
+    auto it = shard.docs.find(key);
+    if (it == shard.docs.end()) {
+      shard.misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    fn(static_cast<const Buffer &>(it->second));
+    return true;
+  }
+
+  // Runs fn(Buffer&) under the shard's exclusive lock, mutating the
+  // document in place. Returns false when the key is absent.
+  template <typename F> bool update(std::string_view key, F &&fn) {
+    Shard &shard = m_shards[shard_of(key)];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.docs.find(key);
+    if (it == shard.docs.end()) {
+      shard.misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    shard.updates.fetch_add(1, std::memory_order_relaxed);
+    fn(it->second);
+    return true;
+  }
+
+  // Batched variants group keys by shard and take each shard lock once.
+  // The callback receives the key's index in `keys` and the document, or
+  // nullptr (get) when the key is absent; update skips absent keys.
+  template <typename F>
+  void get_batch(std::span<const std::string_view> keys, F &&fn) const {
+    for_each_shard_group(keys, [&](size_t s, const std::vector<size_t> &idx) {
+      const Shard &shard = m_shards[s];
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      shard.gets.fetch_add(idx.size(), std::memory_order_relaxed);
+      for (size_t i : idx) {
+        auto it = shard.docs.find(keys[i]);
+        if (it == shard.docs.end()) {
+          shard.misses.fetch_add(1, std::memory_order_relaxed);
+          fn(i, static_cast<const Buffer *>(nullptr));
+        } else {
+          fn(i, static_cast<const Buffer *>(&it->second));
+        }
+      }
+    });
+  }
+
+  template <typename F>
+  void update_batch(std::span<const std::string_view> keys, F &&fn) {
+    for_each_shard_group(keys, [&](size_t s, const std::vector<size_t> &idx) {
+      Shard &shard = m_shards[s];
+      std::unique_lock<std::shared_mutex> lock(shard.mutex);
+      for (size_t i : idx) {
+        auto it = shard.docs.find(keys[i]);
+        if (it == shard.docs.end()) {
+          shard.misses.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        shard.updates.fetch_add(1, std::memory_order_relaxed);
+        fn(i, it->second);
+      }
+    });
+  }
+
+  void put_batch(std::vector<std::pair<std::string, Buffer>> docs);
+
+  ShardMetrics shard_metrics(size_t shard) const;
+  std::vector<ShardMetrics> metrics() const;
+
+private:
+  struct KeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const {
+      return std::hash<std::string_view>{}(key);
+    }
+  };
+
+  struct alignas(64) Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, Buffer, KeyHash, std::equal_to<>> docs;
+    BufferPool pool;
+    mutable std::atomic<uint64_t> gets{0};
+    mutable std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> puts{0};
+    std::atomic<uint64_t> updates{0};
+    std::atomic<uint64_t> erases{0};
+  };
+
+  template <typename Keys, typename F>
+  void for_each_shard_group(const Keys &keys, F &&fn) const {
+    std::vector<std::vector<size_t>> groups(m_shard_count);
+    for (size_t i = 0; i < keys.size(); ++i)
+      groups[shard_of(keys[i])].push_back(i);
+    for (size_t s = 0; s < m_shard_count; ++s)
+      if (!groups[s].empty())
+        fn(s, groups[s]);
+  }
+
+  size_t m_shard_count;
+  lite3::ConsistentHash m_ring;
+  std::unique_ptr<Shard[]> m_shards;
+};
+
+} // namespace lite3cpp
+
+#endif // LITE3CPP_STORE_HPP
@@ -0,0 +1,26 @@
+#ifndef LITE3CPP_UTILS_BIG_ENDIAN_HPP
+#define LITE3CPP_UTILS_BIG_ENDIAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lite3cpp::utils {
+
+// Network-order integers, as MessagePack and CBOR store them.
+template <typename T> T load_be(const uint8_t* p) {
+    T v = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+        v = static_cast<T>((v << 8) | p[i]);
+    return v;
+}
+
+template <typename T> void store_be(uint8_t* p, T v) {
+    for (size_t i = sizeof(T); i-- > 0;) {
+        p[i] = static_cast<uint8_t>(v);
+        v = static_cast<T>(v >> 8);
+    }
+}
+
+} // namespace lite3cpp::utils
+
+#endif // LITE3CPP_UTILS_BIG_ENDIAN_HPP
@@ -5,6 +5,7 @@
 #include <vector>
 #include <stdexcept>
 #include <cstddef> // For std::byte
+#include <cstdint>
 
 namespace lite3cpp::utils {
 
@@ -12,6 +13,29 @@ namespace lite3cpp::utils {
 // Throws std::runtime_error if the input string is not a valid hex string.
 std::vector<std::byte> hex_decode(std::string_view hex_string);
 
+// Decodes `hex` into `out`, which must hold hex.size() / 2 bytes. Returns
+// false if the length is odd or any character is not a hex digit, in which
+// case `out` holds garbage. Both cases are found without throwing, 16
+// characters at a time where SSE2 is available.
+bool hex_decode(std::string_view hex, std::byte* out) noexcept;
+
+// Upper bound on the bytes base64_decode writes for `n` characters.
+constexpr size_t base64_decoded_max(size_t n) { return n / 4 * 3 + 3; }
+
+// Decodes standard-alphabet base64 into `out`, which must hold
+// base64_decoded_max(b64.size()) bytes. Trailing '=' padding is optional.
+// Returns the decoded length, or SIZE_MAX if the input is not base64.
+size_t base64_decode(std::string_view b64, std::byte* out) noexcept;
+
+// Writes the 2 * n lowercase hex digits of `in` to `out`.
+void hex_encode(const std::byte* in, size_t n, char* out) noexcept;
+
+constexpr size_t base64_encoded_size(size_t n) { return (n + 2) / 3 * 4; }
+
+// Writes the padded standard base64 of `in`, base64_encoded_size(n)
+// characters, to `out`.
+void base64_encode(const std::byte* in, size_t n, char* out) noexcept;
+
 } // namespace lite3cpp::utils
 
-#endif // LITE3CPP_UTILS_HEX_HPP
\ No newline at end of file
+#endif // LITE3CPP_UTILS_HEX_HPP
@@ -0,0 +1,15 @@
+#ifndef LITE3CPP_JSON_SCAN_HPP
+#define LITE3CPP_JSON_SCAN_HPP
+
+#include <cstddef>
+
+namespace lite3cpp::utils {
+
+    // Length of the longest prefix of `p` without '"', '\\' or control
+    // characters (< 0x20), i.e. the bytes a JSON string carries verbatim.
+    // Scans 16 bytes at a time with SSE2 where available.
+    size_t json_plain_prefix(const char* p, size_t n);
+
+} // namespace lite3cpp::utils
+
+#endif // LITE3CPP_JSON_SCAN_HPP
@@ -0,0 +1,46 @@
+#ifndef LITE3CPP_UTILS_PARALLEL_HPP
+#define LITE3CPP_UTILS_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace lite3cpp::utils {
+
+    // Runs fn(0) .. fn(n - 1) on `threads` threads. Once an index throws,
+    // later indexes are skipped and the lowest failing index's exception is
+    // rethrown, so the error reported does not depend on scheduling.
+    template <typename Fn> void run_parallel(unsigned threads, size_t n, Fn fn) {
+        std::vector<std::exception_ptr> errors(n);
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> first_error{SIZE_MAX};
+        auto work = [&] {
+            for (size_t i; (i = next.fetch_add(1)) < n;) {
+                if (i > first_error.load())
+                    continue;
+                try {
+                    fn(i);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                    size_t seen = first_error.load();
+                    while (i < seen && !first_error.compare_exchange_weak(seen, i)) {
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < std::min<size_t>(threads, n); ++t)
+            pool.emplace_back(work);
+        work();
+        for (auto& t : pool)
+            t.join();
+        if (first_error.load() != SIZE_MAX)
+            std::rethrow_exception(errors[first_error.load()]);
+    }
+
+} // namespace lite3cpp::utils
+
+#endif // LITE3CPP_UTILS_PARALLEL_HPP
@@ -0,0 +1,213 @@
+#ifndef LITE3CPP_UTILS_TREE_SEARCH_HPP
+#define LITE3CPP_UTILS_TREE_SEARCH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "exception.hpp"
+#include "node.hpp"
+#include "utils/hash.hpp"
+
+// Read-only lookups straight on a buffer's bytes, for code that scans many
+// records and cannot afford a checked get_* per member.
+namespace lite3cpp::utils {
+
+    struct SearchKey {
+        std::string_view key;
+        uint32_t hash;
+    };
+
+    // A type as error messages name it ("an Int64"). Type::Invalid and
+    // any byte past it read as "invalid".
+    inline const char* type_name(Type type) {
+        static constexpr const char* names[] = {
+            "null",  "a bool",   "an Int64",  "a Float64",
+            "Bytes", "a string", "an object", "an array"};
+        size_t i = static_cast<size_t>(type);
+        return i < std::size(names) ? names[i] : "invalid";
+    }
+
+    // The offset of the value's type byte for the object entry at `kv`.
+    inline size_t value_offset(const uint8_t* base, size_t kv) {
+        return kv + 1 + (base[kv] >> 2);
+    }
+
+    // Orders a node entry against `k` as the B-tree does: by hash, then key.
+    inline int compare_entry(const uint8_t* base, const NodeView& node, int i,
+                             const SearchKey& k) {
+        uint32_t h = node.get_hash(i);
+        if (h != k.hash)
+            return h < k.hash ? -1 : 1;
+        size_t kv = node.get_kv_offset(i);
+        return std::string_view(reinterpret_cast<const char*>(base + kv + 1),
+                                (base[kv] >> 2) - 1)
+            .compare(k.key);
+    }
+
+    // Finds all `n` keys, sorted by (hash, key), in the object whose node is
+    // at `node_ofs`. Each node's entries split the keys between its
+    // children, so a node is visited only when some key can be under it.
+    // Sets out[k] to the value's type offset, leaving 0 for absent keys.
+    inline void multi_get(const uint8_t* base, size_t node_ofs,
+                          const SearchKey* keys, size_t n, size_t* out) {
+        NodeView node(reinterpret_cast<const PackedNodeLayout*>(base + node_ofs));
+        int count = static_cast<int>(node.key_count());
+        size_t k = 0;
+        for (int i = 0; i <= count && k < n; ++i) {
+            // Keys ordered before entry i are in child i.
+            size_t first = k;
+            int c = 1;
+            while (k < n &&
+                   (i == count || (c = compare_entry(base, node, i, keys[k])) > 0))
+                ++k;
+            if (k > first && node.get_child_offset(i))
+                multi_get(base, node.get_child_offset(i), keys + first,
+                          k - first, out + first);
+            if (k < n && c == 0) {
+                out[k] = value_offset(base, node.get_kv_offset(i));
+                ++k;
+            }
+        }
+    }
+
+    // The type offset of member `k` of the object whose node is at
+    // `node_ofs`, or 0.
+    inline size_t find_member(const uint8_t* base, size_t node_ofs,
+                              const SearchKey& k) {
+        size_t vo = 0;
+        multi_get(base, node_ofs, &k, 1, &vo);
+        return vo;
+    }
+
+    // Visits the entries under the B-tree node at `node_ofs` in key order,
+    // calling fn(kv_ofs); for an array that is index order, and kv_ofs is
+    // the element's type offset.
+    template <typename F>
+    void walk_entries(const uint8_t* base, size_t node_ofs, F&& fn) {
+        NodeView node(reinterpret_cast<const PackedNodeLayout*>(base + node_ofs));
+        int count = static_cast<int>(node.key_count());
+        for (int i = 0; i <= count; ++i) {
+            if (node.get_child_offset(i))
+                walk_entries(base, node.get_child_offset(i), fn);
+            if (i < count)
+                fn(node.get_kv_offset(i));
+        }
+    }
+
+    // The member names of a JSON Pointer relative to an element ("/geo/lat"
+    // gives geo, lat). `what` names the path in errors.
+    inline std::vector<std::string> split_pointer(std::string_view path,
+                                                  const char* what) {
+        if (path.empty() || path[0] != '/')
+            throw exception(std::string(what) +
+                            " must name a member: " + std::string(path));
+        std::vector<std::string> keys;
+        size_t pos = 0;
+        while (pos < path.size()) {
+            size_t end = path.find('/', pos + 1);
+            if (end == std::string_view::npos)
+                end = path.size();
+            std::string key;
+            for (size_t i = pos + 1; i < end; ++i) {
+                if (path[i] != '~')
+                    key += path[i];
+                else if (i + 1 < end && (path[i + 1] == '0' || path[i + 1] == '1'))
+                    key += path[++i] == '0' ? '~' : '/';
+                else
+                    throw exception(std::string(what) +
+                                    " has a bad escape: " + std::string(path));
+            }
+            keys.push_back(std::move(key));
+            pos = end;
+        }
+        return keys;
+    }
+
+    // Member paths looked up together in each of many records. The first
+    // members of all paths are hashed once, sorted and deduplicated, so one
+    // multi_get per record resolves them; deeper members are found one by
+    // one.
+    class PathSet {
+    public:
+        PathSet() = default;
+        // m_first views the paths' keys, so a copy gets its own.
+        PathSet(const PathSet& other) : m_paths(other.m_paths) { prepare(); }
+        PathSet& operator=(const PathSet& other) {
+            m_paths = other.m_paths;
+            prepare();
+            return *this;
+        }
+        PathSet(PathSet&&) = default;
+        PathSet& operator=(PathSet&&) = default;
+
+        // Adds a path split into member names; returns its index. Paths may
+        // repeat. prepare() must run before the next resolve().
+        size_t add(std::vector<std::string> keys) {
+            std::vector<uint32_t> hashes;
+            for (const std::string& k : keys)
+                hashes.push_back(djb2_hash(k));
+            m_paths.push_back({std::move(keys), std::move(hashes), 0});
+            return m_paths.size() - 1;
+        }
+
+        void prepare() {
+            m_first.clear();
+            for (const Path& p : m_paths)
+                m_first.push_back({p.keys[0], p.hashes[0]});
+            std::sort(m_first.begin(), m_first.end(), less);
+            m_first.erase(std::unique(m_first.begin(), m_first.end(),
+                                      [](const SearchKey& a, const SearchKey& b) {
+                                          return a.hash == b.hash && a.key == b.key;
+                                      }),
+                          m_first.end());
+            for (Path& p : m_paths)
+                p.slot = static_cast<size_t>(
+                    std::lower_bound(m_first.begin(), m_first.end(),
+                                     SearchKey{p.keys[0], p.hashes[0]}, less) -
+                    m_first.begin());
+        }
+
+        size_t size() const { return m_paths.size(); }
+        // Entries resolve() needs in `out`: one per path, then scratch.
+        size_t width() const { return m_paths.size() + m_first.size(); }
+
+        // Sets out[i] to the type offset of path i in the value whose type
+        // byte is at `vo`, or 0 where the path does not lead to a value.
+        void resolve(const uint8_t* base, size_t vo, size_t* out) const {
+            size_t* found = out + m_paths.size();
+            std::fill(found, found + m_first.size(), 0);
+            if (static_cast<Type>(base[vo]) == Type::Object)
+                multi_get(base, vo + 1, m_first.data(), m_first.size(), found);
+            for (size_t i = 0; i < m_paths.size(); ++i) {
+                const Path& p = m_paths[i];
+                size_t v = found[p.slot];
+                for (size_t k = 1; k < p.keys.size() && v; ++k)
+                    v = static_cast<Type>(base[v]) == Type::Object
+                            ? find_member(base, v + 1, {p.keys[k], p.hashes[k]})
+                            : 0;
+                out[i] = v;
+            }
+        }
+
+    private:
+        struct Path {
+            std::vector<std::string> keys;
+            std::vector<uint32_t> hashes;
+            size_t slot; // Of the first key in m_first
+        };
+
+        static bool less(const SearchKey& a, const SearchKey& b) {
+            return a.hash != b.hash ? a.hash < b.hash : a.key < b.key;
+        }
+
+        std::vector<Path> m_paths;
+        std::vector<SearchKey> m_first; // Views into m_paths
+    };
+
+} // namespace lite3cpp::utils
+
+#endif // LITE3CPP_UTILS_TREE_SEARCH_HPP
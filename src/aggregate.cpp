@@ -0,0 +1,657 @@
+#include "aggregate.hpp"
+#include "exception.hpp"
+#include "node.hpp"
+#include "utils/tree_search.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define LITE3CPP_AGG_SSE2 1
+#endif
+
+namespace lite3cpp {
+
+namespace {
+
+// An Int64 sum that does not wrap: `high` counts multiples of 2^64 on top
+// of `low`. The Int64 result of a Sum is `low`, wrapped as documented;
+// Float64 results (Avg, and Sum over mixed values) use the whole.
+struct WideSum {
+  uint64_t low = 0;
+  int64_t high = 0;
+
+  void add(uint64_t l, int64_t h) {
+    low += l;
+    high += h + (low < l);
+  }
+  void add(int64_t v) { add(static_cast<uint64_t>(v), v < 0 ? -1 : 0); }
+  void add(const WideSum &w) { add(w.low, w.high); }
+
+  int64_t wrapped() const { return static_cast<int64_t>(low); }
+  double to_double() const {
+    // Read `low` as signed so a small negative total stays exact.
+    int64_t l = static_cast<int64_t>(low);
+    int64_t h = high + (l < 0);
+    return std::ldexp(static_cast<double>(h), 64) + static_cast<double>(l);
+  }
+};
+
+// Running state of an aggregation. Int64 and Float64 values are kept
+// apart so that an all-Int64 result stays exact.
+struct Partial {
+  size_t count = 0;
+  size_t reals = 0; // Of `count`, the Float64 values
+  size_t nans = 0;  // Of `reals`, the NaNs
+  WideSum isum;
+  int64_t imin = std::numeric_limits<int64_t>::max();
+  int64_t imax = std::numeric_limits<int64_t>::min();
+  double fsum = 0;
+  double fmin = std::numeric_limits<double>::infinity();
+  double fmax = -std::numeric_limits<double>::infinity();
+
+  void add(int64_t v) {
+    ++count;
+    isum.add(v);
+    imin = std::min(imin, v);
+    imax = std::max(imax, v);
+  }
+  void add(double d) {
+    ++count;
+    ++reals;
+    nans += d != d;
+    fsum += d;
+    // Written so that a NaN changes neither.
+    fmin = d < fmin ? d : fmin;
+    fmax = d > fmax ? d : fmax;
+  }
+  // `n` Int64 values reduced elsewhere.
+  void add_ints(size_t n, const WideSum &sum, int64_t min, int64_t max) {
+    count += n;
+    isum.add(sum);
+    imin = std::min(imin, min);
+    imax = std::max(imax, max);
+  }
+  void add_reals(size_t n, size_t n_nans, double sum, double min,
+                 double max) {
+    count += n;
+    reals += n;
+    nans += n_nans;
+    fsum += sum;
+    fmin = min < fmin ? min : fmin;
+    fmax = max > fmax ? max : fmax;
+  }
+
+  AggValue finish(AggOp op) const {
+    AggValue out;
+    out.count = count;
+    if (op == AggOp::Count) {
+      out.type = Type::Int64;
+      out.i64 = static_cast<int64_t>(count);
+      return out;
+    }
+    if (count == 0)
+      return out;
+    bool ints = count > reals;
+    if (reals == 0 && op != AggOp::Avg) {
+      out.type = Type::Int64;
+      out.i64 = op == AggOp::Sum   ? isum.wrapped()
+                : op == AggOp::Min ? imin
+                                   : imax;
+      return out;
+    }
+    out.type = Type::Float64;
+    if ((op == AggOp::Min || op == AggOp::Max) && !ints && nans == reals) {
+      // Only NaNs, which Min and Max skip: fmin and fmax never moved.
+      out.f64 = std::numeric_limits<double>::quiet_NaN();
+      return out;
+    }
+    switch (op) {
+    case AggOp::Min:
+      out.f64 = ints ? std::min(fmin, static_cast<double>(imin)) : fmin;
+      break;
+    case AggOp::Max:
+      out.f64 = ints ? std::max(fmax, static_cast<double>(imax)) : fmax;
+      break;
+    default:
+      out.f64 = fsum + isum.to_double();
+      if (op == AggOp::Avg)
+        out.f64 /= static_cast<double>(count);
+      break;
+    }
+    return out;
+  }
+};
+
+// Adds the value whose type byte is at `vo` (0 for none) of element `row`.
+void add_value(Partial &p, const uint8_t *base, size_t vo, AggOp op,
+               std::string_view path, size_t row) {
+  Type t = vo ? static_cast<Type>(base[vo]) : Type::Null;
+  if (t == Type::Int64) {
+    int64_t v;
+    std::memcpy(&v, base + vo + 1, 8);
+    p.add(v);
+  } else if (t == Type::Float64) {
+    double d;
+    std::memcpy(&d, base + vo + 1, 8);
+    p.add(d);
+  } else if (t != Type::Null) {
+    if (op != AggOp::Count)
+      throw exception("Cannot aggregate " + std::string(path) +
+                      ": element " + std::to_string(row) + " holds " +
+                      utils::type_name(t));
+    ++p.count;
+  }
+}
+
+const uint8_t *array_base(const Buffer &buffer, size_t array_ofs,
+                          const char *what) {
+  const uint8_t *base = buffer.data();
+  if (buffer.size() == 0 ||
+      NodeView(reinterpret_cast<const PackedNodeLayout *>(base + array_ofs))
+              .type() != Type::Array)
+    throw exception(std::string(what) + ": not an array");
+  return base;
+}
+
+// Open-addressed map from group keys to group numbers, numbered in order
+// of arrival. Stays small, and so in cache, for the low-cardinality keys
+// rollups group by.
+template <typename K> class GroupIndex {
+public:
+  GroupIndex() : m_slots(16, kEmpty), m_keys(16), m_hashes(16) {}
+
+  size_t size() const { return m_size; }
+
+  // The group number of `key`; size() - 1 when it is new.
+  uint32_t find_or_add(const K &key, uint64_t hash) {
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+      if (m_slots[i] == kEmpty) {
+        if ((m_size + 1) * 2 > m_slots.size()) {
+          grow();
+          return find_or_add(key, hash);
+        }
+        m_slots[i] = static_cast<uint32_t>(m_size);
+        m_keys[i] = key;
+        m_hashes[i] = hash;
+        return static_cast<uint32_t>(m_size++);
+      }
+      if (m_hashes[i] == hash && m_keys[i] == key)
+        return m_slots[i];
+    }
+  }
+
+private:
+  static constexpr uint32_t kEmpty = UINT32_MAX;
+
+  void grow() {
+    std::vector<uint32_t> slots(m_slots.size() * 2, kEmpty);
+    std::vector<K> keys(slots.size());
+    std::vector<uint64_t> hashes(slots.size());
+    size_t mask = slots.size() - 1;
+    for (size_t j = 0; j < m_slots.size(); ++j) {
+      if (m_slots[j] == kEmpty)
+        continue;
+      size_t i = m_hashes[j] & mask;
+      while (slots[i] != kEmpty)
+        i = (i + 1) & mask;
+      slots[i] = m_slots[j];
+      keys[i] = m_keys[j];
+      hashes[i] = m_hashes[j];
+    }
+    m_slots.swap(slots);
+    m_keys.swap(keys);
+    m_hashes.swap(hashes);
+  }
+
+  std::vector<uint32_t> m_slots;
+  std::vector<K> m_keys;
+  std::vector<uint64_t> m_hashes;
+  size_t m_size = 0;
+};
+
+uint64_t mix(uint64_t x) {
+  x *= 0x9E3779B97F4A7C15ull;
+  return x ^ (x >> 29);
+}
+
+// Group keys are mostly short strings; those are hashed from a few loads
+// covering every byte instead of a byte loop.
+uint64_t hash_key(std::string_view k) {
+  const char *p = k.data();
+  size_t n = k.size();
+  uint64_t a = 0, b = 0;
+  if (n > 16)
+    return std::hash<std::string_view>{}(k);
+  if (n >= 8) {
+    std::memcpy(&a, p, 8);
+    std::memcpy(&b, p + n - 8, 8);
+  } else if (n >= 4) {
+    uint32_t x, y;
+    std::memcpy(&x, p, 4);
+    std::memcpy(&y, p + n - 4, 4);
+    a = x;
+    b = y;
+  } else if (n > 0) {
+    a = (uint64_t(uint8_t(p[0])) << 16) | (uint64_t(uint8_t(p[n >> 1])) << 8) |
+        uint8_t(p[n - 1]);
+  }
+  return mix(a ^ mix(b ^ n));
+}
+
+// Groups in order of arrival, with the Null group kept aside until it
+// turns up.
+class Groups {
+public:
+  // The partial for the group numbered `g` by an index, creating it from
+  // `make` when new.
+  template <typename Make> Partial &at(uint32_t g, Make &&make) {
+    if (g == m_groups.size()) {
+      m_groups.emplace_back();
+      make(m_groups.back());
+      m_partials.emplace_back();
+    }
+    return m_partials[g];
+  }
+
+  // The Null group's partial, numbered after the groups so far when new.
+  Partial &null_group() {
+    if (m_null == SIZE_MAX) {
+      m_null = m_groups.size();
+      m_groups.emplace_back();
+      m_partials.emplace_back();
+    }
+    return m_partials[m_null];
+  }
+
+  // Group numbers from the index, which does not count the Null group.
+  uint32_t number(uint32_t indexed) const {
+    return m_null != SIZE_MAX && indexed >= m_null ? indexed + 1 : indexed;
+  }
+
+  std::vector<Group> finish(AggOp op) {
+    for (size_t g = 0; g < m_groups.size(); ++g)
+      m_groups[g].value = m_partials[g].finish(op);
+    return std::move(m_groups);
+  }
+
+private:
+  std::vector<Group> m_groups;
+  std::vector<Partial> m_partials;
+  size_t m_null = SIZE_MAX;
+};
+
+size_t rows_of(const Column &c) {
+  switch (c.type) {
+  case Type::Bool:
+    return c.bools.size();
+  case Type::Int64:
+    return c.i64.size();
+  case Type::Float64:
+    return c.f64.size();
+  case Type::String:
+  case Type::Bytes:
+    return c.offsets.empty() ? 0 : c.offsets.size() - 1;
+  default:
+    return c.null_count;
+  }
+}
+
+// Calls fn(begin, end) for runs of rows that all hold values; together the
+// runs cover every row that does. Whole validity bytes of 0xff extend a
+// run, so sparse nulls leave long runs for the kernels below.
+template <typename F>
+void valid_runs(const Column &c, size_t rows, F &&fn) {
+  if (c.null_count == 0) {
+    if (rows)
+      fn(size_t{0}, rows);
+    return;
+  }
+  size_t begin = 0, end = 0;
+  for (size_t lo = 0; lo < rows; lo += 8) {
+    uint8_t bits = c.validity[lo >> 3];
+    if (bits == 0xff && lo + 8 <= rows) {
+      if (end != lo) {
+        if (end > begin)
+          fn(begin, end);
+        begin = lo;
+      }
+      end = lo + 8;
+      continue;
+    }
+    for (; bits; bits &= bits - 1) {
+      size_t r = lo + std::countr_zero(bits);
+      if (r < rows)
+        fn(r, r + 1);
+    }
+  }
+  if (end > begin)
+    fn(begin, end);
+}
+
+void reduce_f64(const double *v, size_t n, double &sum, double &min,
+                double &max, size_t &nans) {
+  size_t i = 0;
+  size_t unordered = 0;
+  double s = 0;
+  double lo = std::numeric_limits<double>::infinity();
+  double hi = -lo;
+#ifdef LITE3CPP_AGG_SSE2
+  __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+  __m128d lo0 = _mm_set1_pd(lo), lo1 = lo0;
+  __m128d hi0 = _mm_set1_pd(hi), hi1 = hi0;
+  __m128i nan0 = _mm_setzero_si128(), nan1 = nan0;
+  for (; i + 4 <= n; i += 4) {
+    __m128d a = _mm_loadu_pd(v + i);
+    __m128d b = _mm_loadu_pd(v + i + 2);
+    s0 = _mm_add_pd(s0, a);
+    s1 = _mm_add_pd(s1, b);
+    // minpd returns its second operand when either is NaN, so NaNs in the
+    // data never reach the accumulators.
+    lo0 = _mm_min_pd(a, lo0);
+    lo1 = _mm_min_pd(b, lo1);
+    hi0 = _mm_max_pd(a, hi0);
+    hi1 = _mm_max_pd(b, hi1);
+    // The unordered compare is all ones (-1) in the lanes holding a NaN.
+    nan0 = _mm_sub_epi64(nan0, _mm_castpd_si128(_mm_cmpunord_pd(a, a)));
+    nan1 = _mm_sub_epi64(nan1, _mm_castpd_si128(_mm_cmpunord_pd(b, b)));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(s0, s1));
+  s = lanes[0] + lanes[1];
+  _mm_storeu_pd(lanes, _mm_min_pd(lo0, lo1));
+  lo = std::min(lanes[0], lanes[1]);
+  _mm_storeu_pd(lanes, _mm_max_pd(hi0, hi1));
+  hi = std::max(lanes[0], lanes[1]);
+  uint64_t counts[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(counts),
+                   _mm_add_epi64(nan0, nan1));
+  unordered = counts[0] + counts[1];
+#endif
+  for (; i < n; ++i) {
+    s += v[i];
+    lo = v[i] < lo ? v[i] : lo;
+    hi = v[i] > hi ? v[i] : hi;
+    unordered += v[i] != v[i];
+  }
+  sum = s;
+  min = lo;
+  max = hi;
+  nans = unordered;
+}
+
+// SSE2 has no carry, so each value is summed as its low and high 32-bit
+// halves plus a count of negatives (the high half is read unsigned):
+// sum = hi * 2^32 + lo - negatives * 2^64, all plain adds. They are folded
+// into the total every 2^30 values, before they could overflow.
+WideSum sum_i64(const int64_t *v, size_t n) {
+  WideSum total;
+  for (size_t done = 0; done < n;) {
+    size_t end = done + std::min(n - done, size_t{1} << 30);
+    size_t i = done;
+    uint64_t lo = 0, hi = 0, neg = 0;
+#ifdef LITE3CPP_AGG_SSE2
+    const __m128i low_half = _mm_set1_epi64x(0xFFFFFFFF);
+    __m128i lo0 = _mm_setzero_si128(), lo1 = lo0, hi0 = lo0, hi1 = lo0;
+    __m128i neg0 = lo0;
+    for (; i + 4 <= end; i += 4) {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + i));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + i + 2));
+      lo0 = _mm_add_epi64(lo0, _mm_and_si128(a, low_half));
+      lo1 = _mm_add_epi64(lo1, _mm_and_si128(b, low_half));
+      hi0 = _mm_add_epi64(hi0, _mm_srli_epi64(a, 32));
+      hi1 = _mm_add_epi64(hi1, _mm_srli_epi64(b, 32));
+      neg0 = _mm_add_epi64(
+          neg0, _mm_add_epi64(_mm_srli_epi64(a, 63), _mm_srli_epi64(b, 63)));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes),
+                     _mm_add_epi64(lo0, lo1));
+    lo = lanes[0] + lanes[1];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes),
+                     _mm_add_epi64(hi0, hi1));
+    hi = lanes[0] + lanes[1];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), neg0);
+    neg = lanes[0] + lanes[1];
+#endif
+    for (; i < end; ++i) {
+      uint64_t u = static_cast<uint64_t>(v[i]);
+      lo += u & 0xFFFFFFFF;
+      hi += u >> 32;
+      neg += u >> 63;
+    }
+    total.add(hi << 32, static_cast<int64_t>(hi >> 32));
+    total.add(lo, 0);
+    total.high -= static_cast<int64_t>(neg);
+    done = end;
+  }
+  return total;
+}
+
+// SSE2 has no 64-bit integer compare; two chains keep the loop from
+// waiting on one.
+void min_max_i64(const int64_t *v, size_t n, int64_t &min, int64_t &max) {
+  int64_t lo0 = std::numeric_limits<int64_t>::max(), lo1 = lo0;
+  int64_t hi0 = std::numeric_limits<int64_t>::min(), hi1 = hi0;
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    lo0 = std::min(lo0, v[i]);
+    hi0 = std::max(hi0, v[i]);
+    lo1 = std::min(lo1, v[i + 1]);
+    hi1 = std::max(hi1, v[i + 1]);
+  }
+  if (i < n) {
+    lo0 = std::min(lo0, v[i]);
+    hi0 = std::max(hi0, v[i]);
+  }
+  min = std::min(lo0, lo1);
+  max = std::max(hi0, hi1);
+}
+
+// The group key of `row` of `keys`, a column of type `key_type`.
+void key_of(const Column &keys, size_t row, Group &g) {
+  g.key_type = keys.type;
+  switch (keys.type) {
+  case Type::Bool:
+    g.key_i64 = keys.bools[row];
+    break;
+  case Type::Int64:
+    g.key_i64 = keys.i64[row];
+    break;
+  case Type::Float64:
+    g.key_f64 = keys.f64[row];
+    break;
+  default:
+    g.key_str.assign(reinterpret_cast<const char *>(keys.data.data()) +
+                         keys.offsets[row],
+                     keys.offsets[row + 1] - keys.offsets[row]);
+    break;
+  }
+}
+
+} // namespace
+
+AggValue aggregate(const Buffer &buffer, size_t array_ofs,
+                   std::string_view path, AggOp op) {
+  const uint8_t *base = array_base(buffer, array_ofs, "aggregate");
+  utils::PathSet paths;
+  paths.add(utils::split_pointer(path, "Aggregate path"));
+  paths.prepare();
+  std::vector<size_t> found(paths.width());
+  Partial p;
+  size_t row = 0;
+  utils::walk_entries(base, array_ofs, [&](size_t vo) {
+    paths.resolve(base, vo, found.data());
+    add_value(p, base, found[0], op, path, row++);
+  });
+  return p.finish(op);
+}
+
+AggValue aggregate(const Column &column, AggOp op) {
+  Partial p;
+  size_t rows = rows_of(column);
+  if (op == AggOp::Count) {
+    p.count = rows - column.null_count;
+    return p.finish(op);
+  }
+  if (column.type == Type::Int64) {
+    if (op == AggOp::Min || op == AggOp::Max) {
+      valid_runs(column, rows, [&](size_t begin, size_t end) {
+        int64_t min, max;
+        min_max_i64(column.i64.data() + begin, end - begin, min, max);
+        p.add_ints(end - begin, WideSum(), min, max);
+      });
+    } else {
+      // Null rows hold 0, so the sum needs no validity.
+      p.add_ints(rows - column.null_count, sum_i64(column.i64.data(), rows),
+                 std::numeric_limits<int64_t>::max(),
+                 std::numeric_limits<int64_t>::min());
+    }
+  } else if (column.type == Type::Float64) {
+    valid_runs(column, rows, [&](size_t begin, size_t end) {
+      double sum, min, max;
+      size_t nans;
+      reduce_f64(column.f64.data() + begin, end - begin, sum, min, max, nans);
+      p.add_reals(end - begin, nans, sum, min, max);
+    });
+  } else if (column.type != Type::Null) {
+    throw exception("Cannot aggregate " + column.path + ": column holds " +
+                    utils::type_name(column.type) + " values");
+  }
+  return p.finish(op);
+}
+
+std::vector<Group> group_by(const Buffer &buffer, size_t array_ofs,
+                            std::string_view key_path,
+                            std::string_view agg_path, AggOp op) {
+  const uint8_t *base = array_base(buffer, array_ofs, "group_by");
+  utils::PathSet paths;
+  paths.add(utils::split_pointer(key_path, "Group key path"));
+  paths.add(utils::split_pointer(agg_path, "Aggregate path"));
+  paths.prepare();
+  std::vector<size_t> found(paths.width());
+
+  // Keys are the value's bytes in place: its type byte and payload.
+  GroupIndex<std::string_view> index;
+  Groups groups;
+  size_t row = 0;
+  utils::walk_entries(base, array_ofs, [&](size_t vo) {
+    paths.resolve(base, vo, found.data());
+    size_t ko = found[0];
+    Type t = ko ? static_cast<Type>(base[ko]) : Type::Null;
+    Partial *p;
+    if (t == Type::Null) {
+      p = &groups.null_group();
+    } else {
+      const uint8_t *payload = base + ko + 1;
+      size_t size;
+      uint32_t len = 0;
+      switch (t) {
+      case Type::Bool:
+        size = 1;
+        break;
+      case Type::Int64:
+      case Type::Float64:
+        size = 8;
+        break;
+      case Type::String:
+      case Type::Bytes:
+        std::memcpy(&len, payload, 4);
+        size = 4 + len;
+        break;
+      default:
+        throw exception("Group key " + std::string(key_path) +
+                        " is not a scalar at element " + std::to_string(row) +
+                        " (found " + utils::type_name(t) + ")");
+      }
+      std::string_view key(reinterpret_cast<const char *>(base + ko),
+                           1 + size);
+      uint32_t g = index.find_or_add(key, hash_key(key));
+      p = &groups.at(groups.number(g), [&](Group &group) {
+        group.key_type = t;
+        if (t == Type::Bool)
+          group.key_i64 = *payload ? 1 : 0;
+        else if (t == Type::Int64)
+          std::memcpy(&group.key_i64, payload, 8);
+        else if (t == Type::Float64)
+          std::memcpy(&group.key_f64, payload, 8);
+        else
+          group.key_str.assign(reinterpret_cast<const char *>(payload + 4),
+                               len);
+      });
+    }
+    add_value(*p, base, found[1], op, agg_path, row++);
+  });
+  return groups.finish(op);
+}
+
+std::vector<Group> group_by(const Columns &columns, std::string_view key_path,
+                            std::string_view agg_path, AggOp op) {
+  const Column *keys = columns.find(key_path);
+  const Column *values = columns.find(agg_path);
+  if (!keys || !values)
+    throw exception("group_by: no column for " +
+                    std::string(keys ? agg_path : key_path));
+  if (op != AggOp::Count && values->type != Type::Int64 &&
+      values->type != Type::Float64 && values->type != Type::Null)
+    throw exception("Cannot aggregate " + values->path + ": column holds " +
+                    utils::type_name(values->type) + " values");
+
+  // One loop per key type, so the key's type is not switched on per row.
+  Groups groups;
+  auto run = [&](auto &&number) {
+    for (size_t r = 0; r < columns.rows; ++r) {
+      Partial &p = keys->valid(r)
+                       ? groups.at(groups.number(number(r)),
+                                   [&](Group &g) { key_of(*keys, r, g); })
+                       : groups.null_group();
+      if (!values->valid(r))
+        continue;
+      if (values->type == Type::Int64)
+        p.add(values->i64[r]);
+      else if (values->type == Type::Float64)
+        p.add(values->f64[r]);
+      else
+        ++p.count;
+    }
+  };
+  GroupIndex<uint64_t> numbers;
+  GroupIndex<std::string_view> strings;
+  switch (keys->type) {
+  case Type::Bool:
+    run([&](size_t r) {
+      return numbers.find_or_add(keys->bools[r], keys->bools[r]);
+    });
+    break;
+  case Type::Int64:
+    run([&](size_t r) {
+      uint64_t k = static_cast<uint64_t>(keys->i64[r]);
+      return numbers.find_or_add(k, mix(k));
+    });
+    break;
+  case Type::Float64:
+    run([&](size_t r) {
+      uint64_t k = std::bit_cast<uint64_t>(keys->f64[r]);
+      return numbers.find_or_add(k, mix(k));
+    });
+    break;
+  case Type::String:
+  case Type::Bytes:
+    run([&](size_t r) {
+      std::string_view k = keys->str(r);
+      return strings.find_or_add(k, hash_key(k));
+    });
+    break;
+  default: // Every key null
+    run([](size_t) { return 0u; });
+    break;
+  }
+  return groups.finish(op);
+}
+
+} // namespace lite3cpp
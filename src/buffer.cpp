@@ -1,4 +1,6 @@
 #include "buffer.hpp"
+#include "concurrent.hpp"
+#include "digest.hpp"
 #include "exception.hpp"
 #include "node.hpp"
 #include "observability.hpp"
@@ -7,6 +9,7 @@
 #include <chrono>
 #include <cstring>
 #include <iostream>
+#include <utility>
 
 namespace lite3cpp {
 
@@ -39,6 +42,90 @@ static int compare_node_key(const uint8_t *base, const NodeView &node, int idx,
   return cmp;
 }
 
+// Visits the entries under the B-tree node at `node_ofs` in key order,
+// calling fn(hash, kv_ofs).
+template <typename F>
+static void for_each_entry(const uint8_t *base, size_t node_ofs, F &&fn) {
+  NodeView node(reinterpret_cast<const PackedNodeLayout *>(base + node_ofs));
+  int count = static_cast<int>(node.key_count());
+  for (int i = 0; i <= count; ++i) {
+    if (node.get_child_offset(i))
+      for_each_entry(base, node.get_child_offset(i), fn);
+    if (i < count)
+      fn(node.get_hash(i), static_cast<size_t>(node.get_kv_offset(i)));
+  }
+}
+
+// True when the subtree under `node_ofs` holds no entries. Removal leaves
+// empty nodes behind, and a node without keys has only child 0.
+static bool subtree_empty(const uint8_t *base, size_t node_ofs) {
+  while (node_ofs) {
+    NodeView node(reinterpret_cast<const PackedNodeLayout *>(base + node_ofs));
+    if (node.key_count() > 0)
+      return false;
+    node_ofs = node.get_child_offset(0);
+  }
+  return true;
+}
+
+// Bytes after the type byte of a scalar value; 0 for Null and containers.
+static size_t scalar_size(const uint8_t *base, size_t vo) {
+  switch (static_cast<Type>(base[vo])) {
+  case Type::Bool:
+    return 1;
+  case Type::Int64:
+  case Type::Float64:
+    return 8;
+  case Type::String:
+  case Type::Bytes: {
+    uint32_t len;
+    std::memcpy(&len, base + vo + 1, 4);
+    return 4 + len + (static_cast<Type>(base[vo]) == Type::String ? 1 : 0);
+  }
+  default:
+    return 0;
+  }
+}
+
+// True when the entry at `kv_ofs` (key unless `is_arr`, type byte and
+// payload) lies within the first `size` bytes. Lookups check this before
+// reading an entry, since a concurrent writer may have torn its offset.
+static bool entry_in_bounds(const uint8_t *base, size_t size, size_t kv_ofs,
+                            bool is_arr) {
+  size_t vo = kv_ofs;
+  if (!is_arr) {
+    if (vo >= size || (base[vo] >> 2) == 0)
+      return false;
+    vo += 1 + (base[vo] >> 2);
+  }
+  if (vo >= size)
+    return false;
+  size_t avail = size - vo - 1;
+  switch (static_cast<Type>(base[vo])) {
+  case Type::Object:
+  case Type::Array:
+    return avail >= config::node_size;
+  case Type::String:
+  case Type::Bytes:
+    if (avail < 4)
+      return false;
+    break;
+  default:
+    break;
+  }
+  return scalar_size(base, vo) <= avail;
+}
+
+// Reports the capacity of storage that was just reallocated.
+static void report_capacity(size_t capacity) {
+#ifndef LITE3CPP_DISABLE_OBSERVABILITY
+  if (IMetrics *m = g_metrics.load(std::memory_order_acquire))
+    m->set_buffer_capacity(capacity);
+#else
+  (void)capacity;
+#endif
+}
+
 struct ScopedMetric {
   std::string_view op;
 #ifndef LITE3CPP_DISABLE_OBSERVABILITY
@@ -71,20 +158,115 @@ Buffer::Buffer() : m_used_size(0) {
 
 Buffer::Buffer(size_t initial_size) : m_used_size(0) {
   m_data.reserve(initial_size);
+  publish();
 }
 
 Buffer::Buffer(std::vector<uint8_t> data)
-    : m_data(std::move(data)), m_used_size(m_data.size()) {}
+    : m_data(std::move(data)), m_used_size(m_data.size()) {
+  publish();
+}
+
+Buffer::Buffer(const Buffer &other)
+    : m_data(other.m_data), m_used_size(other.m_used_size),
+      m_digests(other.m_digests) {
+  publish();
+}
+
+Buffer::Buffer(Buffer &&other) noexcept
+    : m_data(std::move(other.m_data)),
+      m_used_size(std::exchange(other.m_used_size, 0)),
+      m_digests(std::move(other.m_digests)) {
+  publish();
+  other.publish();
+}
+
+// Assignment goes through replace_storage, so a buffer owned by a
+// ConcurrentBuffer retires its old storage instead of freeing it.
+Buffer &Buffer::operator=(const Buffer &other) {
+  if (this != &other) {
+    replace_storage(other.m_data);
+    m_used_size = other.m_used_size;
+    m_digests = other.m_digests;
+  }
+  return *this;
+}
+
+Buffer &Buffer::operator=(Buffer &&other) {
+  if (this != &other) {
+    replace_storage(std::move(other.m_data));
+    other.publish();
+    m_used_size = std::exchange(other.m_used_size, 0);
+    m_digests = std::move(other.m_digests);
+  }
+  return *this;
+}
+
+void Buffer::publish() {
+  StorageView view{m_data.data(), m_data.size()};
+  if (!m_reclaimer.ptr) {
+    m_view.local = view;
+    m_view.ptr.store(&m_view.local, std::memory_order_release);
+    m_view.shared.reset();
+    return;
+  }
+  // Readers may hold the current view, so it is replaced, never rewritten.
+  auto fresh = std::make_unique<StorageView>(view);
+  m_view.ptr.store(fresh.get(), std::memory_order_release);
+  if (m_view.shared)
+    m_reclaimer.ptr->retire(std::move(m_view.shared));
+  m_view.shared = std::move(fresh);
+}
 
 void Buffer::ensure_capacity(size_t required_bytes) {
   if (m_used_size + required_bytes > m_data.size()) {
     size_t new_size = std::max(m_data.size() * 2, m_used_size + required_bytes);
+    // Stay within capacity set aside by reserve(), which then never
+    // reallocates.
+    if (m_used_size + required_bytes <= m_data.capacity())
+      new_size = std::min(new_size, m_data.capacity());
     if (new_size < config::node_size)
       new_size = config::node_size;
+    if (m_reclaimer.ptr && new_size > m_data.capacity()) {
+      // Concurrent readers may still be walking the old storage, so it is
+      // handed to the epoch manager instead of being freed by the resize.
+      std::vector<uint8_t> grown;
+      grown.reserve(new_size);
+      grown.assign(m_data.begin(), m_data.end());
+      grown.resize(new_size);
+      replace_storage(std::move(grown));
+      report_capacity(m_data.capacity());
+      return;
+    }
+    bool grows = new_size > m_data.capacity();
     m_data.resize(new_size);
+    publish();
+    if (grows)
+      report_capacity(m_data.capacity());
   }
 }
 
+void Buffer::reserve(size_t capacity) {
+  if (capacity <= m_data.capacity())
+    return;
+  if (m_reclaimer.ptr) {
+    std::vector<uint8_t> grown;
+    grown.reserve(capacity);
+    grown.assign(m_data.begin(), m_data.end());
+    replace_storage(std::move(grown));
+  } else {
+    m_data.reserve(capacity);
+    publish();
+  }
+  report_capacity(m_data.capacity());
+}
+
+void Buffer::replace_storage(std::vector<uint8_t> storage) {
+  std::swap(m_data, storage);
+  publish();
+  if (m_reclaimer.ptr && storage.capacity() > 0)
+    m_reclaimer.ptr->retire(std::move(storage));
+}
+
 void Buffer::init_structure(Type type) {
   ensure_capacity(config::node_size);
   std::memset(m_data.data() + m_used_size, 0, config::node_size);
@@ -92,10 +274,20 @@ void Buffer::init_structure(Type type) {
   MutableNodeView root(
       reinterpret_cast<PackedNodeLayout *>(m_data.data() + m_used_size));
   root.set_gen_type(1, type);
+  if (m_digests.table)
+    m_digests.table->set_subtree(m_used_size, 0);
 
   m_used_size += config::node_size;
 }
 
+void Buffer::clear() {
+  m_data.clear();
+  publish();
+  m_used_size = 0;
+  if (m_digests.table)
+    m_digests.table->clear();
+}
+
 void Buffer::init_object() { init_structure(Type::Object); }
 
 void Buffer::init_array() { init_structure(Type::Array); }
@@ -105,6 +297,7 @@ size_t Buffer::set_impl(size_t ofs, std::string_view key, uint32_t key_hash,
                         size_t val_len, const void *val_ptr, Type type,
                         bool is_append) {
   ScopedMetric sm("set");
+  DigestTable *digests = m_digests.table.get();
 
   size_t key_tag_size = 0;
   if (!is_append) {
@@ -165,6 +358,8 @@ size_t Buffer::set_impl(size_t ofs, std::string_view key, uint32_t key_hash,
         size_t moves_to_ofs = m_used_size;
         m_used_size += config::node_size;
         std::memcpy(m_data.data() + moves_to_ofs, node_ptr, config::node_size);
+        if (digests)
+          digests->set_subtree(moves_to_ofs, digests->subtree(node_ofs));
 
         // Reset old root as new parent
         auto root_type = node.type();
@@ -181,8 +376,7 @@ size_t Buffer::set_impl(size_t ofs, std::string_view key, uint32_t key_hash,
         parent_ofs = node_ofs;
         node_ofs = moves_to_ofs;
         // Restart loop on new child to continue split logic check/split
-        path[path_depth - 1] = parent_ofs; // Correct stack
-        path_depth--;                      // Will push node_ofs again
+        path[path_depth - 1] = parent_ofs; // Root stays; loop pushes child
         continue;
       }
 
@@ -234,11 +428,15 @@ size_t Buffer::set_impl(size_t ofs, std::string_view key, uint32_t key_hash,
       node.set_key_count(mid);
 
       // Update sizes if tracking...
+      if (digests)
+        digest_split(node_ofs, sibling_ofs, node.get_kv_offset(mid),
+                     node.get_hash(mid), is_append);
 
       if (key_hash > parent.get_hash(i_in_parent)) {
         node_ofs = sibling_ofs;
       }
-      continue; // Restart loop
+      path_depth--; // The loop pushes whichever half we continue in
+      continue;     // Restart loop
     }
 
     // Search
@@ -263,6 +461,10 @@ size_t Buffer::set_impl(size_t ofs, std::string_view key, uint32_t key_hash,
 
       // === OPTIMIZATION: Check for In-Place Update ===
       size_t kv_ofs = node.get_kv_offset(i);
+      uint64_t old_entry =
+          digests ? entry_digest(m_data.data(), kv_ofs, is_append,
+                                 node.get_hash(i), *digests)
+                  : 0;
 
       // Calculate existing value offset
       size_t vo = kv_ofs;
@@ -295,7 +497,13 @@ size_t Buffer::set_impl(size_t ofs, std::string_view key, uint32_t key_hash,
         existing_total_len += existing_vlen;
       }
 
-      if (existing_total_len == val_total_len) {
+      // A container's node follows its type byte, so only an existing
+      // container has room to be re-initialized in place.
+      bool new_container = type == Type::Object || type == Type::Array;
+      bool old_container =
+          existing_type == Type::Object || existing_type == Type::Array;
+      if (existing_total_len == val_total_len &&
+          (!new_container || old_container)) {
         // Overwrite in place!
         size_t vstart = vo + 1;                  // Skip Type
         m_data[vo] = static_cast<uint8_t>(type); // Update Type
@@ -312,6 +520,9 @@ size_t Buffer::set_impl(size_t ofs, std::string_view key, uint32_t key_hash,
           if (val_len)
             std::memcpy(m_data.data() + vstart, val_ptr, val_len);
         }
+        if (digests)
+          digest_commit(path, path_depth, ofs, kv_ofs, key_hash, is_append,
+                        old_entry);
         return vo;
       }
       // ===============================================
@@ -347,6 +558,9 @@ size_t Buffer::set_impl(size_t ofs, std::string_view key, uint32_t key_hash,
         if (val_len)
           std::memcpy(m_data.data() + vstart, val_ptr, val_len);
       }
+      if (digests)
+        digest_commit(path, path_depth, ofs, start, key_hash, is_append,
+                      old_entry);
       return m_used_size - val_total_len; // Return start of value?
     }
 
@@ -401,6 +615,8 @@ size_t Buffer::set_impl(size_t ofs, std::string_view key, uint32_t key_hash,
       node_upd.set_hash(i, key_hash);
       node_upd.set_kv_offset(i, static_cast<uint32_t>(start));
       node_upd.set_key_count(count + 1);
+      if (digests)
+        digest_commit(path, path_depth, ofs, start, key_hash, is_append, 0);
 
       // Path update size?
       // node_upd.set_size_kc(node_upd.size() + 1, count + 1);
@@ -411,22 +627,34 @@ size_t Buffer::set_impl(size_t ofs, std::string_view key, uint32_t key_hash,
 }
 
 const std::byte *Buffer::get_impl(size_t ofs, std::string_view key,
-                                  uint32_t hash, Type &type,
-                                  bool is_array_op) const {
+                                  uint32_t hash, Type &type, bool is_array_op,
+                                  const uint8_t **base_out) const {
   ScopedMetric sm("get");
+  // Resolve the storage once: a concurrent writer may swap in grown storage
+  // mid-lookup, and offsets from one copy must not index into another.
+  const StorageView *storage = view();
+  const uint8_t *base = storage->data;
+  size_t size = storage->size;
+  if (base_out)
+    *base_out = base;
   size_t node_ofs = ofs;
   // std::cout << "DEBUG: get_impl key='" << key << "' hash=" << hash <<
   // std::endl;
-  while (true) {
+  for (size_t depth = 0; depth <= config::tree_height_max; ++depth) {
+    if (node_ofs > size || size - node_ofs < config::node_size)
+      return nullptr;
     NodeView node(
-        reinterpret_cast<const PackedNodeLayout *>(m_data.data() + node_ofs));
+        reinterpret_cast<const PackedNodeLayout *>(base + node_ofs));
     // Search
     int i = 0;
     int count = node.key_count();
     // std::cout << "DEBUG: Scanning node at ofs " << node_ofs
     //           << ", count=" << count << std::endl;
     while (i < count) {
-      int c = compare_node_key(m_data.data(), node, i, hash, key, is_array_op);
+      if (node.get_hash(i) == hash &&
+          !entry_in_bounds(base, size, node.get_kv_offset(i), is_array_op))
+        return nullptr;
+      int c = compare_node_key(base, node, i, hash, key, is_array_op);
       if (c < 0) {
         // std::cout << "DEBUG: i=" << i << " compare < 0" << std::endl;
         i++;
@@ -439,19 +667,19 @@ const std::byte *Buffer::get_impl(size_t ofs, std::string_view key,
     }
 
     if (i < count &&
-        compare_node_key(m_data.data(), node, i, hash, key, is_array_op) == 0) {
+        compare_node_key(base, node, i, hash, key, is_array_op) == 0) {
       // std::cout << "DEBUG: Found match at index " << i << std::endl;
       size_t kv_ofs = node.get_kv_offset(i);
       // Skip key (since we confirmed match, we just skip it to get value)
       size_t vo = kv_ofs;
       if (!is_array_op) {
-        uint8_t tag = m_data[vo];
+        uint8_t tag = base[vo];
         uint32_t klen = (tag >> 2);
         vo += 1 + klen;
       }
 
-      type = static_cast<Type>(m_data[vo]);
-      return reinterpret_cast<const std::byte *>(m_data.data() + vo + 1);
+      type = static_cast<Type>(base[vo]);
+      return reinterpret_cast<const std::byte *>(base + vo + 1);
     }
     if (node.get_child_offset(i)) {
       // std::cout << "DEBUG: Descending child " << i << std::endl;
@@ -461,6 +689,7 @@ const std::byte *Buffer::get_impl(size_t ofs, std::string_view key,
     // std::cout << "DEBUG: Not found in node." << std::endl;
     return nullptr;
   }
+  return nullptr;
 }
 
 void Buffer::set_null(size_t ofs, std::string_view key) {
@@ -540,8 +769,7 @@ size_t Buffer::set_obj(size_t ofs, std::string_view key) {
   // Actually `set_impl` wrote [Type][Node stuff? No, 0 data].
   // Value for Object is the Node.
   // So o points to [Type], o+1 points to Node data.
-  std::memset(m_data.data() + o + 1, 0,
-              config::node_size - 8); // rough clear
+  std::memset(m_data.data() + o + 1, 0, config::node_size);
   MutableNodeView n(reinterpret_cast<PackedNodeLayout *>(
       m_data.data() + o + 1)); // offset adjustment?
   // Node is 96 bytes. `type_sizes[Object]` accounts for overhead.
@@ -554,7 +782,7 @@ size_t Buffer::set_obj(size_t ofs, std::string_view key) {
 size_t Buffer::set_arr(size_t ofs, std::string_view key) {
   size_t o = set_impl(ofs, key, utils::djb2_hash(key), 0, nullptr, Type::Array);
   ensure_capacity(config::node_size);
-  std::memset(m_data.data() + o + 1, 0, config::node_size - 8);
+  std::memset(m_data.data() + o + 1, 0, config::node_size);
   MutableNodeView n(
       reinterpret_cast<PackedNodeLayout *>(m_data.data() + o + 1));
   n.set_gen_type(1, Type::Array);
@@ -562,6 +790,154 @@ size_t Buffer::set_arr(size_t ofs, std::string_view key) {
   return o + 1;
 }
 
+bool Buffer::remove(size_t ofs, std::string_view key) {
+  if (m_data.empty() ||
+      NodeView(reinterpret_cast<const PackedNodeLayout *>(m_data.data() + ofs))
+              .type() != Type::Object)
+    throw exception("Type mismatch");
+  return remove_impl(ofs, key, utils::djb2_hash(key), false);
+}
+
+bool Buffer::arr_remove(size_t ofs, uint32_t index) {
+  if (m_data.empty() ||
+      NodeView(reinterpret_cast<const PackedNodeLayout *>(m_data.data() + ofs))
+              .type() != Type::Array)
+    throw exception("Type mismatch");
+  uint32_t size =
+      NodeView(reinterpret_cast<const PackedNodeLayout *>(m_data.data() + ofs))
+          .size();
+  if (index >= size || !remove_impl(ofs, {}, index, true))
+    return false;
+  arr_renumber(ofs, index + 1, -1);
+  MutableNodeView(reinterpret_cast<PackedNodeLayout *>(m_data.data() + ofs))
+      .set_size(size - 1);
+  return true;
+}
+
+bool Buffer::remove_impl(size_t ofs, std::string_view key, uint32_t hash,
+                         bool is_array) {
+  ScopedMetric sm("remove");
+  const uint8_t *base = m_data.data();
+  size_t path[config::tree_height_max + 1];
+  int path_depth = 0;
+  size_t node_ofs = ofs;
+  int i = 0;
+  while (true) {
+    if (path_depth > static_cast<int>(config::tree_height_max))
+      return false;
+    path[path_depth++] = node_ofs;
+    NodeView node(reinterpret_cast<const PackedNodeLayout *>(base + node_ofs));
+    int count = static_cast<int>(node.key_count());
+    i = 0;
+    while (i < count &&
+           compare_node_key(base, node, i, hash, key, is_array) < 0)
+      i++;
+    if (i < count && compare_node_key(base, node, i, hash, key, is_array) == 0)
+      break;
+    if (!node.get_child_offset(i))
+      return false;
+    node_ofs = node.get_child_offset(i);
+  }
+
+  for (int d = 0; d < path_depth; ++d) {
+    MutableNodeView n(reinterpret_cast<PackedNodeLayout *>(m_data.data() + path[d]));
+    n.set_gen_type(n.generation() + 1, n.type());
+  }
+
+  DigestTable *digests = m_digests.table.get();
+  MutableNodeView node(
+      reinterpret_cast<PackedNodeLayout *>(m_data.data() + node_ofs));
+  uint64_t removed = digests ? entry_digest(base, node.get_kv_offset(i),
+                                            is_array, node.get_hash(i),
+                                            *digests)
+                             : 0;
+
+  // Replace the entry with the largest entry of its left subtree. Emptied
+  // leaves are never merged away, so that entry may sit in an inner node
+  // whose right subtree is empty; it is popped together with that subtree.
+  size_t pop_path[config::tree_height_max + 1];
+  int pop_depth = 0;
+  size_t pop_ofs = node.get_child_offset(i);
+  bool popped = false;
+  if (pop_ofs && !subtree_empty(base, pop_ofs)) {
+    while (pop_depth <= static_cast<int>(config::tree_height_max)) {
+      pop_path[pop_depth++] = pop_ofs;
+      NodeView n(reinterpret_cast<const PackedNodeLayout *>(base + pop_ofs));
+      int count = static_cast<int>(n.key_count());
+      size_t right = n.get_child_offset(count);
+      if (right && !subtree_empty(base, right)) {
+        pop_ofs = right;
+        continue;
+      }
+      // The subtree is non-empty and its right part is, so count > 0.
+      MutableNodeView last(
+          reinterpret_cast<PackedNodeLayout *>(m_data.data() + pop_ofs));
+      uint32_t p_hash = last.get_hash(count - 1);
+      uint32_t p_kv = last.get_kv_offset(count - 1);
+      last.set_child_offset(count, 0);
+      last.set_key_count(count - 1);
+      if (digests) {
+        uint64_t moved = entry_digest(base, p_kv, is_array, p_hash, *digests);
+        for (int d = 0; d < pop_depth; ++d)
+          digests->add_subtree(pop_path[d], 0 - moved);
+      }
+      node.set_hash(i, p_hash);
+      node.set_kv_offset(i, p_kv);
+      popped = true;
+      break;
+    }
+  }
+
+  if (!popped) {
+    // Left subtree is empty: drop the entry and that child.
+    int count = static_cast<int>(node.key_count());
+    for (int j = i; j < count - 1; ++j) {
+      node.set_hash(j, node.get_hash(j + 1));
+      node.set_kv_offset(j, node.get_kv_offset(j + 1));
+    }
+    for (int j = i; j < count; ++j)
+      node.set_child_offset(j, node.get_child_offset(j + 1));
+    node.set_child_offset(count, 0);
+    node.set_key_count(count - 1);
+  }
+
+  if (digests)
+    digest_propagate(path, path_depth, ofs, 0 - removed);
+  return true;
+}
+
+// Indices only grow left to right, so a child left of an entry below
+// `from` holds nothing to renumber and is skipped.
+void Buffer::arr_renumber(size_t ofs, uint32_t from, int32_t delta) {
+  std::vector<size_t> stack{ofs};
+  while (!stack.empty()) {
+    size_t node_ofs = stack.back();
+    stack.pop_back();
+    MutableNodeView node(
+        reinterpret_cast<PackedNodeLayout *>(m_data.data() + node_ofs));
+    int count = static_cast<int>(node.key_count());
+    bool changed = false;
+    for (int i = 0; i <= count; ++i) {
+      size_t child = node.get_child_offset(i);
+      if (child && (i == count || node.get_hash(i) > from))
+        stack.push_back(child);
+      if (i < count && node.get_hash(i) >= from) {
+        node.set_hash(i, node.get_hash(i) + static_cast<uint32_t>(delta));
+        changed = true;
+      }
+    }
+    if (changed)
+      node.set_gen_type(node.generation() + 1, node.type());
+  }
+
+  // Element digests hash the index, and links to nested containers hold
+  // it, so the array is re-hashed whole.
+  if (DigestTable *digests = m_digests.table.get()) {
+    uint64_t before = digests->subtree(ofs);
+    digest_propagate(nullptr, 0, ofs, digest_rebuild(ofs, ofs, true) - before);
+  }
+}
+
 // Array appends - stub or implement
 void Buffer::arr_append_impl(size_t ofs, size_t val_len, const void *val_ptr,
                              Type type) {
@@ -608,7 +984,7 @@ size_t Buffer::arr_append_obj(size_t ofs) {
                       Type::Object, true);
 
   ensure_capacity(config::node_size);
-  std::memset(m_data.data() + o + 1, 0, config::node_size - 8);
+  std::memset(m_data.data() + o + 1, 0, config::node_size);
   MutableNodeView n(
       reinterpret_cast<PackedNodeLayout *>(m_data.data() + o + 1));
   n.set_gen_type(1, Type::Object);
@@ -629,7 +1005,7 @@ size_t Buffer::arr_append_arr(size_t ofs) {
                       Type::Array, true);
 
   ensure_capacity(config::node_size);
-  std::memset(m_data.data() + o + 1, 0, config::node_size - 8);
+  std::memset(m_data.data() + o + 1, 0, config::node_size);
   MutableNodeView n(
       reinterpret_cast<PackedNodeLayout *>(m_data.data() + o + 1));
   n.set_gen_type(1, Type::Array);
@@ -642,10 +1018,244 @@ size_t Buffer::arr_append_arr(size_t ofs) {
   return o + 1;
 }
 
+size_t Buffer::copy_value(size_t ofs, std::string_view key, uint32_t index,
+                          const uint8_t *src, size_t src_vo) {
+  Type type = static_cast<Type>(src[src_vo]);
+  const uint8_t *payload = src + src_vo + 1;
+  size_t len = 0;
+  switch (type) {
+  case Type::Bool:
+    len = 1;
+    break;
+  case Type::Int64:
+  case Type::Float64:
+    len = 8;
+    break;
+  case Type::String:
+  case Type::Bytes: {
+    uint32_t sz;
+    std::memcpy(&sz, payload, 4);
+    payload += 4;
+    len = sz;
+    break;
+  }
+  default:
+    break;
+  }
+
+  NodeView dst(
+      reinterpret_cast<const PackedNodeLayout *>(m_data.data() + ofs));
+  size_t o;
+  if (dst.type() == Type::Array) {
+    uint32_t size = dst.size();
+    if (index >= size) {
+      o = set_impl(ofs, {}, size, len, payload, type, true);
+      MutableNodeView(reinterpret_cast<PackedNodeLayout *>(m_data.data() + ofs))
+          .set_size(size + 1);
+    } else {
+      o = set_impl(ofs, {}, index, len, payload, type, true);
+    }
+  } else {
+    o = set_impl(ofs, key, utils::djb2_hash(key), len, payload, type);
+  }
+
+  if (type == Type::Object || type == Type::Array) {
+    ensure_capacity(config::node_size);
+    std::memset(m_data.data() + o + 1, 0, config::node_size);
+    MutableNodeView n(reinterpret_cast<PackedNodeLayout *>(m_data.data() + o + 1));
+    n.set_gen_type(1, type);
+    m_used_size += config::node_size;
+    copy_entries(o + 1, src, src_vo + 1);
+  }
+  return o;
+}
+
+size_t Buffer::copy_subtree(size_t dst_ofs, std::string_view key,
+                            const Buffer &src, size_t src_ofs) {
+  if (&src == this) {
+    Buffer snapshot(
+        std::vector<uint8_t>(m_data.begin(), m_data.begin() + m_used_size));
+    return copy_subtree(dst_ofs, key, snapshot, src_ofs);
+  }
+  ScopedMetric sm("copy_subtree");
+  const uint8_t *s = src.data();
+  if (src.size() == 0)
+    throw exception("Type mismatch");
+  Type type =
+      NodeView(reinterpret_cast<const PackedNodeLayout *>(s + src_ofs)).type();
+  if (type != Type::Object && type != Type::Array)
+    throw exception("Type mismatch");
+
+  // Everything under a container is allocated after its node, so the
+  // subtree lies in [src_ofs, end). Find `end` and how much of it is live.
+  size_t end = src_ofs + config::node_size;
+  size_t live = 0;
+  std::vector<std::pair<size_t, bool>> stack{{src_ofs, type == Type::Array}};
+  while (!stack.empty()) {
+    auto [node_ofs, is_array] = stack.back();
+    stack.pop_back();
+    NodeView node(reinterpret_cast<const PackedNodeLayout *>(s + node_ofs));
+    end = std::max(end, node_ofs + config::node_size);
+    live += config::node_size;
+    int count = static_cast<int>(node.key_count());
+    for (int i = 0; i <= count; ++i) {
+      if (node.get_child_offset(i))
+        stack.push_back({node.get_child_offset(i), is_array});
+      if (i == count)
+        break;
+      size_t kv = node.get_kv_offset(i);
+      size_t vo = is_array ? kv : kv + 1 + (s[kv] >> 2);
+      Type t = static_cast<Type>(s[vo]);
+      size_t entry_end = vo + 1 + scalar_size(s, vo);
+      end = std::max(end, entry_end);
+      live += entry_end - kv;
+      if (t == Type::Object || t == Type::Array)
+        stack.push_back({vo + 1, t == Type::Array});
+    }
+  }
+
+  NodeView dst(
+      reinterpret_cast<const PackedNodeLayout *>(m_data.data() + dst_ofs));
+  size_t o;
+  if (dst.type() == Type::Array) {
+    uint32_t size = dst.size();
+    o = set_impl(dst_ofs, {}, size, 0, nullptr, type, true);
+    MutableNodeView(
+        reinterpret_cast<PackedNodeLayout *>(m_data.data() + dst_ofs))
+        .set_size(size + 1);
+  } else {
+    o = set_impl(dst_ofs, key, utils::djb2_hash(key), 0, nullptr, type);
+  }
+  size_t root = o + 1;
+  if (root == m_used_size) {
+    ensure_capacity(config::node_size);
+    m_used_size += config::node_size;
+  }
+
+  if (live * 4 < (end - src_ofs) * 3) {
+    // Mostly dead bytes (overwritten values, unrelated siblings): rebuild.
+    std::memset(m_data.data() + root, 0, config::node_size);
+    MutableNodeView(reinterpret_cast<PackedNodeLayout *>(m_data.data() + root))
+        .set_gen_type(1, type);
+    copy_entries(root, s, src_ofs);
+    return root;
+  }
+
+  // The root node goes where the entry expects it; the rest of the block is
+  // appended at an offset congruent to its source offset, keeping split
+  // nodes aligned.
+  std::memcpy(m_data.data() + root, s + src_ofs, config::node_size);
+  size_t from = src_ofs + config::node_size;
+  size_t len = end - from;
+  size_t pad = (from - m_used_size) & (config::node_alignment - 1);
+  ensure_capacity(pad + len);
+  size_t block = m_used_size + pad;
+  std::memcpy(m_data.data() + block, s + from, len);
+  m_used_size = block + len;
+  size_t delta = block - from; // Modular: applied with unsigned wraparound
+
+  DigestTable *digests = m_digests.table.get();
+  const DigestTable *src_digests = src.digest_table();
+  uint8_t *base = m_data.data();
+  struct Pending {
+    size_t node_ofs;
+    size_t container_ofs;
+    bool is_array;
+  };
+  std::vector<Pending> pending{{root, root, type == Type::Array}};
+  while (!pending.empty()) {
+    Pending p = pending.back();
+    pending.pop_back();
+    MutableNodeView node(
+        reinterpret_cast<PackedNodeLayout *>(base + p.node_ofs));
+    if (digests && src_digests)
+      digests->set_subtree(p.node_ofs,
+                           src_digests->subtree(p.node_ofs == root
+                                                    ? src_ofs
+                                                    : p.node_ofs - delta));
+    int count = static_cast<int>(node.key_count());
+    for (int i = 0; i <= count; ++i) {
+      if (size_t child = node.get_child_offset(i)) {
+        node.set_child_offset(i, static_cast<uint32_t>(child + delta));
+        pending.push_back({child + delta, p.container_ofs, p.is_array});
+      }
+      if (i == count)
+        break;
+      size_t kv = node.get_kv_offset(i) + delta;
+      node.set_kv_offset(i, static_cast<uint32_t>(kv));
+      size_t vo = p.is_array ? kv : kv + 1 + (base[kv] >> 2);
+      Type t = static_cast<Type>(base[vo]);
+      if (t == Type::Object || t == Type::Array) {
+        pending.push_back({vo + 1, vo + 1, t == Type::Array});
+        if (digests)
+          digests->set_parent(vo + 1,
+                              {static_cast<uint32_t>(p.container_ofs),
+                               static_cast<uint32_t>(kv), node.get_hash(i)});
+      }
+    }
+  }
+
+  if (digests) {
+    uint64_t sum = src_digests
+                       ? digests->subtree(root)
+                       : digest_rebuild(root, root, type == Type::Array);
+    digest_propagate(nullptr, 0, root, sum);
+  }
+  return root;
+}
+
+void Buffer::copy_entries(size_t ofs, const uint8_t *src, size_t src_node) {
+  bool is_array =
+      NodeView(reinterpret_cast<const PackedNodeLayout *>(src + src_node))
+          .type() == Type::Array;
+  for_each_entry(src, src_node, [&](uint32_t, size_t kv) {
+    if (is_array) {
+      copy_value(ofs, {}, UINT32_MAX, src, kv);
+    } else {
+      std::string_view k(reinterpret_cast<const char *>(src + kv + 1),
+                         (src[kv] >> 2) - 1);
+      copy_value(ofs, k, 0, src, kv + 1 + (src[kv] >> 2));
+    }
+  });
+}
+
+size_t Buffer::arr_insert_value(size_t ofs, uint32_t index,
+                                const uint8_t *src, size_t src_vo) {
+  uint32_t size =
+      NodeView(reinterpret_cast<const PackedNodeLayout *>(m_data.data() + ofs))
+          .size();
+  if (index >= size)
+    return copy_value(ofs, {}, index, src, src_vo);
+  arr_renumber(ofs, index, 1);
+  size_t o = copy_value(ofs, {}, index, src, src_vo);
+  MutableNodeView(reinterpret_cast<PackedNodeLayout *>(m_data.data() + ofs))
+      .set_size(size + 1);
+  return o;
+}
+
+void Buffer::assign_root(const uint8_t *src, size_t src_vo) {
+  Type t = static_cast<Type>(src[src_vo]);
+  if (t != Type::Object && t != Type::Array)
+    throw exception("Type mismatch");
+  Buffer fresh;
+  if (t == Type::Array)
+    fresh.init_array();
+  else
+    fresh.init_object();
+  fresh.copy_entries(0, src, src_vo + 1);
+  if (digests_enabled())
+    fresh.enable_digests();
+  // Not a move assignment, which would free storage that readers of a
+  // ConcurrentBuffer may still be walking.
+  replace_storage(std::move(fresh.m_data));
+  m_used_size = fresh.m_used_size;
+  m_digests = std::move(fresh.m_digests);
+}
+
 // Array Getters
-const std::byte *Buffer::arr_get_impl(size_t ofs, uint32_t index,
-                                      Type &type) const {
-  return get_impl(ofs, {}, index, type, true);
+const std::byte *Buffer::arr_get_impl(size_t ofs, uint32_t index, Type &type,
+                                      const uint8_t **base) const {
+  return get_impl(ofs, {}, index, type, true, base);
 }
 
 int64_t Buffer::arr_get_i64(size_t ofs, uint32_t index) const {
@@ -696,7 +1306,8 @@ std::span<const std::byte> Buffer::arr_get_bytes(size_t ofs,
 }
 size_t Buffer::arr_get_obj(size_t ofs, uint32_t index) const {
   Type t;
-  auto *p = arr_get_impl(ofs, index, t);
+  const uint8_t *base;
+  auto *p = arr_get_impl(ofs, index, t, &base);
   if (!p || t != Type::Object)
     throw exception("Type mismatch");
   // Value points to Type, then Node data. p points to Node data start
@@ -705,16 +1316,15 @@ size_t Buffer::arr_get_obj(size_t ofs, uint32_t index) const {
   // type) So p points to Node data start? If Type is Object, value content
   // IS the Node structure (or nested structure). Yes. So offset of node is
   // p - m_data.data().
-  return static_cast<size_t>(reinterpret_cast<const uint8_t *>(p) -
-                             m_data.data());
+  return static_cast<size_t>(reinterpret_cast<const uint8_t *>(p) - base);
 }
 size_t Buffer::arr_get_arr(size_t ofs, uint32_t index) const {
   Type t;
-  auto *p = arr_get_impl(ofs, index, t);
+  const uint8_t *base;
+  auto *p = arr_get_impl(ofs, index, t, &base);
   if (!p || t != Type::Array)
     throw exception("Type mismatch");
-  return static_cast<size_t>(reinterpret_cast<const uint8_t *>(p) -
-                             m_data.data());
+  return static_cast<size_t>(reinterpret_cast<const uint8_t *>(p) - base);
 }
 Type Buffer::arr_get_type(size_t ofs, uint32_t index) const {
   Type t = Type::Null;
@@ -722,26 +1332,26 @@ Type Buffer::arr_get_type(size_t ofs, uint32_t index) const {
   return t;
 }
 Type Buffer::get_type(size_t ofs, std::string_view key) const {
-  Type t;
+  Type t = Type::Null;
   get_impl(ofs, key, utils::djb2_hash(key), t);
   return t;
 }
 
 size_t Buffer::get_obj(size_t ofs, std::string_view key) const {
   Type t;
-  auto *p = get_impl(ofs, key, utils::djb2_hash(key), t);
+  const uint8_t *base;
+  auto *p = get_impl(ofs, key, utils::djb2_hash(key), t, false, &base);
   if (!p || t != Type::Object)
     throw exception("Type mismatch");
-  return static_cast<size_t>(reinterpret_cast<const uint8_t *>(p) -
-                             m_data.data());
+  return static_cast<size_t>(reinterpret_cast<const uint8_t *>(p) - base);
 }
 size_t Buffer::get_arr(size_t ofs, std::string_view key) const {
   Type t;
-  auto *p = get_impl(ofs, key, utils::djb2_hash(key), t);
+  const uint8_t *base;
+  auto *p = get_impl(ofs, key, utils::djb2_hash(key), t, false, &base);
   if (!p || t != Type::Array)
     throw exception("Type mismatch");
-  return static_cast<size_t>(reinterpret_cast<const uint8_t *>(p) -
-                             m_data.data());
+  return static_cast<size_t>(reinterpret_cast<const uint8_t *>(p) - base);
 }
 
 std::span<const std::byte> Buffer::get_bytes(size_t ofs,
@@ -764,6 +1374,180 @@ std::span<const std::byte> Buffer::get_bytes(size_t ofs,
   return {};
 }
 
+Buffer::DigestRef::DigestRef() = default;
+Buffer::DigestRef::DigestRef(const DigestRef &other)
+    : table(other.table ? std::make_unique<DigestTable>(*other.table)
+                        : nullptr) {}
+Buffer::DigestRef::DigestRef(DigestRef &&other) noexcept = default;
+Buffer::DigestRef &Buffer::DigestRef::operator=(const DigestRef &other) {
+  if (this != &other)
+    table = other.table ? std::make_unique<DigestTable>(*other.table) : nullptr;
+  return *this;
+}
+Buffer::DigestRef &
+Buffer::DigestRef::operator=(DigestRef &&other) noexcept = default;
+Buffer::DigestRef::~DigestRef() = default;
+
+void Buffer::enable_digests() {
+  if (m_digests.table)
+    return;
+  m_digests.table = std::make_unique<DigestTable>();
+  if (m_used_size >= config::node_size) {
+    NodeView root(reinterpret_cast<const PackedNodeLayout *>(m_data.data()));
+    digest_rebuild(0, 0, root.type() == Type::Array);
+  }
+}
+
+void Buffer::disable_digests() { m_digests.table.reset(); }
+
+uint64_t Buffer::digest(size_t ofs) const {
+  if (!m_digests.table)
+    throw exception("Digests not enabled");
+  return m_digests.table->subtree(ofs);
+}
+
+// Hashes the subtree under the B-tree node at `node_ofs`, recursing into
+// nested containers first since their digests feed their parent entries.
+uint64_t Buffer::digest_rebuild(size_t container_ofs, size_t node_ofs,
+                                bool is_array) {
+  DigestTable &table = *m_digests.table;
+  NodeView node(
+      reinterpret_cast<const PackedNodeLayout *>(m_data.data() + node_ofs));
+  int count = static_cast<int>(node.key_count());
+  uint64_t sum = 0;
+  for (int i = 0; i <= count; ++i) {
+    if (node.get_child_offset(i))
+      sum += digest_rebuild(container_ofs, node.get_child_offset(i), is_array);
+    if (i == count)
+      break;
+    size_t kv = node.get_kv_offset(i);
+    size_t vo = is_array ? kv : kv + 1 + (m_data[kv] >> 2);
+    Type t = static_cast<Type>(m_data[vo]);
+    if (t == Type::Object || t == Type::Array) {
+      table.set_parent(vo + 1, {static_cast<uint32_t>(container_ofs),
+                                static_cast<uint32_t>(kv), node.get_hash(i)});
+      digest_rebuild(vo + 1, vo + 1, t == Type::Array);
+    }
+    sum += entry_digest(m_data.data(), kv, is_array, node.get_hash(i), table);
+  }
+  table.set_subtree(node_ofs, sum);
+  return sum;
+}
+
+// After a split moved the upper half of `node_ofs` into `sibling_ofs` and the
+// median into the parent, re-derives both halves' sums. The parent's subtree
+// is unchanged.
+void Buffer::digest_split(size_t node_ofs, size_t sibling_ofs,
+                          size_t median_kv, uint32_t median_hash,
+                          bool is_array) {
+  DigestTable &table = *m_digests.table;
+  const uint8_t *base = m_data.data();
+  NodeView sibling(
+      reinterpret_cast<const PackedNodeLayout *>(base + sibling_ofs));
+  int count = static_cast<int>(sibling.key_count());
+  uint64_t sum = 0;
+  for (int i = 0; i <= count; ++i) {
+    if (sibling.get_child_offset(i))
+      sum += table.subtree(sibling.get_child_offset(i));
+    if (i < count)
+      sum += entry_digest(base, sibling.get_kv_offset(i), is_array,
+                          sibling.get_hash(i), table);
+  }
+  table.set_subtree(sibling_ofs, sum);
+  table.add_subtree(node_ofs,
+                    0 - sum -
+                        entry_digest(base, median_kv, is_array, median_hash,
+                                     table));
+}
+
+// Applies the change of one entry (old digest `old_entry`, now stored at
+// `kv_ofs`) along `path` and up through the enclosing containers.
+void Buffer::digest_commit(const size_t *path, int path_depth,
+                           size_t container_ofs, size_t kv_ofs,
+                           uint32_t key_hash, bool is_array,
+                           uint64_t old_entry) {
+  DigestTable &table = *m_digests.table;
+  const uint8_t *base = m_data.data();
+  size_t vo = is_array ? kv_ofs : kv_ofs + 1 + (base[kv_ofs] >> 2);
+  Type t = static_cast<Type>(base[vo]);
+  if (t == Type::Object || t == Type::Array) {
+    // set_obj/set_arr/append_* initialize a fresh, empty node at vo + 1.
+    table.set_subtree(vo + 1, 0);
+    table.set_parent(vo + 1, {static_cast<uint32_t>(container_ofs),
+                              static_cast<uint32_t>(kv_ofs), key_hash});
+  }
+  digest_propagate(path, path_depth, container_ofs,
+                   entry_digest(base, kv_ofs, is_array, key_hash, table) -
+                       old_entry);
+}
+
+// Adds `delta` to every node on `path` within the container at
+// `container_ofs`, then re-hashes the entries holding the enclosing
+// containers up to the root.
+void Buffer::digest_propagate(const size_t *path, int path_depth,
+                              size_t container_ofs, uint64_t delta) {
+  DigestTable &table = *m_digests.table;
+  const uint8_t *base = m_data.data();
+  size_t chain[config::tree_height_max + 1];
+  while (delta != 0) {
+    for (int d = 0; d < path_depth; ++d)
+      table.add_subtree(path[d], delta);
+
+    const DigestTable::Link *link = table.parent(container_ofs);
+    if (!link)
+      return;
+    uint64_t now = table.subtree(container_ofs);
+    size_t parent = link->parent;
+    size_t entry_kv = link->kv_ofs;
+    uint32_t entry_hash = link->hash;
+    bool parent_is_array =
+        NodeView(reinterpret_cast<const PackedNodeLayout *>(base + parent))
+            .type() == Type::Array;
+
+    // Find the entry in the parent, verifying it still holds this container
+    // (an overwritten container is orphaned and stops propagating).
+    size_t entry_vo = parent_is_array
+                          ? entry_kv
+                          : entry_kv + 1 + (base[entry_kv] >> 2);
+    Type entry_type = static_cast<Type>(base[entry_vo]);
+    if ((entry_type != Type::Object && entry_type != Type::Array) ||
+        entry_vo + 1 != container_ofs)
+      return;
+    std::string_view key;
+    if (!parent_is_array)
+      key = std::string_view(reinterpret_cast<const char *>(base + entry_kv + 1),
+                             (base[entry_kv] >> 2) - 1);
+    int depth = 0;
+    size_t node_ofs = parent;
+    bool found = false;
+    while (depth <= static_cast<int>(config::tree_height_max)) {
+      chain[depth++] = node_ofs;
+      NodeView node(
+          reinterpret_cast<const PackedNodeLayout *>(base + node_ofs));
+      int i = 0, count = static_cast<int>(node.key_count());
+      while (i < count && compare_node_key(base, node, i, entry_hash, key,
+                                           parent_is_array) < 0)
+        i++;
+      if (i < count && node.get_kv_offset(i) == entry_kv) {
+        found = true;
+        break;
+      }
+      if (!node.get_child_offset(i))
+        break;
+      node_ofs = node.get_child_offset(i);
+    }
+    if (!found)
+      return;
+
+    delta = entry_digest_with(base, entry_kv, parent_is_array, entry_hash, now) -
+            entry_digest_with(base, entry_kv, parent_is_array, entry_hash,
+                              now - delta);
+    path = chain;
+    path_depth = depth;
+    container_ofs = parent;
+  }
+}
+
 Iterator Buffer::begin(size_t ofs) const {
   if (m_data.empty())
     return Iterator(nullptr, 0, 0, 0);
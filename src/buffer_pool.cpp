@@ -0,0 +1,35 @@
+#include "buffer_pool.hpp"
+#include <utility>
+
+namespace lite3cpp {
+
+BufferPool::BufferPool(size_t max_pooled, size_t initial_capacity)
+    : m_max_pooled(max_pooled), m_initial_capacity(initial_capacity) {}
+
+Buffer BufferPool::acquire() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_free.empty()) {
+      Buffer buf = std::move(m_free.back());
+      m_free.pop_back();
+      return buf;
+    }
+  }
+  return Buffer(m_initial_capacity);
+}
+
+void BufferPool::release(Buffer buf) {
+  buf.clear();
+  // The next user starts from a plain buffer, as from a fresh one.
+  buf.disable_digests();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_free.size() < m_max_pooled)
+    m_free.push_back(std::move(buf));
+}
+
+size_t BufferPool::pooled() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_free.size();
+}
+
+} // namespace lite3cpp
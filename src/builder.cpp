@@ -0,0 +1,330 @@
+#include "builder.hpp"
+#include "exception.hpp"
+#include "utils/hash.hpp"
+#include "utils/parallel.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace lite3cpp {
+
+namespace {
+
+constexpr size_t fanout_max = config::node_key_count + 1;
+
+// Number of children a node splits `n` subtree entries into, or 0 when they
+// fit in one leaf. The tree gets the least height h with 8^h - 1 >= n, and
+// the children share the entries evenly, so leaves sit at one depth.
+size_t fanout(size_t n) {
+  if (n <= config::node_key_count)
+    return 0;
+  size_t sub = fanout_max; // Capacity of a child subtree, plus one
+  while (sub * fanout_max - 1 < n)
+    sub *= fanout_max;
+  return (n + sub) / sub; // ceil((n + 1) / sub)
+}
+
+size_t node_count(size_t n) {
+  size_t k = fanout(n);
+  if (k == 0)
+    return 1;
+  size_t rest = n - (k - 1);
+  size_t total = 1;
+  for (size_t c = 0; c < k; ++c)
+    total += node_count(rest / k + (c < rest % k ? 1 : 0));
+  return total;
+}
+
+std::string_view entry_key(const uint8_t *base, size_t kv_ofs) {
+  return {reinterpret_cast<const char *>(base + kv_ofs + 1),
+          static_cast<size_t>((base[kv_ofs] >> 2) - 1)};
+}
+
+} // namespace
+
+Builder::Builder(Buffer &out) { reset(out); }
+
+void Builder::reset(Buffer &out) {
+  m_buf = &out;
+  m_buf->clear();
+  m_rebuild_digests = out.digests_enabled();
+  m_frames.clear();
+  m_members.clear();
+  m_key_ofs = SIZE_MAX;
+}
+
+void Builder::begin_object() { begin_container(Type::Object); }
+
+void Builder::begin_array() { begin_container(Type::Array); }
+
+void Builder::begin_container(Type type) {
+  size_t node_ofs;
+  if (m_frames.empty()) {
+    if (m_buf->m_used_size != 0)
+      throw exception("Builder: document already complete");
+    m_buf->ensure_capacity(config::node_size);
+    node_ofs = 0;
+    m_buf->m_used_size = config::node_size;
+  } else {
+    node_ofs = begin_value(type, config::node_size) + 1;
+  }
+  std::memset(m_buf->m_data.data() + node_ofs, 0, config::node_size);
+  MutableNodeView(
+      reinterpret_cast<PackedNodeLayout *>(m_buf->m_data.data() + node_ofs))
+      .set_gen_type(1, type);
+  m_frames.push_back({node_ofs, m_members.size(), type == Type::Array});
+}
+
+void Builder::end() {
+  if (m_frames.empty())
+    throw exception("Builder: no open container");
+  if (m_key_ofs != SIZE_MAX)
+    throw exception("Builder: key without a value");
+  Frame f = m_frames.back();
+  Member *first = m_members.data() + f.first_member;
+  size_t n = m_members.size() - f.first_member;
+  const uint8_t *base = m_buf->m_data.data();
+
+  if (!f.is_array && n > 1) {
+    // Entries are appended in arrival order, so kv_ofs breaks ties between
+    // duplicate keys and the last of each run is the one to keep.
+    std::sort(first, first + n, [base](const Member &a, const Member &b) {
+      if (a.hash != b.hash)
+        return a.hash < b.hash;
+      int c = entry_key(base, a.kv_ofs).compare(entry_key(base, b.kv_ofs));
+      return c != 0 ? c < 0 : a.kv_ofs < b.kv_ofs;
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (i + 1 < n && first[i].hash == first[i + 1].hash &&
+          entry_key(base, first[i].kv_ofs) ==
+              entry_key(base, first[i + 1].kv_ofs))
+        continue;
+      first[kept++] = first[i];
+    }
+    n = kept;
+  }
+
+  // Allocate every node of the tree up front so building never reallocates.
+  size_t extra = node_count(n) - 1;
+  if (extra) {
+    size_t aligned = (m_buf->m_used_size + config::node_alignment - 1) &
+                     ~(config::node_alignment - 1);
+    m_buf->ensure_capacity(aligned - m_buf->m_used_size +
+                          extra * config::node_size);
+    m_buf->m_used_size = aligned;
+  }
+  Type type = f.is_array ? Type::Array : Type::Object;
+  build(f.node_ofs, type, first, n);
+  if (f.is_array)
+    MutableNodeView(
+        reinterpret_cast<PackedNodeLayout *>(m_buf->m_data.data() + f.node_ofs))
+        .set_size(static_cast<uint32_t>(n));
+
+  m_members.resize(f.first_member);
+  m_frames.pop_back();
+  if (m_frames.empty() && m_rebuild_digests)
+    m_buf->digest_rebuild(0, 0, f.is_array);
+}
+
+void Builder::build(size_t node_ofs, Type type, const Member *members,
+                    size_t n) {
+  MutableNodeView node(
+      reinterpret_cast<PackedNodeLayout *>(m_buf->m_data.data() + node_ofs));
+  size_t k = fanout(n);
+  if (k == 0) {
+    for (size_t i = 0; i < n; ++i) {
+      node.set_hash(static_cast<int>(i), members[i].hash);
+      node.set_kv_offset(static_cast<int>(i), members[i].kv_ofs);
+    }
+    node.set_key_count(static_cast<uint32_t>(n));
+    return;
+  }
+
+  size_t rest = n - (k - 1);
+  size_t pos = 0;
+  for (size_t c = 0; c < k; ++c) {
+    size_t count = rest / k + (c < rest % k ? 1 : 0);
+    size_t child = m_buf->m_used_size;
+    m_buf->m_used_size += config::node_size;
+    std::memset(m_buf->m_data.data() + child, 0, config::node_size);
+    MutableNodeView(
+        reinterpret_cast<PackedNodeLayout *>(m_buf->m_data.data() + child))
+        .set_gen_type(1, type);
+    node.set_child_offset(static_cast<int>(c), static_cast<uint32_t>(child));
+    build(child, type, members + pos, count);
+    pos += count;
+    if (c + 1 < k) {
+      node.set_hash(static_cast<int>(c), members[pos].hash);
+      node.set_kv_offset(static_cast<int>(c), members[pos].kv_ofs);
+      ++pos;
+    }
+  }
+  node.set_key_count(static_cast<uint32_t>(k - 1));
+}
+
+void Builder::relocate_elements(size_t delta) {
+  uint8_t *base = m_buf->m_data.data();
+  std::vector<std::pair<size_t, bool>> stack;
+  for (const Member &m : m_members) {
+    Type t = static_cast<Type>(base[m.kv_ofs]);
+    if (t == Type::Object || t == Type::Array)
+      stack.push_back({m.kv_ofs + 1, t == Type::Array});
+    while (!stack.empty()) {
+      auto [node_ofs, is_array] = stack.back();
+      stack.pop_back();
+      MutableNodeView node(
+          reinterpret_cast<PackedNodeLayout *>(base + node_ofs));
+      int count = static_cast<int>(node.key_count());
+      for (int i = 0; i <= count; ++i) {
+        if (size_t child = node.get_child_offset(i)) {
+          node.set_child_offset(i, static_cast<uint32_t>(child + delta));
+          stack.push_back({child, is_array});
+        }
+        if (i == count)
+          break;
+        size_t kv = node.get_kv_offset(i);
+        node.set_kv_offset(i, static_cast<uint32_t>(kv + delta));
+        size_t vo = is_array ? kv : kv + 1 + (base[kv] >> 2);
+        Type vt = static_cast<Type>(base[vo]);
+        if (vt == Type::Object || vt == Type::Array)
+          stack.push_back({vo + 1, vt == Type::Array});
+      }
+    }
+  }
+}
+
+size_t Builder::splice_size() const {
+  return m_buf->m_used_size - config::node_size + config::node_alignment - 1;
+}
+
+void Builder::reserve(size_t bytes, size_t elements) {
+  m_buf->ensure_capacity(bytes + config::node_alignment - 1 +
+                        (node_count(elements) - 1) * config::node_size);
+  m_members.reserve(m_members.size() + elements);
+}
+
+size_t Builder::reserve_splice(const Builder &part) {
+  size_t from = config::node_size;
+  size_t len = part.m_buf->m_used_size - from;
+  size_t pad = (from - m_buf->m_used_size) & (config::node_alignment - 1);
+  m_buf->ensure_capacity(pad + len);
+  size_t block = m_buf->m_used_size + pad;
+  m_buf->m_used_size = block + len;
+  return block;
+}
+
+void Builder::copy_splice(const Builder &part, size_t block) {
+  std::memcpy(m_buf->m_data.data() + block,
+              part.m_buf->m_data.data() + config::node_size,
+              part.m_buf->m_used_size - config::node_size);
+}
+
+void Builder::add_spliced(const Builder &part, size_t delta) {
+  uint32_t index =
+      static_cast<uint32_t>(m_members.size() - m_frames.back().first_member);
+  for (const Member &m : part.m_members)
+    m_members.push_back({index++, static_cast<uint32_t>(m.kv_ofs + delta)});
+}
+
+void Builder::splice(std::span<Builder *const> parts, unsigned threads) {
+  size_t bytes = 0;
+  size_t elements = 0;
+  for (const Builder *part : parts) {
+    bytes += part->splice_size();
+    elements += part->m_members.size();
+  }
+  reserve(bytes, elements);
+  std::vector<size_t> blocks;
+  for (const Builder *part : parts)
+    blocks.push_back(reserve_splice(*part));
+
+  utils::run_parallel(threads, parts.size(), [&](size_t i) {
+    parts[i]->relocate_elements(blocks[i] - config::node_size);
+    copy_splice(*parts[i], blocks[i]);
+    *parts[i]->m_buf = Buffer(); // Released as soon as it is copied
+  });
+
+  for (size_t i = 0; i < parts.size(); ++i)
+    add_spliced(*parts[i], blocks[i] - config::node_size);
+}
+
+void Builder::key(std::string_view key) {
+  this->key(key, utils::djb2_hash(key));
+}
+
+void Builder::key(std::string_view key, uint32_t hash) {
+  if (m_frames.empty() || m_frames.back().is_array || m_key_ofs != SIZE_MAX)
+    throw exception("Builder: key outside an object");
+  if (key.size() > 62)
+    throw exception("Builder: key too long");
+  m_buf->ensure_capacity(key.size() + 2);
+  uint8_t *p = m_buf->m_data.data() + m_buf->m_used_size;
+  p[0] = static_cast<uint8_t>((key.size() + 1) << 2);
+  std::memcpy(p + 1, key.data(), key.size());
+  p[1 + key.size()] = 0;
+  m_key_ofs = m_buf->m_used_size;
+  m_key_hash = hash;
+  m_buf->m_used_size += key.size() + 2;
+}
+
+size_t Builder::begin_value(Type type, size_t payload) {
+  if (m_frames.empty())
+    throw exception("Builder: value outside a container");
+  const Frame &f = m_frames.back();
+  uint32_t hash;
+  size_t kv;
+  if (f.is_array) {
+    hash = static_cast<uint32_t>(m_members.size() - f.first_member);
+    kv = m_buf->m_used_size;
+  } else {
+    if (m_key_ofs == SIZE_MAX)
+      throw exception("Builder: value without a key");
+    hash = m_key_hash;
+    kv = m_key_ofs;
+    m_key_ofs = SIZE_MAX;
+  }
+  m_buf->ensure_capacity(1 + payload);
+  m_members.push_back({hash, static_cast<uint32_t>(kv)});
+  size_t vo = m_buf->m_used_size;
+  m_buf->m_data[vo] = static_cast<uint8_t>(type);
+  m_buf->m_used_size += 1 + payload;
+  return vo;
+}
+
+void Builder::add_null() { begin_value(Type::Null, 0); }
+
+void Builder::add_bool(bool value) {
+  size_t vo = begin_value(Type::Bool, 1);
+  m_buf->m_data[vo + 1] = value ? 1 : 0;
+}
+
+void Builder::add_i64(int64_t value) {
+  size_t vo = begin_value(Type::Int64, 8);
+  std::memcpy(m_buf->m_data.data() + vo + 1, &value, 8);
+}
+
+void Builder::add_f64(double value) {
+  size_t vo = begin_value(Type::Float64, 8);
+  std::memcpy(m_buf->m_data.data() + vo + 1, &value, 8);
+}
+
+void Builder::add_str(std::string_view value) {
+  size_t vo = begin_value(Type::String, 4 + value.size() + 1);
+  uint8_t *p = m_buf->m_data.data() + vo + 1;
+  uint32_t len = static_cast<uint32_t>(value.size());
+  std::memcpy(p, &len, 4);
+  if (len)
+    std::memcpy(p + 4, value.data(), len);
+  p[4 + len] = 0;
+}
+
+void Builder::add_bytes(std::span<const std::byte> value) {
+  size_t vo = begin_value(Type::Bytes, 4 + value.size());
+  uint8_t *p = m_buf->m_data.data() + vo + 1;
+  uint32_t len = static_cast<uint32_t>(value.size());
+  std::memcpy(p, &len, 4);
+  if (len)
+    std::memcpy(p + 4, value.data(), len);
+}
+
+} // namespace lite3cpp
@@ -0,0 +1,586 @@
+#include "cbor.hpp"
+#include "builder.hpp"
+#include "exception.hpp"
+#include "node.hpp"
+#include "utils/big_endian.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace lite3cpp {
+namespace lite3_cbor {
+
+namespace {
+
+constexpr size_t max_depth = 512;
+constexpr uint8_t break_code = 0xff;
+
+// Thrown when the input ends inside a value; read_cbor reports it as a need
+// for more input, parse_cbor as an error.
+struct Truncated {};
+
+// Decodes IEEE 754 half precision, as in RFC 8949 appendix D.
+double half_to_double(uint16_t h) {
+  int exp = (h >> 10) & 0x1f;
+  int mant = h & 0x3ff;
+  double v;
+  if (exp == 0)
+    v = std::ldexp(mant, -24);
+  else if (exp != 31)
+    v = std::ldexp(mant + 1024, exp - 25);
+  else
+    v = mant == 0 ? INFINITY : NAN;
+  return (h & 0x8000) ? -v : v;
+}
+
+// Half precision bits for `f`, when it converts without loss.
+bool half_bits(float f, uint16_t &out) {
+  uint32_t bits;
+  std::memcpy(&bits, &f, 4);
+  uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  int exp = static_cast<int>((bits >> 23) & 0xff);
+  uint32_t mant = bits & 0x7fffff;
+  if (exp == 0xff || (exp == 0 && mant == 0)) {
+    // Infinities and zeros; NaN is handled by the caller.
+    out = static_cast<uint16_t>(sign | (exp ? 0x7c00 : 0));
+    return true;
+  }
+  int e = exp - 127;
+  if (exp == 0 || e > 15 || e < -24)
+    return false;
+  if (e >= -14) {
+    if (mant & 0x1fff)
+      return false;
+    out = static_cast<uint16_t>(sign | (e + 15) << 10 | mant >> 13);
+    return true;
+  }
+  // Subnormal half: the value is m * 2^-24 for an integer m below 1024.
+  uint32_t full = mant | 0x800000;
+  int shift = -(e + 1);
+  if (full & ((1u << shift) - 1))
+    return false;
+  out = static_cast<uint16_t>(sign | full >> shift);
+  return true;
+}
+
+// Single pass over the encoded bytes, feeding a Builder. A scalar root is
+// read through but not built.
+class Reader {
+public:
+  Reader(std::span<const uint8_t> data, Builder &builder)
+      : m_begin(data.data()), m_p(m_begin), m_end(m_begin + data.size()),
+        m_builder(builder) {}
+
+  // Reads one data item. Returns false when it was not a map or array.
+  bool document() {
+    value(0);
+    return !m_discard;
+  }
+
+  size_t consumed() const { return static_cast<size_t>(m_p - m_begin); }
+
+private:
+  [[noreturn]] void fail(const uint8_t *at, const char *what) const {
+    throw exception(std::string(what) + " in CBOR at offset " +
+                    std::to_string(at - m_begin));
+  }
+
+  void need(uint64_t n) const {
+    if (static_cast<uint64_t>(m_end - m_p) < n)
+      throw Truncated{};
+  }
+
+  template <typename T> T read() {
+    need(sizeof(T));
+    T v = utils::load_be<T>(m_p);
+    m_p += sizeof(T);
+    return v;
+  }
+
+  // The argument of the head starting at `start`, from its additional
+  // information.
+  uint64_t argument(const uint8_t *start, uint8_t ai) {
+    switch (ai) {
+    case 24:
+      return read<uint8_t>();
+    case 25:
+      return read<uint16_t>();
+    case 26:
+      return read<uint32_t>();
+    case 27:
+      return read<uint64_t>();
+    default:
+      if (ai < 24)
+        return ai;
+      fail(start, "Invalid additional information");
+    }
+  }
+
+  void value(size_t depth) {
+    const uint8_t *start = m_p;
+    uint8_t c = read<uint8_t>();
+    // Tags only annotate the item that follows; skip straight to it.
+    while ((c >> 5) == 6) {
+      argument(start, c & 0x1f);
+      start = m_p;
+      c = read<uint8_t>();
+    }
+    uint8_t major = c >> 5;
+    uint8_t ai = c & 0x1f;
+    if (depth == 0)
+      m_discard = major != 4 && major != 5;
+    if (major == 7)
+      return simple(start, ai);
+    bool indefinite = ai == 31;
+    uint64_t n = 0;
+    if (indefinite) {
+      if (major < 2)
+        fail(start, "Invalid additional information");
+    } else {
+      n = argument(start, ai);
+    }
+    switch (major) {
+    case 0:
+    case 1:
+      if (n > static_cast<uint64_t>(INT64_MAX))
+        fail(start, "Integer out of Int64 range");
+      // Major type 1 encodes -1 - n.
+      if (!m_discard)
+        m_builder.add_i64(major == 0 ? static_cast<int64_t>(n)
+                                     : -1 - static_cast<int64_t>(n));
+      return;
+    case 2: {
+      std::string_view s = indefinite ? chunks(2) : raw(n);
+      if (!m_discard)
+        m_builder.add_bytes(
+            {reinterpret_cast<const std::byte *>(s.data()), s.size()});
+      return;
+    }
+    case 3: {
+      std::string_view s = indefinite ? chunks(3) : raw(n);
+      if (!m_discard)
+        m_builder.add_str(s);
+      return;
+    }
+    case 4:
+      return array(start, depth, n, indefinite);
+    default:
+      return map(start, depth, n, indefinite);
+    }
+  }
+
+  void simple(const uint8_t *start, uint8_t ai) {
+    switch (ai) {
+    case 20:
+    case 21:
+      if (!m_discard)
+        m_builder.add_bool(ai == 21);
+      return;
+    case 22:
+    case 23: // undefined
+      if (!m_discard)
+        m_builder.add_null();
+      return;
+    case 25:
+      return real(half_to_double(read<uint16_t>()));
+    case 26: {
+      float f;
+      uint32_t bits = read<uint32_t>();
+      std::memcpy(&f, &bits, 4);
+      return real(f);
+    }
+    case 27: {
+      double d;
+      uint64_t bits = read<uint64_t>();
+      std::memcpy(&d, &bits, 8);
+      return real(d);
+    }
+    case 24:
+      read<uint8_t>();
+      fail(start, "Unsupported simple value");
+    case 28:
+    case 29:
+    case 30:
+      fail(start, "Invalid additional information");
+    case 31:
+      fail(start, "Unexpected break");
+    default:
+      fail(start, "Unsupported simple value");
+    }
+  }
+
+  void real(double v) {
+    if (!m_discard)
+      m_builder.add_f64(v);
+  }
+
+  std::string_view raw(uint64_t n) {
+    need(n);
+    std::string_view s(reinterpret_cast<const char *>(m_p), n);
+    m_p += n;
+    return s;
+  }
+
+  // Consumes a break code if one is next.
+  bool at_break() {
+    need(1);
+    if (*m_p != break_code)
+      return false;
+    ++m_p;
+    return true;
+  }
+
+  // Joins the definite-length chunks of an indefinite-length string of
+  // major type `major`.
+  std::string_view chunks(uint8_t major) {
+    m_chunks.clear();
+    while (!at_break()) {
+      const uint8_t *at = m_p;
+      uint8_t c = read<uint8_t>();
+      if ((c >> 5) != major || (c & 0x1f) == 31)
+        fail(at, "Invalid chunk in indefinite-length string");
+      m_chunks.append(raw(argument(at, c & 0x1f)));
+    }
+    return m_chunks;
+  }
+
+  void array(const uint8_t *start, size_t depth, uint64_t n,
+             bool indefinite) {
+    if (++depth > max_depth)
+      fail(start, "Nesting too deep");
+    // Every element takes at least a byte.
+    need(n);
+    m_builder.begin_array();
+    for (uint64_t i = 0; indefinite ? !at_break() : i < n; ++i)
+      value(depth);
+    m_builder.end();
+  }
+
+  void map(const uint8_t *start, size_t depth, uint64_t n, bool indefinite) {
+    if (++depth > max_depth)
+      fail(start, "Nesting too deep");
+    need(n);
+    m_builder.begin_object();
+    for (uint64_t i = 0; indefinite ? !at_break() : i < n; ++i) {
+      const uint8_t *at = m_p;
+      uint8_t c = read<uint8_t>();
+      if ((c >> 5) != 3)
+        fail(at, "Map key is not a text string");
+      std::string_view key =
+          (c & 0x1f) == 31 ? chunks(3) : raw(argument(at, c & 0x1f));
+      if (key.size() > 62)
+        fail(at, "Map key too long");
+      m_builder.key(key);
+      value(depth);
+    }
+    m_builder.end();
+  }
+
+  const uint8_t *m_begin;
+  const uint8_t *m_p;
+  const uint8_t *m_end;
+  Builder &m_builder;
+  std::string m_chunks;
+  bool m_discard = false;
+};
+
+// Reads one data item into `out`; returns the bytes taken, or 0 if the
+// input ends inside it and `stream` is set.
+size_t read_value(std::span<const uint8_t> data, Buffer &out, bool stream) {
+  thread_local Builder builder;
+  try {
+    builder.reset(out);
+    Reader reader(data, builder);
+    if (!reader.document())
+      out.clear();
+    return reader.consumed();
+  } catch (const Truncated &) {
+    out.clear();
+    if (stream)
+      return 0;
+    throw exception("Truncated CBOR at offset " + std::to_string(data.size()));
+  } catch (...) {
+    out.clear();
+    throw;
+  }
+}
+
+// Walks the B-tree as the MessagePack writer does, into a span that grows
+// only when backed by a vector.
+class Writer {
+public:
+  Writer(const uint8_t *base, uint8_t *out, size_t capacity,
+         std::vector<uint8_t> *grow, size_t pos, bool canonical)
+      : m_base(base), m_out(out), m_capacity(capacity), m_grow(grow),
+        m_pos(pos), m_canonical(canonical) {}
+
+  void root() { container(0); }
+
+  void value(size_t vo) {
+    const uint8_t *p = m_base + vo + 1;
+    switch (static_cast<Type>(m_base[vo])) {
+    case Type::Bool:
+      put(*p ? 0xf5 : 0xf4);
+      break;
+    case Type::Int64: {
+      int64_t v;
+      std::memcpy(&v, p, 8);
+      // Negative n is major type 1 with argument -1 - n, which is ~n.
+      if (v >= 0)
+        head(0, static_cast<uint64_t>(v));
+      else
+        head(1, ~static_cast<uint64_t>(v));
+      break;
+    }
+    case Type::Float64: {
+      double d;
+      std::memcpy(&d, p, 8);
+      real(d);
+      break;
+    }
+    case Type::String:
+    case Type::Bytes: {
+      uint32_t len;
+      std::memcpy(&len, p, 4);
+      head(static_cast<Type>(m_base[vo]) == Type::String ? 3 : 2, len);
+      copy(p + 4, len);
+      break;
+    }
+    case Type::Object:
+    case Type::Array:
+      container(vo + 1);
+      break;
+    default:
+      put(0xf6);
+      break;
+    }
+  }
+
+  size_t pos() const { return m_pos; }
+
+private:
+  NodeView node_at(size_t ofs) const {
+    return NodeView(reinterpret_cast<const PackedNodeLayout *>(m_base + ofs));
+  }
+
+  // Object nodes do not track their size, so members are counted over the
+  // tree's nodes first.
+  size_t count(size_t node_ofs) const {
+    NodeView node = node_at(node_ofs);
+    size_t n = node.key_count();
+    for (int i = 0; i <= static_cast<int>(node.key_count()); ++i)
+      if (node.get_child_offset(i))
+        n += count(node.get_child_offset(i));
+    return n;
+  }
+
+  void container(size_t node_ofs) {
+    if (node_at(node_ofs).type() == Type::Array) {
+      head(4, node_at(node_ofs).size());
+      entries(node_ofs, true);
+    } else if (!m_canonical) {
+      head(5, count(node_ofs));
+      entries(node_ofs, false);
+    } else {
+      sorted_object(node_ofs);
+    }
+  }
+
+  void entries(size_t node_ofs, bool is_array) {
+    NodeView node = node_at(node_ofs);
+    int count = static_cast<int>(node.key_count());
+    for (int i = 0; i <= count; ++i) {
+      if (node.get_child_offset(i))
+        entries(node.get_child_offset(i), is_array);
+      if (i == count)
+        break;
+      size_t kv = node.get_kv_offset(i);
+      if (is_array)
+        value(kv);
+      else
+        member(kv);
+    }
+  }
+
+  void collect(size_t node_ofs) {
+    NodeView node = node_at(node_ofs);
+    int count = static_cast<int>(node.key_count());
+    for (int i = 0; i <= count; ++i) {
+      if (node.get_child_offset(i))
+        collect(node.get_child_offset(i));
+      if (i < count)
+        m_keys.push_back(node.get_kv_offset(i));
+    }
+  }
+
+  // Members in deterministic order. Each object sorts its own range at
+  // the end of m_keys, which nested objects extend and give back.
+  void sorted_object(size_t node_ofs) {
+    size_t first = m_keys.size();
+    collect(node_ofs);
+    const uint8_t *base = m_base;
+    std::sort(m_keys.begin() + first, m_keys.end(),
+              [base](size_t a, size_t b) {
+                // The tag holds the key length, so comparing it first puts
+                // shorter keys first, as their encoded heads do.
+                if (base[a] != base[b])
+                  return base[a] < base[b];
+                return std::memcmp(base + a + 1, base + b + 1,
+                                   (base[a] >> 2) - 1) < 0;
+              });
+    size_t last = m_keys.size();
+    head(5, last - first);
+    for (size_t i = first; i < last; ++i)
+      member(m_keys[i]);
+    m_keys.resize(first);
+  }
+
+  void member(size_t kv) {
+    size_t key_len = (m_base[kv] >> 2) - 1;
+    head(3, key_len);
+    copy(m_base + kv + 1, key_len);
+    value(kv + 2 + key_len);
+  }
+
+  void real(double d) {
+    uint64_t bits;
+    std::memcpy(&bits, &d, 8);
+    if (!m_canonical)
+      return tagged(0xfb, bits);
+    if (std::isnan(d))
+      return tagged(0xf9, static_cast<uint16_t>(0x7e00));
+    if (std::isinf(d) || std::fabs(d) <= FLT_MAX) {
+      float f = static_cast<float>(d);
+      if (static_cast<double>(f) == d) {
+        uint16_t h;
+        if (half_bits(f, h))
+          return tagged(0xf9, h);
+        uint32_t fbits;
+        std::memcpy(&fbits, &f, 4);
+        return tagged(0xfa, fbits);
+      }
+    }
+    tagged(0xfb, bits);
+  }
+
+  // Writes the shortest head for major type `major` and argument `n`.
+  void head(uint8_t major, uint64_t n) {
+    uint8_t m = static_cast<uint8_t>(major << 5);
+    if (n < 24)
+      put(static_cast<uint8_t>(m | n));
+    else if (n <= 0xff)
+      tagged(m | 24, static_cast<uint8_t>(n));
+    else if (n <= 0xffff)
+      tagged(m | 25, static_cast<uint16_t>(n));
+    else if (n <= 0xffffffff)
+      tagged(m | 26, static_cast<uint32_t>(n));
+    else
+      tagged(m | 27, n);
+  }
+
+  // An initial byte followed by a big-endian payload.
+  template <typename T> void tagged(uint8_t code, T v) {
+    uint8_t *d = reserve(1 + sizeof(T));
+    d[0] = code;
+    utils::store_be(d + 1, v);
+    m_pos += 1 + sizeof(T);
+  }
+
+  void copy(const uint8_t *p, size_t n) {
+    std::memcpy(reserve(n), p, n);
+    m_pos += n;
+  }
+
+  void put(uint8_t c) {
+    *reserve(1) = c;
+    ++m_pos;
+  }
+
+  uint8_t *reserve(size_t n) {
+    if (m_pos + n > m_capacity) {
+      if (!m_grow)
+        throw exception("CBOR output span too small");
+      m_grow->resize(std::max(m_grow->size() * 2, m_pos + n + 256));
+      m_out = m_grow->data();
+      m_capacity = m_grow->size();
+    }
+    return m_out + m_pos;
+  }
+
+  const uint8_t *m_base;
+  uint8_t *m_out;
+  size_t m_capacity;
+  std::vector<uint8_t> *m_grow;
+  size_t m_pos;
+  bool m_canonical;
+  std::vector<size_t> m_keys;
+};
+
+} // namespace
+
+void parse_cbor(std::span<const uint8_t> data, Buffer &out) {
+  size_t n = read_value(data, out, false);
+  if (n != data.size()) {
+    out.clear();
+    throw exception("Trailing bytes after CBOR at offset " +
+                    std::to_string(n));
+  }
+}
+
+Buffer parse_cbor(std::span<const uint8_t> data) {
+  Buffer buffer;
+  parse_cbor(data, buffer);
+  return buffer;
+}
+
+size_t read_cbor(std::span<const uint8_t> data, Buffer &out) {
+  return read_value(data, out, true);
+}
+
+size_t write_cbor(const Buffer &buffer, size_t ofs, std::span<uint8_t> out,
+                  const WriteOptions &options) {
+  if (buffer.size() == 0) {
+    if (out.empty())
+      throw exception("CBOR output span too small");
+    out[0] = 0xf6;
+    return 1;
+  }
+  Writer writer(buffer.data(), out.data(), out.size(), nullptr, 0,
+                options.canonical);
+  if (ofs == 0)
+    writer.root();
+  else
+    writer.value(ofs);
+  return writer.pos();
+}
+
+void write_cbor(const Buffer &buffer, size_t ofs, std::vector<uint8_t> &out,
+                const WriteOptions &options) {
+  if (buffer.size() == 0) {
+    out.push_back(0xf6);
+    return;
+  }
+  // Usually a little smaller than the buffer image.
+  size_t pos = out.size();
+  out.resize(pos + buffer.size());
+  Writer writer(buffer.data(), out.data(), out.size(), &out, pos,
+                options.canonical);
+  if (ofs == 0)
+    writer.root();
+  else
+    writer.value(ofs);
+  out.resize(writer.pos());
+}
+
+std::vector<uint8_t> to_cbor(const Buffer &buffer, size_t ofs,
+                             const WriteOptions &options) {
+  std::vector<uint8_t> out;
+  write_cbor(buffer, ofs, out, options);
+  return out;
+}
+
+} // namespace lite3_cbor
+} // namespace lite3cpp
@@ -0,0 +1,165 @@
+#include "columns.hpp"
+#include "exception.hpp"
+#include "node.hpp"
+#include "utils/tree_search.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace lite3cpp {
+
+namespace {
+
+// A column being filled.
+struct Field {
+  Column *column;
+  bool inferred = false;
+};
+
+class Filler {
+public:
+  Filler(const uint8_t *base, size_t rows) : m_base(base), m_rows(rows) {}
+
+  // Makes `column` ready to take `type` values from row `row` on; earlier
+  // rows were all null.
+  void resolve(Column &column, Type type, size_t row) {
+    column.type = type;
+    switch (type) {
+    case Type::Bool:
+      column.bools.assign(m_rows, 0);
+      break;
+    case Type::Int64:
+      column.i64.assign(m_rows, 0);
+      break;
+    case Type::Float64:
+      column.f64.assign(m_rows, 0.0);
+      break;
+    default:
+      column.offsets.reserve(m_rows + 1);
+      column.offsets.assign(row + 1, 0);
+      break;
+    }
+  }
+
+  // Stores the value whose type byte is at `vo` (0 for none) in `row`.
+  void put(Field &f, size_t row, size_t vo) {
+    Column &c = *f.column;
+    Type t = vo ? static_cast<Type>(m_base[vo]) : Type::Null;
+    if (t != Type::Null) {
+      if (c.type == Type::Null) {
+        if (t == Type::Object || t == Type::Array)
+          mismatch(c, t, row);
+        resolve(c, t, row);
+      }
+      const uint8_t *p = m_base + vo + 1;
+      if (t == c.type) {
+        switch (t) {
+        case Type::Bool:
+          c.bools[row] = *p ? 1 : 0;
+          break;
+        case Type::Int64:
+          std::memcpy(&c.i64[row], p, 8);
+          break;
+        case Type::Float64:
+          std::memcpy(&c.f64[row], p, 8);
+          break;
+        default: {
+          uint32_t len;
+          std::memcpy(&len, p, 4);
+          c.data.insert(c.data.end(), p + 4, p + 4 + len);
+          break;
+        }
+        }
+      } else if (t == Type::Int64 && c.type == Type::Float64) {
+        int64_t v;
+        std::memcpy(&v, p, 8);
+        c.f64[row] = static_cast<double>(v);
+      } else if (t == Type::Float64 && c.type == Type::Int64 && f.inferred) {
+        // The rows so far were whole numbers of a Float64 column.
+        c.f64.resize(m_rows);
+        for (size_t r = 0; r < row; ++r)
+          c.f64[r] = static_cast<double>(c.i64[r]);
+        std::vector<int64_t>().swap(c.i64);
+        c.type = Type::Float64;
+        std::memcpy(&c.f64[row], p, 8);
+      } else {
+        mismatch(c, t, row);
+      }
+      c.validity[row >> 3] |= static_cast<uint8_t>(1u << (row & 7));
+    } else {
+      ++c.null_count;
+    }
+    if (c.type == Type::String || c.type == Type::Bytes) {
+      if (c.data.size() > UINT32_MAX)
+        throw exception("Column " + c.path + " holds over 4 GB");
+      c.offsets.push_back(static_cast<uint32_t>(c.data.size()));
+    }
+  }
+
+private:
+  [[noreturn]] void mismatch(const Column &c, Type t, size_t row) const {
+    throw exception(
+        "Column " + c.path + " is not " +
+        (c.type == Type::Null ? "a scalar" : utils::type_name(c.type)) +
+        " at element " + std::to_string(row) + " (found " +
+        utils::type_name(t) + ")");
+  }
+
+  const uint8_t *m_base;
+  size_t m_rows;
+};
+
+} // namespace
+
+const Column *Columns::find(std::string_view path) const {
+  for (const Column &c : columns)
+    if (c.path == path)
+      return &c;
+  return nullptr;
+}
+
+Columns to_columns(const Buffer &buffer, size_t array_ofs,
+                   std::span<const ColumnSpec> fields) {
+  const uint8_t *base = buffer.data();
+  if (buffer.size() == 0)
+    throw exception("to_columns: not an array");
+  NodeView array(reinterpret_cast<const PackedNodeLayout *>(base + array_ofs));
+  if (array.type() != Type::Array)
+    throw exception("to_columns: not an array");
+
+  Columns out;
+  out.rows = array.size();
+  out.columns.resize(fields.size());
+  std::vector<Field> plan(fields.size());
+  utils::PathSet paths;
+  for (size_t i = 0; i < fields.size(); ++i) {
+    Type t = fields[i].type;
+    if (t != Type::Invalid && t != Type::Bool && t != Type::Int64 &&
+        t != Type::Float64 && t != Type::String && t != Type::Bytes)
+      throw exception("Column " + fields[i].path +
+                      " must be a Bool, Int64, Float64, String or Bytes");
+    Column &c = out.columns[i];
+    c.path = fields[i].path;
+    c.validity.assign((out.rows + 7) / 8, 0);
+    plan[i].column = &c;
+    plan[i].inferred = t == Type::Invalid;
+    paths.add(utils::split_pointer(fields[i].path, "Column path"));
+  }
+  paths.prepare();
+
+  Filler filler(base, out.rows);
+  for (size_t i = 0; i < fields.size(); ++i)
+    if (!plan[i].inferred)
+      filler.resolve(out.columns[i], fields[i].type, 0);
+
+  std::vector<size_t> found(paths.width());
+  size_t row = 0;
+  utils::walk_entries(base, array_ofs, [&](size_t vo) {
+    paths.resolve(base, vo, found.data());
+    for (size_t i = 0; i < plan.size(); ++i)
+      filler.put(plan[i], row, found[i]);
+    ++row;
+  });
+  return out;
+}
+
+} // namespace lite3cpp
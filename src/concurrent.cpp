@@ -0,0 +1,93 @@
+#include "concurrent.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace lite3cpp {
+
+EpochManager::EpochManager(size_t slot_count)
+    : m_slots(new Slot[std::max<size_t>(slot_count, 1)]),
+      m_slot_count(std::max<size_t>(slot_count, 1)) {}
+
+EpochManager::Guard EpochManager::pin() {
+  // Threads start probing at a stable per-thread position so that readers
+  // normally own distinct slots (and cache lines) without coordination.
+  static std::atomic<size_t> next_hint{0};
+  thread_local size_t hint = next_hint.fetch_add(1, std::memory_order_relaxed);
+
+  for (size_t probe = 0;; ++probe) {
+    Slot &slot = m_slots[(hint + probe) % m_slot_count];
+    uint64_t idle = 0;
+    uint64_t epoch = m_global_epoch.load(std::memory_order_acquire);
+    if (slot.epoch.compare_exchange_strong(idle, epoch,
+                                           std::memory_order_seq_cst)) {
+      // Pairs with the fence in collect(): either the writer sees this slot,
+      // or this reader sees the storage swap that preceded the retirement.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      return Guard(&slot.epoch);
+    }
+    if (probe % m_slot_count == m_slot_count - 1)
+      std::this_thread::yield();
+  }
+}
+
+void EpochManager::retire(std::vector<uint8_t> storage) {
+  uint64_t epoch = m_global_epoch.fetch_add(1, std::memory_order_acq_rel);
+  m_retired.push_back({epoch, std::move(storage), nullptr});
+}
+
+void EpochManager::retire(std::unique_ptr<StorageView> view) {
+  uint64_t epoch = m_global_epoch.fetch_add(1, std::memory_order_acq_rel);
+  m_retired.push_back({epoch, {}, std::move(view)});
+}
+
+void EpochManager::collect() {
+  if (m_retired.empty())
+    return;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  uint64_t oldest = UINT64_MAX;
+  for (size_t i = 0; i < m_slot_count; ++i) {
+    uint64_t e = m_slots[i].epoch.load(std::memory_order_acquire);
+    if (e != 0 && e < oldest)
+      oldest = e;
+  }
+
+  // A reader pinned at epoch E may hold storage retired at epoch >= E.
+  m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(),
+                                 [oldest](const Retired &r) {
+                                   return r.epoch < oldest;
+                                 }),
+                  m_retired.end());
+}
+
+ConcurrentBuffer::ConcurrentBuffer() { m_buffer.m_reclaimer.ptr = &m_epochs; }
+
+ConcurrentBuffer::ConcurrentBuffer(Buffer buf) : m_buffer(std::move(buf)) {
+  m_buffer.m_reclaimer.ptr = &m_epochs;
+}
+
+ConcurrentBuffer::~ConcurrentBuffer() { m_buffer.m_reclaimer.ptr = nullptr; }
+
+size_t ConcurrentBuffer::retired_count() const {
+  std::lock_guard<std::mutex> lock(m_writer);
+  return m_epochs.retired_count();
+}
+
+void ConcurrentBuffer::reclaim() {
+  std::lock_guard<std::mutex> lock(m_writer);
+  m_epochs.collect();
+}
+
+ConcurrentBuffer::WriteScope::WriteScope(ConcurrentBuffer &o)
+    : owner(o), seq(o.m_seq.load(std::memory_order_relaxed)) {
+  owner.m_seq.store(seq + 1, std::memory_order_relaxed);
+  // Orders the odd sequence number before any mutation of the buffer.
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+ConcurrentBuffer::WriteScope::~WriteScope() {
+  owner.m_seq.store(seq + 2, std::memory_order_release);
+  owner.m_epochs.collect();
+}
+
+} // namespace lite3cpp
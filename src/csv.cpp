@@ -0,0 +1,399 @@
+#include "csv.hpp"
+#include "builder.hpp"
+#include "exception.hpp"
+#include "utils/hash.hpp"
+#include "utils/parallel.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <thread>
+
+namespace lite3cpp {
+namespace lite3_csv {
+
+namespace {
+
+struct Column {
+  std::string name;
+  uint32_t hash; // Computed once per file
+  Type type;
+};
+
+// A field of the current record: a view of the input, or of the reader's
+// scratch when "" escapes had to be collapsed.
+struct Field {
+  size_t begin;
+  size_t size;
+  size_t at; // Input offset, for errors
+  bool quoted;
+  bool scratch;
+};
+
+class Reader {
+public:
+  Reader(std::string_view csv, char delimiter)
+      : m_csv(csv), m_delimiter(delimiter) {
+    m_stop[static_cast<uint8_t>(delimiter)] = true;
+    m_stop['\n'] = m_stop['\r'] = m_stop['"'] = true;
+  }
+
+  // Reads the fields of the record at `pos`; returns where the next one
+  // starts.
+  size_t record(size_t pos, size_t end) {
+    m_fields.clear();
+    m_scratch.clear();
+    for (;;) {
+      pos = pos < end && m_csv[pos] == '"' ? quoted(pos, end)
+                                           : unquoted(pos, end);
+      if (pos < end && m_csv[pos] == m_delimiter) {
+        ++pos;
+        continue;
+      }
+      if (pos < end && m_csv[pos] == '\r') {
+        if (pos + 1 >= end || m_csv[pos + 1] != '\n')
+          fail(pos, "Carriage return without a newline");
+        ++pos;
+      }
+      return pos < end ? pos + 1 : pos;
+    }
+  }
+
+  size_t field_count() const { return m_fields.size(); }
+
+  std::string_view text(size_t i) const {
+    const Field &f = m_fields[i];
+    return {(f.scratch ? m_scratch.data() : m_csv.data()) + f.begin, f.size};
+  }
+
+  // Skips blank lines at `pos`.
+  size_t skip_blank(size_t pos, size_t end) const {
+    for (;;) {
+      if (pos < end && m_csv[pos] == '\n')
+        ++pos;
+      else if (pos + 1 < end && m_csv[pos] == '\r' && m_csv[pos + 1] == '\n')
+        pos += 2;
+      else
+        return pos;
+    }
+  }
+
+  // Appends one object per record in [pos, end), which starts and ends at
+  // record boundaries, to the builder's open array.
+  void records(size_t pos, size_t end, const std::vector<Column> &columns,
+               Builder &builder) {
+    while ((pos = skip_blank(pos, end)) < end) {
+      size_t at = pos;
+      pos = record(pos, end);
+      if (m_fields.size() != columns.size())
+        fail(at, "Expected " + std::to_string(columns.size()) +
+                     " fields, found " + std::to_string(m_fields.size()));
+      builder.begin_object();
+      for (size_t i = 0; i < columns.size(); ++i) {
+        builder.key(columns[i].name, columns[i].hash);
+        value(columns[i], i, builder);
+      }
+      builder.end();
+    }
+  }
+
+  [[noreturn]] void fail(size_t at, const std::string &what) const {
+    throw exception(what + " in CSV at offset " + std::to_string(at));
+  }
+
+private:
+  size_t unquoted(size_t pos, size_t end) {
+    size_t p = pos;
+    while (p < end && !m_stop[static_cast<uint8_t>(m_csv[p])])
+      ++p;
+    if (p < end && m_csv[p] == '"')
+      fail(p, "Quote in an unquoted field");
+    m_fields.push_back({pos, p - pos, pos, false, false});
+    return p;
+  }
+
+  size_t quoted(size_t pos, size_t end) {
+    size_t start = pos + 1;
+    size_t p = start;
+    bool escaped = false;
+    size_t scratch_begin = m_scratch.size();
+    for (;;) {
+      const void *q = std::memchr(m_csv.data() + p, '"', end - p);
+      if (!q)
+        fail(pos, "Unterminated quoted field");
+      p = static_cast<const char *>(q) - m_csv.data();
+      if (p + 1 < end && m_csv[p + 1] == '"') {
+        // "" is a quote; keep one.
+        escaped = true;
+        m_scratch.append(m_csv.data() + start, p + 1 - start);
+        p += 2;
+        start = p;
+        continue;
+      }
+      break;
+    }
+    if (escaped) {
+      m_scratch.append(m_csv.data() + start, p - start);
+      m_fields.push_back({scratch_begin, m_scratch.size() - scratch_begin,
+                          pos, true, true});
+    } else {
+      m_fields.push_back({start, p - start, pos, true, false});
+    }
+    ++p;
+    if (p < end && m_csv[p] != m_delimiter && m_csv[p] != '\n' &&
+        m_csv[p] != '\r')
+      fail(p, "Unexpected character after a quoted field");
+    return p;
+  }
+
+  [[noreturn]] void mismatch(const Column &column, size_t i,
+                             const char *type) const {
+    fail(m_fields[i].at, "Field of column " + column.name + " is not " + type);
+  }
+
+  void value(const Column &column, size_t i, Builder &builder) {
+    std::string_view s = text(i);
+    if (s.empty()) {
+      // "" is an empty string where a string can go.
+      bool text = column.type == Type::String || column.type == Type::Invalid;
+      if (m_fields[i].quoted && text)
+        builder.add_str(s);
+      else
+        builder.add_null();
+      return;
+    }
+    switch (column.type) {
+    case Type::String:
+      builder.add_str(s);
+      return;
+    case Type::Bool:
+      if (s == "true" || s == "1")
+        builder.add_bool(true);
+      else if (s == "false" || s == "0")
+        builder.add_bool(false);
+      else
+        mismatch(column, i, "a bool");
+      return;
+    case Type::Int64: {
+      int64_t v;
+      if (!integer(s, v))
+        mismatch(column, i, "an Int64");
+      builder.add_i64(v);
+      return;
+    }
+    case Type::Float64: {
+      double d;
+      if (!real(s, d))
+        mismatch(column, i, "a Float64");
+      builder.add_f64(d);
+      return;
+    }
+    default:
+      infer(s, builder);
+      return;
+    }
+  }
+
+  // A leading '+' must be followed by a digit: from_chars would otherwise
+  // take the '-' in "+-5".
+  static bool integer(std::string_view s, int64_t &v) {
+    if (s[0] == '+') {
+      s.remove_prefix(1);
+      if (s.empty() || s[0] < '0' || s[0] > '9')
+        return false;
+    }
+    auto r = std::from_chars(s.data(), s.data() + s.size(), v);
+    return r.ec == std::errc() && r.ptr == s.data() + s.size();
+  }
+
+  // Decimal numbers only: from_chars also takes "inf" and "nan". Numbers
+  // past the range of a double read as an infinity, and ones too small for
+  // it as zero, keeping the sign.
+  static bool real(std::string_view s, double &d) {
+    bool plus = s[0] == '+';
+    if (plus)
+      s.remove_prefix(1);
+    size_t i = !plus && !s.empty() && s[0] == '-' ? 1 : 0;
+    if (i >= s.size() || !((s[i] >= '0' && s[i] <= '9') || s[i] == '.'))
+      return false;
+    auto r = std::from_chars(s.data(), s.data() + s.size(), d);
+    if (r.ptr != s.data() + s.size())
+      return false;
+    if (r.ec == std::errc::result_out_of_range) {
+      d = overflows(s.substr(i)) ? std::numeric_limits<double>::infinity()
+                                 : 0.0;
+      d = i ? -d : d;
+      return true;
+    }
+    return r.ec == std::errc();
+  }
+
+  // Whether an unsigned decimal out of a double's range is too large
+  // rather than too small: the place of its leading nonzero digit plus its
+  // exponent (saturated).
+  static bool overflows(std::string_view s) {
+    size_t exp = std::min(s.find_first_of("eE"), s.size());
+    size_t point = std::min(s.find('.'), exp);
+    size_t lead = s.find_first_not_of("0.");
+    int64_t scale = static_cast<int64_t>(point) - static_cast<int64_t>(lead);
+    if (lead < point)
+      --scale;
+    if (exp < s.size()) {
+      size_t e = exp + 1;
+      bool minus = s[e] == '-';
+      if (s[e] == '+' || s[e] == '-')
+        ++e;
+      int64_t written = 0;
+      for (; e < s.size() && written < (int64_t{1} << 40); ++e)
+        written = written * 10 + (s[e] - '0');
+      scale += minus ? -written : written;
+    }
+    return scale > 0;
+  }
+
+  static void infer(std::string_view s, Builder &builder) {
+    int64_t v;
+    double d;
+    if (s == "true" || s == "false")
+      builder.add_bool(s[0] == 't');
+    else if (integer(s, v))
+      builder.add_i64(v);
+    else if (real(s, d))
+      builder.add_f64(d);
+    else
+      builder.add_str(s);
+  }
+
+  std::string_view m_csv;
+  char m_delimiter;
+  bool m_stop[256] = {};
+  std::vector<Field> m_fields;
+  std::string m_scratch;
+};
+
+// Record boundaries cutting [pos, csv.size()) into pieces of about `step`
+// bytes. Quotes only enclose whole fields, so their parity tells which
+// newlines end a record.
+std::vector<size_t> cut_records(std::string_view csv, size_t pos,
+                                size_t step) {
+  std::vector<size_t> cuts = {pos};
+  bool quoted = false;
+  size_t next = pos + step;
+  for (size_t i = pos; i < csv.size(); ++i) {
+    if (csv[i] == '"')
+      quoted = !quoted;
+    else if (csv[i] == '\n' && !quoted && i + 1 >= next &&
+             i + 1 < csv.size()) {
+      cuts.push_back(i + 1);
+      next = i + 1 + step;
+    }
+  }
+  cuts.push_back(csv.size());
+  return cuts;
+}
+
+// The columns, with names from the header record when there is one. Returns
+// where the data records start.
+size_t read_columns(Reader &reader, std::string_view csv,
+                    const CsvOptions &options, std::vector<Column> &columns) {
+  size_t pos = 0;
+  if (options.header) {
+    pos = reader.skip_blank(0, csv.size());
+    if (pos == csv.size())
+      return pos;
+    size_t at = pos;
+    pos = reader.record(pos, csv.size());
+    for (size_t i = 0; i < reader.field_count(); ++i)
+      columns.push_back({std::string(reader.text(i)), 0, Type::Invalid});
+    for (const CsvColumn &c : options.columns) {
+      auto it = std::find_if(
+          columns.begin(), columns.end(),
+          [&](const Column &col) { return col.name == c.name; });
+      if (it == columns.end())
+        reader.fail(at, "Column " + c.name + " is not in the header");
+      it->type = c.type;
+    }
+  } else {
+    if (options.columns.empty())
+      throw exception("CSV without a header needs its columns named");
+    for (const CsvColumn &c : options.columns)
+      columns.push_back({c.name, 0, c.type});
+  }
+  for (Column &c : columns) {
+    if (c.name.empty())
+      throw exception("Empty CSV column name");
+    if (c.name.size() > 62)
+      throw exception("CSV column name too long: " + c.name);
+    if (c.type != Type::Invalid && c.type != Type::Bool &&
+        c.type != Type::Int64 && c.type != Type::Float64 &&
+        c.type != Type::String)
+      throw exception("CSV column " + c.name +
+                      " must be a Bool, Int64, Float64 or String");
+    c.hash = utils::djb2_hash(c.name);
+  }
+  std::vector<std::string_view> names;
+  for (const Column &c : columns)
+    names.push_back(c.name);
+  std::sort(names.begin(), names.end());
+  auto dup = std::adjacent_find(names.begin(), names.end());
+  if (dup != names.end())
+    throw exception("Duplicate CSV column name: " + std::string(*dup));
+  return pos;
+}
+
+} // namespace
+
+void parse_csv(std::string_view csv, Buffer &out, const CsvOptions &options) {
+  thread_local Builder builder;
+  try {
+    builder.reset(out);
+    Reader reader(csv, options.delimiter);
+    std::vector<Column> columns;
+    size_t pos = read_columns(reader, csv, options, columns);
+    builder.begin_array();
+
+    unsigned threads = options.threads;
+    if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t slices = std::min<size_t>(
+        size_t(threads) * 4,
+        (csv.size() - pos) / std::max<size_t>(options.min_chunk, 1));
+    std::vector<size_t> cuts;
+    if (threads > 1 && slices >= 2)
+      cuts = cut_records(csv, pos, (csv.size() - pos) / slices);
+    if (cuts.size() < 3) {
+      reader.records(pos, csv.size(), columns, builder);
+    } else {
+      // Each piece fills its own array, spliced in as one block.
+      struct Part {
+        Buffer buffer;
+        std::optional<Builder> builder;
+      };
+      std::vector<Part> parts(cuts.size() - 1);
+      utils::run_parallel(threads, parts.size(), [&](size_t i) {
+        Builder &b = parts[i].builder.emplace(parts[i].buffer);
+        b.begin_array();
+        Reader(csv, options.delimiter)
+            .records(cuts[i], cuts[i + 1], columns, b);
+      });
+      std::vector<Builder *> builders;
+      for (Part &part : parts)
+        builders.push_back(&*part.builder);
+      builder.splice(builders, threads);
+    }
+    builder.end();
+  } catch (...) {
+    out.clear();
+    throw;
+  }
+}
+
+Buffer parse_csv(std::string_view csv, const CsvOptions &options) {
+  Buffer buffer;
+  parse_csv(csv, buffer, options);
+  return buffer;
+}
+
+} // namespace lite3_csv
+} // namespace lite3cpp
@@ -0,0 +1,273 @@
+#include "digest.hpp"
+#include "buffer.hpp"
+#include "exception.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+namespace lite3cpp {
+
+namespace {
+
+// splitmix64 finalizer: spreads FNV's weak high bits before values are summed.
+uint64_t mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+uint64_t hash_bytes(const uint8_t *p, size_t n, uint64_t seed) {
+  uint64_t h = 14695981039346656037ULL ^ seed;
+  for (size_t i = 0; i < n; ++i) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  return mix(h ^ n);
+}
+
+size_t value_offset(const uint8_t *base, size_t kv_ofs, bool is_array) {
+  return is_array ? kv_ofs : kv_ofs + 1 + (base[kv_ofs] >> 2);
+}
+
+std::string_view entry_key(const uint8_t *base, size_t kv_ofs) {
+  return {reinterpret_cast<const char *>(base + kv_ofs + 1),
+          static_cast<size_t>((base[kv_ofs] >> 2) - 1)};
+}
+
+uint64_t key_digest(const uint8_t *base, size_t kv_ofs, bool is_array,
+                    uint32_t node_hash) {
+  if (is_array)
+    return mix(0x9e3779b97f4a7c15ULL + node_hash);
+  std::string_view k = entry_key(base, kv_ofs);
+  return hash_bytes(reinterpret_cast<const uint8_t *>(k.data()), k.size(), 1);
+}
+
+uint64_t scalar_digest(const uint8_t *base, size_t vo) {
+  Type t = static_cast<Type>(base[vo]);
+  const uint8_t *p = base + vo + 1;
+  size_t n = 0;
+  switch (t) {
+  case Type::Bool:
+    n = 1;
+    break;
+  case Type::Int64:
+  case Type::Float64:
+    n = 8;
+    break;
+  case Type::String:
+  case Type::Bytes: {
+    uint32_t len;
+    std::memcpy(&len, p, 4);
+    p += 4;
+    n = len;
+    break;
+  }
+  default:
+    break;
+  }
+  return hash_bytes(p, n, static_cast<uint64_t>(t) << 8);
+}
+
+uint64_t combine(uint64_t key, uint64_t value) {
+  return mix(key ^ (value * 0x9e3779b97f4a7c15ULL));
+}
+
+} // namespace
+
+uint64_t entry_digest_with(const uint8_t *base, size_t kv_ofs, bool is_array,
+                           uint32_t node_hash, uint64_t container_digest) {
+  size_t vo = value_offset(base, kv_ofs, is_array);
+  Type t = static_cast<Type>(base[vo]);
+  uint64_t value = (t == Type::Object || t == Type::Array)
+                       ? mix(container_digest + static_cast<uint64_t>(t))
+                       : scalar_digest(base, vo);
+  return combine(key_digest(base, kv_ofs, is_array, node_hash), value);
+}
+
+uint64_t entry_digest(const uint8_t *base, size_t kv_ofs, bool is_array,
+                      uint32_t node_hash, const DigestTable &table) {
+  size_t vo = value_offset(base, kv_ofs, is_array);
+  return entry_digest_with(base, kv_ofs, is_array, node_hash,
+                           table.subtree(vo + 1));
+}
+
+namespace {
+
+struct Entry {
+  uint32_t hash;
+  size_t kv_ofs;
+};
+
+class DigestDiffer {
+public:
+  DigestDiffer(const Buffer &a, const Buffer &b)
+      : m_a(a.data()), m_b(b.data()), m_ta(*a.digest_table()),
+        m_tb(*b.digest_table()) {}
+
+  void container(size_t ao, size_t bo, std::string &path) {
+    if (m_ta.subtree(ao) == m_tb.subtree(bo))
+      return;
+    bool is_array = node(m_a, ao).type() == Type::Array;
+    nodes(ao, bo, is_array, path);
+  }
+
+  std::vector<std::string> out;
+
+private:
+  static NodeView node(const uint8_t *base, size_t ofs) {
+    return NodeView(reinterpret_cast<const PackedNodeLayout *>(base + ofs));
+  }
+
+  void nodes(size_t an, size_t bn, bool is_array, std::string &path) {
+    if (m_ta.subtree(an) == m_tb.subtree(bn))
+      return;
+    NodeView x = node(m_a, an), y = node(m_b, bn);
+    if (!same_shape(x, y, is_array)) {
+      merge(an, bn, is_array, path);
+      return;
+    }
+    int count = static_cast<int>(x.key_count());
+    for (int i = 0; i <= count; ++i) {
+      if (x.get_child_offset(i))
+        nodes(x.get_child_offset(i), y.get_child_offset(i), is_array, path);
+      if (i < count)
+        entry({x.get_hash(i), x.get_kv_offset(i)},
+              {y.get_hash(i), y.get_kv_offset(i)}, is_array, path);
+    }
+  }
+
+  // Same keys in the same slots and the same child layout, so children can
+  // be compared pairwise by their subtree sums.
+  bool same_shape(NodeView x, NodeView y, bool is_array) const {
+    if (x.key_count() != y.key_count())
+      return false;
+    int count = static_cast<int>(x.key_count());
+    for (int i = 0; i < count; ++i) {
+      if (x.get_hash(i) != y.get_hash(i))
+        return false;
+      if (!is_array && entry_key(m_a, x.get_kv_offset(i)) !=
+                           entry_key(m_b, y.get_kv_offset(i)))
+        return false;
+    }
+    for (int i = 0; i <= count; ++i)
+      if ((x.get_child_offset(i) == 0) != (y.get_child_offset(i) == 0))
+        return false;
+    return true;
+  }
+
+  void entry(Entry ea, Entry eb, bool is_array, std::string &path) {
+    if (entry_digest(m_a, ea.kv_ofs, is_array, ea.hash, m_ta) ==
+        entry_digest(m_b, eb.kv_ofs, is_array, eb.hash, m_tb))
+      return;
+    size_t base_len = path.size();
+    append(path, ea, is_array);
+    size_t va = value_offset(m_a, ea.kv_ofs, is_array);
+    size_t vb = value_offset(m_b, eb.kv_ofs, is_array);
+    Type ta = static_cast<Type>(m_a[va]), tb = static_cast<Type>(m_b[vb]);
+    if (ta == tb && (ta == Type::Object || ta == Type::Array))
+      container(va + 1, vb + 1, path);
+    else
+      out.push_back(path);
+    path.resize(base_len);
+  }
+
+  void report(const uint8_t *base, Entry e, bool is_array,
+              std::string &path) {
+    size_t base_len = path.size();
+    if (is_array)
+      path += '/' + std::to_string(e.hash);
+    else
+      append_key(path, entry_key(base, e.kv_ofs));
+    out.push_back(path);
+    path.resize(base_len);
+  }
+
+  void append(std::string &path, Entry e, bool is_array) const {
+    if (is_array)
+      path += '/' + std::to_string(e.hash);
+    else
+      append_key(path, entry_key(m_a, e.kv_ofs));
+  }
+
+  static void append_key(std::string &path, std::string_view key) {
+    path += '/';
+    for (char c : key) {
+      if (c == '~')
+        path += "~0";
+      else if (c == '/')
+        path += "~1";
+      else
+        path += c;
+    }
+  }
+
+  static void collect(const uint8_t *base, size_t ofs,
+                      std::vector<Entry> &entries) {
+    NodeView n = node(base, ofs);
+    int count = static_cast<int>(n.key_count());
+    for (int i = 0; i <= count; ++i) {
+      if (n.get_child_offset(i))
+        collect(base, n.get_child_offset(i), entries);
+      if (i < count)
+        entries.push_back({n.get_hash(i), n.get_kv_offset(i)});
+    }
+  }
+
+  int order(Entry ea, Entry eb, bool is_array) const {
+    if (ea.hash != eb.hash)
+      return ea.hash < eb.hash ? -1 : 1;
+    if (is_array)
+      return 0;
+    return entry_key(m_a, ea.kv_ofs).compare(entry_key(m_b, eb.kv_ofs));
+  }
+
+  // Shape mismatch: both subtrees hold their entries in (hash, key) order,
+  // so a merge pairs them up.
+  void merge(size_t an, size_t bn, bool is_array, std::string &path) {
+    std::vector<Entry> xa, xb;
+    collect(m_a, an, xa);
+    collect(m_b, bn, xb);
+    size_t i = 0, j = 0;
+    while (i < xa.size() || j < xb.size()) {
+      int c = i == xa.size()   ? 1
+              : j == xb.size() ? -1
+                               : order(xa[i], xb[j], is_array);
+      if (c < 0)
+        report(m_a, xa[i++], is_array, path);
+      else if (c > 0)
+        report(m_b, xb[j++], is_array, path);
+      else
+        entry(xa[i++], xb[j++], is_array, path);
+    }
+  }
+
+  const uint8_t *m_a;
+  const uint8_t *m_b;
+  const DigestTable &m_ta;
+  const DigestTable &m_tb;
+};
+
+} // namespace
+
+std::vector<std::string> diff_digests(const Buffer &a, const Buffer &b) {
+  if (!a.digests_enabled() || !b.digests_enabled())
+    throw exception("Digests not enabled");
+  if (a.size() == 0 || b.size() == 0) {
+    if (a.size() != b.size())
+      return {""};
+    return {};
+  }
+  NodeView ra(reinterpret_cast<const PackedNodeLayout *>(a.data()));
+  NodeView rb(reinterpret_cast<const PackedNodeLayout *>(b.data()));
+  if (ra.type() != rb.type())
+    return {""};
+  DigestDiffer differ(a, b);
+  std::string path;
+  differ.container(0, 0, path);
+  return std::move(differ.out);
+}
+
+} // namespace lite3cpp
@@ -2,7 +2,6 @@
 #include "buffer.hpp" // Explicitly include buffer
 #include "exception.hpp"
 #include "observability.hpp" // Add this
-#include "utils/hex.hpp"     // Include new hex utility
 #include "yyjson.h"
 #include <chrono>      // Add this
 #include <string_view> // Add this
@@ -13,11 +12,10 @@ namespace lite3cpp {
 namespace lite3_json {
 
 // Forward declarations for helper functions
-void from_yyjson_val(yyjson_val *val, Buffer &buffer, size_t ofs);
 void from_yyjson_val(yyjson_val *val, Buffer &buffer, size_t ofs,
-                     const char *key);
-yyjson_mut_val *to_yyjson_val(const Buffer &buffer, size_t ofs,
-                              yyjson_mut_doc *doc);
+                     const ImportPolicy &policy);
+void from_yyjson_val(yyjson_val *val, Buffer &buffer, size_t ofs,
+                     const char *key, const ImportPolicy &policy);
 
 struct ScopedMetric {
   std::string_view op;
@@ -50,45 +48,63 @@ std::string to_json_string(const Buffer &buffer, size_t ofs) {
   ScopedMetric sm("json_serialize");
   lite3cpp::log_if_enabled(lite3cpp::LogLevel::Info, "JSON stringify started.",
                            "JsonStringify", std::chrono::microseconds(0), ofs);
-  yyjson_mut_doc *doc = yyjson_mut_doc_new(nullptr);
-  
-  yyjson_mut_val *root = nullptr;
-  if (ofs == 0 && buffer.size() >= config::node_size) {
-      // Root node handling: no type tag, read from layout
-      NodeView node(reinterpret_cast<const PackedNodeLayout *>(buffer.data()));
-      Type root_type = node.type();
-      if (root_type == Type::Object) {
-          root = yyjson_mut_obj(doc);
-          for (auto it = buffer.begin(0); it != buffer.end(0); ++it) {
-              yyjson_mut_obj_add_val(doc, root, it->key.data(),
-                                     to_yyjson_val(buffer, it->value_offset, doc));
-          }
-      } else if (root_type == Type::Array) {
-          root = yyjson_mut_arr(doc);
-          for (uint32_t i = 0; i < node.size(); ++i) {
-              Type val_type = buffer.arr_get_type(0, i);
-              // Simplified: call to_yyjson_val logic or implement here
-              // For brevity in this fix, I'll just use to_yyjson_val if I can get an offset
-              // But array elements HAVE tags. So we can use arr_get_impl - 1?
-              // Actually, I'll just skip adding items if it's a root array for now, 
-              // or better, implement it correctly.
-          }
-      } else {
-          root = yyjson_mut_null(doc);
-      }
-  } else {
-      root = to_yyjson_val(buffer, ofs, doc);
-  }
-
-  yyjson_mut_doc_set_root(doc, root);
-  const char *json_str = yyjson_mut_write(doc, 0, nullptr);
-  std::string result(json_str ? json_str : "{}");
-  if (json_str) free((void *)json_str);
-  yyjson_mut_doc_free(doc);
+  std::string result;
+  write_json(buffer, ofs, result);
   return result;
 }
 
-Buffer from_json_string(const std::string &json_str) {
+namespace {
+
+// A container's node plus the nodes its `n` members can split it into: at
+// most n / node_key_count_min, since both halves of a split keep that many
+// keys and an import removes nothing. Split nodes may be padded to
+// alignment.
+size_t container_bound(size_t n) {
+  return config::node_size + n / config::node_key_count_min *
+                                 (config::node_size + config::node_alignment);
+}
+
+// Upper bound on the bytes from_yyjson_val appends for `val`, stored under
+// a key taking `key_bytes` (0 for an array element). Every entry is
+// counted as appended, which also covers duplicate keys.
+size_t import_size_bound(yyjson_val *val, size_t key_bytes) {
+  size_t size = key_bytes + 1; // Type byte
+  switch (yyjson_get_type(val)) {
+  case YYJSON_TYPE_BOOL:
+    return size + 1;
+  case YYJSON_TYPE_NUM:
+    return size + 8;
+  case YYJSON_TYPE_STR:
+    // Decoded Bytes are never longer than the string.
+    return size + 4 + yyjson_get_len(val) + 1;
+  case YYJSON_TYPE_ARR: {
+    size += container_bound(yyjson_get_len(val));
+    yyjson_arr_iter iter;
+    yyjson_arr_iter_init(val, &iter);
+    while (yyjson_val *item = yyjson_arr_iter_next(&iter))
+      size += import_size_bound(item, 0);
+    return size;
+  }
+  case YYJSON_TYPE_OBJ: {
+    size += container_bound(yyjson_get_len(val));
+    yyjson_obj_iter iter;
+    yyjson_obj_iter_init(val, &iter);
+    while (yyjson_val *key = yyjson_obj_iter_next(&iter)) {
+      size_t len = yyjson_get_len(key);
+      size_t tag = len < 64 ? 1 : len < 16384 ? 2 : 3;
+      size += import_size_bound(yyjson_obj_iter_get_val(key), tag + len + 1);
+    }
+    return size;
+  }
+  default:
+    return size;
+  }
+}
+
+} // namespace
+
+Buffer from_json_string(const std::string &json_str,
+                        const ImportPolicy &policy) {
   ScopedMetric sm("json_parse");
   lite3cpp::log_if_enabled(lite3cpp::LogLevel::Info, "JSON parse started.",
                            "JsonParse", std::chrono::microseconds(0), 0);
@@ -98,13 +114,17 @@ Buffer from_json_string(const std::string &json_str) {
   }
   yyjson_val *root = yyjson_doc_get_root(doc);
   Buffer buffer;
-  from_yyjson_val(root, buffer, 0);
+  // Sized once from the document, so the import never regrows and copies.
+  // The slack covers the headroom a node split asks for.
+  if (yyjson_is_ctn(root))
+    buffer.reserve(import_size_bound(root, 0) + 128);
+  from_yyjson_val(root, buffer, 0, policy);
   yyjson_doc_free(doc);
   return buffer;
 }
 
 void from_yyjson_val(yyjson_val *val, Buffer &buffer, size_t ofs,
-                     const char *key) {
+                     const char *key, const ImportPolicy &policy) {
   yyjson_type type = yyjson_get_type(val);
   switch (type) {
   case YYJSON_TYPE_NULL:
@@ -121,30 +141,29 @@ void from_yyjson_val(yyjson_val *val, Buffer &buffer, size_t ofs,
     }
     break;
   case YYJSON_TYPE_STR: {
-    std::string_view str_val = yyjson_get_str(val);
-    try {
-      std::vector<std::byte> decoded_bytes = utils::hex_decode(str_val);
+    std::string_view str_val(yyjson_get_str(val), yyjson_get_len(val));
+    std::vector<std::byte> decoded_bytes;
+    if (policy.decode_bytes(str_val, decoded_bytes))
       buffer.set_bytes(ofs, key, decoded_bytes);
-    } catch (const std::runtime_error &) {
-      // If hex_decode fails, treat it as a regular string
+    else
       buffer.set_str(ofs, key, str_val);
-    }
     break;
   }
   case YYJSON_TYPE_ARR: {
     size_t new_ofs = buffer.set_arr(ofs, key);
-    from_yyjson_val(val, buffer, new_ofs);
+    from_yyjson_val(val, buffer, new_ofs, policy);
     break;
   }
   case YYJSON_TYPE_OBJ: {
     size_t new_ofs = buffer.set_obj(ofs, key);
-    from_yyjson_val(val, buffer, new_ofs);
+    from_yyjson_val(val, buffer, new_ofs, policy);
     break;
   }
   }
 }
 
-void from_yyjson_val(yyjson_val *val, Buffer &buffer, size_t ofs) {
+void from_yyjson_val(yyjson_val *val, Buffer &buffer, size_t ofs,
+                     const ImportPolicy &policy) {
   yyjson_type type = yyjson_get_type(val);
   switch (type) {
   case YYJSON_TYPE_NULL:
@@ -183,24 +202,22 @@ void from_yyjson_val(yyjson_val *val, Buffer &buffer, size_t ofs) {
         }
         break;
       case YYJSON_TYPE_STR: {
-        std::string_view str_val = yyjson_get_str(item);
-        try {
-          std::vector<std::byte> decoded_bytes = utils::hex_decode(str_val);
+        std::string_view str_val(yyjson_get_str(item), yyjson_get_len(item));
+        std::vector<std::byte> decoded_bytes;
+        if (policy.decode_bytes(str_val, decoded_bytes))
           buffer.arr_append_bytes(ofs, decoded_bytes);
-        } catch (const std::runtime_error &) {
-          // If hex_decode fails, treat it as a regular string
+        else
           buffer.arr_append_str(ofs, str_val);
-        }
         break;
       }
       case YYJSON_TYPE_OBJ: { // Corrected: Using YYJSON_TYPE_OBJ
         size_t new_ofs = buffer.arr_append_obj(ofs);
-        from_yyjson_val(item, buffer, new_ofs);
+        from_yyjson_val(item, buffer, new_ofs, policy);
         break;
       }
       case YYJSON_TYPE_ARR: { // Corrected: Using YYJSON_TYPE_ARR
         size_t new_ofs = buffer.arr_append_arr(ofs);
-        from_yyjson_val(item, buffer, new_ofs);
+        from_yyjson_val(item, buffer, new_ofs, policy);
         break;
       }
       default:
@@ -219,110 +236,12 @@ void from_yyjson_val(yyjson_val *val, Buffer &buffer, size_t ofs) {
     while ((key = yyjson_obj_iter_next(&iter))) {
       item = yyjson_obj_iter_get_val(key);
       const char *key_str = yyjson_get_str(key);
-      from_yyjson_val(item, buffer, ofs, key_str);
+      from_yyjson_val(item, buffer, ofs, key_str, policy);
     }
     break;
   }
   }
 }
 
-yyjson_mut_val *to_yyjson_val(const Buffer &buffer, size_t ofs,
-                              yyjson_mut_doc *doc) {
-  Type type = static_cast<Type>(buffer.data()[ofs]);
-  switch (type) {
-  case Type::Null:
-    return yyjson_mut_null(doc);
-  case Type::Bool:
-    return yyjson_mut_bool(
-        doc, *reinterpret_cast<const bool *>(buffer.data() + ofs + 1));
-  case Type::Int64:
-    return yyjson_mut_int(
-        doc, *reinterpret_cast<const int64_t *>(buffer.data() + ofs + 1));
-  case Type::Float64:
-    return yyjson_mut_real(
-        doc, *reinterpret_cast<const double *>(buffer.data() + ofs + 1));
-  case Type::String: {
-    uint32_t size;
-    std::memcpy(&size, buffer.data() + ofs + 1, sizeof(size));
-    const char *str_data =
-        reinterpret_cast<const char *>(buffer.data() + ofs + 1 + sizeof(size));
-    return yyjson_mut_strncpy(doc, str_data,
-                              size); // Use strncpy to copy the string
-  }
-  case Type::Bytes: {
-    uint32_t size;
-    std::memcpy(&size, buffer.data() + ofs + 1, sizeof(size));
-    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(
-        buffer.data() + ofs + 1 + sizeof(size));
-    std::string hex_str;
-    for (uint32_t i = 0; i < size; ++i) {
-      char buf[3];
-      snprintf(buf, sizeof(buf), "%02x", static_cast<unsigned char>(bytes[i]));
-      hex_str += buf;
-    }
-    return yyjson_mut_strncpy(doc, hex_str.data(), hex_str.size());
-  }
-  case Type::Object: {
-    yyjson_mut_val *obj = yyjson_mut_obj(doc);
-    for (auto it = buffer.begin(ofs + 1); it != buffer.end(ofs + 1); ++it) {
-      yyjson_mut_obj_add_val(doc, obj, it->key.data(),
-                             to_yyjson_val(buffer, it->value_offset, doc));
-    }
-    return obj;
-  }
-  case Type::Array: {
-    yyjson_mut_val *arr = yyjson_mut_arr(doc);
-    NodeView node(
-        reinterpret_cast<const PackedNodeLayout *>(buffer.data() + ofs + 1));
-    for (uint32_t i = 0; i < node.size(); ++i) {
-      Type value_type = buffer.arr_get_type(ofs + 1, i);
-      switch (value_type) {
-      case Type::Null:
-        yyjson_mut_arr_add_null(doc, arr);
-        break;
-      case Type::Bool:
-        yyjson_mut_arr_add_bool(doc, arr, buffer.arr_get_bool(ofs, i));
-        break;
-      case Type::Int64:
-        yyjson_mut_arr_add_int(doc, arr, buffer.arr_get_i64(ofs, i));
-        break;
-      case Type::Float64:
-        yyjson_mut_arr_add_real(doc, arr, buffer.arr_get_f64(ofs, i));
-        break;
-      case Type::String: {
-        auto str = buffer.arr_get_str(ofs, i);
-        yyjson_mut_arr_add_strncpy(doc, arr, str.data(), str.size());
-        break;
-      }
-      case Type::Bytes: {
-        auto bytes_span = buffer.arr_get_bytes(ofs, i);
-        std::string hex_str;
-        for (size_t j = 0; j < bytes_span.size(); ++j) {
-          char buf[3];
-          snprintf(buf, sizeof(buf), "%02x",
-                   static_cast<unsigned char>(bytes_span[j]));
-          hex_str += buf;
-        }
-        yyjson_mut_arr_add_str(doc, arr, hex_str.c_str());
-        break;
-      }
-      case Type::Object:
-        yyjson_mut_arr_add_val(
-            arr, to_yyjson_val(buffer, buffer.arr_get_obj(ofs, i), doc));
-        break;
-      case Type::Array:
-        yyjson_mut_arr_add_val(
-            arr, to_yyjson_val(buffer, buffer.arr_get_arr(ofs, i), doc));
-        break;
-      default:
-        break;
-      }
-    }
-    return arr;
-  }
-  default:
-    return yyjson_mut_null(doc);
-  }
-}
 } // namespace lite3_json
 } // namespace lite3cpp
\ No newline at end of file
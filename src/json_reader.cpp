@@ -0,0 +1,944 @@
+#include "builder.hpp"
+#include "exception.hpp"
+#include "json.hpp"
+#include "utils/hash.hpp"
+#include "utils/hex.hpp"
+#include "utils/json_scan.hpp"
+#include "utils/parallel.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace lite3cpp {
+namespace lite3_json {
+
+namespace {
+
+constexpr size_t max_depth = 512;
+
+int hex_value(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+bool is_ws(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+struct Number {
+  bool real;
+  int64_t i;
+  double d;
+};
+
+// Recursive descent over the text, handing each token to a Builder as it is
+// read. Unescaped strings are passed as views into the input.
+class Reader {
+public:
+  Reader(std::string_view json, Builder &builder, const ImportPolicy &policy)
+      : m_begin(json.data()), m_p(json.data()),
+        m_end(json.data() + json.size()), m_builder(builder),
+        m_policy(policy) {}
+
+  // Points the reader at new text, keeping its scratch space.
+  void reset(std::string_view json) {
+    m_begin = m_p = json.data();
+    m_end = json.data() + json.size();
+  }
+
+  // Returns false for a scalar document, which is read into a throwaway
+  // array since a Buffer has no way to hold it.
+  bool document() {
+    skip_ws();
+    if (m_p == m_end)
+      fail();
+    bool container = *m_p == '{' || *m_p == '[';
+    if (!container)
+      m_builder.begin_array();
+    value(0);
+    if (!container)
+      m_builder.end();
+    skip_ws();
+    if (m_p != m_end)
+      fail();
+    return container;
+  }
+
+  // As document(), keeping only what `schema` selects.
+  bool projected_document(const Schema &schema) {
+    const Schema::Node &root = schema.root();
+    skip_ws();
+    if (m_p == m_end)
+      fail();
+    if (root.selected || (*m_p != '{' && *m_p != '['))
+      return document();
+    project(0, root);
+    skip_ws();
+    if (m_p != m_end)
+      fail();
+    return true;
+  }
+
+  // Reads the comma-separated values in [from, to) of the text into the
+  // builder's open root array. Error offsets stay relative to the whole
+  // text.
+  void elements(size_t from, size_t to) {
+    m_p = m_begin + from;
+    m_end = m_begin + to;
+    while (true) {
+      skip_ws();
+      value(1);
+      skip_ws();
+      if (m_p == m_end)
+        return;
+      expect(',');
+    }
+  }
+
+private:
+  [[noreturn]] void fail() const {
+    throw exception("Invalid JSON at offset " +
+                    std::to_string(m_p - m_begin));
+  }
+
+  void skip_ws() {
+    while (m_p != m_end &&
+           (*m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t'))
+      ++m_p;
+  }
+
+  void expect(char c) {
+    if (m_p == m_end || *m_p != c)
+      fail();
+    ++m_p;
+  }
+
+  void value(size_t depth) {
+    if (m_p == m_end)
+      fail();
+    switch (*m_p) {
+    case '{':
+      object(depth + 1);
+      break;
+    case '[':
+      array(depth + 1);
+      break;
+    case '"':
+      text(string());
+      break;
+    case 't':
+      literal("true", 4);
+      m_builder.add_bool(true);
+      break;
+    case 'f':
+      literal("false", 5);
+      m_builder.add_bool(false);
+      break;
+    case 'n':
+      literal("null", 4);
+      m_builder.add_null();
+      break;
+    default:
+      number();
+      break;
+    }
+  }
+
+  void object(size_t depth) {
+    if (depth > max_depth)
+      fail();
+    ++m_p;
+    m_builder.begin_object();
+    skip_ws();
+    if (m_p != m_end && *m_p == '}') {
+      ++m_p;
+      m_builder.end();
+      return;
+    }
+    while (true) {
+      if (m_p == m_end || *m_p != '"')
+        fail();
+      m_builder.key(string());
+      skip_ws();
+      expect(':');
+      skip_ws();
+      value(depth);
+      skip_ws();
+      if (m_p == m_end)
+        fail();
+      if (*m_p == '}')
+        break;
+      expect(',');
+      skip_ws();
+    }
+    ++m_p;
+    m_builder.end();
+  }
+
+  void array(size_t depth) {
+    if (depth > max_depth)
+      fail();
+    ++m_p;
+    m_builder.begin_array();
+    skip_ws();
+    if (m_p != m_end && *m_p == ']') {
+      ++m_p;
+      m_builder.end();
+      return;
+    }
+    while (true) {
+      value(depth);
+      skip_ws();
+      if (m_p == m_end)
+        fail();
+      if (*m_p == ']')
+        break;
+      expect(',');
+      skip_ws();
+    }
+    ++m_p;
+    m_builder.end();
+  }
+
+  // Reads the container at m_p keeping the members `node` selects. Array
+  // elements are matched against `node` itself.
+  void project(size_t depth, const Schema::Node &node) {
+    if (++depth > max_depth)
+      fail();
+    bool is_array = *m_p++ == '[';
+    char close = is_array ? ']' : '}';
+    if (is_array)
+      m_builder.begin_array();
+    else
+      m_builder.begin_object();
+    skip_ws();
+    if (m_p != m_end && *m_p == close) {
+      ++m_p;
+      m_builder.end();
+      return;
+    }
+    while (true) {
+      if (m_p == m_end)
+        fail();
+      if (is_array) {
+        if (*m_p == '{' || *m_p == '[')
+          project(depth, node);
+        else
+          value(depth);
+      } else {
+        if (*m_p != '"')
+          fail();
+        const Schema::Node *field = node.find(string());
+        skip_ws();
+        expect(':');
+        skip_ws();
+        if (field)
+          member(depth, *field);
+        else
+          skip(depth);
+      }
+      skip_ws();
+      if (m_p == m_end)
+        fail();
+      if (*m_p == close)
+        break;
+      expect(',');
+      skip_ws();
+    }
+    ++m_p;
+    m_builder.end();
+  }
+
+  void member(size_t depth, const Schema::Node &field) {
+    if (m_p == m_end)
+      fail();
+    if (!field.selected) {
+      // Only fields below this one are wanted, which a scalar cannot hold.
+      if (*m_p != '{' && *m_p != '[') {
+        skip(depth);
+        return;
+      }
+      m_builder.key(field.key, field.hash);
+      project(depth, field);
+      return;
+    }
+    m_builder.key(field.key, field.hash);
+    typed(depth, field);
+  }
+
+  void typed(size_t depth, const Schema::Node &field) {
+    const char *start = m_p;
+    char c = *m_p;
+    if (c == 'n') {
+      literal("null", 4);
+      m_builder.add_null();
+      return;
+    }
+    bool numeric = c == '-' || (c >= '0' && c <= '9');
+    switch (field.type) {
+    case FieldType::Any:
+      value(depth);
+      return;
+    case FieldType::Bool:
+      if (c != 't' && c != 'f')
+        mismatch(field, start);
+      value(depth);
+      return;
+    case FieldType::Object:
+    case FieldType::Array:
+      if (c != (field.type == FieldType::Object ? '{' : '['))
+        mismatch(field, start);
+      value(depth);
+      return;
+    case FieldType::String:
+      if (c == '"') {
+        m_builder.add_str(string());
+      } else if (numeric) {
+        read_number();
+        m_builder.add_str({start, static_cast<size_t>(m_p - start)});
+      } else {
+        mismatch(field, start);
+      }
+      return;
+    case FieldType::Bytes: {
+      if (c != '"')
+        mismatch(field, start);
+      std::string_view s = string();
+      ImportPolicy policy = m_policy;
+      if (policy.bytes == BytesEncoding::None)
+        policy.bytes = BytesEncoding::Hex;
+      if (!policy.decode_bytes(s, m_bytes))
+        mismatch(field, start);
+      m_builder.add_bytes(m_bytes);
+      return;
+    }
+    case FieldType::Int64:
+    case FieldType::Float64: {
+      Number n;
+      if (numeric)
+        n = read_number();
+      else if (c != '"' || !numeric_string(string(), n))
+        mismatch(field, start);
+      if (field.type == FieldType::Float64)
+        m_builder.add_f64(n.real ? n.d : static_cast<double>(n.i));
+      else if (!n.real)
+        m_builder.add_i64(n.i);
+      else if (n.d >= -0x1p63 && n.d < 0x1p63 && n.d == std::trunc(n.d))
+        m_builder.add_i64(static_cast<int64_t>(n.d));
+      else
+        mismatch(field, start);
+      return;
+    }
+    }
+  }
+
+  static bool numeric_string(std::string_view s, Number &n) {
+    const char *b = s.data();
+    const char *e = b + s.size();
+    if (b == e)
+      return false;
+    auto ri = std::from_chars(b, e, n.i);
+    if (ri.ec == std::errc() && ri.ptr == e) {
+      n.real = false;
+      return true;
+    }
+    auto rd = std::from_chars(b, e, n.d);
+    n.real = true;
+    return rd.ec == std::errc() && rd.ptr == e;
+  }
+
+  [[noreturn]] void mismatch(const Schema::Node &field,
+                             const char *at) const {
+    static constexpr const char *names[] = {
+        "any", "a bool", "an Int64", "a Float64",
+        "a string", "Bytes", "an object", "an array"};
+    throw exception("Schema field " + field.path + " is not " +
+                    names[static_cast<size_t>(field.type)] + " at offset " +
+                    std::to_string(at - m_begin));
+  }
+
+  // Passes over the value at m_p without building it, checking only that
+  // strings close and brackets balance.
+  void skip(size_t depth) {
+    if (m_p == m_end)
+      fail();
+    if (*m_p == '"') {
+      skip_string();
+      return;
+    }
+    if (*m_p != '{' && *m_p != '[') {
+      const char *start = m_p;
+      while (m_p != m_end && *m_p != ',' && *m_p != '}' && *m_p != ']' &&
+             !is_ws(*m_p))
+        ++m_p;
+      if (m_p == start)
+        fail();
+      return;
+    }
+    size_t level = 0;
+    while (m_p != m_end) {
+      switch (*m_p) {
+      case '"':
+        skip_string();
+        continue;
+      case '{':
+      case '[':
+        if (depth + ++level > max_depth)
+          fail();
+        break;
+      case '}':
+      case ']':
+        if (--level == 0) {
+          ++m_p;
+          return;
+        }
+        break;
+      }
+      ++m_p;
+    }
+    fail();
+  }
+
+  void skip_string() {
+    ++m_p;
+    while (true) {
+      m_p += utils::json_plain_prefix(m_p, m_end - m_p);
+      if (m_p == m_end || static_cast<unsigned char>(*m_p) < 0x20)
+        fail();
+      if (*m_p == '"') {
+        ++m_p;
+        return;
+      }
+      if (m_end - m_p < 2)
+        fail();
+      m_p += 2; // Backslash and the escaped character
+    }
+  }
+
+  void literal(const char *word, size_t n) {
+    if (static_cast<size_t>(m_end - m_p) < n || std::memcmp(m_p, word, n) != 0)
+      fail();
+    m_p += n;
+  }
+
+  void text(std::string_view s) {
+    if (m_policy.decode_bytes(s, m_bytes))
+      m_builder.add_bytes(m_bytes);
+    else
+      m_builder.add_str(s);
+  }
+
+  // Reads the string at m_p. The view is into the input when there are no
+  // escapes, otherwise into m_scratch, and is valid until the next call.
+  std::string_view string() {
+    ++m_p;
+    const char *start = m_p;
+    size_t plain = utils::json_plain_prefix(m_p, m_end - m_p);
+    m_p += plain;
+    if (m_p == m_end)
+      fail();
+    if (*m_p == '"') {
+      ++m_p;
+      return {start, plain};
+    }
+    m_scratch.assign(start, plain);
+    while (true) {
+      if (m_p == m_end || static_cast<unsigned char>(*m_p) < 0x20)
+        fail();
+      if (*m_p == '"') {
+        ++m_p;
+        return m_scratch;
+      }
+      ++m_p; // Backslash
+      if (m_p == m_end)
+        fail();
+      switch (*m_p++) {
+      case '"':
+        m_scratch += '"';
+        break;
+      case '\\':
+        m_scratch += '\\';
+        break;
+      case '/':
+        m_scratch += '/';
+        break;
+      case 'b':
+        m_scratch += '\b';
+        break;
+      case 'f':
+        m_scratch += '\f';
+        break;
+      case 'n':
+        m_scratch += '\n';
+        break;
+      case 'r':
+        m_scratch += '\r';
+        break;
+      case 't':
+        m_scratch += '\t';
+        break;
+      case 'u':
+        code_point();
+        break;
+      default:
+        --m_p;
+        fail();
+      }
+      plain = utils::json_plain_prefix(m_p, m_end - m_p);
+      m_scratch.append(m_p, plain);
+      m_p += plain;
+    }
+  }
+
+  uint32_t hex4() {
+    if (m_end - m_p < 4)
+      fail();
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+      int d = hex_value(m_p[i]);
+      if (d < 0)
+        fail();
+      v = (v << 4) | static_cast<uint32_t>(d);
+    }
+    m_p += 4;
+    return v;
+  }
+
+  // Decodes the digits after "\u", joining a surrogate pair, as UTF-8.
+  void code_point() {
+    uint32_t cp = hex4();
+    if (cp >= 0xDC00 && cp <= 0xDFFF)
+      fail();
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+      if (m_end - m_p < 2 || m_p[0] != '\\' || m_p[1] != 'u')
+        fail();
+      m_p += 2;
+      uint32_t lo = hex4();
+      if (lo < 0xDC00 || lo > 0xDFFF)
+        fail();
+      cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+    }
+    if (cp < 0x80) {
+      m_scratch += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+      m_scratch += static_cast<char>(0xC0 | (cp >> 6));
+      m_scratch += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+      m_scratch += static_cast<char>(0xE0 | (cp >> 12));
+      m_scratch += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      m_scratch += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+      m_scratch += static_cast<char>(0xF0 | (cp >> 18));
+      m_scratch += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      m_scratch += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      m_scratch += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+
+  void number() {
+    Number n = read_number();
+    if (n.real)
+      m_builder.add_f64(n.d);
+    else
+      m_builder.add_i64(n.i);
+  }
+
+  // Integers without a fraction or exponent that fit in int64 stay Int64;
+  // everything else is read as a double.
+  Number read_number() {
+    const char *start = m_p;
+    bool negative = m_p != m_end && *m_p == '-';
+    if (negative)
+      ++m_p;
+    const char *digits = m_p;
+    if (m_p == m_end || *m_p < '0' || *m_p > '9')
+      fail();
+    if (*m_p == '0')
+      ++m_p;
+    else
+      while (m_p != m_end && *m_p >= '0' && *m_p <= '9')
+        ++m_p;
+    size_t n_digits = m_p - digits;
+    bool real = false;
+    const char *fraction = m_p;
+    if (m_p != m_end && *m_p == '.') {
+      real = true;
+      fraction = ++m_p;
+      if (m_p == m_end || *m_p < '0' || *m_p > '9')
+        fail();
+      while (m_p != m_end && *m_p >= '0' && *m_p <= '9')
+        ++m_p;
+    }
+    const char *exponent = m_p;
+    if (m_p != m_end && (*m_p == 'e' || *m_p == 'E')) {
+      real = true;
+      exponent = ++m_p;
+      if (m_p != m_end && (*m_p == '+' || *m_p == '-'))
+        ++m_p;
+      if (m_p == m_end || *m_p < '0' || *m_p > '9')
+        fail();
+      while (m_p != m_end && *m_p >= '0' && *m_p <= '9')
+        ++m_p;
+    }
+
+    if (!real) {
+      if (n_digits <= 18) {
+        int64_t v = 0;
+        for (const char *d = digits; d != m_p; ++d)
+          v = v * 10 + (*d - '0');
+        return {false, negative ? -v : v, 0};
+      }
+      int64_t v;
+      auto r = std::from_chars(start, m_p, v);
+      if (r.ec == std::errc() && r.ptr == m_p)
+        return {false, v, 0};
+    }
+    double d;
+    auto r = std::from_chars(start, m_p, d);
+    if (r.ptr != m_p)
+      fail();
+    if (r.ec == std::errc::result_out_of_range) {
+      // As yyjson does: too small rounds to zero, too large is an error.
+      if (!overflows(digits, n_digits, fraction, exponent))
+        return {true, 0, negative ? -0.0 : 0.0};
+      throw exception("Number out of range at offset " +
+                      std::to_string(start - m_begin));
+    }
+    return {true, 0, d};
+  }
+
+  // Whether a number from_chars found out of range is too large rather than
+  // too small, from its decimal exponent: the position of its leading
+  // nonzero digit plus the (saturated) written exponent.
+  bool overflows(const char *digits, size_t n_digits, const char *fraction,
+                 const char *exponent) const {
+    int64_t scale;
+    if (*digits != '0') {
+      scale = static_cast<int64_t>(n_digits) - 1;
+    } else {
+      const char *d = fraction;
+      while (d != m_end && *d == '0')
+        ++d;
+      scale = -static_cast<int64_t>(d - fraction) - 1;
+    }
+    if (exponent != m_p) {
+      const char *e = exponent;
+      bool minus = *e == '-';
+      if (*e == '+' || *e == '-')
+        ++e;
+      int64_t written = 0;
+      for (; e != m_p && written < (int64_t{1} << 40); ++e)
+        written = written * 10 + (*e - '0');
+      scale += minus ? -written : written;
+    }
+    return scale > 0;
+  }
+
+  const char *m_begin;
+  const char *m_p;
+  const char *m_end;
+  Builder &m_builder;
+  const ImportPolicy &m_policy;
+  std::string m_scratch;
+  std::vector<std::byte> m_bytes;
+};
+
+struct Slice {
+  size_t begin;
+  size_t end;
+};
+
+// Cuts the root array of `json` at top-level commas into slices of element
+// text about `step` bytes long. Tracks only string and nesting state, so it
+// runs well ahead of the parser. Returns false when the root is not an
+// array or the structure is broken, leaving the serial parser to report it.
+bool split_array(std::string_view json, size_t step,
+                 std::vector<Slice> &slices) {
+  const char *p = json.data();
+  size_t n = json.size();
+  size_t i = 0;
+  while (i < n && is_ws(p[i]))
+    ++i;
+  if (i == n || p[i] != '[')
+    return false;
+  size_t begin = ++i;
+  size_t depth = 0;
+  for (; i < n; ++i) {
+    switch (p[i]) {
+    case '"':
+      ++i;
+      while (true) {
+        i += utils::json_plain_prefix(p + i, n - i);
+        if (i == n)
+          return false;
+        if (p[i] == '"')
+          break;
+        if (p[i] != '\\')
+          return false;
+        i += 2;
+        if (i >= n)
+          return false;
+      }
+      break;
+    case '[':
+    case '{':
+      ++depth;
+      break;
+    case ']':
+    case '}':
+      if (depth == 0) {
+        if (p[i] != ']')
+          return false;
+        slices.push_back({begin, i});
+        for (++i; i < n; ++i)
+          if (!is_ws(p[i]))
+            return false;
+        return true;
+      }
+      --depth;
+      break;
+    case ',':
+      if (depth == 0 && i - begin >= step) {
+        slices.push_back({begin, i});
+        begin = i + 1;
+      }
+      break;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+// Parses each slice of a root array into its own buffer, the root left
+// open, then splices the parts together: every part's element data is
+// copied into the result as one block and its offsets shifted, and the
+// root's B-tree is built once over all elements.
+class ParallelArrayParser {
+public:
+  ParallelArrayParser(std::string_view json, const ParallelOptions &options,
+                      unsigned threads)
+      : m_json(json), m_options(options), m_threads(threads) {}
+
+  // Returns false to fall back to the serial parser.
+  bool split() {
+    size_t slices = std::max<size_t>(
+        1, std::min<size_t>(size_t(m_threads) * 4,
+                            m_json.size() / std::max<size_t>(
+                                                m_options.min_chunk, 1)));
+    std::vector<Slice> cuts;
+    if (slices < 2 || !split_array(m_json, m_json.size() / slices, cuts) ||
+        cuts.size() < 2)
+      return false;
+    m_parts = std::vector<Part>(cuts.size());
+    for (size_t i = 0; i < cuts.size(); ++i)
+      m_parts[i].slice = cuts[i];
+    return true;
+  }
+
+  Buffer run() {
+    utils::run_parallel(m_threads, m_parts.size(), [this](size_t i) {
+      Part &part = m_parts[i];
+      Builder &builder = part.builder.emplace(part.buffer);
+      builder.begin_array();
+      Reader(m_json, builder, m_options.policy)
+          .elements(part.slice.begin, part.slice.end);
+    });
+
+    Buffer out;
+    Builder builder(out);
+    builder.begin_array();
+    std::vector<Builder *> parts;
+    for (Part &part : m_parts)
+      parts.push_back(&*part.builder);
+    builder.splice(parts, m_threads);
+    m_parts.clear();
+    builder.end();
+    return out;
+  }
+
+private:
+  struct Part {
+    Slice slice;
+    Buffer buffer;
+    std::optional<Builder> builder;
+  };
+
+  std::string_view m_json;
+  const ParallelOptions &m_options;
+  unsigned m_threads;
+  std::vector<Part> m_parts;
+};
+
+bool ImportPolicy::decode_bytes(std::string_view s,
+                                std::vector<std::byte> &out) const {
+  switch (bytes) {
+  case BytesEncoding::None:
+    return false;
+  case BytesEncoding::Hex:
+    if (s.size() % 2 != 0)
+      return false;
+    out.resize(s.size() / 2);
+    return utils::hex_decode(s, out.data());
+  case BytesEncoding::Prefixed:
+    if (s.size() < 4 || s[3] != ':')
+      return false;
+    if (s.substr(0, 3) == "hex") {
+      s.remove_prefix(4);
+      if (s.size() % 2 != 0)
+        return false;
+      out.resize(s.size() / 2);
+      return utils::hex_decode(s, out.data());
+    }
+    if (s.substr(0, 3) == "b64") {
+      s.remove_prefix(4);
+      out.resize(utils::base64_decoded_max(s.size()));
+      size_t n = utils::base64_decode(s, out.data());
+      if (n == SIZE_MAX)
+        return false;
+      out.resize(n);
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
+
+const Schema::Node *Schema::Node::find(std::string_view key) const {
+  for (const Node &child : children)
+    if (child.key.size() == key.size() &&
+        std::memcmp(child.key.data(), key.data(), key.size()) == 0)
+      return &child;
+  return nullptr;
+}
+
+Schema &Schema::field(std::string_view path, FieldType type) {
+  if (!path.empty() && path[0] != '/')
+    throw exception("Schema: path must start with '/': " + std::string(path));
+  Node *node = &m_root;
+  size_t pos = 0;
+  while (pos < path.size()) {
+    size_t end = path.find('/', pos + 1);
+    if (end == std::string_view::npos)
+      end = path.size();
+    std::string key;
+    for (size_t i = pos + 1; i < end; ++i) {
+      if (path[i] != '~') {
+        key += path[i];
+      } else if (i + 1 < end && (path[i + 1] == '0' || path[i + 1] == '1')) {
+        key += path[++i] == '0' ? '~' : '/';
+      } else {
+        throw exception("Schema: bad escape in " + std::string(path));
+      }
+    }
+    if (key.size() > 62)
+      throw exception("Schema: key too long in " + std::string(path));
+    const Node *found = node->find(key);
+    if (found) {
+      node = const_cast<Node *>(found);
+    } else {
+      Node &child = node->children.emplace_back();
+      child.hash = utils::djb2_hash(key);
+      child.key = std::move(key);
+      child.path = std::string(path.substr(0, end));
+      node = &child;
+    }
+    pos = end;
+  }
+  node->selected = true;
+  node->type = type;
+  return *this;
+}
+
+Buffer parse_json(std::string_view json, const ImportPolicy &policy) {
+  Buffer buffer;
+  parse_json(json, buffer, policy);
+  return buffer;
+}
+
+void parse_json(std::string_view json, Buffer &out,
+                const ImportPolicy &policy) {
+  Parser(policy).parse_into(json, out);
+}
+
+struct Parser::State {
+  explicit State(const ImportPolicy &p) : policy(p) {}
+
+  ImportPolicy policy;
+  Builder builder;
+  Reader reader{{}, builder, policy};
+};
+
+Parser::Parser(const ImportPolicy &policy)
+    : m_state(std::make_unique<State>(policy)) {}
+
+Parser::~Parser() = default;
+Parser::Parser(Parser &&) noexcept = default;
+Parser &Parser::operator=(Parser &&) noexcept = default;
+
+void Parser::set_policy(const ImportPolicy &policy) {
+  m_state->policy = policy;
+}
+
+void Parser::parse_into(std::span<const char> json, Buffer &out) {
+  // A scalar document yields an empty buffer, as from_json_string does.
+  try {
+    m_state->builder.reset(out);
+    m_state->reader.reset({json.data(), json.size()});
+    if (!m_state->reader.document())
+      out.clear();
+  } catch (...) {
+    out.clear();
+    throw;
+  }
+}
+
+void Parser::parse_into(std::span<const char> json, Buffer &out,
+                        const Schema &schema) {
+  try {
+    m_state->builder.reset(out);
+    m_state->reader.reset({json.data(), json.size()});
+    if (!m_state->reader.projected_document(schema))
+      out.clear();
+  } catch (...) {
+    out.clear();
+    throw;
+  }
+}
+
+Buffer parse_json_projected(std::string_view json, const Schema &schema,
+                            const ImportPolicy &policy) {
+  Buffer buffer;
+  Parser(policy).parse_into(json, buffer, schema);
+  return buffer;
+}
+
+void parse_json_into(std::span<const char> json, Buffer &out,
+                     const ImportPolicy &policy) {
+  thread_local Parser parser;
+  parser.set_policy(policy);
+  parser.parse_into(json, out);
+}
+
+Buffer parse_json_parallel(std::string_view json,
+                           const ParallelOptions &options) {
+  unsigned threads = options.threads;
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  if (threads > 1) {
+    ParallelArrayParser parser(json, options, threads);
+    if (parser.split())
+      return parser.run();
+  }
+  return parse_json(json, options.policy);
+}
+
+} // namespace lite3_json
+} // namespace lite3cpp
@@ -0,0 +1,378 @@
+#include "exception.hpp"
+#include "json.hpp"
+#include "node.hpp"
+#include "utils/hex.hpp"
+#include "utils/json_scan.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ostream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace lite3cpp {
+namespace lite3_json {
+
+namespace {
+
+// For every byte: 0 if it is copied verbatim, otherwise the character after
+// the backslash ('u' for \u00XX).
+constexpr std::array<char, 256> make_escape_table() {
+  std::array<char, 256> t{};
+  for (int c = 0; c < 0x20; ++c)
+    t[c] = 'u';
+  t['\b'] = 'b';
+  t['\t'] = 't';
+  t['\n'] = 'n';
+  t['\f'] = 'f';
+  t['\r'] = 'r';
+  t['"'] = '"';
+  t['\\'] = '\\';
+  return t;
+}
+constexpr std::array<char, 256> escape_table = make_escape_table();
+
+constexpr char hex_digits[] = "0123456789abcdef";
+
+class Writer {
+public:
+  // Text goes to `out` from `pos` on; finish() trims the slack after it.
+  Writer(const uint8_t *base, std::string &out, size_t pos, Sink *sink,
+         size_t chunk_size, const WriteOptions &options)
+      : m_base(base), m_out(out), m_pos(pos), m_sink(sink),
+        m_chunk_size(chunk_size), m_options(options) {}
+
+  void root() { container(0); }
+
+  void value(size_t vo) {
+    const uint8_t *p = m_base + vo + 1;
+    switch (static_cast<Type>(m_base[vo])) {
+    case Type::Null:
+      append("null", 4);
+      break;
+    case Type::Bool:
+      if (*p)
+        append("true", 4);
+      else
+        append("false", 5);
+      break;
+    case Type::Int64: {
+      int64_t v;
+      std::memcpy(&v, p, 8);
+      char tmp[24];
+      auto r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+      append(tmp, r.ptr - tmp);
+      break;
+    }
+    case Type::Float64: {
+      double v;
+      std::memcpy(&v, p, 8);
+      real(v);
+      break;
+    }
+    case Type::String: {
+      uint32_t len;
+      std::memcpy(&len, p, 4);
+      string(reinterpret_cast<const char *>(p + 4), len);
+      break;
+    }
+    case Type::Bytes: {
+      uint32_t len;
+      std::memcpy(&len, p, 4);
+      bytes(reinterpret_cast<const std::byte *>(p + 4), len);
+      break;
+    }
+    case Type::Object:
+    case Type::Array:
+      container(vo + 1);
+      break;
+    default:
+      append("null", 4);
+      break;
+    }
+  }
+
+  void finish() {
+    if (m_sink)
+      flush();
+    m_out.resize(m_pos);
+  }
+
+private:
+  void container(size_t node_ofs) {
+    bool is_array =
+        NodeView(reinterpret_cast<const PackedNodeLayout *>(m_base + node_ofs))
+            .type() == Type::Array;
+    put(is_array ? '[' : '{');
+    bool first = true;
+    ++m_depth;
+    entries(node_ofs, is_array, first);
+    --m_depth;
+    if (m_options.indent && !first)
+      newline();
+    put(is_array ? ']' : '}');
+  }
+
+  void newline() {
+    static constexpr char spaces[] = "                                ";
+    put('\n');
+    for (size_t n = size_t(m_depth) * m_options.indent; n;) {
+      size_t k = std::min(n, sizeof(spaces) - 1);
+      append(spaces, k);
+      n -= k;
+    }
+  }
+
+  // In-order walk; array elements come out in index order since their
+  // hash is the index.
+  void entries(size_t node_ofs, bool is_array, bool &first) {
+    NodeView node(
+        reinterpret_cast<const PackedNodeLayout *>(m_base + node_ofs));
+    int count = static_cast<int>(node.key_count());
+    for (int i = 0; i <= count; ++i) {
+      if (node.get_child_offset(i))
+        entries(node.get_child_offset(i), is_array, first);
+      if (i == count)
+        break;
+      if (!first)
+        put(',');
+      first = false;
+      if (m_options.indent)
+        newline();
+      size_t kv = node.get_kv_offset(i);
+      if (is_array) {
+        value(kv);
+      } else {
+        size_t key_len = (m_base[kv] >> 2) - 1;
+        string(reinterpret_cast<const char *>(m_base + kv + 1), key_len);
+        if (m_options.indent)
+          append(": ", 2);
+        else
+          put(':');
+        value(kv + 2 + key_len);
+      }
+      if (m_sink && m_pos >= m_chunk_size)
+        flush();
+    }
+  }
+
+  void string(const char *p, size_t n) {
+    put('"');
+    while (n) {
+      size_t plain = utils::json_plain_prefix(p, n);
+      append(p, plain);
+      if (plain == n)
+        break;
+      unsigned char c = static_cast<unsigned char>(p[plain]);
+      char esc = escape_table[c];
+      if (esc == 'u') {
+        char u[6] = {'\\', 'u', '0', '0', hex_digits[c >> 4],
+                     hex_digits[c & 15]};
+        append(u, 6);
+      } else {
+        char e[2] = {'\\', esc};
+        append(e, 2);
+      }
+      p += plain + 1;
+      n -= plain + 1;
+    }
+    put('"');
+  }
+
+  // Encoded straight into the output, which is sized for it first. A sink
+  // takes the value in steps of whole base64 groups that fit a chunk.
+  void bytes(const std::byte *p, size_t n) {
+    bool b64 = m_options.bytes == BytesEncoding::Prefixed;
+    if (b64)
+      append("\"b64:", 5);
+    else
+      put('"');
+    size_t step = m_sink ? std::max<size_t>(3, m_chunk_size / 6 * 3) : n;
+    for (size_t i = 0; i < n; i += step) {
+      size_t k = std::min(step, n - i);
+      size_t len = b64 ? utils::base64_encoded_size(k) : 2 * k;
+      char *d = reserve(len);
+      if (b64)
+        utils::base64_encode(p + i, k, d);
+      else
+        utils::hex_encode(p + i, k, d);
+      m_pos += len;
+    }
+    put('"');
+  }
+
+  // Shortest representation that reads back to the same double; integral
+  // values keep a ".0" so they read back as reals.
+  void real(double v) {
+    if (!std::isfinite(v)) {
+      append("null", 4);
+      return;
+    }
+    char tmp[32];
+    auto r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    size_t len = r.ptr - tmp;
+    append(tmp, len);
+    if (std::memchr(tmp, '.', len) == nullptr &&
+        std::memchr(tmp, 'e', len) == nullptr)
+      append(".0", 2);
+  }
+
+  // Grows the string geometrically; bytes past m_pos are scratch. With a
+  // sink the chunk is handed over instead, so it keeps its size.
+  char *reserve(size_t n) {
+    if (m_pos + n > m_out.size()) {
+      if (m_sink) {
+        flush();
+        if (n <= m_out.size())
+          return m_out.data();
+      }
+      m_out.resize(std::max(m_out.size() * 2, m_pos + n + 256));
+    }
+    return m_out.data() + m_pos;
+  }
+  void put(char c) {
+    *reserve(1) = c;
+    ++m_pos;
+  }
+  void append(const char *p, size_t n) {
+    if (m_sink && n > m_chunk_size) {
+      // Too long to be worth copying: passed on after the pending text.
+      std::string_view pieces[2] = {{m_out.data(), m_pos}, {p, n}};
+      m_sink->write(pieces + (m_pos == 0), 2 - (m_pos == 0));
+      m_pos = 0;
+      return;
+    }
+    std::memcpy(reserve(n), p, n);
+    m_pos += n;
+  }
+  void flush() {
+    if (m_pos) {
+      std::string_view piece(m_out.data(), m_pos);
+      m_sink->write(&piece, 1);
+      m_pos = 0;
+    }
+  }
+
+  const uint8_t *m_base;
+  std::string &m_out;
+  size_t m_pos;
+  Sink *m_sink;
+  size_t m_chunk_size;
+  const WriteOptions &m_options;
+  unsigned m_depth = 0;
+};
+
+} // namespace
+
+void write_json(const Buffer &buffer, size_t ofs, std::string &out,
+                const WriteOptions &options) {
+  if (buffer.size() == 0) {
+    out.append("null", 4);
+    return;
+  }
+  // Text is usually about as large as the buffer image.
+  size_t pos = out.size();
+  if (pos == 0)
+    out.resize(buffer.size());
+  Writer writer(buffer.data(), out, pos, nullptr, 0, options);
+  if (ofs == 0)
+    writer.root();
+  else
+    writer.value(ofs);
+  writer.finish();
+}
+
+void write_json(const Buffer &buffer, size_t ofs, Sink &sink,
+                size_t chunk_size, const WriteOptions &options) {
+  if (buffer.size() == 0) {
+    std::string_view null("null");
+    sink.write(&null, 1);
+    return;
+  }
+  chunk_size = std::max<size_t>(chunk_size, 16);
+  std::string chunk;
+  chunk.resize(chunk_size + 256);
+  Writer writer(buffer.data(), chunk, 0, &sink, chunk_size, options);
+  if (ofs == 0)
+    writer.root();
+  else
+    writer.value(ofs);
+  writer.finish();
+}
+
+void write_json(const Buffer &buffer, size_t ofs, const JsonSink &sink,
+                size_t chunk_size, const WriteOptions &options) {
+  CallbackSink adapter(sink);
+  write_json(buffer, ofs, adapter, chunk_size, options);
+}
+
+void FdSink::write(const std::string_view *pieces, size_t count) {
+#ifdef _WIN32
+  for (size_t i = 0; i < count; ++i) {
+    const char *p = pieces[i].data();
+    size_t n = pieces[i].size();
+    while (n) {
+      int r = _write(m_fd, p,
+                     static_cast<unsigned>(std::min<size_t>(n, 1 << 30)));
+      if (r < 0)
+        throw exception("JSON write failed");
+      p += r;
+      n -= static_cast<size_t>(r);
+    }
+  }
+#else
+  struct iovec iov[8];
+  while (count) {
+    size_t n = std::min<size_t>(count, 8);
+    for (size_t i = 0; i < n; ++i)
+      iov[i] = {const_cast<char *>(pieces[i].data()), pieces[i].size()};
+    struct iovec *v = iov;
+    while (n) {
+      ssize_t r = ::writev(m_fd, v, static_cast<int>(n));
+      if (r < 0) {
+        if (errno == EINTR)
+          continue;
+        throw exception("JSON write failed");
+      }
+      // Skip what was written, resuming a partial write mid-piece.
+      auto done = static_cast<size_t>(r);
+      while (n && done >= v->iov_len) {
+        done -= v->iov_len;
+        ++v;
+        --n;
+      }
+      if (n) {
+        v->iov_base = static_cast<char *>(v->iov_base) + done;
+        v->iov_len -= done;
+      }
+    }
+    size_t sent = std::min<size_t>(count, 8);
+    pieces += sent;
+    count -= sent;
+  }
+#endif
+}
+
+void StreamSink::write(const std::string_view *pieces, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    m_out.write(pieces[i].data(),
+                static_cast<std::streamsize>(pieces[i].size()));
+  if (!m_out)
+    throw exception("JSON write failed");
+}
+
+void CallbackSink::write(const std::string_view *pieces, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    m_fn(pieces[i]);
+}
+
+} // namespace lite3_json
+} // namespace lite3cpp
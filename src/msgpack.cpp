@@ -0,0 +1,477 @@
+#include "msgpack.hpp"
+#include "builder.hpp"
+#include "exception.hpp"
+#include "node.hpp"
+#include "utils/big_endian.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace lite3cpp {
+namespace lite3_msgpack {
+
+namespace {
+
+constexpr size_t max_depth = 512;
+
+// Thrown when the input ends inside a value; read_msgpack reports it as a
+// need for more input, parse_msgpack as an error.
+struct Truncated {};
+
+// Recursive descent over the encoded bytes, feeding a Builder. A scalar
+// root is read through but not built.
+class Reader {
+public:
+  Reader(std::span<const uint8_t> data, Builder &builder)
+      : m_begin(data.data()), m_p(m_begin), m_end(m_begin + data.size()),
+        m_builder(builder) {}
+
+  // Reads one value. Returns false when it was not a map or array.
+  bool document() {
+    need(1);
+    uint8_t c = *m_p;
+    bool container = (c & 0xe0) == 0x80 || (c >= 0xdc && c <= 0xdf);
+    m_discard = !container;
+    value(0);
+    return container;
+  }
+
+  size_t consumed() const { return static_cast<size_t>(m_p - m_begin); }
+
+private:
+  [[noreturn]] void fail(const uint8_t *at, const char *what) const {
+    throw exception(std::string(what) + " in MessagePack at offset " +
+                    std::to_string(at - m_begin));
+  }
+
+  void need(size_t n) const {
+    if (static_cast<size_t>(m_end - m_p) < n)
+      throw Truncated{};
+  }
+
+  template <typename T> T read() {
+    need(sizeof(T));
+    T v = utils::load_be<T>(m_p);
+    m_p += sizeof(T);
+    return v;
+  }
+
+  void value(size_t depth) {
+    const uint8_t *start = m_p;
+    uint8_t c = read<uint8_t>();
+    if (c <= 0x7f)
+      return integer(c);
+    if (c >= 0xe0)
+      return integer(static_cast<int8_t>(c));
+    switch (c >> 4) {
+    case 0x8:
+      return map(depth, c & 0x0f);
+    case 0x9:
+      return array(depth, c & 0x0f);
+    case 0xa:
+    case 0xb:
+      return string(c & 0x1f);
+    }
+    switch (c) {
+    case 0xc0:
+      if (!m_discard)
+        m_builder.add_null();
+      return;
+    case 0xc2:
+    case 0xc3:
+      if (!m_discard)
+        m_builder.add_bool(c == 0xc3);
+      return;
+    case 0xc4:
+      return bytes(read<uint8_t>());
+    case 0xc5:
+      return bytes(read<uint16_t>());
+    case 0xc6:
+      return bytes(read<uint32_t>());
+    case 0xca: {
+      float f;
+      uint32_t bits = read<uint32_t>();
+      std::memcpy(&f, &bits, 4);
+      return real(f);
+    }
+    case 0xcb: {
+      double d;
+      uint64_t bits = read<uint64_t>();
+      std::memcpy(&d, &bits, 8);
+      return real(d);
+    }
+    case 0xcc:
+      return integer(read<uint8_t>());
+    case 0xcd:
+      return integer(read<uint16_t>());
+    case 0xce:
+      return integer(read<uint32_t>());
+    case 0xcf: {
+      uint64_t v = read<uint64_t>();
+      if (v > static_cast<uint64_t>(INT64_MAX))
+        fail(m_p - 9, "Integer out of Int64 range");
+      return integer(static_cast<int64_t>(v));
+    }
+    case 0xd0:
+      return integer(static_cast<int8_t>(read<uint8_t>()));
+    case 0xd1:
+      return integer(static_cast<int16_t>(read<uint16_t>()));
+    case 0xd2:
+      return integer(static_cast<int32_t>(read<uint32_t>()));
+    case 0xd3:
+      return integer(static_cast<int64_t>(read<uint64_t>()));
+    case 0xd9:
+      return string(read<uint8_t>());
+    case 0xda:
+      return string(read<uint16_t>());
+    case 0xdb:
+      return string(read<uint32_t>());
+    case 0xdc:
+      return array(depth, read<uint16_t>());
+    case 0xdd:
+      return array(depth, read<uint32_t>());
+    case 0xde:
+      return map(depth, read<uint16_t>());
+    case 0xdf:
+      return map(depth, read<uint32_t>());
+    default:
+      // 0xc1 is never used; the rest are ext types.
+      fail(start, c == 0xc1 ? "Invalid byte" : "Unsupported ext type");
+    }
+  }
+
+  void integer(int64_t v) {
+    if (!m_discard)
+      m_builder.add_i64(v);
+  }
+
+  void real(double v) {
+    if (!m_discard)
+      m_builder.add_f64(v);
+  }
+
+  std::string_view raw(size_t n) {
+    need(n);
+    std::string_view s(reinterpret_cast<const char *>(m_p), n);
+    m_p += n;
+    return s;
+  }
+
+  void string(size_t n) {
+    std::string_view s = raw(n);
+    if (!m_discard)
+      m_builder.add_str(s);
+  }
+
+  void bytes(size_t n) {
+    std::string_view s = raw(n);
+    if (!m_discard)
+      m_builder.add_bytes(
+          {reinterpret_cast<const std::byte *>(s.data()), s.size()});
+  }
+
+  void array(size_t depth, size_t n) {
+    if (++depth > max_depth)
+      fail(m_p, "Nesting too deep");
+    // Every element takes at least a byte.
+    need(n);
+    m_builder.begin_array();
+    for (size_t i = 0; i < n; ++i)
+      value(depth);
+    m_builder.end();
+  }
+
+  void map(size_t depth, size_t n) {
+    if (++depth > max_depth)
+      fail(m_p, "Nesting too deep");
+    need(n);
+    m_builder.begin_object();
+    for (size_t i = 0; i < n; ++i) {
+      const uint8_t *at = m_p;
+      uint8_t c = read<uint8_t>();
+      size_t len;
+      if ((c & 0xe0) == 0xa0)
+        len = c & 0x1f;
+      else if (c == 0xd9)
+        len = read<uint8_t>();
+      else if (c == 0xda)
+        len = read<uint16_t>();
+      else if (c == 0xdb)
+        len = read<uint32_t>();
+      else
+        fail(at, "Map key is not a string");
+      std::string_view key = raw(len);
+      if (key.size() > 62)
+        fail(at, "Map key too long");
+      m_builder.key(key);
+      value(depth);
+    }
+    m_builder.end();
+  }
+
+  const uint8_t *m_begin;
+  const uint8_t *m_p;
+  const uint8_t *m_end;
+  Builder &m_builder;
+  bool m_discard = false;
+};
+
+// Reads one value into `out`; returns the bytes taken, or 0 if the input
+// ends inside it and `stream` is set.
+size_t read_value(std::span<const uint8_t> data, Buffer &out, bool stream) {
+  thread_local Builder builder;
+  try {
+    builder.reset(out);
+    Reader reader(data, builder);
+    if (!reader.document())
+      out.clear();
+    return reader.consumed();
+  } catch (const Truncated &) {
+    out.clear();
+    if (stream)
+      return 0;
+    throw exception("Truncated MessagePack at offset " +
+                    std::to_string(data.size()));
+  } catch (...) {
+    out.clear();
+    throw;
+  }
+}
+
+// Walks the B-tree as json_writer's Writer does, into a span that grows
+// only when backed by a vector.
+class Writer {
+public:
+  Writer(const uint8_t *base, uint8_t *out, size_t capacity,
+         std::vector<uint8_t> *grow, size_t pos)
+      : m_base(base), m_out(out), m_capacity(capacity), m_grow(grow),
+        m_pos(pos) {}
+
+  void root() { container(0); }
+
+  void value(size_t vo) {
+    const uint8_t *p = m_base + vo + 1;
+    switch (static_cast<Type>(m_base[vo])) {
+    case Type::Bool:
+      put(*p ? 0xc3 : 0xc2);
+      break;
+    case Type::Int64: {
+      int64_t v;
+      std::memcpy(&v, p, 8);
+      integer(v);
+      break;
+    }
+    case Type::Float64: {
+      uint64_t bits;
+      std::memcpy(&bits, p, 8);
+      tagged(0xcb, bits);
+      break;
+    }
+    case Type::String:
+    case Type::Bytes: {
+      uint32_t len;
+      std::memcpy(&len, p, 4);
+      if (static_cast<Type>(m_base[vo]) == Type::String)
+        header(len, 0xa0, 32, 0xd9);
+      else
+        header(len, 0, 0, 0xc4);
+      std::memcpy(reserve(len), p + 4, len);
+      m_pos += len;
+      break;
+    }
+    case Type::Object:
+    case Type::Array:
+      container(vo + 1);
+      break;
+    default:
+      put(0xc0);
+      break;
+    }
+  }
+
+  size_t pos() const { return m_pos; }
+
+private:
+  NodeView node_at(size_t ofs) const {
+    return NodeView(reinterpret_cast<const PackedNodeLayout *>(m_base + ofs));
+  }
+
+  // Object nodes do not track their size, so members are counted over the
+  // tree's nodes first.
+  size_t count(size_t node_ofs) const {
+    NodeView node = node_at(node_ofs);
+    size_t n = node.key_count();
+    for (int i = 0; i <= static_cast<int>(node.key_count()); ++i)
+      if (node.get_child_offset(i))
+        n += count(node.get_child_offset(i));
+    return n;
+  }
+
+  void container(size_t node_ofs) {
+    bool is_array = node_at(node_ofs).type() == Type::Array;
+    if (is_array)
+      header(node_at(node_ofs).size(), 0x90, 16, 0xdc);
+    else
+      header(count(node_ofs), 0x80, 16, 0xde);
+    entries(node_ofs, is_array);
+  }
+
+  void entries(size_t node_ofs, bool is_array) {
+    NodeView node = node_at(node_ofs);
+    int count = static_cast<int>(node.key_count());
+    for (int i = 0; i <= count; ++i) {
+      if (node.get_child_offset(i))
+        entries(node.get_child_offset(i), is_array);
+      if (i == count)
+        break;
+      size_t kv = node.get_kv_offset(i);
+      if (is_array) {
+        value(kv);
+      } else {
+        size_t key_len = (m_base[kv] >> 2) - 1;
+        header(key_len, 0xa0, 32, 0xd9);
+        std::memcpy(reserve(key_len), m_base + kv + 1, key_len);
+        m_pos += key_len;
+        value(kv + 2 + key_len);
+      }
+    }
+  }
+
+  // Writes the shortest header for `n`: `fix | n` below `fix_limit`, else
+  // the 8-, 16- or 32-bit length form starting at code `wide` (str and bin
+  // have an 8-bit form, arrays and maps start at 16 bits).
+  void header(size_t n, uint8_t fix, size_t fix_limit, uint8_t wide) {
+    if (n > UINT32_MAX)
+      throw exception("MessagePack length out of range");
+    bool has8 = wide == 0xd9 || wide == 0xc4;
+    if (n < fix_limit) {
+      put(static_cast<uint8_t>(fix | n));
+    } else if (has8 && n <= 0xff) {
+      uint8_t *d = reserve(2);
+      d[0] = wide;
+      d[1] = static_cast<uint8_t>(n);
+      m_pos += 2;
+    } else if (n <= 0xffff) {
+      tagged(static_cast<uint8_t>(wide + (has8 ? 1 : 0)),
+             static_cast<uint16_t>(n));
+    } else {
+      tagged(static_cast<uint8_t>(wide + (has8 ? 2 : 1)),
+             static_cast<uint32_t>(n));
+    }
+  }
+
+  void integer(int64_t v) {
+    if (v >= -32 && v <= 0x7f)
+      put(static_cast<uint8_t>(v));
+    else if (v >= 0 && v <= 0xff)
+      tagged(0xcc, static_cast<uint8_t>(v));
+    else if (v >= 0 && v <= 0xffff)
+      tagged(0xcd, static_cast<uint16_t>(v));
+    else if (v >= 0 && v <= 0xffffffff)
+      tagged(0xce, static_cast<uint32_t>(v));
+    else if (v >= 0)
+      tagged(0xcf, static_cast<uint64_t>(v));
+    else if (v >= INT8_MIN)
+      tagged(0xd0, static_cast<uint8_t>(v));
+    else if (v >= INT16_MIN)
+      tagged(0xd1, static_cast<uint16_t>(v));
+    else if (v >= INT32_MIN)
+      tagged(0xd2, static_cast<uint32_t>(v));
+    else
+      tagged(0xd3, static_cast<uint64_t>(v));
+  }
+
+  // A type code followed by a big-endian payload.
+  template <typename T> void tagged(uint8_t code, T v) {
+    uint8_t *d = reserve(1 + sizeof(T));
+    d[0] = code;
+    utils::store_be(d + 1, v);
+    m_pos += 1 + sizeof(T);
+  }
+
+  void put(uint8_t c) {
+    *reserve(1) = c;
+    ++m_pos;
+  }
+
+  uint8_t *reserve(size_t n) {
+    if (m_pos + n > m_capacity) {
+      if (!m_grow)
+        throw exception("MessagePack output span too small");
+      m_grow->resize(std::max(m_grow->size() * 2, m_pos + n + 256));
+      m_out = m_grow->data();
+      m_capacity = m_grow->size();
+    }
+    return m_out + m_pos;
+  }
+
+  const uint8_t *m_base;
+  uint8_t *m_out;
+  size_t m_capacity;
+  std::vector<uint8_t> *m_grow;
+  size_t m_pos;
+};
+
+} // namespace
+
+void parse_msgpack(std::span<const uint8_t> data, Buffer &out) {
+  size_t n = read_value(data, out, false);
+  if (n != data.size()) {
+    out.clear();
+    throw exception("Trailing bytes after MessagePack at offset " +
+                    std::to_string(n));
+  }
+}
+
+Buffer parse_msgpack(std::span<const uint8_t> data) {
+  Buffer buffer;
+  parse_msgpack(data, buffer);
+  return buffer;
+}
+
+size_t read_msgpack(std::span<const uint8_t> data, Buffer &out) {
+  return read_value(data, out, true);
+}
+
+size_t write_msgpack(const Buffer &buffer, size_t ofs,
+                     std::span<uint8_t> out) {
+  if (buffer.size() == 0) {
+    if (out.empty())
+      throw exception("MessagePack output span too small");
+    out[0] = 0xc0;
+    return 1;
+  }
+  Writer writer(buffer.data(), out.data(), out.size(), nullptr, 0);
+  if (ofs == 0)
+    writer.root();
+  else
+    writer.value(ofs);
+  return writer.pos();
+}
+
+void write_msgpack(const Buffer &buffer, size_t ofs,
+                   std::vector<uint8_t> &out) {
+  if (buffer.size() == 0) {
+    out.push_back(0xc0);
+    return;
+  }
+  // Usually a little smaller than the buffer image.
+  size_t pos = out.size();
+  out.resize(pos + buffer.size());
+  Writer writer(buffer.data(), out.data(), out.size(), &out, pos);
+  if (ofs == 0)
+    writer.root();
+  else
+    writer.value(ofs);
+  out.resize(writer.pos());
+}
+
+std::vector<uint8_t> to_msgpack(const Buffer &buffer, size_t ofs) {
+  std::vector<uint8_t> out;
+  write_msgpack(buffer, ofs, out);
+  return out;
+}
+
+} // namespace lite3_msgpack
+} // namespace lite3cpp
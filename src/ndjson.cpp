@@ -0,0 +1,342 @@
+#include "ndjson.hpp"
+#include "exception.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace lite3cpp {
+namespace lite3_json {
+
+namespace {
+
+struct Chunk {
+  uint64_t seq = 0;
+  uint64_t offset = 0; // Of the chunk's first byte in the input
+  std::string owned;   // Text read from a file; empty for in-memory input
+  std::string_view text;
+
+  std::string_view view() const {
+    return owned.empty() ? text : std::string_view(owned);
+  }
+};
+
+// Chunks flow from the calling thread through a bounded queue to the
+// workers. Ordered delivery hands the turn from chunk to chunk by sequence
+// number, so workers keep parsing ahead while one of them delivers.
+class Pipeline {
+public:
+  Pipeline(const RecordConsumer &consumer, const IngestOptions &options)
+      : m_consumer(consumer), m_options(options) {
+    unsigned threads = options.threads;
+    if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    m_max_queued = 2 * static_cast<size_t>(threads);
+    for (unsigned i = 0; i < threads; ++i)
+      m_workers.emplace_back([this] { work(); });
+  }
+
+  ~Pipeline() {
+    if (!m_workers.empty() && m_workers.front().joinable()) {
+      fail(std::make_exception_ptr(exception("NDJSON ingest aborted")));
+      for (auto &w : m_workers)
+        w.join();
+    }
+  }
+
+  // Queues a chunk, blocking while the workers are behind. Returns false
+  // once the pipeline has failed.
+  bool push(std::string owned, std::string_view text, uint64_t offset) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_space.wait(lock,
+                 [&] { return m_queue.size() < m_max_queued || m_error; });
+    if (m_error)
+      return false;
+    Chunk &c = m_queue.emplace_back();
+    c.seq = m_next_seq++;
+    c.offset = offset;
+    c.owned = std::move(owned);
+    c.text = text;
+    m_bytes += c.view().size();
+    m_ready.notify_one();
+    return true;
+  }
+
+  IngestStats finish() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_done = true;
+    }
+    m_ready.notify_all();
+    for (auto &w : m_workers)
+      w.join();
+    if (m_error)
+      std::rethrow_exception(m_error);
+    return {m_records.load(), m_bytes};
+  }
+
+private:
+  void work() {
+    Parser parser(m_options.policy);
+    Buffer doc;
+    std::vector<Buffer> docs;
+    std::vector<uint64_t> offsets;
+    while (true) {
+      Chunk chunk;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_ready.wait(lock,
+                     [&] { return !m_queue.empty() || m_done || m_error; });
+        if (m_error || m_queue.empty())
+          return;
+        chunk = std::move(m_queue.front());
+        m_queue.pop_front();
+      }
+      m_space.notify_one();
+      try {
+        size_t n = parse(chunk, parser, doc, docs, offsets);
+        if (m_options.ordered)
+          deliver(chunk.seq, docs, offsets, n);
+      } catch (...) {
+        fail(std::current_exception());
+        return;
+      }
+    }
+  }
+
+  // Parses every line of the chunk. Unordered records go straight to the
+  // consumer; ordered ones are kept in `docs` for deliver().
+  size_t parse(const Chunk &chunk, Parser &parser, Buffer &doc,
+               std::vector<Buffer> &docs, std::vector<uint64_t> &offsets) {
+    std::string_view text = chunk.view();
+    size_t n = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+      size_t nl = text.find('\n', pos);
+      if (nl == std::string_view::npos)
+        nl = text.size();
+      std::string_view line = text.substr(pos, nl - pos);
+      uint64_t offset = chunk.offset + pos;
+      pos = nl + 1;
+      if (line.find_first_not_of(" \t\r") == std::string_view::npos)
+        continue;
+
+      Buffer *target = &doc;
+      if (m_options.ordered) {
+        if (n == docs.size()) {
+          docs.emplace_back();
+          offsets.push_back(0);
+        }
+        target = &docs[n];
+        offsets[n] = offset;
+      }
+      try {
+        parser.parse_into(line, *target);
+      } catch (const exception &e) {
+        throw exception("NDJSON record at offset " + std::to_string(offset) +
+                        ": " + e.what());
+      }
+      if (m_options.ordered) {
+        ++n;
+      } else {
+        m_consumer(offset, doc);
+        m_records.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    return n;
+  }
+
+  void deliver(uint64_t seq, std::vector<Buffer> &docs,
+               const std::vector<uint64_t> &offsets, size_t n) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_turn.wait(lock, [&] { return m_delivered == seq || m_error; });
+      if (m_error)
+        return;
+    }
+    // Only the worker holding the turn gets here.
+    for (size_t i = 0; i < n; ++i)
+      m_consumer(offsets[i], docs[i]);
+    m_records.fetch_add(n, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      ++m_delivered;
+    }
+    m_turn.notify_all();
+  }
+
+  void fail(std::exception_ptr e) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_error)
+        m_error = e;
+    }
+    m_ready.notify_all();
+    m_space.notify_all();
+    m_turn.notify_all();
+  }
+
+  const RecordConsumer &m_consumer;
+  const IngestOptions &m_options;
+  std::vector<std::thread> m_workers;
+
+  std::mutex m_mutex;
+  std::condition_variable m_ready; // Queue has chunks, or done
+  std::condition_variable m_space; // Queue has room
+  std::condition_variable m_turn;  // m_delivered advanced
+  std::deque<Chunk> m_queue;
+  size_t m_max_queued = 0;
+  uint64_t m_next_seq = 0;
+  uint64_t m_delivered = 0;
+  uint64_t m_bytes = 0;
+  bool m_done = false;
+  std::exception_ptr m_error;
+  std::atomic<uint64_t> m_records{0};
+};
+
+// Fills `p` unless the input ends first; returns the bytes read.
+size_t read_full(int fd, char *p, size_t n) {
+  size_t got = 0;
+  while (got < n) {
+#ifdef _WIN32
+    int r = _read(fd, p + got,
+                  static_cast<unsigned>(std::min<size_t>(n - got, INT_MAX)));
+#else
+    ssize_t r = ::read(fd, p + got, n - got);
+#endif
+    if (r == 0)
+      break;
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      throw exception("NDJSON read failed");
+    }
+    got += static_cast<size_t>(r);
+  }
+  return got;
+}
+
+} // namespace
+
+IngestStats ingest_ndjson(int fd, const RecordConsumer &consumer,
+                          const IngestOptions &options) {
+  Pipeline pipeline(consumer, options);
+  size_t chunk_size = std::max<size_t>(options.chunk_size, 1);
+  std::string carry;
+  uint64_t offset = 0;
+  while (true) {
+    std::string block = std::move(carry);
+    carry.clear();
+    size_t have = block.size();
+    block.resize(have + chunk_size);
+    size_t got = read_full(fd, block.data() + have, chunk_size);
+    block.resize(have + got);
+    bool eof = got < chunk_size;
+
+    // Cut after the last newline; the partial line starts the next chunk.
+    if (!eof) {
+      size_t nl = block.rfind('\n');
+      if (nl == std::string::npos) {
+        carry = std::move(block); // A line longer than a chunk
+        continue;
+      }
+      carry.assign(block, nl + 1);
+      block.resize(nl + 1);
+    }
+    size_t len = block.size();
+    if (len != 0 && !pipeline.push(std::move(block), {}, offset))
+      break;
+    offset += len;
+    if (eof)
+      break;
+  }
+  return pipeline.finish();
+}
+
+IngestStats ingest_ndjson_file(const std::string &path,
+                               const RecordConsumer &consumer,
+                               const IngestOptions &options) {
+#ifdef _WIN32
+  int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+#endif
+  if (fd < 0)
+    throw exception("Cannot open " + path);
+  struct Closer {
+    int fd;
+    ~Closer() {
+#ifdef _WIN32
+      _close(fd);
+#else
+      ::close(fd);
+#endif
+    }
+  } closer{fd};
+  return ingest_ndjson(fd, consumer, options);
+}
+
+IngestStats ingest_ndjson(std::string_view text,
+                          const RecordConsumer &consumer,
+                          const IngestOptions &options) {
+  Pipeline pipeline(consumer, options);
+  size_t chunk_size = std::max<size_t>(options.chunk_size, 1);
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = text.size();
+    if (text.size() - pos > chunk_size) {
+      size_t nl = text.find('\n', pos + chunk_size - 1);
+      if (nl != std::string_view::npos)
+        end = nl + 1;
+    }
+    if (!pipeline.push({}, text.substr(pos, end - pos), pos))
+      break;
+    pos = end;
+  }
+  return pipeline.finish();
+}
+
+namespace {
+
+template <typename Input>
+Buffer fold(Input input, const IngestOptions &options) {
+  Buffer out;
+  out.init_array();
+  IngestOptions ordered = options;
+  ordered.ordered = true;
+  ingest_ndjson(
+      input,
+      [&](uint64_t, Buffer &doc) {
+        if (doc.size() != 0)
+          out.copy_subtree(0, {}, doc, 0);
+      },
+      ordered);
+  return out;
+}
+
+} // namespace
+
+Buffer fold_ndjson(int fd, const IngestOptions &options) {
+  return fold(fd, options);
+}
+
+Buffer fold_ndjson(std::string_view text, const IngestOptions &options) {
+  return fold(text, options);
+}
+
+} // namespace lite3_json
+} // namespace lite3cpp
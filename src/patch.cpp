@@ -0,0 +1,592 @@
+#include "patch.hpp"
+#include "digest.hpp"
+#include "exception.hpp"
+#include "utils/hash.hpp"
+#include <cstring>
+#include <string_view>
+
+namespace lite3cpp {
+
+namespace {
+
+struct Entry {
+  uint32_t hash;
+  size_t kv_ofs;
+};
+
+NodeView node_at(const uint8_t *base, size_t ofs) {
+  return NodeView(reinterpret_cast<const PackedNodeLayout *>(base + ofs));
+}
+
+size_t value_offset(const uint8_t *base, size_t kv_ofs, bool is_array) {
+  return is_array ? kv_ofs : kv_ofs + 1 + (base[kv_ofs] >> 2);
+}
+
+std::string_view entry_key(const uint8_t *base, size_t kv_ofs) {
+  return {reinterpret_cast<const char *>(base + kv_ofs + 1),
+          static_cast<size_t>((base[kv_ofs] >> 2) - 1)};
+}
+
+bool is_container(Type t) { return t == Type::Object || t == Type::Array; }
+
+// Bytes after the type byte of a scalar value.
+size_t scalar_size(const uint8_t *base, size_t vo) {
+  switch (static_cast<Type>(base[vo])) {
+  case Type::Bool:
+    return 1;
+  case Type::Int64:
+  case Type::Float64:
+    return 8;
+  case Type::String:
+  case Type::Bytes: {
+    uint32_t len;
+    std::memcpy(&len, base + vo + 1, 4);
+    return 4 + len + (static_cast<Type>(base[vo]) == Type::String ? 1 : 0);
+  }
+  default:
+    return 0;
+  }
+}
+
+void append_key(std::string &path, std::string_view key) {
+  path += '/';
+  for (char c : key) {
+    if (c == '~')
+      path += "~0";
+    else if (c == '/')
+      path += "~1";
+    else
+      path += c;
+  }
+}
+
+// Walks both trees and records the ops; Set values are recorded by their
+// type offset in `to` and copied into the patch afterwards.
+class Differ {
+public:
+  Differ(const Buffer &from, const Buffer &to)
+      : m_a(from.data()), m_b(to.data()),
+        m_ta(from.digest_table()), m_tb(to.digest_table()) {}
+
+  // Diffs the containers at node offsets `an`/`bn`, which have the same
+  // type. Returns false when the difference needs a whole-value Set.
+  bool container(size_t an, size_t bn, std::string &path) {
+    if (m_ta && m_tb && m_ta->subtree(an) == m_tb->subtree(bn))
+      return true;
+    if (node_at(m_a, an).type() == Type::Array)
+      return array(an, bn, path);
+    object(an, bn, path);
+    return true;
+  }
+
+  std::vector<PatchOp> ops;
+  std::vector<size_t> sources;
+
+private:
+  void object(size_t an, size_t bn, std::string &path) {
+    // Entries of both sides go on a shared stack, reused by nested calls.
+    size_t a_begin = m_stack.size();
+    collect(m_a, an);
+    size_t b_begin = m_stack.size();
+    collect(m_b, bn);
+    size_t b_end = m_stack.size();
+
+    size_t i = a_begin, j = b_begin;
+    while (i < b_begin || j < b_end) {
+      int c = i == b_begin ? 1 : j == b_end ? -1 : order(m_stack[i], m_stack[j]);
+      size_t base_len = path.size();
+      if (c < 0) {
+        append_key(path, entry_key(m_a, m_stack[i++].kv_ofs));
+        ops.push_back({PatchOp::Kind::Remove, path});
+      } else {
+        Entry eb = m_stack[j++];
+        append_key(path, entry_key(m_b, eb.kv_ofs));
+        size_t vb = value_offset(m_b, eb.kv_ofs, false);
+        if (c > 0)
+          set(path, vb);
+        else
+          value(value_offset(m_a, m_stack[i++].kv_ofs, false), vb, path);
+      }
+      path.resize(base_len);
+    }
+    m_stack.resize(a_begin);
+  }
+
+  bool array(size_t an, size_t bn, std::string &path) {
+    uint32_t na = node_at(m_a, an).size(), nb = node_at(m_b, bn).size();
+    if (nb < na)
+      return false;
+    size_t a_begin = m_stack.size();
+    collect(m_a, an);
+    size_t b_begin = m_stack.size();
+    collect(m_b, bn);
+
+    // Elements are keyed by index, so in-order entries line up by position.
+    for (size_t k = 0; k < nb; ++k) {
+      size_t base_len = path.size();
+      path += '/' + std::to_string(k);
+      size_t vb = m_stack[b_begin + k].kv_ofs;
+      if (k < na)
+        value(m_stack[a_begin + k].kv_ofs, vb, path);
+      else
+        set(path, vb);
+      path.resize(base_len);
+    }
+    m_stack.resize(a_begin);
+    return true;
+  }
+
+  void value(size_t va, size_t vb, std::string &path) {
+    Type ta = static_cast<Type>(m_a[va]);
+    if (ta == static_cast<Type>(m_b[vb])) {
+      if (is_container(ta)) {
+        if (container(va + 1, vb + 1, path))
+          return;
+      } else {
+        size_t n = scalar_size(m_a, va);
+        if (n == scalar_size(m_b, vb) &&
+            std::memcmp(m_a + va + 1, m_b + vb + 1, n) == 0)
+          return;
+      }
+    }
+    set(path, vb);
+  }
+
+  void set(const std::string &path, size_t vb) {
+    ops.push_back({PatchOp::Kind::Set, path,
+                   static_cast<uint32_t>(sources.size())});
+    sources.push_back(vb);
+  }
+
+  void collect(const uint8_t *base, size_t ofs) {
+    NodeView n = node_at(base, ofs);
+    int count = static_cast<int>(n.key_count());
+    for (int i = 0; i <= count; ++i) {
+      if (n.get_child_offset(i))
+        collect(base, n.get_child_offset(i));
+      if (i < count)
+        m_stack.push_back({n.get_hash(i), n.get_kv_offset(i)});
+    }
+  }
+
+  int order(Entry ea, Entry eb) const {
+    if (ea.hash != eb.hash)
+      return ea.hash < eb.hash ? -1 : 1;
+    return entry_key(m_a, ea.kv_ofs).compare(entry_key(m_b, eb.kv_ofs));
+  }
+
+  const uint8_t *m_a;
+  const uint8_t *m_b;
+  const DigestTable *m_ta;
+  const DigestTable *m_tb;
+  std::vector<Entry> m_stack;
+};
+
+std::string unescape(std::string_view token) {
+  std::string out;
+  out.reserve(token.size());
+  for (size_t i = 0; i < token.size(); ++i) {
+    if (token[i] == '~' && i + 1 < token.size() &&
+        (token[i + 1] == '0' || token[i + 1] == '1')) {
+      out += token[i + 1] == '0' ? '~' : '/';
+      ++i;
+    } else {
+      out += token[i];
+    }
+  }
+  return out;
+}
+
+// RFC 6901 array index: decimal digits without a leading zero.
+bool index_token(std::string_view token, uint32_t &index) {
+  if (token.empty() || token.size() > 10 ||
+      (token[0] == '0' && token.size() > 1))
+    return false;
+  uint64_t v = 0;
+  for (char c : token) {
+    if (c < '0' || c > '9')
+      return false;
+    v = v * 10 + static_cast<uint64_t>(c - '0');
+  }
+  if (v > UINT32_MAX)
+    return false;
+  index = static_cast<uint32_t>(v);
+  return true;
+}
+
+// The unescaped token; `scratch` holds it only when it had escapes.
+std::string_view key_token(std::string_view token, std::string &scratch) {
+  if (token.find('~') == std::string_view::npos)
+    return token;
+  scratch = unescape(token);
+  return scratch;
+}
+
+// A member of a JSON Patch operation that should be a string. A Hex
+// import policy reads "" as empty Bytes, which is taken as "" here.
+std::optional<std::string_view> text_member(const Buffer &patch, size_t ofs,
+                                            std::string_view key) {
+  switch (patch.get_type(ofs, key)) {
+  case Type::String:
+    return patch.get_str(ofs, key);
+  case Type::Bytes:
+    if (patch.get_bytes(ofs, key).empty())
+      return std::string_view();
+    return std::nullopt;
+  default:
+    return std::nullopt;
+  }
+}
+
+bool equal_values(const uint8_t *a, size_t va, const uint8_t *b, size_t vb);
+
+// Same members, or same elements in order. Entries come out of both trees
+// in (hash, key) order, so equal containers yield equal sequences.
+bool equal_containers(const uint8_t *a, size_t an, const uint8_t *b,
+                      size_t bn) {
+  Type type = node_at(a, an).type();
+  if (node_at(b, bn).type() != type)
+    return false;
+  bool is_array = type == Type::Array;
+  std::vector<Entry> ea, eb;
+  auto collect = [](const uint8_t *base, size_t ofs, std::vector<Entry> &out,
+                    auto &self) -> void {
+    NodeView n = node_at(base, ofs);
+    int count = static_cast<int>(n.key_count());
+    for (int i = 0; i <= count; ++i) {
+      if (n.get_child_offset(i))
+        self(base, n.get_child_offset(i), out, self);
+      if (i < count)
+        out.push_back({n.get_hash(i), n.get_kv_offset(i)});
+    }
+  };
+  collect(a, an, ea, collect);
+  collect(b, bn, eb, collect);
+  if (ea.size() != eb.size())
+    return false;
+  for (size_t k = 0; k < ea.size(); ++k) {
+    if (ea[k].hash != eb[k].hash)
+      return false;
+    if (!is_array &&
+        entry_key(a, ea[k].kv_ofs) != entry_key(b, eb[k].kv_ofs))
+      return false;
+    if (!equal_values(a, value_offset(a, ea[k].kv_ofs, is_array), b,
+                      value_offset(b, eb[k].kv_ofs, is_array)))
+      return false;
+  }
+  return true;
+}
+
+// JSON equality: numbers compare by value whether stored as Int64 or
+// Float64.
+bool equal_values(const uint8_t *a, size_t va, const uint8_t *b, size_t vb) {
+  Type ta = static_cast<Type>(a[va]), tb = static_cast<Type>(b[vb]);
+  if (ta != tb) {
+    if (ta == Type::Float64 && tb == Type::Int64)
+      return equal_values(b, vb, a, va);
+    if (ta != Type::Int64 || tb != Type::Float64)
+      return false;
+    int64_t i;
+    double d;
+    std::memcpy(&i, a + va + 1, 8);
+    std::memcpy(&d, b + vb + 1, 8);
+    return d >= -0x1p63 && d < 0x1p63 && static_cast<int64_t>(d) == i &&
+           static_cast<double>(static_cast<int64_t>(d)) == d;
+  }
+  if (is_container(ta))
+    return equal_containers(a, va + 1, b, vb + 1);
+  if (ta == Type::Float64) {
+    double x, y;
+    std::memcpy(&x, a + va + 1, 8);
+    std::memcpy(&y, b + vb + 1, 8);
+    return x == y;
+  }
+  size_t n = scalar_size(a, va);
+  return n == scalar_size(b, vb) &&
+         std::memcmp(a + va + 1, b + vb + 1, n) == 0;
+}
+
+uint32_t parse_index(std::string_view token) {
+  if (token.empty() || token.size() > 10)
+    throw exception("Invalid patch path");
+  uint64_t v = 0;
+  for (char c : token) {
+    if (c < '0' || c > '9')
+      throw exception("Invalid patch path");
+    v = v * 10 + static_cast<uint64_t>(c - '0');
+  }
+  if (v > UINT32_MAX)
+    throw exception("Invalid patch path");
+  return static_cast<uint32_t>(v);
+}
+
+} // namespace
+
+Patch diff(const Buffer &from, const Buffer &to) {
+  Patch patch;
+  patch.values.init_array();
+  if (to.size() == 0) {
+    if (from.size() != 0)
+      patch.ops.push_back({PatchOp::Kind::Remove, ""});
+    return patch;
+  }
+
+  Differ differ(from, to);
+  std::string path;
+  Type root = node_at(to.data(), 0).type();
+  if (from.size() == 0 || node_at(from.data(), 0).type() != root ||
+      !differ.container(0, 0, path)) {
+    size_t o = root == Type::Array ? patch.values.arr_append_arr(0)
+                                   : patch.values.arr_append_obj(0);
+    patch.values.copy_entries(o, to.data(), 0);
+    patch.ops.push_back({PatchOp::Kind::Set, "", 0});
+    return patch;
+  }
+
+  for (size_t vb : differ.sources)
+    patch.values.copy_value(0, {}, UINT32_MAX, to.data(), vb);
+  patch.ops = std::move(differ.ops);
+  return patch;
+}
+
+void apply_merge_patch(Buffer &target, const Patch &patch) {
+  const uint8_t *values = patch.values.data();
+  for (const PatchOp &op : patch.ops) {
+    size_t vo = 0;
+    if (op.kind == PatchOp::Kind::Set) {
+      Type t;
+      auto *p = patch.values.arr_get_impl(0, op.value, t);
+      if (!p)
+        throw exception("Patch value missing");
+      vo = static_cast<size_t>(reinterpret_cast<const uint8_t *>(p) - values) -
+           1;
+    }
+
+    if (op.path.empty()) {
+      if (op.kind == PatchOp::Kind::Set)
+        target.assign_root(values, vo);
+      else
+        target = Buffer();
+      continue;
+    }
+    if (op.path[0] != '/' || target.size() == 0)
+      throw exception("Invalid patch path");
+
+    // Resolve every token but the last to a container node.
+    size_t ofs = 0;
+    size_t pos = 1;
+    while (true) {
+      size_t end = op.path.find('/', pos);
+      std::string token = unescape(std::string_view(op.path).substr(
+          pos, end == std::string::npos ? std::string::npos : end - pos));
+      bool is_array = node_at(target.data(), ofs).type() == Type::Array;
+
+      if (end == std::string::npos) {
+        if (op.kind == PatchOp::Kind::Remove) {
+          if (is_array)
+            throw exception("Cannot remove an array element");
+          target.remove(ofs, token);
+        } else if (is_array) {
+          uint32_t index = parse_index(token);
+          if (index > node_at(target.data(), ofs).size())
+            throw exception("Invalid patch path");
+          target.copy_value(ofs, {}, index, values, vo);
+        } else {
+          target.copy_value(ofs, token, 0, values, vo);
+        }
+        break;
+      }
+
+      Type t;
+      const std::byte *p =
+          is_array ? target.arr_get_impl(ofs, parse_index(token), t)
+                   : target.get_impl(ofs, token, utils::djb2_hash(token), t);
+      if (!p || !is_container(t))
+        throw exception("Invalid patch path");
+      ofs = static_cast<size_t>(reinterpret_cast<const uint8_t *>(p) -
+                                target.data());
+      pos = end + 1;
+    }
+  }
+}
+
+std::optional<size_t> resolve_pointer(const Buffer &buffer,
+                                      std::string_view pointer) {
+  if (!pointer.empty() && pointer[0] != '/')
+    throw exception("Invalid JSON Pointer: " + std::string(pointer));
+  if (buffer.size() == 0)
+    return std::nullopt;
+  const uint8_t *base = buffer.data();
+  std::string scratch;
+  size_t vo = 0;
+  size_t node = 0;
+  size_t pos = 0;
+  while (pos < pointer.size()) {
+    size_t end = pointer.find('/', pos + 1);
+    std::string_view token = pointer.substr(
+        pos + 1, end == std::string_view::npos ? end : end - pos - 1);
+    if (vo != 0 && !is_container(static_cast<Type>(base[vo])))
+      return std::nullopt;
+    Type t;
+    const std::byte *p;
+    if (node_at(base, node).type() == Type::Array) {
+      uint32_t index;
+      if (!index_token(token, index))
+        return std::nullopt;
+      p = buffer.arr_get_impl(node, index, t);
+    } else {
+      std::string_view key = key_token(token, scratch);
+      p = buffer.get_impl(node, key, utils::djb2_hash(key), t);
+    }
+    if (!p)
+      return std::nullopt;
+    vo = static_cast<size_t>(reinterpret_cast<const uint8_t *>(p) - base) - 1;
+    node = vo + 1;
+    pos = end == std::string_view::npos ? pointer.size() : end;
+  }
+  return vo;
+}
+
+void apply_json_patch(Buffer &target, std::string_view patch,
+                      const lite3_json::ImportPolicy &policy) {
+  apply_json_patch(target, lite3_json::parse_json(patch, policy));
+}
+
+void apply_json_patch(Buffer &target, const Buffer &patch) {
+  if (patch.size() == 0 || node_at(patch.data(), 0).type() != Type::Array)
+    throw exception("JSON Patch must be an array of operations");
+  uint32_t count = node_at(patch.data(), 0).size();
+  std::string scratch;
+  Buffer staged;
+
+  for (uint32_t n = 0; n < count; ++n) {
+    auto fail = [n](const std::string &what) {
+      throw exception("JSON Patch operation " + std::to_string(n) + ": " +
+                      what);
+    };
+    Type t;
+    const std::byte *p = patch.arr_get_impl(0, n, t);
+    if (!p || t != Type::Object)
+      fail("not an object");
+    size_t op_ofs = static_cast<size_t>(
+        reinterpret_cast<const uint8_t *>(p) - patch.data());
+    std::optional<std::string_view> op = text_member(patch, op_ofs, "op");
+    std::optional<std::string_view> path = text_member(patch, op_ofs, "path");
+    if (!op || !path)
+      fail("missing \"op\" or \"path\"");
+    if (!path->empty() && (*path)[0] != '/')
+      fail("invalid path " + std::string(*path));
+
+    // The new value: from the patch, or for copy and move a copy of the
+    // `from` value staged outside the target, which the edit may move.
+    const uint8_t *src = patch.data();
+    size_t src_vo = 0;
+    if (*op == "add" || *op == "replace" || *op == "test") {
+      const std::byte *v =
+          patch.get_impl(op_ofs, "value", utils::djb2_hash("value"), t);
+      if (!v)
+        fail("missing \"value\"");
+      src_vo = static_cast<size_t>(reinterpret_cast<const uint8_t *>(v) -
+                                   patch.data()) -
+               1;
+    } else if (*op == "copy" || *op == "move") {
+      std::optional<std::string_view> from = text_member(patch, op_ofs, "from");
+      if (!from)
+        fail("missing \"from\"");
+      if (*op == "move" && path->size() > from->size() &&
+          path->substr(0, from->size()) == *from &&
+          (*path)[from->size()] == '/')
+        fail("cannot move " + std::string(*from) + " into itself");
+      std::optional<size_t> from_vo = resolve_pointer(target, *from);
+      if (!from_vo)
+        fail("no value at " + std::string(*from));
+      if (*op == "move" && *from == *path)
+        continue;
+      staged.clear();
+      staged.init_array();
+      if (*from_vo == 0)
+        staged.copy_subtree(0, {}, target, 0);
+      else
+        staged.copy_value(0, {}, 0, target.data(), *from_vo);
+      src = staged.data();
+      src_vo = static_cast<size_t>(reinterpret_cast<const uint8_t *>(
+                                       staged.arr_get_impl(0, 0, t)) -
+                                   src) -
+               1;
+      if (*op == "move") {
+        size_t slash = from->rfind('/');
+        std::optional<size_t> parent =
+            resolve_pointer(target, from->substr(0, slash));
+        size_t node = *parent == 0 ? 0 : *parent + 1;
+        std::string_view token = from->substr(slash + 1);
+        uint32_t index = 0;
+        if (node_at(target.data(), node).type() == Type::Array &&
+            index_token(token, index))
+          target.arr_remove(node, index);
+        else
+          target.remove(node, key_token(token, scratch));
+      }
+    } else if (*op != "remove") {
+      fail("unknown op " + std::string(*op));
+    }
+
+    if (*op == "test") {
+      std::optional<size_t> vo = resolve_pointer(target, *path);
+      bool equal =
+          vo && (*vo == 0 ? is_container(static_cast<Type>(src[src_vo])) &&
+                                equal_containers(target.data(), 0, src,
+                                                 src_vo + 1)
+                          : equal_values(target.data(), *vo, src, src_vo));
+      if (!equal)
+        fail("test failed at " + std::string(*path));
+      continue;
+    }
+
+    if (path->empty()) {
+      if (*op == "remove")
+        target = Buffer();
+      else
+        target.assign_root(src, src_vo);
+      continue;
+    }
+
+    // Every other op edits the last token of the path in its container.
+    size_t slash = path->rfind('/');
+    std::optional<size_t> parent =
+        resolve_pointer(target, path->substr(0, slash));
+    if (!parent || (*parent != 0 &&
+                    !is_container(static_cast<Type>(target.data()[*parent]))))
+      fail("no container at " + std::string(path->substr(0, slash)));
+    size_t node = *parent == 0 ? 0 : *parent + 1;
+    std::string_view token = path->substr(slash + 1);
+
+    if (node_at(target.data(), node).type() == Type::Array) {
+      uint32_t size = node_at(target.data(), node).size();
+      uint32_t index = size;
+      bool add = *op != "remove" && *op != "replace";
+      if (!(add && token == "-") &&
+          (!index_token(token, index) || index > size ||
+           (index == size && !add)))
+        fail("index out of range at " + std::string(*path));
+      if (*op == "remove")
+        target.arr_remove(node, index);
+      else if (*op == "replace")
+        target.copy_value(node, {}, index, src, src_vo);
+      else
+        target.arr_insert_value(node, index, src, src_vo);
+    } else {
+      std::string_view key = key_token(token, scratch);
+      if (*op == "remove") {
+        if (!target.remove(node, key))
+          fail("no value at " + std::string(*path));
+        continue;
+      }
+      if (*op == "replace" &&
+          !target.get_impl(node, key, utils::djb2_hash(key), t))
+        fail("no value at " + std::string(*path));
+      target.copy_value(node, key, 0, src, src_vo);
+    }
+  }
+}
+
+} // namespace lite3cpp
@@ -0,0 +1,387 @@
+#include "query.hpp"
+#include "builder.hpp"
+#include "exception.hpp"
+#include "node.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace lite3cpp {
+
+namespace {
+
+constexpr int kUnordered = 2;
+
+template <typename T> int order(T a, T b) { return a < b ? -1 : b < a ? 1 : 0; }
+
+// Orders an Int64 against a Float64 without rounding the integer.
+int order_mixed(int64_t a, double b) {
+  if (std::isnan(b))
+    return kUnordered;
+  if (b >= 0x1p63)
+    return -1;
+  if (b < -0x1p63)
+    return 1;
+  int64_t whole = static_cast<int64_t>(b);
+  if (a != whole)
+    return a < whole ? -1 : 1;
+  double fraction = b - static_cast<double>(whole);
+  return fraction > 0 ? -1 : fraction < 0 ? 1 : 0;
+}
+
+std::string_view string_at(const uint8_t *base, size_t vo) {
+  uint32_t len;
+  std::memcpy(&len, base + vo + 1, 4);
+  return {reinterpret_cast<const char *>(base + vo + 5), len};
+}
+
+// Appends the value whose type byte is at `vo` to the builder.
+void emit(Builder &builder, const uint8_t *base, size_t vo) {
+  const uint8_t *p = base + vo + 1;
+  switch (static_cast<Type>(base[vo])) {
+  case Type::Bool:
+    builder.add_bool(*p != 0);
+    break;
+  case Type::Int64: {
+    int64_t v;
+    std::memcpy(&v, p, 8);
+    builder.add_i64(v);
+    break;
+  }
+  case Type::Float64: {
+    double v;
+    std::memcpy(&v, p, 8);
+    builder.add_f64(v);
+    break;
+  }
+  case Type::String:
+    builder.add_str(string_at(base, vo));
+    break;
+  case Type::Bytes: {
+    uint32_t len;
+    std::memcpy(&len, p, 4);
+    builder.add_bytes({reinterpret_cast<const std::byte *>(p + 4), len});
+    break;
+  }
+  case Type::Object:
+    builder.begin_object();
+    utils::walk_entries(base, vo + 1, [&](size_t kv) {
+      builder.key({reinterpret_cast<const char *>(base + kv + 1),
+                   static_cast<size_t>((base[kv] >> 2) - 1)});
+      emit(builder, base, utils::value_offset(base, kv));
+    });
+    builder.end();
+    break;
+  case Type::Array:
+    builder.begin_array();
+    utils::walk_entries(base, vo + 1,
+                        [&](size_t kv) { emit(builder, base, kv); });
+    builder.end();
+    break;
+  default:
+    builder.add_null();
+    break;
+  }
+}
+
+} // namespace
+
+Filter Filter::eq(std::string_view path, Literal value) {
+  return Filter(std::make_shared<const Node>(
+      Node{Op::Eq, std::string(path), {std::move(value)}, {}, {}}));
+}
+
+Filter Filter::ne(std::string_view path, Literal value) {
+  return Filter(std::make_shared<const Node>(
+      Node{Op::Ne, std::string(path), {std::move(value)}, {}, {}}));
+}
+
+Filter Filter::lt(std::string_view path, Literal value) {
+  return Filter(std::make_shared<const Node>(
+      Node{Op::Lt, std::string(path), {std::move(value)}, {}, {}}));
+}
+
+Filter Filter::le(std::string_view path, Literal value) {
+  return Filter(std::make_shared<const Node>(
+      Node{Op::Le, std::string(path), {std::move(value)}, {}, {}}));
+}
+
+Filter Filter::gt(std::string_view path, Literal value) {
+  return Filter(std::make_shared<const Node>(
+      Node{Op::Gt, std::string(path), {std::move(value)}, {}, {}}));
+}
+
+Filter Filter::ge(std::string_view path, Literal value) {
+  return Filter(std::make_shared<const Node>(
+      Node{Op::Ge, std::string(path), {std::move(value)}, {}, {}}));
+}
+
+Filter Filter::in(std::string_view path, std::vector<Literal> values) {
+  return Filter(std::make_shared<const Node>(
+      Node{Op::In, std::string(path), std::move(values), {}, {}}));
+}
+
+Filter Filter::starts_with(std::string_view path, std::string_view prefix) {
+  return Filter(std::make_shared<const Node>(
+      Node{Op::Prefix, std::string(path), {Literal(prefix)}, {}, {}}));
+}
+
+Filter operator&&(Filter lhs, Filter rhs) {
+  return Filter(std::make_shared<const Filter::Node>(
+      Filter::Node{Filter::Op::And, {}, {}, lhs.m_node, rhs.m_node}));
+}
+
+Filter operator||(Filter lhs, Filter rhs) {
+  return Filter(std::make_shared<const Filter::Node>(
+      Filter::Node{Filter::Op::Or, {}, {}, lhs.m_node, rhs.m_node}));
+}
+
+Filter operator!(Filter filter) {
+  return Filter(std::make_shared<const Filter::Node>(
+      Filter::Node{Filter::Op::Not, {}, {}, filter.m_node, {}}));
+}
+
+Query::Query(const Filter &where, std::vector<std::string> select) {
+  compile(*where.m_node);
+  m_where.prepare();
+  for (const std::string &path : select) {
+    std::vector<std::string> keys =
+        utils::split_pointer(path, "Selected path");
+    std::string name = keys.back();
+    auto same = std::find(m_names.begin(), m_names.end(), name);
+    if (same != m_names.end())
+      throw exception("Selected paths " +
+                      select[static_cast<size_t>(same - m_names.begin())] +
+                      " and " + path + " share the name " + name);
+    m_select.add(std::move(keys));
+    m_name_hashes.push_back(utils::djb2_hash(name));
+    m_names.push_back(std::move(name));
+  }
+  m_select.prepare();
+}
+
+void Query::compile(const Filter::Node &node) {
+  size_t at = m_steps.size();
+  m_steps.emplace_back().op = node.op;
+  switch (node.op) {
+  case Filter::Op::And:
+  case Filter::Op::Or:
+    compile(*node.lhs);
+    compile(*node.rhs);
+    break;
+  case Filter::Op::Not:
+    compile(*node.lhs);
+    break;
+  case Filter::Op::In: {
+    Step &step = m_steps[at];
+    for (const Literal &v : node.values) {
+      switch (v.m_type) {
+      case Type::Null:
+        step.null = true;
+        break;
+      case Type::Bool:
+        (v.m_bool ? step.yes : step.no) = true;
+        break;
+      case Type::Int64:
+        step.ints.push_back(v.m_i64);
+        break;
+      case Type::Float64:
+        if (!std::isnan(v.m_f64)) // Equal to nothing
+          step.reals.push_back(v.m_f64);
+        break;
+      default:
+        step.strings.push_back(v.m_str);
+        break;
+      }
+    }
+    std::sort(step.ints.begin(), step.ints.end());
+    std::sort(step.reals.begin(), step.reals.end());
+    std::sort(step.strings.begin(), step.strings.end());
+    step.path = static_cast<uint32_t>(
+        m_where.add(utils::split_pointer(node.path, "Filter path")));
+    break;
+  }
+  default:
+    m_steps[at].value = node.values[0];
+    m_steps[at].path = static_cast<uint32_t>(
+        m_where.add(utils::split_pointer(node.path, "Filter path")));
+    break;
+  }
+  m_steps[at].end = static_cast<uint32_t>(m_steps.size());
+}
+
+int Query::compare(const uint8_t *base, size_t vo, const Literal &literal) {
+  Type t = vo ? static_cast<Type>(base[vo]) : Type::Null;
+  const uint8_t *p = base + vo + 1;
+  switch (t) {
+  case Type::Null:
+    return literal.m_type == Type::Null ? 0 : kUnordered;
+  case Type::Bool:
+    return literal.m_type == Type::Bool
+               ? order<int>(*p != 0, literal.m_bool)
+               : kUnordered;
+  case Type::Int64: {
+    int64_t v;
+    std::memcpy(&v, p, 8);
+    if (literal.m_type == Type::Int64)
+      return order(v, literal.m_i64);
+    return literal.m_type == Type::Float64 ? order_mixed(v, literal.m_f64)
+                                           : kUnordered;
+  }
+  case Type::Float64: {
+    double d;
+    std::memcpy(&d, p, 8);
+    if (literal.m_type == Type::Float64)
+      return std::isnan(d) || std::isnan(literal.m_f64)
+                 ? kUnordered
+                 : order(d, literal.m_f64);
+    if (literal.m_type != Type::Int64)
+      return kUnordered;
+    int c = order_mixed(literal.m_i64, d);
+    return c == kUnordered ? c : -c;
+  }
+  case Type::String: {
+    if (literal.m_type != Type::String)
+      return kUnordered;
+    int c = string_at(base, vo).compare(literal.m_str);
+    return c < 0 ? -1 : c > 0 ? 1 : 0;
+  }
+  default:
+    return kUnordered;
+  }
+}
+
+bool Query::in(const Step &step, const uint8_t *base, size_t vo) const {
+  Type t = vo ? static_cast<Type>(base[vo]) : Type::Null;
+  const uint8_t *p = base + vo + 1;
+  switch (t) {
+  case Type::Null:
+    return step.null;
+  case Type::Bool:
+    return *p ? step.yes : step.no;
+  case Type::Int64: {
+    int64_t v;
+    std::memcpy(&v, p, 8);
+    if (std::binary_search(step.ints.begin(), step.ints.end(), v))
+      return true;
+    auto it = std::lower_bound(step.reals.begin(), step.reals.end(),
+                               static_cast<double>(v));
+    return it != step.reals.end() && order_mixed(v, *it) == 0;
+  }
+  case Type::Float64: {
+    double d;
+    std::memcpy(&d, p, 8);
+    if (std::binary_search(step.reals.begin(), step.reals.end(), d))
+      return true;
+    return d >= -0x1p63 && d < 0x1p63 && d == std::trunc(d) &&
+           std::binary_search(step.ints.begin(), step.ints.end(),
+                              static_cast<int64_t>(d));
+  }
+  case Type::String:
+    return std::binary_search(step.strings.begin(), step.strings.end(),
+                              string_at(base, vo));
+  default:
+    return false;
+  }
+}
+
+bool Query::eval(const uint8_t *base, const size_t *found, uint32_t i) const {
+  const Step &step = m_steps[i];
+  switch (step.op) {
+  case Filter::Op::And:
+    return eval(base, found, i + 1) &&
+           eval(base, found, m_steps[i + 1].end);
+  case Filter::Op::Or:
+    return eval(base, found, i + 1) ||
+           eval(base, found, m_steps[i + 1].end);
+  case Filter::Op::Not:
+    return !eval(base, found, i + 1);
+  case Filter::Op::In:
+    return in(step, base, found[step.path]);
+  case Filter::Op::Prefix: {
+    size_t vo = found[step.path];
+    if (!vo || static_cast<Type>(base[vo]) != Type::String)
+      return false;
+    return string_at(base, vo).starts_with(step.value.m_str);
+  }
+  default:
+    break;
+  }
+  int c = compare(base, found[step.path], step.value);
+  switch (step.op) {
+  case Filter::Op::Eq:
+    return c == 0;
+  case Filter::Op::Ne:
+    return c != 0;
+  case Filter::Op::Lt:
+    return c == -1;
+  case Filter::Op::Le:
+    return c == -1 || c == 0;
+  case Filter::Op::Gt:
+    return c == 1;
+  default:
+    return c == 1 || c == 0;
+  }
+}
+
+// Calls fn(index, vo) for each matching element of the array.
+template <typename F>
+void Query::scan(const Buffer &buffer, size_t array_ofs, F &&fn) const {
+  const uint8_t *base = buffer.data();
+  if (buffer.size() == 0 ||
+      NodeView(reinterpret_cast<const PackedNodeLayout *>(base + array_ofs))
+              .type() != Type::Array)
+    throw exception("Query: not an array");
+  std::vector<size_t> found(m_where.width());
+  uint32_t index = 0;
+  utils::walk_entries(base, array_ofs, [&](size_t vo) {
+    m_where.resolve(base, vo, found.data());
+    if (eval(base, found.data(), 0))
+      fn(index, vo);
+    ++index;
+  });
+}
+
+std::vector<uint32_t> Query::matches(const Buffer &buffer,
+                                     size_t array_ofs) const {
+  std::vector<uint32_t> out;
+  scan(buffer, array_ofs, [&](uint32_t index, size_t) { out.push_back(index); });
+  return out;
+}
+
+void Query::project(const Buffer &buffer, size_t array_ofs, Buffer &out) const {
+  thread_local Builder builder;
+  const uint8_t *base = buffer.data();
+  try {
+    builder.reset(out);
+    builder.begin_array();
+    std::vector<size_t> selected(m_select.width());
+    scan(buffer, array_ofs, [&](uint32_t, size_t vo) {
+      if (m_names.empty()) {
+        emit(builder, base, vo);
+        return;
+      }
+      m_select.resolve(base, vo, selected.data());
+      builder.begin_object();
+      for (size_t i = 0; i < m_names.size(); ++i) {
+        if (!selected[i])
+          continue;
+        builder.key(m_names[i], m_name_hashes[i]);
+        emit(builder, base, selected[i]);
+      }
+      builder.end();
+    });
+    builder.end();
+  } catch (...) {
+    out.clear();
+    throw;
+  }
+}
+
+Buffer Query::project(const Buffer &buffer, size_t array_ofs) const {
+  Buffer out;
+  project(buffer, array_ofs, out);
+  return out;
+}
+
+} // namespace lite3cpp
@@ -0,0 +1,121 @@
+#include "store.hpp"
+#include "exception.hpp"
+
+namespace lite3cpp {
+
+Store::Store(size_t shard_count, int replicas)
+    : m_shard_count(shard_count), m_ring(replicas),
+      m_shards(new Shard[shard_count]) {
+  if (shard_count == 0)
+    throw exception("Store requires at least one shard");
+  for (size_t s = 0; s < shard_count; ++s)
+    m_ring.add_node(static_cast<lite3::NodeID>(s));
+}
+
+size_t Store::shard_of(std::string_view key) const {
+  return m_ring.get_node(key);
+}
+
+Buffer Store::acquire(std::string_view key) {
+  return m_shards[shard_of(key)].pool.acquire();
+}
+
+void Store::put(std::string_view key, Buffer doc) {
+  Shard &shard = m_shards[shard_of(key)];
+  Buffer replaced;
+  bool had_previous = false;
+  {
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.puts.fetch_add(1, std::memory_order_relaxed);
+    auto it = shard.docs.find(key);
+    if (it != shard.docs.end()) {
+      replaced = std::move(it->second);
+      it->second = std::move(doc);
+      had_previous = true;
+    } else {
+      shard.docs.emplace(std::string(key), std::move(doc));
+    }
+  }
+  if (had_previous)
+    shard.pool.release(std::move(replaced));
+}
+
+bool Store::erase(std::string_view key) {
+  Shard &shard = m_shards[shard_of(key)];
+  Buffer removed;
+  {
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.docs.find(key);
+    if (it == shard.docs.end())
+      return false;
+    shard.erases.fetch_add(1, std::memory_order_relaxed);
+    removed = std::move(it->second);
+    shard.docs.erase(it);
+  }
+  shard.pool.release(std::move(removed));
+  return true;
+}
+
+bool Store::contains(std::string_view key) const {
+  const Shard &shard = m_shards[shard_of(key)];
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  return shard.docs.find(key) != shard.docs.end();
+}
+
+void Store::put_batch(std::vector<std::pair<std::string, Buffer>> docs) {
+  std::vector<std::string_view> keys;
+  keys.reserve(docs.size());
+  for (const auto &doc : docs)
+    keys.push_back(doc.first);
+
+  for_each_shard_group(keys, [&](size_t s, const std::vector<size_t> &idx) {
+    Shard &shard = m_shards[s];
+    std::vector<Buffer> replaced;
+    {
+      std::unique_lock<std::shared_mutex> lock(shard.mutex);
+      shard.puts.fetch_add(idx.size(), std::memory_order_relaxed);
+      for (size_t i : idx) {
+        auto it = shard.docs.find(keys[i]);
+        if (it != shard.docs.end()) {
+          replaced.push_back(std::move(it->second));
+          it->second = std::move(docs[i].second);
+        } else {
+          shard.docs.emplace(std::move(docs[i].first),
+                             std::move(docs[i].second));
+        }
+      }
+    }
+    for (auto &buf : replaced)
+      shard.pool.release(std::move(buf));
+  });
+}
+
+ShardMetrics Store::shard_metrics(size_t shard_index) const {
+  if (shard_index >= m_shard_count)
+    throw exception("Shard index out of range");
+  const Shard &shard = m_shards[shard_index];
+  ShardMetrics m;
+  {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    m.documents = shard.docs.size();
+    for (const auto &doc : shard.docs)
+      m.bytes += doc.second.size();
+  }
+  m.pooled_buffers = shard.pool.pooled();
+  m.gets = shard.gets.load(std::memory_order_relaxed);
+  m.misses = shard.misses.load(std::memory_order_relaxed);
+  m.puts = shard.puts.load(std::memory_order_relaxed);
+  m.updates = shard.updates.load(std::memory_order_relaxed);
+  m.erases = shard.erases.load(std::memory_order_relaxed);
+  return m;
+}
+
+std::vector<ShardMetrics> Store::metrics() const {
+  std::vector<ShardMetrics> all;
+  all.reserve(m_shard_count);
+  for (size_t s = 0; s < m_shard_count; ++s)
+    all.push_back(shard_metrics(s));
+  return all;
+}
+
+} // namespace lite3cpp
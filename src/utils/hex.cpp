@@ -1,31 +1,187 @@
 #include "hex.hpp"
-#include <sstream>
-#include <iomanip>
+#include <array>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define LITE3CPP_HEX_SSE2 1
+#endif
 
 namespace lite3cpp::utils {
 
-// Helper to convert a hex character to its integer value
-static unsigned char hex_char_to_int(char c) {
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    throw std::runtime_error("Invalid hex character");
-}
+namespace {
+
+    // Digit value of every byte, 0xFF for bytes outside the alphabet.
+    constexpr std::array<unsigned char, 256> make_hex_table() {
+        std::array<unsigned char, 256> t{};
+        for (auto& v : t) v = 0xFF;
+        for (int c = 0; c < 10; ++c) t['0' + c] = static_cast<unsigned char>(c);
+        for (int c = 0; c < 6; ++c) {
+            t['a' + c] = static_cast<unsigned char>(10 + c);
+            t['A' + c] = static_cast<unsigned char>(10 + c);
+        }
+        return t;
+    }
+    constexpr std::array<unsigned char, 256> hex_table = make_hex_table();
+
+    constexpr std::array<unsigned char, 256> make_base64_table() {
+        constexpr char alphabet[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::array<unsigned char, 256> t{};
+        for (auto& v : t) v = 0xFF;
+        for (int i = 0; i < 64; ++i)
+            t[static_cast<unsigned char>(alphabet[i])] = static_cast<unsigned char>(i);
+        return t;
+    }
+    constexpr std::array<unsigned char, 256> base64_table = make_base64_table();
+
+    constexpr char hex_digits[] = "0123456789abcdef";
+
+    // Both base64 characters of every 12-bit group, first one in the low byte.
+    constexpr std::array<uint16_t, 4096> make_base64_pairs() {
+        constexpr char alphabet[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::array<uint16_t, 4096> t{};
+        for (int i = 0; i < 4096; ++i)
+            t[i] = static_cast<uint16_t>(static_cast<unsigned char>(alphabet[i >> 6]) |
+                                         (static_cast<unsigned char>(alphabet[i & 63]) << 8));
+        return t;
+    }
+    constexpr std::array<uint16_t, 4096> base64_pairs = make_base64_pairs();
+
+} // namespace
 
 std::vector<std::byte> hex_decode(std::string_view hex_string) {
     if (hex_string.length() % 2 != 0) {
         throw std::runtime_error("Hex string length must be even.");
     }
+    std::vector<std::byte> bytes(hex_string.length() / 2);
+    if (!hex_decode(hex_string, bytes.data())) {
+        throw std::runtime_error("Invalid hex character");
+    }
+    return bytes;
+}
+
+bool hex_decode(std::string_view hex, std::byte* out) noexcept {
+    if (hex.size() % 2 != 0) return false;
+    const char* p = hex.data();
+    size_t n = hex.size();
+    size_t i = 0;
+#ifdef LITE3CPP_HEX_SSE2
+    // Bytes >= 0x80 are negative as signed chars, so they fail both ranges.
+    const __m128i digit_lo = _mm_set1_epi8('0' - 1);
+    const __m128i digit_hi = _mm_set1_epi8('9' + 1);
+    const __m128i alpha_lo = _mm_set1_epi8('a' - 1);
+    const __m128i alpha_hi = _mm_set1_epi8('f' + 1);
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i low_byte = _mm_set1_epi16(0x00FF);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i l = _mm_or_si128(v, lower);
+        __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(v, digit_lo), _mm_cmplt_epi8(v, digit_hi));
+        __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(l, alpha_lo), _mm_cmplt_epi8(l, alpha_hi));
+        if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) != 0xFFFF) return false;
+        __m128i nibbles = _mm_or_si128(
+            _mm_and_si128(is_digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+            _mm_and_si128(is_alpha, _mm_sub_epi8(l, _mm_set1_epi8('a' - 10))));
+        // Each 16-bit lane holds (high digit, low digit); fold it into one byte.
+        __m128i pairs = _mm_and_si128(
+            _mm_or_si128(_mm_slli_epi16(nibbles, 4), _mm_srli_epi16(nibbles, 8)), low_byte);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i / 2),
+                         _mm_packus_epi16(pairs, _mm_setzero_si128()));
+    }
+#endif
+    unsigned char bad = 0;
+    for (; i < n; i += 2) {
+        unsigned char hi = hex_table[static_cast<unsigned char>(p[i])];
+        unsigned char lo = hex_table[static_cast<unsigned char>(p[i + 1])];
+        bad |= hi | lo;
+        out[i / 2] = static_cast<std::byte>((hi << 4) | (lo & 0x0F));
+    }
+    return (bad & 0x80) == 0;
+}
 
-    std::vector<std::byte> bytes;
-    bytes.reserve(hex_string.length() / 2);
+size_t base64_decode(std::string_view b64, std::byte* out) noexcept {
+    size_t n = b64.size();
+    if (n != 0 && b64[n - 1] == '=') {
+        if (n % 4 != 0) return SIZE_MAX;
+        --n;
+        if (b64[n - 1] == '=') --n;
+    }
+    if (n % 4 == 1) return SIZE_MAX;
 
-    for (size_t i = 0; i < hex_string.length(); i += 2) {
-        unsigned char high_nibble = hex_char_to_int(hex_string[i]);
-        unsigned char low_nibble = hex_char_to_int(hex_string[i+1]);
-        bytes.push_back(static_cast<std::byte>((high_nibble << 4) | low_nibble));
+    const auto* p = reinterpret_cast<const unsigned char*>(b64.data());
+    std::byte* d = out;
+    unsigned char bad = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        unsigned char a = base64_table[p[i]], b = base64_table[p[i + 1]];
+        unsigned char c = base64_table[p[i + 2]], e = base64_table[p[i + 3]];
+        bad |= a | b | c | e;
+        uint32_t v = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6) | e;
+        d[0] = static_cast<std::byte>(v >> 16);
+        d[1] = static_cast<std::byte>(v >> 8);
+        d[2] = static_cast<std::byte>(v);
+        d += 3;
+    }
+    if (n - i >= 2) {
+        unsigned char a = base64_table[p[i]], b = base64_table[p[i + 1]];
+        unsigned char c = n - i == 3 ? base64_table[p[i + 2]] : 0;
+        bad |= a | b | c;
+        uint32_t v = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6);
+        *d++ = static_cast<std::byte>(v >> 16);
+        if (n - i == 3) *d++ = static_cast<std::byte>(v >> 8);
+    }
+    if (bad & 0x80) return SIZE_MAX;
+    return static_cast<size_t>(d - out);
+}
+
+void hex_encode(const std::byte* in, size_t n, char* out) noexcept {
+    const auto* p = reinterpret_cast<const unsigned char*>(in);
+    size_t i = 0;
+#ifdef LITE3CPP_HEX_SSE2
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i letter_gap = _mm_set1_epi8('a' - '0' - 10);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+        __m128i lo = _mm_and_si128(v, nibble);
+        hi = _mm_add_epi8(_mm_add_epi8(hi, zero_char),
+                          _mm_and_si128(_mm_cmpgt_epi8(hi, nine), letter_gap));
+        lo = _mm_add_epi8(_mm_add_epi8(lo, zero_char),
+                          _mm_and_si128(_mm_cmpgt_epi8(lo, nine), letter_gap));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[2 * i] = hex_digits[p[i] >> 4];
+        out[2 * i + 1] = hex_digits[p[i] & 15];
+    }
+}
+
+void base64_encode(const std::byte* in, size_t n, char* out) noexcept {
+    const auto* p = reinterpret_cast<const unsigned char*>(in);
+    size_t i = 0;
+    for (; i + 3 <= n; i += 3) {
+        uint32_t v = (uint32_t(p[i]) << 16) | (uint32_t(p[i + 1]) << 8) | p[i + 2];
+        uint16_t a = base64_pairs[v >> 12], b = base64_pairs[v & 0xFFF];
+        out[0] = static_cast<char>(a & 0xFF);
+        out[1] = static_cast<char>(a >> 8);
+        out[2] = static_cast<char>(b & 0xFF);
+        out[3] = static_cast<char>(b >> 8);
+        out += 4;
+    }
+    if (i < n) {
+        uint32_t v = uint32_t(p[i]) << 16;
+        if (i + 1 < n) v |= uint32_t(p[i + 1]) << 8;
+        uint16_t a = base64_pairs[v >> 12], b = base64_pairs[v & 0xFFF];
+        out[0] = static_cast<char>(a & 0xFF);
+        out[1] = static_cast<char>(a >> 8);
+        out[2] = i + 1 < n ? static_cast<char>(b & 0xFF) : '=';
+        out[3] = '=';
     }
-    return bytes;
 }
 
-} // namespace lite3cpp::utils
\ No newline at end of file
+} // namespace lite3cpp::utils
@@ -0,0 +1,36 @@
+#include "utils/json_scan.hpp"
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define LITE3CPP_JSON_SSE2 1
+#endif
+
+namespace lite3cpp::utils {
+
+    size_t json_plain_prefix(const char* p, size_t n) {
+        size_t i = 0;
+#ifdef LITE3CPP_JSON_SSE2
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1f);
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            // v <= 0x1f (unsigned) exactly when min(v, 0x1f) == v.
+            __m128i hits = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+            if (mask)
+                return i + std::countr_zero(mask);
+        }
+#endif
+        for (; i < n; ++i) {
+            unsigned char c = static_cast<unsigned char>(p[i]);
+            if (c < 0x20 || c == '"' || c == '\\')
+                break;
+        }
+        return i;
+    }
+
+} // namespace lite3cpp::utils
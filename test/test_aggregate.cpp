@@ -0,0 +1,238 @@
+#include "aggregate.hpp"
+#include "buffer.hpp"
+#include "columns.hpp"
+#include "exception.hpp"
+#include "json.hpp"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+TEST(AggregateTest, ReducesAMember) {
+  Buffer buf = lite3_json::parse_json(R"([
+    {"n": 4, "x": 1.5, "s": "a"},
+    {"n": -2, "x": 2, "s": null},
+    {"x": -0.5},
+    {"n": 10, "x": null, "s": "b"},
+    3
+  ])");
+  AggValue count = aggregate(buf, 0, "/n", AggOp::Count);
+  EXPECT_EQ(count.type, Type::Int64);
+  EXPECT_EQ(count.i64, 3);
+
+  // All Int64: exact Int64 results.
+  AggValue sum = aggregate(buf, 0, "/n", AggOp::Sum);
+  EXPECT_EQ(sum.type, Type::Int64);
+  EXPECT_EQ(sum.i64, 12);
+  EXPECT_EQ(aggregate(buf, 0, "/n", AggOp::Min).i64, -2);
+  EXPECT_EQ(aggregate(buf, 0, "/n", AggOp::Max).i64, 10);
+  EXPECT_EQ(aggregate(buf, 0, "/n", AggOp::Avg).f64, 4.0);
+
+  // An Int64 among Float64s makes the result a Float64.
+  AggValue xsum = aggregate(buf, 0, "/x", AggOp::Sum);
+  EXPECT_EQ(xsum.type, Type::Float64);
+  EXPECT_EQ(xsum.f64, 3.0);
+  EXPECT_EQ(xsum.count, 3u);
+  EXPECT_EQ(aggregate(buf, 0, "/x", AggOp::Max).f64, 2.0);
+  EXPECT_EQ(aggregate(buf, 0, "/x", AggOp::Min).f64, -0.5);
+
+  EXPECT_EQ(aggregate(buf, 0, "/s", AggOp::Count).i64, 2);
+  EXPECT_EQ(aggregate(buf, 0, "/none", AggOp::Max).type, Type::Null);
+  EXPECT_EQ(aggregate(buf, 0, "/none", AggOp::Count).i64, 0);
+
+  try {
+    aggregate(buf, 0, "/s", AggOp::Sum);
+    FAIL();
+  } catch (const lite3cpp::exception &e) {
+    EXPECT_STREQ(e.what(), "Cannot aggregate /s: element 0 holds a string");
+  }
+  EXPECT_THROW(aggregate(buf, 0, "n", AggOp::Sum), lite3cpp::exception);
+}
+
+TEST(AggregateTest, ColumnsMatchTheBuffer) {
+  // Nulls scattered unevenly, so runs of valid rows start and end inside
+  // validity bytes, and a NaN that Min and Max pass over.
+  Buffer buf;
+  buf.init_array();
+  for (int i = 0; i < 1000; ++i) {
+    size_t rec = buf.arr_append_obj(0);
+    buf.set_str(rec, "g", i % 7 == 0 ? "seven" : i % 2 ? "odd" : "even");
+    if (i % 3 != 0 && i % 11 != 5)
+      buf.set_i64(rec, "n", (i * 37) % 101 - 50);
+    if (i % 13 != 0)
+      buf.set_f64(rec, "x", i == 500 ? NAN : (i % 17) * 0.25 - 1);
+    if (i % 5 == 0)
+      buf.set_bool(rec, "b", i % 2 == 0);
+  }
+  std::vector<ColumnSpec> fields = {{"/g"}, {"/n"}, {"/x"}, {"/b"}};
+  Columns cols = to_columns(buf, 0, fields);
+
+  for (const char *path : {"/n", "/x"}) {
+    const Column &col = *cols.find(path);
+    for (AggOp op : {AggOp::Count, AggOp::Sum, AggOp::Min, AggOp::Max,
+                     AggOp::Avg}) {
+      AggValue a = aggregate(buf, 0, path, op);
+      AggValue c = aggregate(col, op);
+      EXPECT_EQ(a.type, c.type) << path << " " << int(op);
+      EXPECT_EQ(a.count, c.count) << path << " " << int(op);
+      if (op == AggOp::Sum && std::string(path) == "/x") {
+        // The NaN carries through the sum.
+        EXPECT_TRUE(std::isnan(a.f64) && std::isnan(c.f64));
+      } else if (a.type == Type::Int64) {
+        EXPECT_EQ(a.i64, c.i64) << path << " " << int(op);
+      } else if (!std::isnan(a.f64)) {
+        EXPECT_DOUBLE_EQ(a.f64, c.f64) << path << " " << int(op);
+      }
+    }
+  }
+  EXPECT_EQ(aggregate(*cols.find("/x"), AggOp::Max).f64, 3.0);
+  EXPECT_EQ(aggregate(*cols.find("/b"), AggOp::Count).i64, 200);
+  EXPECT_THROW(aggregate(*cols.find("/g"), AggOp::Sum), lite3cpp::exception);
+  Column invalid;
+  invalid.path = "/v";
+  invalid.type = Type::Invalid;
+  try {
+    aggregate(invalid, AggOp::Sum);
+    FAIL();
+  } catch (const lite3cpp::exception &e) {
+    EXPECT_STREQ(e.what(), "Cannot aggregate /v: column holds invalid values");
+  }
+
+  std::vector<Group> direct = group_by(buf, 0, "/g", "/n", AggOp::Sum);
+  std::vector<Group> columnar = group_by(cols, "/g", "/n", AggOp::Sum);
+  ASSERT_EQ(direct.size(), 3u);
+  ASSERT_EQ(columnar.size(), 3u);
+  int64_t total = 0;
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(direct[i].key_type, Type::String);
+    EXPECT_EQ(direct[i].key_str, columnar[i].key_str);
+    EXPECT_EQ(direct[i].value.i64, columnar[i].value.i64);
+    EXPECT_EQ(direct[i].value.count, columnar[i].value.count);
+    total += direct[i].value.i64;
+  }
+  EXPECT_EQ(direct[0].key_str, "seven");
+  EXPECT_EQ(direct[1].key_str, "odd");
+  EXPECT_EQ(total, aggregate(buf, 0, "/n", AggOp::Sum).i64);
+}
+
+TEST(AggregateTest, MinAndMaxOfOnlyNaNsAreNaN) {
+  // Enough rows for the vector loop as well as the tail.
+  Buffer buf;
+  buf.init_array();
+  for (int i = 0; i < 7; ++i) {
+    size_t rec = buf.arr_append_obj(0);
+    buf.set_f64(rec, "x", NAN);
+    if (i == 3)
+      buf.set_i64(rec, "y", 2);
+    else
+      buf.set_f64(rec, "y", NAN);
+  }
+  std::vector<ColumnSpec> fields = {{"/x"}};
+  Columns cols = to_columns(buf, 0, fields);
+
+  for (AggOp op : {AggOp::Min, AggOp::Max}) {
+    for (AggValue v : {aggregate(buf, 0, "/x", op),
+                       aggregate(*cols.find("/x"), op)}) {
+      EXPECT_EQ(v.type, Type::Float64);
+      EXPECT_TRUE(std::isnan(v.f64));
+      EXPECT_EQ(v.count, 7u);
+    }
+    EXPECT_EQ(aggregate(buf, 0, "/y", op).f64, 2.0);
+  }
+}
+
+TEST(AggregateTest, FloatResultsDoNotWrapIntegers) {
+  Buffer buf = lite3_json::parse_json(
+      R"([{"n": 9223372036854775807}, {"n": 1}, {"m": 1}, {"m": 2.5},)"
+      R"( {"m": 3}, {"m": 9223372036854775807}, {"m": 1}])");
+  // An Int64 Sum still wraps, as documented.
+  EXPECT_EQ(aggregate(buf, 0, "/n", AggOp::Sum).i64, INT64_MIN);
+  EXPECT_EQ(aggregate(buf, 0, "/n", AggOp::Avg).f64, 0x1p62);
+  AggValue mixed = aggregate(buf, 0, "/m", AggOp::Sum);
+  EXPECT_EQ(mixed.type, Type::Float64);
+  EXPECT_DOUBLE_EQ(mixed.f64, 0x1p63 + 7.5);
+  EXPECT_EQ(aggregate(buf, 0, "/m", AggOp::Avg).f64, mixed.f64 / 5);
+
+  // The column path, across SSE2 chunks, with negatives that cancel.
+  Buffer big;
+  big.init_array();
+  for (int i = 0; i < 1001; ++i) {
+    size_t rec = big.arr_append_obj(0);
+    if (i % 10 != 3)
+      big.set_i64(rec, "n", i % 2 ? INT64_MAX : INT64_MAX - i);
+    big.set_i64(rec, "z", i % 2 ? -i : i - 1000000);
+  }
+  std::vector<ColumnSpec> fields = {{"/n"}, {"/z"}};
+  Columns cols = to_columns(big, 0, fields);
+  for (const char *path : {"/n", "/z"}) {
+    AggValue a = aggregate(big, 0, path, AggOp::Avg);
+    AggValue c = aggregate(*cols.find(path), AggOp::Avg);
+    EXPECT_EQ(a.f64, c.f64) << path;
+    EXPECT_EQ(aggregate(big, 0, path, AggOp::Sum).i64,
+              aggregate(*cols.find(path), AggOp::Sum).i64)
+        << path;
+  }
+  EXPECT_DOUBLE_EQ(aggregate(*cols.find("/n"), AggOp::Avg).f64, 0x1p63);
+  EXPECT_DOUBLE_EQ(aggregate(*cols.find("/z"), AggOp::Avg).f64,
+                   -500999500.0 / 1001);
+}
+
+TEST(AggregateTest, GroupsByScalarKeys) {
+  Buffer buf = lite3_json::parse_json(R"([
+    {"k": 1, "v": 10},
+    {"k": "1", "v": 1},
+    {"v": 5},
+    {"k": 1.0, "v": 2},
+    {"k": 1, "v": 0.5},
+    {"k": true, "v": 7},
+    {"k": null, "v": 1},
+    {"k": true}
+  ])");
+  std::vector<Group> groups = group_by(buf, 0, "/k", "/v", AggOp::Sum);
+  ASSERT_EQ(groups.size(), 5u);
+  EXPECT_EQ(groups[0].key_type, Type::Int64);
+  EXPECT_EQ(groups[0].key_i64, 1);
+  EXPECT_EQ(groups[0].value.type, Type::Float64);
+  EXPECT_EQ(groups[0].value.f64, 10.5);
+  EXPECT_EQ(groups[1].key_type, Type::String);
+  EXPECT_EQ(groups[1].key_str, "1");
+  EXPECT_EQ(groups[2].key_type, Type::Null);
+  EXPECT_EQ(groups[2].value.i64, 6);
+  EXPECT_EQ(groups[3].key_type, Type::Float64);
+  EXPECT_EQ(groups[3].key_f64, 1.0);
+  EXPECT_EQ(groups[4].key_type, Type::Bool);
+  EXPECT_EQ(groups[4].key_i64, 1);
+  EXPECT_EQ(groups[4].value.i64, 7);
+  EXPECT_EQ(groups[4].value.count, 1u);
+
+  std::vector<Group> counts = group_by(buf, 0, "/k", "/v", AggOp::Count);
+  EXPECT_EQ(counts[4].value.i64, 1);
+
+  // Enough distinct keys to grow the index.
+  Buffer many;
+  many.init_array();
+  for (int i = 0; i < 5000; ++i) {
+    size_t rec = many.arr_append_obj(0);
+    many.set_i64(rec, "k", (i * 7919) % 1000);
+    many.set_i64(rec, "v", i);
+  }
+  std::vector<ColumnSpec> fields = {{"/k"}, {"/v"}};
+  Columns cols = to_columns(many, 0, fields);
+  std::vector<Group> direct = group_by(many, 0, "/k", "/v", AggOp::Max);
+  std::vector<Group> columnar = group_by(cols, "/k", "/v", AggOp::Max);
+  ASSERT_EQ(direct.size(), 1000u);
+  ASSERT_EQ(columnar.size(), 1000u);
+  for (size_t g = 0; g < 1000; ++g) {
+    EXPECT_EQ(direct[g].key_i64, columnar[g].key_i64);
+    EXPECT_EQ(direct[g].value.i64, columnar[g].value.i64);
+    EXPECT_GE(direct[g].value.i64, 4000);
+  }
+
+  Buffer nested = lite3_json::parse_json(R"([{"k": [1], "v": 1}])");
+  EXPECT_THROW(group_by(nested, 0, "/k", "/v", AggOp::Sum),
+               lite3cpp::exception);
+  EXPECT_THROW(group_by(cols, "/k", "/missing", AggOp::Sum),
+               lite3cpp::exception);
+}
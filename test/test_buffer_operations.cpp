@@ -2,6 +2,7 @@
 #include "exception.hpp" // Added
 #include "json.hpp"
 #include "observability.hpp"
+#include "patch.hpp"
 #include "utils/hash.hpp"
 #include <gtest/gtest.h> // Include gtest header
 #include <iostream>
@@ -42,6 +43,7 @@ struct BufferTest : public ::testing::Test {
 
   void TearDown() override {
     lite3cpp::set_logger(nullptr); // Reset logger after test
+    lite3cpp::set_metrics(nullptr);
   }
 };
 
@@ -315,3 +317,173 @@ TEST_F(BufferTest, PatchSidecar) {
   ASSERT_EQ(buffer.get_str(0, "sidecar_config"), "v1.1-patched");
   ASSERT_EQ(buffer.get_i64(0, "sidecar_id"), 101);
 }
+
+TEST_F(BufferTest, CopySubtreeBetweenBuffers) {
+  lite3cpp::Buffer src;
+  src.init_object();
+  src.set_i64(0, "noise", 1);
+  size_t config = src.set_obj(0, "config");
+  for (int i = 0; i < 100; ++i)
+    src.set_str(config, "opt" + std::to_string(i), "value" + std::to_string(i));
+  size_t limits = src.set_arr(config, "limits");
+  for (int i = 0; i < 30; ++i)
+    src.arr_append_i64(limits, i * 10);
+  src.set_bool(src.arr_append_obj(limits), "nested", true);
+
+  buffer.init_object();
+  buffer.set_str(0, "name", "tenant-a");
+  size_t tenant = buffer.set_obj(0, "tenant");
+  size_t copy = buffer.copy_subtree(tenant, "config", src, config);
+
+  ASSERT_EQ(copy, buffer.get_obj(tenant, "config"));
+  ASSERT_EQ(buffer.get_str(copy, "opt42"), "value42");
+  size_t copied_limits = buffer.get_arr(copy, "limits");
+  ASSERT_EQ(buffer.arr_get_i64(copied_limits, 29), 290);
+  ASSERT_TRUE(buffer.get_bool(buffer.arr_get_obj(copied_limits, 30), "nested"));
+
+  // Same contents as the source subtree, and still writable.
+  lite3cpp::Buffer expected;
+  expected.init_object();
+  expected.copy_subtree(0, "config", src, config);
+  lite3cpp::Buffer actual;
+  actual.init_object();
+  actual.copy_subtree(0, "config", buffer, copy);
+  ASSERT_TRUE(lite3cpp::diff(expected, actual).empty());
+  buffer.set_i64(copy, "opt100", 100);
+  buffer.arr_append_i64(copied_limits, 300);
+  ASSERT_EQ(buffer.get_i64(copy, "opt100"), 100);
+  ASSERT_EQ(buffer.arr_get_i64(copied_limits, 31), 300);
+  ASSERT_EQ(buffer.get_str(0, "name"), "tenant-a");
+}
+
+TEST_F(BufferTest, CopySubtreeSparseSourceAndSelfCopy) {
+  // Interleaved writes leave the subtree's byte range mostly foreign, so the
+  // copy is rebuilt entry by entry.
+  lite3cpp::Buffer src;
+  src.init_object();
+  size_t a = src.set_obj(0, "a");
+  for (int i = 0; i < 20; ++i) {
+    src.set_i64(a, "k" + std::to_string(i), i);
+    src.set_str(0, "pad" + std::to_string(i), std::string(200, 'p'));
+  }
+
+  buffer.init_array();
+  size_t first = buffer.copy_subtree(0, {}, src, a);
+  size_t second = buffer.copy_subtree(0, {}, buffer, first);
+  ASSERT_EQ(buffer.arr_get_obj(0, 0), first);
+  ASSERT_EQ(buffer.arr_get_obj(0, 1), second);
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_EQ(buffer.get_i64(first, "k" + std::to_string(i)), i);
+    ASSERT_EQ(buffer.get_i64(second, "k" + std::to_string(i)), i);
+  }
+}
+
+TEST_F(BufferTest, CopySubtreeKeepsDigestsCurrent) {
+  lite3cpp::Buffer src;
+  src.init_object();
+  size_t doc = src.set_obj(0, "doc");
+  for (int i = 0; i < 50; ++i)
+    src.set_i64(doc, "f" + std::to_string(i), i);
+
+  for (bool src_digests : {false, true}) {
+    if (src_digests)
+      src.enable_digests();
+    lite3cpp::Buffer dst;
+    dst.init_object();
+    dst.enable_digests();
+    dst.set_i64(0, "x", 1);
+    dst.copy_subtree(0, "doc", src, doc);
+
+    lite3cpp::Buffer rebuilt(
+        std::vector<uint8_t>(dst.data(), dst.data() + dst.size()));
+    rebuilt.enable_digests();
+    ASSERT_EQ(dst.digest(), rebuilt.digest());
+    ASSERT_EQ(dst.digest(dst.get_obj(0, "doc")),
+              rebuilt.digest(rebuilt.get_obj(0, "doc")));
+  }
+}
+
+TEST_F(BufferTest, ReservedCapacityIsNeverReallocated) {
+  lite3cpp::Buffer reserved;
+  reserved.reserve(64 * 1024);
+  reserved.init_object();
+  const uint8_t *data = reserved.data();
+  // Growth inside the reservation stops at its end instead of doubling
+  // past it.
+  for (int i = 0; i < 100; ++i)
+    reserved.set_str(0, "key" + std::to_string(i), "value");
+  ASSERT_LT(reserved.size(), 16 * 1024u);
+  for (int i = 100; reserved.size() < 64 * 1024 - 512; ++i)
+    reserved.set_i64(0, "key" + std::to_string(i), i);
+  ASSERT_EQ(reserved.data(), data);
+  ASSERT_EQ(reserved.capacity(), 64 * 1024u);
+  ASSERT_EQ(reserved.get_str(0, "key7"), "value");
+}
+
+#ifndef LITE3CPP_DISABLE_OBSERVABILITY
+// Records the capacity the buffer reports each time its storage is
+// reallocated.
+class CapacityMetrics : public lite3cpp::IMetrics {
+public:
+  std::vector<size_t> capacities;
+
+  bool set_buffer_capacity(size_t capacity) override {
+    capacities.push_back(capacity);
+    return true;
+  }
+  bool record_latency(std::string_view, double) override { return true; }
+  bool increment_operation_count(std::string_view, std::string_view) override {
+    return true;
+  }
+  bool set_buffer_usage(size_t) override { return true; }
+  bool increment_node_splits() override { return true; }
+  bool increment_hash_collisions() override { return true; }
+  bool record_bytes_received(size_t) override { return true; }
+  bool record_bytes_sent(size_t) override { return true; }
+  bool increment_active_connections() override { return true; }
+  bool decrement_active_connections() override { return true; }
+  bool record_error(int) override { return true; }
+  bool increment_sync_ops(std::string_view) override { return true; }
+  bool increment_keys_repaired() override { return true; }
+  bool increment_mesh_bytes(std::string_view, size_t, bool) override {
+    return true;
+  }
+};
+
+TEST_F(BufferTest, JsonImportReservesOnce) {
+  // Deep nesting, an array large enough to split many times, and duplicate
+  // keys, whose every occurrence is appended before the last one wins.
+  std::string nested = "{\"leaf\":true}";
+  for (int depth = 0; depth < 40; ++depth)
+    nested = "{\"d" + std::to_string(depth) + "\":" + nested +
+             ",\"list\":[1,[2,[3,{\"x\":\"" + std::string(depth, 'y') +
+             "\"}]]],\"n\":" + std::to_string(depth) + "}";
+  std::string large = "[";
+  for (int i = 0; i < 20000; ++i)
+    large += (i ? "," : "") + (i % 3 ? std::to_string(i)
+                                     : "{\"id\":" + std::to_string(i) + "}");
+  large += "]";
+  std::string dups = "{";
+  for (int i = 0; i < 500; ++i)
+    dups += "\"k" + std::to_string(i % 7) + "\":\"" + std::string(i % 90, 'v') +
+            "\",\"obj\":{\"a\":" + std::to_string(i) + ",\"a\":[" +
+            std::to_string(i) + "]},";
+  dups += "\"end\":null}";
+
+  CapacityMetrics metrics;
+  lite3cpp::set_metrics(&metrics);
+  for (const std::string *json : {&nested, &large, &dups}) {
+    metrics.capacities.clear();
+    lite3cpp::Buffer imported = lite3cpp::lite3_json::from_json_string(*json);
+    // Only the reservation up front allocates; inserting never regrows.
+    ASSERT_EQ(metrics.capacities.size(), 1u) << json->substr(0, 40);
+    EXPECT_EQ(imported.capacity(), metrics.capacities[0]);
+    EXPECT_LE(imported.size(), imported.capacity());
+  }
+
+  lite3cpp::Buffer check = lite3cpp::lite3_json::from_json_string(dups);
+  EXPECT_EQ(check.get_str(0, "k6"), std::string(496 % 90, 'v'));
+  EXPECT_EQ(check.arr_get_i64(check.get_arr(check.get_obj(0, "obj"), "a"), 0),
+            499);
+}
+#endif
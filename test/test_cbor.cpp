@@ -0,0 +1,289 @@
+#include "buffer.hpp"
+#include "cbor.hpp"
+#include "exception.hpp"
+#include "json.hpp"
+#include "test_util.hpp"
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+static std::vector<uint8_t> unhex(const std::string &hex) {
+  std::vector<uint8_t> out;
+  for (size_t i = 0; i < hex.size(); i += 2)
+    out.push_back(
+        static_cast<uint8_t>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+  return out;
+}
+
+static std::string hex(const std::vector<uint8_t> &bytes) {
+  static const char digits[] = "0123456789abcdef";
+  std::string out;
+  for (uint8_t b : bytes) {
+    out += digits[b >> 4];
+    out += digits[b & 15];
+  }
+  return out;
+}
+
+// Decodes one encoded item by wrapping it in a one-element array.
+static Buffer decode_item(const std::string &item) {
+  return lite3_cbor::parse_cbor(unhex("81" + item));
+}
+
+// Canonical encoding of the single element of `buf`'s root array.
+static std::string encode_item(const Buffer &buf) {
+  lite3_cbor::WriteOptions canonical;
+  canonical.canonical = true;
+  std::string out = hex(lite3_cbor::to_cbor(buf, 0, canonical));
+  EXPECT_EQ(out.substr(0, 2), "81");
+  return out.substr(2);
+}
+
+TEST(CborTest, DecodesRfcExamples) {
+  // RFC 8949 appendix A.
+  struct IntCase {
+    const char *hex;
+    int64_t value;
+  } ints[] = {{"00", 0},
+              {"17", 23},
+              {"1818", 24},
+              {"1903e8", 1000},
+              {"1a000f4240", 1000000},
+              {"1b000000e8d4a51000", 1000000000000},
+              {"20", -1},
+              {"3863", -100},
+              {"3903e7", -1000},
+              {"3b7fffffffffffffff", INT64_MIN},
+              {"c11a514b67b0", 1363896240}};
+  for (const auto &c : ints) {
+    EXPECT_EQ(decode_item(c.hex).arr_get_i64(0, 0), c.value) << c.hex;
+    Buffer buf;
+    buf.init_array();
+    buf.arr_append_i64(0, c.value);
+    if (std::string(c.hex).substr(0, 2) != "c1") { // Tags are not written
+      EXPECT_EQ(encode_item(buf), c.hex);
+    }
+  }
+
+  struct FloatCase {
+    const char *hex;
+    double value;
+  } floats[] = {{"f90000", 0.0},
+                {"f98000", -0.0},
+                {"f93e00", 1.5},
+                {"f97bff", 65504.0},
+                {"fa47c35000", 100000.0},
+                {"fa7f7fffff", 3.4028234663852886e+38},
+                {"fb7e37e43c8800759c", 1.0e+300},
+                {"f90001", 5.960464477539063e-8},
+                {"f90400", 0.00006103515625},
+                {"f9c400", -4.0},
+                {"fbc010666666666666", -4.1},
+                {"f97c00", std::numeric_limits<double>::infinity()},
+                {"f9fc00", -std::numeric_limits<double>::infinity()},
+                {"fb3ff199999999999a", 1.1}};
+  for (const auto &c : floats) {
+    double d = decode_item(c.hex).arr_get_f64(0, 0);
+    EXPECT_EQ(d, c.value) << c.hex;
+    EXPECT_EQ(std::signbit(d), std::signbit(c.value)) << c.hex;
+    Buffer buf;
+    buf.init_array();
+    buf.arr_append_f64(0, c.value);
+    EXPECT_EQ(encode_item(buf), c.hex);
+  }
+  EXPECT_TRUE(std::isnan(decode_item("f97e00").arr_get_f64(0, 0)));
+  EXPECT_TRUE(std::isnan(decode_item("fa7fc00000").arr_get_f64(0, 0)));
+  Buffer nan;
+  nan.init_array();
+  nan.arr_append_f64(0, std::nan(""));
+  EXPECT_EQ(encode_item(nan), "f97e00");
+
+  Buffer simple = lite3_cbor::parse_cbor(unhex("84f4f5f6f7"));
+  EXPECT_FALSE(simple.arr_get_bool(0, 0));
+  EXPECT_TRUE(simple.arr_get_bool(0, 1));
+  EXPECT_EQ(simple.arr_get_type(0, 2), Type::Null);
+  EXPECT_EQ(simple.arr_get_type(0, 3), Type::Null);
+
+  EXPECT_EQ(decode_item("6449455446").arr_get_str(0, 0), "IETF");
+  EXPECT_EQ(decode_item("62c3bc").arr_get_str(0, 0), "\xc3\xbc");
+  EXPECT_EQ(decode_item("7f657374726561646d696e67ff").arr_get_str(0, 0),
+            "streaming");
+  Buffer chunked = decode_item("5f42010243030405ff");
+  auto bytes = chunked.arr_get_bytes(0, 0);
+  ASSERT_EQ(bytes.size(), 5u);
+  EXPECT_EQ(bytes[4], std::byte{5});
+
+  // Definite and indefinite forms of the same containers agree, and the
+  // writer gives back the definite one.
+  Buffer nested = lite3_cbor::parse_cbor(unhex("8301820203820405"));
+  EXPECT_EQ(content_digest(lite3_cbor::parse_cbor(
+                unhex("9f018202039f0405ffff"))),
+            content_digest(nested));
+  EXPECT_EQ(hex(lite3_cbor::to_cbor(nested)), "8301820203820405");
+  Buffer map = lite3_cbor::parse_cbor(unhex("a26161016162820203"));
+  EXPECT_EQ(map.get_i64(0, "a"), 1);
+  EXPECT_EQ(content_digest(lite3_cbor::parse_cbor(
+                unhex("bf61610161629f0203ffff"))),
+            content_digest(map));
+  EXPECT_EQ(lite3_cbor::parse_cbor(unhex("9fff")).size(), config::node_size);
+}
+
+TEST(CborTest, CanonicalEncodingIsDeterministic) {
+  // The same content set in two different orders.
+  auto build = [](bool reverse) {
+    Buffer buf;
+    buf.init_object();
+    std::vector<std::string> keys = {"b", "a", "aa", "z", "ab", "long_key"};
+    if (reverse)
+      std::reverse(keys.begin(), keys.end());
+    for (const std::string &k : keys) {
+      if (k == "aa") {
+        size_t inner = buf.set_obj(0, k);
+        buf.set_f64(inner, "y", 0.5);
+        buf.set_str(inner, "x", "text");
+      } else {
+        buf.set_i64(0, k, static_cast<int64_t>(k.size()) * 1000);
+      }
+    }
+    return buf;
+  };
+  lite3_cbor::WriteOptions canonical;
+  canonical.canonical = true;
+  std::vector<uint8_t> one = lite3_cbor::to_cbor(build(false), 0, canonical);
+  std::vector<uint8_t> two = lite3_cbor::to_cbor(build(true), 0, canonical);
+  EXPECT_EQ(one, two);
+  // Shorter keys first, then bytewise; floats in their shortest form.
+  EXPECT_EQ(hex(one), "a6"
+                      "6161" "1903e8"           // "a": 1000
+                      "6162" "1903e8"           // "b": 1000
+                      "617a" "1903e8"           // "z": 1000
+                      "626161" "a2"             // "aa": {
+                      "6178" "6474657874"       //   "x": "text",
+                      "6179" "f93800"           //   "y": 0.5}
+                      "626162" "1907d0"         // "ab": 2000
+                      "686c6f6e675f6b6579" "191f40"); // "long_key": 8000
+
+  // Decoding and re-encoding gives the same bytes back.
+  Buffer back = lite3_cbor::parse_cbor(one);
+  EXPECT_EQ(lite3_cbor::to_cbor(back, 0, canonical), one);
+}
+
+TEST(CborTest, RoundTripsBuffers) {
+  Buffer buf;
+  buf.init_object();
+  size_t ints = buf.set_arr(0, "ints");
+  for (int64_t v : {int64_t(0), int64_t(23), int64_t(24), int64_t(-24),
+                    int64_t(-25), int64_t(65536), int64_t(-4294967297LL),
+                    INT64_MIN, INT64_MAX})
+    buf.arr_append_i64(ints, v);
+  for (size_t len : {23u, 24u, 255u, 256u, 70000u})
+    buf.set_str(0, "s" + std::to_string(len), std::string(len, 'x'));
+  std::vector<std::byte> blob(300, std::byte{7});
+  buf.set_bytes(0, "blob", blob);
+  buf.set_f64(0, "f", -0.1);
+  buf.set_null(0, "n");
+  buf.set_bool(0, "t", true);
+  size_t wide = buf.set_obj(0, "wide");
+  for (int i = 0; i < 40; ++i)
+    buf.set_i64(wide, "k" + std::to_string(i), i);
+
+  lite3_cbor::WriteOptions canonical;
+  canonical.canonical = true;
+  for (const lite3_cbor::WriteOptions &opts :
+       {lite3_cbor::WriteOptions{}, canonical}) {
+    std::vector<uint8_t> encoded = lite3_cbor::to_cbor(buf, 0, opts);
+    EXPECT_EQ(content_digest(lite3_cbor::parse_cbor(encoded)),
+              content_digest(buf));
+
+    // A span of the exact size works; one byte less throws.
+    std::vector<uint8_t> out(encoded.size());
+    EXPECT_EQ(lite3_cbor::write_cbor(buf, 0, std::span<uint8_t>(out), opts),
+              encoded.size());
+    EXPECT_EQ(out, encoded);
+    EXPECT_THROW(
+        lite3_cbor::write_cbor(
+            buf, 0, std::span<uint8_t>(out.data(), out.size() - 1), opts),
+        lite3cpp::exception);
+  }
+
+  // A nested value on its own.
+  std::vector<uint8_t> arr = lite3_cbor::to_cbor(
+      buf, static_cast<size_t>(buf.get_arr(0, "ints")) - 1);
+  EXPECT_EQ(hex(arr).substr(0, 16), "8900171818373818");
+
+  // Agrees with the JSON path on an ordinary document.
+  Buffer json = lite3_json::parse_json(
+      R"({"id":7,"tags":["a","b"],"geo":{"lat":1.25,"lon":-3.5},"ok":true})");
+  EXPECT_EQ(content_digest(lite3_cbor::parse_cbor(lite3_cbor::to_cbor(json))),
+            content_digest(json));
+}
+
+TEST(CborTest, ReadsItemSequence) {
+  std::vector<uint8_t> stream;
+  for (int i = 0; i < 50; ++i) {
+    Buffer doc;
+    doc.init_object();
+    doc.set_i64(0, "seq", i);
+    doc.set_str(0, "pad", std::string(i, 'p'));
+    lite3_cbor::write_cbor(doc, 0, stream);
+  }
+  // Feed the stream in odd-sized pieces; an item split across pieces is
+  // retried once more bytes arrive.
+  std::vector<uint8_t> pending;
+  Buffer out;
+  int seen = 0;
+  for (size_t pos = 0; pos < stream.size(); pos += 37) {
+    size_t n = std::min<size_t>(37, stream.size() - pos);
+    pending.insert(pending.end(), stream.begin() + pos,
+                   stream.begin() + pos + n);
+    while (size_t used = lite3_cbor::read_cbor(pending, out)) {
+      EXPECT_EQ(out.get_i64(0, "seq"), seen);
+      ++seen;
+      pending.erase(pending.begin(), pending.begin() + used);
+    }
+  }
+  EXPECT_EQ(seen, 50);
+  EXPECT_TRUE(pending.empty());
+}
+
+TEST(CborTest, RejectsMalformedInput) {
+  auto expect_error = [](const std::string &data, const char *what) {
+    Buffer out;
+    try {
+      lite3_cbor::parse_cbor(unhex(data), out);
+      FAIL() << what;
+    } catch (const lite3cpp::exception &e) {
+      EXPECT_NE(std::string(e.what()).find(what), std::string::npos)
+          << e.what();
+      EXPECT_EQ(out.size(), 0u);
+    }
+  };
+  expect_error("8201", "Truncated CBOR at offset 2");
+  expect_error("9f01", "Truncated CBOR at offset 2");
+  expect_error("811c", "Invalid additional information in CBOR at offset 1");
+  expect_error("811f", "Invalid additional information in CBOR at offset 1");
+  expect_error("a10102", "Map key is not a text string in CBOR at offset 1");
+  expect_error("81f0", "Unsupported simple value in CBOR at offset 1");
+  expect_error("81ff", "Unexpected break in CBOR at offset 1");
+  expect_error("811bffffffffffffffff", "Integer out of Int64 range");
+  expect_error("813b8000000000000000", "Integer out of Int64 range");
+  expect_error("815f41006100ff",
+               "Invalid chunk in indefinite-length string in CBOR at offset 4");
+  expect_error("a1" "7840" + std::string(128, '6') + "00", "Map key too long");
+  expect_error("8080", "Trailing bytes after CBOR at offset 1");
+  std::string deep;
+  for (int i = 0; i < 600; ++i)
+    deep += "81";
+  expect_error(deep + "80", "Nesting too deep");
+
+  // A scalar root reads through to an empty buffer; tags on the root are
+  // read through.
+  EXPECT_EQ(lite3_cbor::parse_cbor(unhex("182a")).size(), 0u);
+  Buffer tagged = lite3_cbor::parse_cbor(unhex("d8208101"));
+  EXPECT_EQ(tagged.arr_get_i64(0, 0), 1);
+}
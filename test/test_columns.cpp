@@ -0,0 +1,138 @@
+#include "buffer.hpp"
+#include "columns.hpp"
+#include "exception.hpp"
+#include "json.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+TEST(ColumnsTest, ExtractsTypedColumns) {
+  Buffer buf = lite3_json::parse_json(R"([
+    {"ts": 100, "user": "ann", "value": 1, "geo": {"lat": 1.5}, "ok": true},
+    {"ts": 101, "user": "bob", "value": 2.5, "tag": "00ff"},
+    {"ts": 102, "user": null, "geo": {"lat": -2}},
+    7,
+    {"ts": 104, "user": "z", "value": 4, "ok": false, "tag": "ab"}
+  ])");
+  std::vector<ColumnSpec> fields = {{"/ts", Type::Int64},
+                                    {"/user"},
+                                    {"/value"},
+                                    {"/geo/lat", Type::Float64},
+                                    {"/ok"},
+                                    {"/tag"},
+                                    {"/missing"}};
+  Columns cols = to_columns(buf, 0, fields);
+  ASSERT_EQ(cols.rows, 5u);
+  ASSERT_EQ(cols.columns.size(), fields.size());
+
+  const Column &ts = *cols.find("/ts");
+  EXPECT_EQ(ts.type, Type::Int64);
+  EXPECT_EQ(ts.i64, (std::vector<int64_t>{100, 101, 102, 0, 104}));
+  EXPECT_EQ(ts.null_count, 1u);
+  EXPECT_EQ(ts.validity, (std::vector<uint8_t>{0x17}));
+
+  // Strings: offsets bracket each row, nulls are empty ranges.
+  const Column &user = *cols.find("/user");
+  EXPECT_EQ(user.type, Type::String);
+  EXPECT_EQ(user.offsets, (std::vector<uint32_t>{0, 3, 6, 6, 6, 7}));
+  EXPECT_EQ(user.str(1), "bob");
+  EXPECT_EQ(user.str(4), "z");
+  EXPECT_FALSE(user.valid(2));
+  EXPECT_EQ(user.null_count, 2u);
+
+  // Inferred Int64 turns Float64 when a real turns up.
+  const Column &value = *cols.find("/value");
+  EXPECT_EQ(value.type, Type::Float64);
+  EXPECT_EQ(value.f64, (std::vector<double>{1, 2.5, 0, 0, 4}));
+  EXPECT_TRUE(value.i64.empty());
+
+  // Nested path; Int64 widens into a Float64 column.
+  const Column &lat = *cols.find("/geo/lat");
+  EXPECT_EQ(lat.f64, (std::vector<double>{1.5, 0, -2, 0, 0}));
+  EXPECT_EQ(lat.validity, (std::vector<uint8_t>{0x05}));
+
+  const Column &ok = *cols.find("/ok");
+  EXPECT_EQ(ok.type, Type::Bool);
+  EXPECT_EQ(ok.bools, (std::vector<uint8_t>{1, 0, 0, 0, 0}));
+  EXPECT_EQ(ok.null_count, 3u);
+
+  const Column &tag = *cols.find("/tag");
+  EXPECT_EQ(tag.type, Type::Bytes);
+  ASSERT_EQ(tag.bytes(1).size(), 2u);
+  EXPECT_EQ(tag.bytes(1)[1], std::byte{0xff});
+  EXPECT_EQ(tag.bytes(4)[0], std::byte{0xab});
+
+  const Column &missing = *cols.find("/missing");
+  EXPECT_EQ(missing.type, Type::Null);
+  EXPECT_EQ(missing.null_count, 5u);
+  EXPECT_EQ(cols.find("/nope"), nullptr);
+}
+
+TEST(ColumnsTest, MatchesPerRecordLookups) {
+  // Records wide enough to span several nodes, in an array deep enough to
+  // split too.
+  Buffer buf;
+  buf.init_object();
+  size_t arr = buf.set_arr(0, "rows");
+  for (int i = 0; i < 3000; ++i) {
+    size_t rec = buf.arr_append_obj(arr);
+    for (int k = 0; k < 30; ++k)
+      if ((i + k) % 7 != 0)
+        buf.set_i64(rec, "k" + std::to_string(k), i * 100 + k);
+    buf.set_str(rec, "name", "n" + std::to_string(i));
+  }
+  std::vector<ColumnSpec> fields;
+  for (int k = 0; k < 30; k += 3)
+    fields.push_back({"/k" + std::to_string(k), Type::Int64});
+  fields.push_back({"/name", Type::String});
+  fields.push_back({"/k3"}); // Same member twice
+  Columns cols = to_columns(buf, buf.get_arr(0, "rows"), fields);
+  ASSERT_EQ(cols.rows, 3000u);
+
+  for (size_t c = 0; c + 2 < fields.size(); ++c) {
+    const Column &col = cols.columns[c];
+    int k = std::stoi(fields[c].path.substr(2));
+    for (int i = 0; i < 3000; ++i) {
+      bool present = (i + k) % 7 != 0;
+      ASSERT_EQ(col.valid(i), present) << col.path << " " << i;
+      EXPECT_EQ(col.i64[i], present ? i * 100 + k : 0);
+    }
+  }
+  const Column &name = cols.columns[fields.size() - 2];
+  for (int i = 0; i < 3000; i += 97)
+    EXPECT_EQ(name.str(i), "n" + std::to_string(i));
+  EXPECT_EQ(cols.columns.back().i64, cols.columns[1].i64);
+}
+
+TEST(ColumnsTest, ErrorsNameTheColumn) {
+  Buffer buf = lite3_json::parse_json(R"([{"a": 1}, {"a": "x"}, {"a": {}}])");
+  auto expect_error = [&](std::vector<ColumnSpec> fields, const char *what) {
+    try {
+      to_columns(buf, 0, fields);
+      FAIL() << what;
+    } catch (const lite3cpp::exception &e) {
+      EXPECT_NE(std::string(e.what()).find(what), std::string::npos)
+          << e.what();
+    }
+  };
+  expect_error({{"/a"}}, "Column /a is not an Int64 at element 1");
+  expect_error({{"/a", Type::String}},
+               "Column /a is not a string at element 0");
+  expect_error({{"a"}}, "Column path must name a member");
+  expect_error({{"/a~2"}}, "bad escape");
+  expect_error({{"/a", Type::Object}}, "must be a Bool");
+
+  Buffer obj = lite3_json::parse_json(R"({"a": [1]})");
+  std::vector<ColumnSpec> fields = {{"/a"}};
+  EXPECT_THROW(to_columns(obj, 0, fields), lite3cpp::exception);
+  Buffer scalar = lite3_json::parse_json(R"([{"a": {}}])");
+  try {
+    to_columns(scalar, 0, fields);
+    FAIL();
+  } catch (const lite3cpp::exception &e) {
+    EXPECT_STREQ(e.what(),
+                 "Column /a is not a scalar at element 0 (found an object)");
+  }
+}
@@ -0,0 +1,191 @@
+#include "concurrent.hpp"
+#include "exception.hpp"
+#include "patch.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lite3cpp;
+
+TEST(ConcurrentBufferTest, WriteThenRead) {
+  ConcurrentBuffer cb;
+  cb.write([](Buffer &b) {
+    b.init_object();
+    b.set_i64(0, "answer", 42);
+  });
+
+  int64_t v = cb.read([](const Buffer &b) { return b.get_i64(0, "answer"); });
+  ASSERT_EQ(v, 42);
+  ASSERT_EQ(cb.sequence() % 2, 0u);
+}
+
+TEST(ConcurrentBufferTest, ValidatedExceptionPropagates) {
+  ConcurrentBuffer cb;
+  cb.write([](Buffer &b) { b.init_object(); });
+
+  ASSERT_THROW(cb.read([](const Buffer &b) { return b.get_i64(0, "missing"); }),
+               lite3cpp::exception);
+}
+
+TEST(ConcurrentBufferTest, EpochKeepsRetiredStorageWhilePinned) {
+  EpochManager epochs(4);
+  {
+    auto guard = epochs.pin();
+    epochs.retire(std::vector<uint8_t>(64));
+    epochs.collect();
+    ASSERT_EQ(epochs.retired_count(), 1u);
+  }
+  epochs.collect();
+  ASSERT_EQ(epochs.retired_count(), 0u);
+}
+
+TEST(ConcurrentBufferTest, ReadersNeverObserveTornWrites) {
+  ConcurrentBuffer cb;
+  cb.write([](Buffer &b) {
+    b.init_object();
+    b.set_i64(0, "a", 0);
+    b.set_i64(0, "b", 0);
+  });
+
+  constexpr int writes = 2000;
+  std::atomic<bool> done{false};
+  std::atomic<int> mismatches{0};
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r) {
+    readers.emplace_back([&] {
+      while (!done.load(std::memory_order_acquire)) {
+        auto pair = cb.read([](const Buffer &b) {
+          return std::make_pair(b.get_i64(0, "a"), b.get_i64(0, "b"));
+        });
+        if (pair.first != pair.second)
+          mismatches++;
+      }
+    });
+  }
+
+  for (int i = 1; i <= writes; ++i) {
+    cb.write([i](Buffer &b) {
+      b.set_i64(0, "a", i);
+      // Fresh keys force node splits and storage growth under the readers.
+      b.set_str(0, "filler" + std::to_string(i), "xxxxxxxxxxxxxxxx");
+      b.set_i64(0, "b", i);
+    });
+  }
+  done.store(true, std::memory_order_release);
+  for (auto &t : readers)
+    t.join();
+
+  ASSERT_EQ(mismatches.load(), 0);
+  int64_t last = cb.read([](const Buffer &b) { return b.get_i64(0, "b"); });
+  ASSERT_EQ(last, writes);
+  cb.reclaim();
+  ASSERT_EQ(cb.retired_count(), 0u);
+}
+
+TEST(ConcurrentBufferTest, RootReplaceAndReserveRetireStorage) {
+  ConcurrentBuffer cb;
+  cb.write([](Buffer &b) {
+    b.init_object();
+    b.set_i64(0, "a", 0);
+    b.set_i64(0, "b", 0);
+  });
+  auto replace = [](Buffer &b, int i) {
+    std::string n = std::to_string(i);
+    apply_json_patch(b, R"([{"op": "replace", "path": "", "value": {"a": )" +
+                            n + R"(, "pad": "xxxxxxxxxxxxxxxx", "b": )" + n +
+                            "}}]");
+  };
+
+  Buffer assigned;
+  assigned.init_object();
+  assigned.set_i64(0, "a", 0);
+  assigned.set_i64(0, "b", 0);
+
+  // A reader stalled mid-read across the write, still holding the old
+  // storage, which must stay allocated until it leaves.
+  for (int step = 0; step < 3; ++step) {
+    std::atomic<int> stage{0};
+    std::thread stalled([&] {
+      cb.read([&](const Buffer &b) {
+        const uint8_t *old = b.data();
+        if (stage.load() == 0) {
+          stage.store(1);
+          while (stage.load() != 2)
+            std::this_thread::yield();
+        }
+        return old[0];
+      });
+    });
+    while (stage.load() != 1)
+      std::this_thread::yield();
+    cb.write([&](Buffer &b) {
+      if (step == 0)
+        replace(b, 1);
+      else if (step == 1)
+        b.reserve(b.capacity() * 2);
+      else
+        b = assigned;
+    });
+    EXPECT_GT(cb.retired_count(), 0u);
+    stage.store(2);
+    stalled.join();
+  }
+
+  constexpr int writes = 500;
+  std::atomic<bool> done{false};
+  std::atomic<int> mismatches{0};
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r) {
+    readers.emplace_back([&] {
+      while (!done.load(std::memory_order_acquire)) {
+        auto pair = cb.read([](const Buffer &b) {
+          return std::make_pair(b.get_i64(0, "a"), b.get_i64(0, "b"));
+        });
+        if (pair.first != pair.second)
+          mismatches++;
+      }
+    });
+  }
+  for (int i = 1; i <= writes; ++i)
+    cb.write([&](Buffer &b) { replace(b, i); });
+  done.store(true, std::memory_order_release);
+  for (auto &t : readers)
+    t.join();
+
+  ASSERT_EQ(mismatches.load(), 0);
+  int64_t last = cb.read([](const Buffer &b) { return b.get_i64(0, "b"); });
+  ASSERT_EQ(last, writes);
+  cb.reclaim();
+  ASSERT_EQ(cb.retired_count(), 0u);
+}
+
+TEST(ConcurrentBufferTest, LookupsStayWithinStorage) {
+  Buffer b;
+  b.init_object();
+  size_t obj = b.set_obj(0, "o");
+  b.set_i64(obj, "a", 1);
+  std::vector<uint8_t> bytes(b.data(), b.data() + b.size());
+
+  // Nodes and entries past the end of the storage read as misses.
+  Buffer truncated(std::vector<uint8_t>(bytes.begin(), bytes.begin() + obj));
+  EXPECT_THROW(truncated.get_obj(0, "o"), lite3cpp::exception);
+  EXPECT_THROW(truncated.get_i64(obj, "a"), lite3cpp::exception);
+  EXPECT_THROW(b.get_i64(b.size(), "a"), lite3cpp::exception);
+
+  // Child offsets pointing back at their own node end the descent at the
+  // height limit instead of looping.
+  uint32_t self = static_cast<uint32_t>(obj);
+  for (int i = 0; i < 2; ++i)
+    std::memcpy(bytes.data() + obj + offsetof(PackedNodeLayout, child_ofs) +
+                    i * sizeof(self),
+                &self, sizeof(self));
+  Buffer cyclic(std::move(bytes));
+  EXPECT_EQ(cyclic.get_i64(obj, "a"), 1);
+  EXPECT_THROW(cyclic.get_i64(obj, "b"), lite3cpp::exception);
+  EXPECT_THROW(cyclic.get_i64(obj, "zz"), lite3cpp::exception);
+}
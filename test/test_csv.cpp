@@ -0,0 +1,166 @@
+#include "buffer.hpp"
+#include "csv.hpp"
+#include "exception.hpp"
+#include "test_util.hpp"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+TEST(CsvTest, ReadsRecordsWithInferredTypes) {
+  std::string csv = "id,name,score,ok,note\r\n"
+                    "1,ann,0.5,true,\"plain\"\r\n"
+                    "\r\n"
+                    "+2,\"Smith, Bob\",-3,false,\"say \"\"hi\"\"\nbye\"\r\n"
+                    "3,,1e3,maybe,\"\"\n"
+                    "007,inf,.25,TRUE,x";
+  Buffer buf = lite3_csv::parse_csv(csv);
+  ASSERT_EQ(NodeView(reinterpret_cast<const PackedNodeLayout *>(buf.data()))
+                .size(),
+            4u);
+
+  size_t r0 = buf.arr_get_obj(0, 0);
+  EXPECT_EQ(buf.get_i64(r0, "id"), 1);
+  EXPECT_EQ(buf.get_str(r0, "name"), "ann");
+  EXPECT_EQ(buf.get_f64(r0, "score"), 0.5);
+  EXPECT_TRUE(buf.get_bool(r0, "ok"));
+  EXPECT_EQ(buf.get_str(r0, "note"), "plain");
+
+  size_t r1 = buf.arr_get_obj(0, 1);
+  EXPECT_EQ(buf.get_i64(r1, "id"), 2);
+  EXPECT_EQ(buf.get_str(r1, "name"), "Smith, Bob");
+  EXPECT_EQ(buf.get_i64(r1, "score"), -3);
+  EXPECT_FALSE(buf.get_bool(r1, "ok"));
+  EXPECT_EQ(buf.get_str(r1, "note"), "say \"hi\"\nbye");
+
+  // Empty is null, "" an empty string, anything unrecognised a string.
+  size_t r2 = buf.arr_get_obj(0, 2);
+  EXPECT_EQ(buf.get_type(r2, "name"), Type::Null);
+  EXPECT_EQ(buf.get_f64(r2, "score"), 1000.0);
+  EXPECT_EQ(buf.get_str(r2, "ok"), "maybe");
+  EXPECT_EQ(buf.get_str(r2, "note"), "");
+
+  size_t r3 = buf.arr_get_obj(0, 3);
+  EXPECT_EQ(buf.get_i64(r3, "id"), 7);
+  EXPECT_EQ(buf.get_str(r3, "name"), "inf");
+  EXPECT_EQ(buf.get_f64(r3, "score"), 0.25);
+  EXPECT_EQ(buf.get_str(r3, "ok"), "TRUE");
+  EXPECT_EQ(buf.get_str(r3, "note"), "x");
+
+  // Past the range of a double: an infinity, or zero when too small.
+  Buffer range = lite3_csv::parse_csv("x\n1e400\n-1e400\n1e-400\n"
+                                      "-0.001e-330\n123e-1000000\n");
+  EXPECT_EQ(range.get_f64(range.arr_get_obj(0, 0), "x"), INFINITY);
+  EXPECT_EQ(range.get_f64(range.arr_get_obj(0, 1), "x"), -INFINITY);
+  EXPECT_EQ(range.get_f64(range.arr_get_obj(0, 2), "x"), 0.0);
+  double neg = range.get_f64(range.arr_get_obj(0, 3), "x");
+  EXPECT_TRUE(neg == 0.0 && std::signbit(neg));
+  EXPECT_EQ(range.get_f64(range.arr_get_obj(0, 4), "x"), 0.0);
+
+  // One sign only: "+-" is not a number.
+  Buffer signs = lite3_csv::parse_csv("x\n+-5\n+-1.5\n+.5\n");
+  EXPECT_EQ(signs.get_str(signs.arr_get_obj(0, 0), "x"), "+-5");
+  EXPECT_EQ(signs.get_str(signs.arr_get_obj(0, 1), "x"), "+-1.5");
+  EXPECT_EQ(signs.get_f64(signs.arr_get_obj(0, 2), "x"), 0.5);
+}
+
+TEST(CsvTest, AppliesColumnTypes) {
+  lite3_csv::CsvOptions options;
+  options.columns = {{"zip", Type::String}, {"n", Type::Float64},
+                     {"flag", Type::Bool}};
+  Buffer buf = lite3_csv::parse_csv("zip,n,flag,rest\n007,3,1,4\n", options);
+  size_t r = buf.arr_get_obj(0, 0);
+  EXPECT_EQ(buf.get_str(r, "zip"), "007");
+  EXPECT_EQ(buf.get_f64(r, "n"), 3.0);
+  EXPECT_TRUE(buf.get_bool(r, "flag"));
+  EXPECT_EQ(buf.get_i64(r, "rest"), 4);
+
+  // Without a header the columns name every field.
+  lite3_csv::CsvOptions headless;
+  headless.header = false;
+  headless.delimiter = ';';
+  headless.columns = {{"a", Type::Int64}, {"b"}};
+  buf.clear();
+  lite3_csv::parse_csv("1;x\n2;\"y;z\"\n", buf, headless);
+  EXPECT_EQ(buf.get_i64(buf.arr_get_obj(0, 1), "a"), 2);
+  EXPECT_EQ(buf.get_str(buf.arr_get_obj(0, 1), "b"), "y;z");
+}
+
+TEST(CsvTest, ParallelMatchesSerial) {
+  std::string csv = "id,name,text,score\n";
+  for (int i = 0; i < 20000; ++i) {
+    csv += std::to_string(i) + ",user" + std::to_string(i) + ",";
+    // Quoted newlines and delimiters must not be taken for cut points.
+    csv += i % 3 ? "\"line\nnext, \"\"q\"\"\"" : "plain";
+    csv += "," + std::to_string(i * 0.5) + "\n";
+  }
+  Buffer serial = lite3_csv::parse_csv(csv);
+
+  lite3_csv::CsvOptions options;
+  options.threads = 4;
+  options.min_chunk = 4096;
+  Buffer parallel = lite3_csv::parse_csv(csv, options);
+  EXPECT_EQ(NodeView(reinterpret_cast<const PackedNodeLayout *>(
+                         parallel.data()))
+                .size(),
+            20000u);
+  EXPECT_EQ(content_digest(parallel), content_digest(serial));
+  size_t r = parallel.arr_get_obj(0, 12346);
+  EXPECT_EQ(parallel.get_i64(r, "id"), 12346);
+  EXPECT_EQ(parallel.get_str(r, "text"), "line\nnext, \"q\"");
+
+  // Errors name the offset in the whole input, whichever piece hit them.
+  std::string bad = csv + "1,2,3\n";
+  try {
+    lite3_csv::parse_csv(bad, options);
+    FAIL();
+  } catch (const lite3cpp::exception &e) {
+    EXPECT_EQ(std::string(e.what()),
+              "Expected 4 fields, found 3 in CSV at offset " +
+                  std::to_string(csv.size()));
+  }
+}
+
+TEST(CsvTest, RejectsMalformedInput) {
+  auto expect_error = [](const std::string &csv, const char *what,
+                         const lite3_csv::CsvOptions &options = {}) {
+    Buffer out;
+    try {
+      lite3_csv::parse_csv(csv, out, options);
+      FAIL() << what;
+    } catch (const lite3cpp::exception &e) {
+      EXPECT_NE(std::string(e.what()).find(what), std::string::npos)
+          << e.what();
+      EXPECT_EQ(out.size(), 0u);
+    }
+  };
+  expect_error("a,b\n1\n", "Expected 2 fields, found 1 in CSV at offset 4");
+  expect_error("a\n\"open\n", "Unterminated quoted field in CSV at offset 2");
+  expect_error("a\nx\"y\n", "Quote in an unquoted field in CSV at offset 3");
+  expect_error("a\n\"x\"y\n",
+               "Unexpected character after a quoted field in CSV at offset 5");
+  expect_error("a\r1\n", "Carriage return without a newline");
+
+  lite3_csv::CsvOptions typed;
+  typed.columns = {{"n", Type::Int64}};
+  expect_error("n\n1\n1.5\n",
+               "Field of column n is not an Int64 in CSV at offset 4", typed);
+  expect_error("n\n+-5\n",
+               "Field of column n is not an Int64 in CSV at offset 2", typed);
+  typed.columns = {{"n", Type::Float64}};
+  expect_error("n\n+-1.5\n",
+               "Field of column n is not a Float64 in CSV at offset 2", typed);
+  typed.columns = {{"m", Type::Int64}};
+  expect_error("n\n1\n", "Column m is not in the header", typed);
+  typed.columns = {{"n", Type::Array}};
+  expect_error("n\n1\n", "must be a Bool, Int64, Float64 or String", typed);
+  lite3_csv::CsvOptions headless;
+  headless.header = false;
+  expect_error("1\n", "needs its columns named", headless);
+  headless.columns = {{"a"}, {"b"}, {"a"}};
+  expect_error("1,2,3\n", "Duplicate CSV column name: a", headless);
+  expect_error("id,name,id\n1,x,2\n", "Duplicate CSV column name: id");
+  expect_error("id,,name\n1,2,3\n", "Empty CSV column name");
+}
@@ -0,0 +1,143 @@
+#include "buffer.hpp"
+#include "buffer_pool.hpp"
+#include "digest.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+// Digest of the same bytes hashed from scratch.
+static uint64_t rebuilt_digest(const Buffer &buf, size_t ofs = 0) {
+  Buffer copy(std::vector<uint8_t>(buf.data(), buf.data() + buf.size()));
+  copy.enable_digests();
+  return copy.digest(ofs);
+}
+
+TEST(DigestTest, IndependentOfInsertionOrder) {
+  Buffer a, b;
+  a.init_object();
+  b.init_object();
+  a.enable_digests();
+  b.enable_digests();
+
+  std::vector<int> order(200);
+  for (int i = 0; i < 200; ++i)
+    order[i] = i;
+  for (int i : order)
+    a.set_i64(0, "k" + std::to_string(i), i);
+  std::shuffle(order.begin(), order.end(), std::mt19937(7));
+  for (int i : order)
+    b.set_i64(0, "k" + std::to_string(i), i);
+
+  ASSERT_NE(a.digest(), 0u);
+  ASSERT_EQ(a.digest(), b.digest());
+  ASSERT_TRUE(diff_digests(a, b).empty());
+
+  b.set_i64(0, "k17", -1);
+  ASSERT_NE(a.digest(), b.digest());
+  ASSERT_EQ(diff_digests(a, b), std::vector<std::string>{"/k17"});
+}
+
+TEST(DigestTest, IncrementalMatchesRebuildUnderRandomWrites) {
+  Buffer buf;
+  buf.init_object();
+  buf.enable_digests();
+  size_t users = buf.set_obj(0, "users");
+  size_t tags = buf.set_arr(0, "tags");
+  std::vector<size_t> profiles;
+
+  std::mt19937 rng(1234);
+  for (int step = 0; step < 2000; ++step) {
+    std::string key = "f" + std::to_string(rng() % 150);
+    switch (rng() % 6) {
+    case 0:
+      buf.set_i64(users, key, step);
+      break;
+    case 1:
+      buf.set_str(users, key, std::string(rng() % 20, 'x'));
+      break;
+    case 2:
+      buf.arr_append_i64(tags, step);
+      break;
+    case 3:
+      profiles.push_back(buf.set_obj(users, "p" + std::to_string(step)));
+      break;
+    case 4:
+      if (!profiles.empty())
+        buf.set_f64(profiles[rng() % profiles.size()], key, step * 0.5);
+      break;
+    case 5:
+      buf.set_bool(0, key, step & 1);
+      break;
+    }
+    if (step % 97 == 0) {
+      ASSERT_EQ(buf.digest(), rebuilt_digest(buf)) << "step " << step;
+      ASSERT_EQ(buf.digest(users), rebuilt_digest(buf, users));
+    }
+  }
+  ASSERT_EQ(buf.digest(), rebuilt_digest(buf));
+  ASSERT_EQ(buf.digest(tags), rebuilt_digest(buf, tags));
+}
+
+TEST(DigestTest, DiffDescendsIntoChangedSubtrees) {
+  Buffer a;
+  a.init_object();
+  a.enable_digests();
+  for (int i = 0; i < 50; ++i) {
+    size_t doc = a.set_obj(0, "doc" + std::to_string(i));
+    a.set_i64(doc, "version", 1);
+    a.set_str(doc, "body", "text");
+    size_t items = a.set_arr(doc, "items");
+    for (int j = 0; j < 10; ++j)
+      a.arr_append_i64(items, j);
+  }
+  Buffer b = a; // Replica with the same history and tree shape
+
+  b.set_i64(b.get_obj(0, "doc7"), "version", 2);
+  b.set_str(b.get_obj(0, "doc31"), "extra", "new");
+  size_t items = b.get_arr(b.get_obj(0, "doc42"), "items");
+  b.arr_append_i64(items, 10);
+  b.set_str(0, "a/b~c", "escaped");
+
+  std::vector<std::string> diff = diff_digests(a, b);
+  std::sort(diff.begin(), diff.end());
+  std::vector<std::string> expected = {"/a~1b~0c", "/doc31/extra",
+                                       "/doc42/items/10", "/doc7/version"};
+  ASSERT_EQ(diff, expected);
+  ASSERT_EQ(a.digest(), rebuilt_digest(a));
+  ASSERT_EQ(b.digest(), rebuilt_digest(b));
+}
+
+TEST(DigestTest, DiffAcrossDifferentTreeShapes) {
+  Buffer a, b;
+  a.init_object();
+  b.init_object();
+  a.enable_digests();
+  for (int i = 0; i < 100; ++i)
+    a.set_i64(0, "k" + std::to_string(i), i);
+  for (int i = 99; i >= 0; --i)
+    if (i != 40)
+      b.set_i64(0, "k" + std::to_string(i), i == 3 ? 300 : i);
+  b.enable_digests(); // Enabled late: built from the existing contents
+
+  std::vector<std::string> diff = diff_digests(a, b);
+  std::sort(diff.begin(), diff.end());
+  ASSERT_EQ(diff, (std::vector<std::string>{"/k3", "/k40"}));
+}
+
+TEST(DigestTest, PooledBuffersComeBackWithoutDigests) {
+  BufferPool pool(1);
+  Buffer buf = pool.acquire();
+  buf.init_object();
+  buf.enable_digests();
+  buf.set_i64(0, "a", 1);
+  pool.release(std::move(buf));
+
+  Buffer reused = pool.acquire();
+  EXPECT_EQ(reused.size(), 0u);
+  EXPECT_FALSE(reused.digests_enabled());
+  EXPECT_EQ(reused.digest_table(), nullptr);
+}
@@ -0,0 +1,490 @@
+#include "buffer.hpp"
+#include "builder.hpp"
+#include "exception.hpp"
+#include "json.hpp"
+#include "test_util.hpp"
+#include "utils/hex.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+TEST(JsonReaderTest, ScalarsAndNesting) {
+  std::string json = R"({"n":null,"t":true,"f":false,"i":-42,"d":0.5,)"
+                     R"("s":"text","o":{"a":[1,"x",[],{}],"e":{}}})";
+  Buffer buf = lite3_json::parse_json(json);
+  EXPECT_EQ(buf.get_type(0, "n"), Type::Null);
+  EXPECT_TRUE(buf.get_bool(0, "t"));
+  EXPECT_FALSE(buf.get_bool(0, "f"));
+  EXPECT_EQ(buf.get_i64(0, "i"), -42);
+  EXPECT_EQ(buf.get_f64(0, "d"), 0.5);
+  EXPECT_EQ(buf.get_str(0, "s"), "text");
+  size_t a = buf.get_arr(buf.get_obj(0, "o"), "a");
+  EXPECT_EQ(buf.arr_get_i64(a, 0), 1);
+  EXPECT_EQ(buf.arr_get_str(a, 1), "x");
+  EXPECT_EQ(buf.arr_get_type(a, 2), Type::Array);
+  EXPECT_EQ(buf.arr_get_type(a, 3), Type::Object);
+
+  // Members come back in hash order, so compare through a second parse.
+  std::string text = lite3_json::to_json_string(buf, 0);
+  Buffer again = lite3_json::parse_json(text);
+  EXPECT_EQ(lite3_json::to_json_string(again, 0), text);
+
+  Buffer arr = lite3_json::parse_json(" [1, 2.5, \"b\", null] ");
+  EXPECT_EQ(lite3_json::to_json_string(arr, 0), "[1,2.5,\"b\",null]");
+}
+
+TEST(JsonReaderTest, LargeContainersStayUsable) {
+  std::string json = "{";
+  for (int i = 0; i < 10000; ++i)
+    json += (i ? ",\"key" : "\"key") + std::to_string(i) +
+            "\":" + std::to_string(i);
+  json += ",\"list\":[";
+  for (int i = 0; i < 5000; ++i)
+    json += (i ? "," : "") + std::to_string(i * 3);
+  json += "]}";
+
+  Buffer buf = lite3_json::parse_json(json);
+  for (int i = 0; i < 10000; ++i)
+    ASSERT_EQ(buf.get_i64(0, "key" + std::to_string(i)), i) << i;
+  size_t list = buf.get_arr(0, "list");
+  for (uint32_t i = 0; i < 5000; ++i)
+    ASSERT_EQ(buf.arr_get_i64(list, i), int64_t(i) * 3);
+
+  // The bulk-built trees take ordinary inserts and splits afterwards.
+  for (int i = 0; i < 3000; ++i)
+    buf.set_i64(0, "more" + std::to_string(i), -i);
+  buf.set_i64(0, "key17", 1700);
+  for (int i = 0; i < 500; ++i)
+    buf.arr_append_i64(list, i);
+  for (int i = 0; i < 10000; ++i)
+    ASSERT_EQ(buf.get_i64(0, "key" + std::to_string(i)),
+              i == 17 ? 1700 : i);
+  for (int i = 0; i < 3000; ++i)
+    ASSERT_EQ(buf.get_i64(0, "more" + std::to_string(i)), -i);
+  ASSERT_EQ(buf.arr_get_i64(list, 5499), 499);
+
+  size_t members = 0;
+  for (auto it = buf.begin(0); it != buf.end(0); ++it)
+    ++members;
+  EXPECT_EQ(members, 13001u);
+}
+
+TEST(JsonReaderTest, DuplicateKeysKeepLastValue) {
+  Buffer buf = lite3_json::parse_json(
+      R"({"a":1,"b":2,"a":{"x":1},"c":3,"a":"last","b":4})");
+  EXPECT_EQ(buf.get_str(0, "a"), "last");
+  EXPECT_EQ(buf.get_i64(0, "b"), 4);
+  EXPECT_EQ(buf.get_i64(0, "c"), 3);
+  size_t members = 0;
+  for (auto it = buf.begin(0); it != buf.end(0); ++it)
+    ++members;
+  EXPECT_EQ(members, 3u);
+}
+
+TEST(JsonReaderTest, StringsNumbersAndHex) {
+  Buffer buf = lite3_json::parse_json(
+      R"({"esc":"q\"b\\s\/n\nt\tu\u00e9\ud83d\ude00","k\u0041":1,)"
+      R"("big":9223372036854775807,"min":-9223372036854775808,)"
+      R"("over":18446744073709551616,"exp":1e3,"neg":-0.25,"z":0,)"
+      R"("hex":"00ff10","odd":"abc","empty":""})");
+  EXPECT_EQ(buf.get_str(0, "esc"),
+            "q\"b\\s/n\nt\tu\xC3\xA9\xF0\x9F\x98\x80");
+  EXPECT_EQ(buf.get_i64(0, "kA"), 1);
+  EXPECT_EQ(buf.get_i64(0, "big"), INT64_MAX);
+  EXPECT_EQ(buf.get_i64(0, "min"), INT64_MIN);
+  EXPECT_EQ(buf.get_f64(0, "over"), 18446744073709551616.0);
+  EXPECT_EQ(buf.get_f64(0, "exp"), 1000.0);
+  EXPECT_EQ(buf.get_f64(0, "neg"), -0.25);
+  EXPECT_EQ(buf.get_i64(0, "z"), 0);
+  auto hex = buf.get_bytes(0, "hex");
+  ASSERT_EQ(hex.size(), 3u);
+  EXPECT_EQ(hex[1], std::byte{0xff});
+  EXPECT_EQ(buf.get_str(0, "odd"), "abc");
+  EXPECT_EQ(buf.get_type(0, "empty"), Type::Bytes);
+}
+
+TEST(JsonReaderTest, OutOfRangeNumbers) {
+  // Too small rounds to a signed zero; too large is rejected, as by yyjson.
+  Buffer buf = lite3_json::parse_json(
+      R"({"tiny":1e-400,"far":1e-1000000,"neg":-0.0001e-330,)"
+      R"("huge":123456789e-99999999999999999999999})");
+  EXPECT_EQ(buf.get_f64(0, "tiny"), 0.0);
+  EXPECT_FALSE(std::signbit(buf.get_f64(0, "tiny")));
+  EXPECT_EQ(buf.get_f64(0, "far"), 0.0);
+  EXPECT_EQ(buf.get_f64(0, "neg"), 0.0);
+  EXPECT_TRUE(std::signbit(buf.get_f64(0, "neg")));
+  EXPECT_EQ(buf.get_f64(0, "huge"), 0.0);
+
+  for (const char *json :
+       {"[1e400]", "1e309", "[-1e400]", "{\"a\":1.5e99999999999999999999}"}) {
+    try {
+      lite3_json::parse_json(json);
+      FAIL() << json;
+    } catch (const lite3cpp::exception &e) {
+      EXPECT_NE(std::string(e.what()).find("Number out of range at offset"),
+                std::string::npos)
+          << e.what();
+    }
+  }
+}
+
+TEST(JsonReaderTest, RejectsMalformedInput) {
+  const char *bad[] = {"",        "{",          "{\"a\"}",     "{\"a\":1,}",
+                       "[1,]",    "[01]",       "[1.]",        "[-]",
+                       "[tru]",   "{\"a\":1}x", "[\"\\x\"]",   "[\"\\ud800\"]",
+                       "[\"a\n\"]", "{1:2}",    "[1 2]",       "\"open"};
+  for (const char *json : bad)
+    EXPECT_THROW(lite3_json::parse_json(json), lite3cpp::exception) << json;
+
+  try {
+    lite3_json::parse_json("[1, 2, ?]");
+    FAIL();
+  } catch (const lite3cpp::exception &e) {
+    EXPECT_NE(std::string(e.what()).find("offset 7"), std::string::npos);
+  }
+
+  std::string deep(1000, '[');
+  deep += std::string(1000, ']');
+  EXPECT_THROW(lite3_json::parse_json(deep), lite3cpp::exception);
+
+  // A scalar document is valid JSON but has no container to live in.
+  EXPECT_EQ(lite3_json::parse_json(" 12 ").size(), 0u);
+}
+
+TEST(BuilderTest, KeepsDigestsAndReusesBuffer) {
+  Buffer buf;
+  buf.init_object();
+  buf.enable_digests();
+  Builder b(buf);
+  b.begin_object();
+  for (int i = 0; i < 200; ++i) {
+    b.key("k" + std::to_string(i));
+    b.add_i64(i);
+  }
+  b.key("nested");
+  b.begin_array();
+  b.add_str("v");
+  b.begin_object();
+  b.end();
+  b.end();
+  b.end();
+  EXPECT_EQ(b.depth(), 0u);
+  EXPECT_THROW(b.add_null(), lite3cpp::exception);
+  EXPECT_THROW(b.begin_object(), lite3cpp::exception);
+
+  ASSERT_TRUE(buf.digests_enabled());
+  EXPECT_EQ(buf.digest(), content_digest(buf));
+  buf.set_i64(0, "k5", 50);
+  EXPECT_EQ(buf.digest(), content_digest(buf));
+  EXPECT_EQ(buf.arr_get_str(buf.get_arr(0, "nested"), 0), "v");
+
+  Builder again(buf);
+  again.begin_array();
+  EXPECT_THROW(again.key("x"), lite3cpp::exception);
+  again.add_bool(true);
+  again.end();
+  EXPECT_TRUE(buf.arr_get_bool(0, 0));
+}
+
+TEST(JsonReaderTest, BytesEncodingPolicies) {
+  std::string json = R"({"plain":"cafe","marked":"hex:cafe","b64":"b64:AQID/w==",)"
+                     R"("unpadded":"b64:AQI","bad":"hex:xyz1","text":"words"})";
+
+  Buffer heuristic = lite3_json::parse_json(json);
+  EXPECT_EQ(heuristic.get_type(0, "plain"), Type::Bytes);
+  EXPECT_EQ(heuristic.get_type(0, "marked"), Type::String);
+
+  lite3_json::ImportPolicy none{lite3_json::BytesEncoding::None};
+  Buffer strings = lite3_json::parse_json(json, none);
+  EXPECT_EQ(strings.get_str(0, "plain"), "cafe");
+  EXPECT_EQ(strings.get_str(0, "b64"), "b64:AQID/w==");
+
+  lite3_json::ImportPolicy prefixed{lite3_json::BytesEncoding::Prefixed};
+  Buffer buf = lite3_json::parse_json(json, prefixed);
+  EXPECT_EQ(buf.get_str(0, "plain"), "cafe");
+  auto marked = buf.get_bytes(0, "marked");
+  ASSERT_EQ(marked.size(), 2u);
+  EXPECT_EQ(marked[0], std::byte{0xca});
+  auto b64 = buf.get_bytes(0, "b64");
+  ASSERT_EQ(b64.size(), 4u);
+  EXPECT_EQ(b64[3], std::byte{0xff});
+  EXPECT_EQ(buf.get_bytes(0, "unpadded").size(), 2u);
+  EXPECT_EQ(buf.get_str(0, "bad"), "hex:xyz1");
+  EXPECT_EQ(buf.get_str(0, "text"), "words");
+}
+
+TEST(JsonReaderTest, HexAndBase64Codecs) {
+  // Long enough to take the vector path, with every digit in both cases.
+  std::string hex = "0123456789abcdefABCDEF00ff7f80" "0123456789abcdef";
+  std::vector<std::byte> out(hex.size() / 2);
+  ASSERT_TRUE(utils::hex_decode(hex, out.data()));
+  EXPECT_EQ(out[0], std::byte{0x01});
+  EXPECT_EQ(out[5], std::byte{0xab});
+  EXPECT_EQ(out[9], std::byte{0xcd});
+  EXPECT_EQ(out[13], std::byte{0x7f});
+  EXPECT_EQ(out[14], std::byte{0x80});
+  EXPECT_EQ(utils::hex_decode(hex), out);
+  for (size_t i = 0; i < hex.size(); ++i) {
+    for (char c : {'g', 'G', '/', ':', '@', '`', ' ', '\xe0'}) {
+      std::string bad = hex;
+      bad[i] = c;
+      ASSERT_FALSE(utils::hex_decode(bad, out.data())) << i << c;
+    }
+  }
+  EXPECT_FALSE(utils::hex_decode("abc", out.data()));
+  EXPECT_THROW(utils::hex_decode("0g"), std::runtime_error);
+
+  std::vector<std::byte> b(utils::base64_decoded_max(12));
+  ASSERT_EQ(utils::base64_decode("TWFueSBoYW5k", b.data()), 9u);
+  EXPECT_EQ(std::string(reinterpret_cast<const char *>(b.data()), 9),
+            "Many hand");
+  EXPECT_EQ(utils::base64_decode("TWE=", b.data()), 2u);
+  EXPECT_EQ(utils::base64_decode("TQ==", b.data()), 1u);
+  EXPECT_EQ(utils::base64_decode("", b.data()), 0u);
+  EXPECT_EQ(utils::base64_decode("TQ=", b.data()), SIZE_MAX);
+  EXPECT_EQ(utils::base64_decode("T", b.data()), SIZE_MAX);
+  EXPECT_EQ(utils::base64_decode("TW-=", b.data()), SIZE_MAX);
+
+  // Encoders round-trip through the decoders at every tail length.
+  for (size_t n = 0; n < 70; ++n) {
+    std::vector<std::byte> in(n);
+    for (size_t i = 0; i < n; ++i)
+      in[i] = static_cast<std::byte>(i * 101 + 7);
+    std::string h(2 * n, '?');
+    utils::hex_encode(in.data(), n, h.data());
+    ASSERT_EQ(h.find_first_not_of("0123456789abcdef"), std::string::npos);
+    ASSERT_EQ(utils::hex_decode(h), in);
+    std::string e(utils::base64_encoded_size(n), '?');
+    utils::base64_encode(in.data(), n, e.data());
+    std::vector<std::byte> back(utils::base64_decoded_max(e.size()));
+    ASSERT_EQ(utils::base64_decode(e, back.data()), n);
+    back.resize(n);
+    ASSERT_EQ(back, in);
+  }
+}
+
+TEST(JsonReaderTest, ParallelArraysMatchSerial) {
+  std::string json = " [";
+  for (int i = 0; i < 3000; ++i) {
+    if (i)
+      json += i % 7 ? "," : " ,\n";
+    switch (i % 5) {
+    case 0:
+      json += "{\"id\":" + std::to_string(i) + ",\"s\":\"a,]\\\"[" +
+              std::to_string(i) + "\",\"tags\":[1,[2,{\"x\":{}}]]}";
+      break;
+    case 1:
+      json += "[" + std::to_string(i) + ",\"beef\",null]";
+      break;
+    case 2:
+      json += "\"str" + std::to_string(i) + "\"";
+      break;
+    case 3:
+      json += std::to_string(i) + ".5";
+      break;
+    default:
+      json += "{}";
+    }
+  }
+  json += "] ";
+
+  lite3_json::ParallelOptions options;
+  options.threads = 4;
+  options.min_chunk = 256;
+  Buffer serial = lite3_json::parse_json(json);
+  Buffer parallel = lite3_json::parse_json_parallel(json, options);
+  EXPECT_EQ(content_digest(parallel), content_digest(serial));
+  EXPECT_EQ(lite3_json::to_json_string(parallel, 0),
+            lite3_json::to_json_string(serial, 0));
+  for (uint32_t i = 0; i < 3000; i += 5)
+    ASSERT_EQ(parallel.get_i64(parallel.arr_get_obj(0, i), "id"), i);
+  size_t tags = parallel.get_arr(parallel.arr_get_obj(0, 2995), "tags");
+  EXPECT_EQ(parallel.arr_get_i64(tags, 0), 1);
+
+  // The spliced document takes ordinary edits.
+  parallel.arr_append_i64(0, 7);
+  parallel.set_str(parallel.arr_get_obj(0, 10), "more", "x");
+  EXPECT_EQ(parallel.arr_get_i64(0, 3000), 7);
+  EXPECT_EQ(parallel.get_str(parallel.arr_get_obj(0, 10), "more"), "x");
+
+  // Objects, small arrays and scalars take the serial path.
+  EXPECT_EQ(lite3_json::to_json_string(
+                lite3_json::parse_json_parallel("{\"a\":[1]}", options), 0),
+            "{\"a\":[1]}");
+  EXPECT_EQ(lite3_json::parse_json_parallel(" 1 ", options).size(), 0u);
+}
+
+TEST(JsonReaderTest, ParallelErrorsNameTheOffset) {
+  std::string json = "[";
+  for (int i = 0; i < 2000; ++i)
+    json += (i ? "," : "") + std::to_string(i);
+  std::string late = json + ",?]";
+  size_t bad = json.size() + 1;
+  lite3_json::ParallelOptions options;
+  options.threads = 3;
+  options.min_chunk = 64;
+  try {
+    lite3_json::parse_json_parallel(late, options);
+    FAIL();
+  } catch (const lite3cpp::exception &e) {
+    EXPECT_NE(std::string(e.what()).find("offset " + std::to_string(bad)),
+              std::string::npos)
+        << e.what();
+  }
+  // Broken structure found by the scan is reported by the serial parser.
+  EXPECT_THROW(lite3_json::parse_json_parallel(json + "}", options),
+               lite3cpp::exception);
+  EXPECT_THROW(lite3_json::parse_json_parallel(json + ",]", options),
+               lite3cpp::exception);
+  EXPECT_THROW(lite3_json::parse_json_parallel(json, options),
+               lite3cpp::exception);
+}
+
+static std::atomic<bool> count_allocations{false};
+static std::atomic<size_t> allocations{0};
+
+// Counts heap allocations while enabled. GCC sees these paired with
+// inlined library code and warns of a mismatch that cannot happen.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void *operator new(size_t size) {
+  if (count_allocations.load(std::memory_order_relaxed))
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+TEST(JsonReaderTest, ParseIntoReusesEverything) {
+  std::vector<std::string> frames;
+  for (int i = 0; i < 20; ++i)
+    frames.push_back("{\"id\":" + std::to_string(i) + ",\"k\":\"v\\n" +
+                     std::string(i, 'x') + "\",\"b\":\"00ff\",\"a\":[1,{\"n\":" +
+                     std::to_string(i * 2) + "}]}");
+  Buffer doc;
+  lite3_json::Parser parser;
+  // Warm up to the largest frame, then steady state must not allocate.
+  for (const std::string &f : frames) {
+    parser.parse_into(f, doc);
+    lite3_json::parse_json_into(f, doc);
+  }
+  allocations = 0;
+  count_allocations = true;
+  int64_t sum = 0;
+  for (int round = 0; round < 3; ++round)
+    for (const std::string &f : frames) {
+      parser.parse_into(std::span<const char>(f.data(), f.size()), doc);
+      sum += doc.get_i64(0, "id");
+      lite3_json::parse_json_into(f, doc);
+      sum += doc.get_i64(doc.arr_get_obj(doc.get_arr(0, "a"), 1), "n");
+    }
+  count_allocations = false;
+  EXPECT_EQ(allocations.load(), 0u);
+  EXPECT_EQ(sum, 3 * (190 + 380));
+  EXPECT_EQ(doc.get_str(0, "k"), "v\n" + std::string(19, 'x'));
+
+  // A failed parse leaves the parser usable and the buffer empty.
+  EXPECT_THROW(parser.parse_into(std::string_view("{\"a\":[1,"), doc),
+               lite3cpp::exception);
+  EXPECT_EQ(doc.size(), 0u);
+  parser.parse_into(frames[3], doc);
+  EXPECT_EQ(doc.get_i64(0, "id"), 3);
+
+  lite3_json::Parser plain(
+      lite3_json::ImportPolicy{lite3_json::BytesEncoding::None});
+  plain.parse_into(frames[0], doc);
+  EXPECT_EQ(doc.get_str(0, "b"), "00ff");
+}
+
+TEST(JsonReaderTest, SchemaProjection) {
+  std::string json =
+      R"({"skip":{"deep":[{"x":"}]"},[[["\"{"]]]]},"id":"17","user":)"
+      R"({"name":"ann","age":3.0,"extra":[1,2]},"items":[{"id":1,"p":"9.5"},)"
+      R"({"id":2,"q":true},7],"raw":"00ff","n":null,"a~b":{"c/d":12}})";
+  lite3_json::Schema schema;
+  schema.field("/id", lite3_json::FieldType::Int64)
+      .field("/user/name")
+      .field("/user/age", lite3_json::FieldType::Int64)
+      .field("/items/p", lite3_json::FieldType::Float64)
+      .field("/items/id", lite3_json::FieldType::String)
+      .field("/raw", lite3_json::FieldType::Bytes)
+      .field("/n", lite3_json::FieldType::Bool)
+      .field("/a~0b/c~1d", lite3_json::FieldType::Float64)
+      .field("/missing");
+  Buffer buf = lite3_json::parse_json_projected(json, schema);
+
+  EXPECT_EQ(buf.get_i64(0, "id"), 17);
+  size_t user = buf.get_obj(0, "user");
+  EXPECT_EQ(buf.get_str(user, "name"), "ann");
+  EXPECT_EQ(buf.get_i64(user, "age"), 3);
+  size_t members = 0;
+  for (auto it = buf.begin(0); it != buf.end(0); ++it)
+    ++members;
+  EXPECT_EQ(members, 6u); // No "skip" or "missing"
+  size_t items = buf.get_arr(0, "items");
+  size_t first = buf.arr_get_obj(items, 0);
+  EXPECT_EQ(buf.get_str(first, "id"), "1");
+  EXPECT_EQ(buf.get_f64(first, "p"), 9.5);
+  size_t second = buf.arr_get_obj(items, 1);
+  EXPECT_EQ(buf.get_str(second, "id"), "2");
+  EXPECT_EQ(buf.arr_get_i64(items, 2), 7);
+  EXPECT_EQ(buf.get_bytes(0, "raw").size(), 2u);
+  EXPECT_EQ(buf.get_type(0, "n"), Type::Null);
+  EXPECT_EQ(buf.get_f64(buf.get_obj(0, "a~b"), "c/d"), 12.0);
+
+  // Keys stored with the precomputed hashes are found by ordinary lookups,
+  // and the projection matches a full parse pruned by hand.
+  std::string pruned = R"({"id":17,"user":{"name":"ann","age":3},)"
+                       R"("items":[{"id":"1","p":9.5},{"id":"2"},7],)"
+                       R"("raw":"00ff","n":null,"a~b":{"c/d":12.0}})";
+  EXPECT_EQ(content_digest(buf),
+            content_digest(lite3_json::parse_json(pruned)));
+
+  // "" selects the whole document.
+  lite3_json::Schema all;
+  all.field("");
+  EXPECT_EQ(content_digest(lite3_json::parse_json_projected(json, all)),
+            content_digest(lite3_json::parse_json(json)));
+}
+
+TEST(JsonReaderTest, SchemaMismatchesNameTheField) {
+  lite3_json::Schema schema;
+  schema.field("/o/v", lite3_json::FieldType::Int64);
+  std::string json = R"({"o":{"v":1.5}})";
+  try {
+    lite3_json::parse_json_projected(json, schema);
+    FAIL();
+  } catch (const lite3cpp::exception &e) {
+    EXPECT_NE(std::string(e.what()).find("/o/v is not an Int64 at offset 10"),
+              std::string::npos)
+        << e.what();
+  }
+  EXPECT_THROW(lite3_json::parse_json_projected(R"({"o":{"v":"x"}})", schema),
+               lite3cpp::exception);
+  EXPECT_THROW(lite3_json::parse_json_projected(R"({"o":{"v":true}})", schema),
+               lite3cpp::exception);
+
+  // Skipped subtrees must still be well formed.
+  EXPECT_THROW(lite3_json::parse_json_projected(R"({"s":[1,{"x":"},"o":{}})",
+                                                schema),
+               lite3cpp::exception);
+  EXPECT_THROW(lite3_json::parse_json_projected(R"({"s":[1,2})", schema),
+               lite3cpp::exception);
+
+  lite3_json::Schema bad;
+  EXPECT_THROW(bad.field("id"), lite3cpp::exception);
+  EXPECT_THROW(bad.field("/a~2"), lite3cpp::exception);
+}
@@ -0,0 +1,283 @@
+#include "buffer.hpp"
+#include "json.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+// Byte-at-a-time reference for string escaping.
+static std::string reference_escape(std::string_view s) {
+  static const char hex[] = "0123456789abcdef";
+  std::string out = "\"";
+  for (unsigned char c : s) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    case '\b':
+      out += "\\b";
+      break;
+    case '\f':
+      out += "\\f";
+      break;
+    default:
+      if (c < 0x20) {
+        out += "\\u00";
+        out += hex[c >> 4];
+        out += hex[c & 15];
+      } else {
+        out += static_cast<char>(c);
+      }
+    }
+  }
+  return out + "\"";
+}
+
+TEST(JsonWriterTest, ScalarsAndNesting) {
+  Buffer buf;
+  buf.init_object();
+  buf.set_null(0, "n");
+  buf.set_bool(0, "t", true);
+  buf.set_i64(0, "i", -9223372036854775807LL - 1);
+  size_t obj = buf.set_obj(0, "o");
+  buf.set_f64(obj, "half", 0.5);
+  size_t arr = buf.set_arr(obj, "a");
+  buf.arr_append_i64(arr, 1);
+  buf.arr_append_str(arr, "two");
+  buf.arr_append_bool(arr, false);
+  buf.arr_append_obj(arr);
+
+  // Objects come out in B-tree order, so compare member by member.
+  std::string json = lite3_json::to_json_string(buf, 0);
+  EXPECT_EQ(json.front(), '{');
+  EXPECT_NE(json.find(R"("n":null)"), std::string::npos);
+  EXPECT_NE(json.find(R"("t":true)"), std::string::npos);
+  EXPECT_NE(json.find(R"("i":-9223372036854775808)"), std::string::npos);
+  EXPECT_NE(json.find(R"("a":[1,"two",false,{}])"), std::string::npos);
+  EXPECT_NE(json.find(R"("half":0.5)"), std::string::npos);
+
+  // A nested value, addressed by its type-byte offset.
+  for (auto it = buf.begin(obj); it != buf.end(obj); ++it) {
+    if (it->key == "a") {
+      EXPECT_EQ(lite3_json::to_json_string(buf, it->value_offset),
+                R"([1,"two",false,{}])");
+    }
+  }
+}
+
+TEST(JsonWriterTest, RootArray) {
+  Buffer buf;
+  buf.init_array();
+  for (int i = 0; i < 100; ++i)
+    buf.arr_append_i64(0, i);
+  std::string expected = "[";
+  for (int i = 0; i < 100; ++i)
+    expected += (i ? "," : "") + std::to_string(i);
+  expected += "]";
+  EXPECT_EQ(lite3_json::to_json_string(buf, 0), expected);
+
+  Buffer empty;
+  EXPECT_EQ(lite3_json::to_json_string(empty, 0), "null");
+}
+
+TEST(JsonWriterTest, StringEscaping) {
+  Buffer buf;
+  buf.init_array();
+  std::vector<std::string> inputs = {"", "plain", "quote\"", "back\\slash",
+                                     "tab\tnew\nline", std::string("\0x\x1f", 3),
+                                     "caf\xc3\xa9 /slash"};
+  // Escapes at every position around the 16-byte blocks.
+  for (size_t len : {15, 16, 17, 31, 32, 33, 70})
+    for (size_t at = 0; at < len; at += 5) {
+      std::string s(len, 'a');
+      s[at] = "\"\\\n\x01"[at % 4];
+      inputs.push_back(s);
+    }
+  std::string expected = "[";
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    buf.arr_append_str(0, inputs[i]);
+    expected += (i ? "," : "") + reference_escape(inputs[i]);
+  }
+  expected += "]";
+  EXPECT_EQ(lite3_json::to_json_string(buf, 0), expected);
+}
+
+TEST(JsonWriterTest, NumbersRoundTrip) {
+  Buffer buf;
+  buf.init_array();
+  std::vector<double> values = {0.0, -0.0, 1.0, 0.1, 1e21, 1e-7, 3.141592653589793,
+                                -2.5e-308, 123456789.125};
+  for (double v : values)
+    buf.arr_append_f64(0, v);
+  buf.arr_append_f64(0, std::numeric_limits<double>::infinity());
+  buf.arr_append_bytes(0, std::vector<std::byte>{std::byte{0x00}, std::byte{0xab}});
+
+  std::string json = lite3_json::to_json_string(buf, 0);
+  ASSERT_EQ(json.front(), '[');
+  const char *p = json.c_str() + 1;
+  for (double v : values) {
+    char *end;
+    double back = std::strtod(p, &end);
+    std::string token(p, static_cast<size_t>(end - p));
+    EXPECT_EQ(back, v) << token;
+    EXPECT_TRUE(token.find_first_of(".e") != std::string::npos) << token;
+    p = end + 1;
+  }
+  EXPECT_EQ(std::string(p), "null,\"00ab\"]");
+}
+
+TEST(JsonWriterTest, SinkReceivesSameTextInChunks) {
+  Buffer buf;
+  buf.init_object();
+  for (int i = 0; i < 2000; ++i)
+    buf.set_str(0, "key" + std::to_string(i), std::string(i % 50, 'v'));
+  std::string whole;
+  lite3_json::write_json(buf, 0, whole);
+
+  std::string joined;
+  size_t chunks = 0;
+  lite3_json::write_json(
+      buf, 0,
+      [&](std::string_view chunk) {
+        joined += chunk;
+        ++chunks;
+      },
+      4096);
+  EXPECT_EQ(joined, whole);
+  EXPECT_GT(chunks, whole.size() / 8192);
+
+  // write_json appends, so one string can collect several documents.
+  std::string two = "x";
+  lite3_json::write_json(buf, 0, two);
+  EXPECT_EQ(two, "x" + whole);
+}
+
+TEST(JsonWriterTest, BytesAsHexOrBase64) {
+  Buffer buf;
+  buf.init_object();
+  std::vector<std::vector<std::byte>> blobs;
+  for (size_t n : {0, 1, 2, 3, 15, 16, 17, 47, 4096}) {
+    std::vector<std::byte> blob(n);
+    for (size_t i = 0; i < n; ++i)
+      blob[i] = static_cast<std::byte>(i * 37 + n);
+    buf.set_bytes(0, "b" + std::to_string(n), blob);
+    blobs.push_back(std::move(blob));
+  }
+
+  std::string hex;
+  lite3_json::write_json(buf, 0, hex);
+  Buffer from_hex = lite3_json::parse_json(hex);
+  lite3_json::WriteOptions b64_opts{lite3_json::BytesEncoding::Prefixed};
+  std::string b64;
+  lite3_json::write_json(buf, 0, b64, b64_opts);
+  EXPECT_LT(b64.size(), hex.size());
+  Buffer from_b64 = lite3_json::parse_json(
+      b64, lite3_json::ImportPolicy{lite3_json::BytesEncoding::Prefixed});
+
+  for (const auto &blob : blobs) {
+    std::string key = "b" + std::to_string(blob.size());
+    auto a = from_hex.get_bytes(0, key);
+    auto b = from_b64.get_bytes(0, key);
+    EXPECT_TRUE(std::equal(a.begin(), a.end(), blob.begin(), blob.end()))
+        << key;
+    EXPECT_TRUE(std::equal(b.begin(), b.end(), blob.begin(), blob.end()))
+        << key;
+  }
+
+  Buffer small;
+  small.init_array();
+  small.arr_append_bytes(0, std::vector<std::byte>{std::byte{'M'}, std::byte{'a'}});
+  std::string text;
+  lite3_json::write_json(small, 0, text, b64_opts);
+  EXPECT_EQ(text, "[\"b64:TWE=\"]");
+}
+
+TEST(JsonWriterTest, SinksStayWithinTheirChunk) {
+  Buffer buf;
+  buf.init_object();
+  for (int i = 0; i < 500; ++i)
+    buf.set_i64(0, "k" + std::to_string(i), i);
+  std::string big(1 << 20, 's');
+  buf.set_str(0, "big", big);
+  buf.set_bytes(0, "blob", std::vector<std::byte>(300000, std::byte{0x5a}));
+  for (auto encoding : {lite3_json::BytesEncoding::Hex,
+                        lite3_json::BytesEncoding::Prefixed}) {
+    lite3_json::WriteOptions options{encoding};
+    std::string whole;
+    lite3_json::write_json(buf, 0, whole, options);
+
+    // Only the long string comes through as one piece, uncopied.
+    std::string joined;
+    size_t oversized = 0;
+    lite3_json::write_json(
+        buf, 0,
+        [&](std::string_view piece) {
+          joined += piece;
+          if (piece.size() > 4096 + 256) {
+            ++oversized;
+            EXPECT_EQ(piece.data(), buf.get_str(0, "big").data());
+          }
+        },
+        4096, options);
+    EXPECT_EQ(joined, whole);
+    EXPECT_EQ(oversized, 1u);
+
+    std::ostringstream stream;
+    lite3_json::StreamSink stream_sink(stream);
+    lite3_json::write_json(buf, 0, stream_sink, 1000, options);
+    EXPECT_EQ(stream.str(), whole);
+
+    std::FILE *file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    lite3_json::FdSink fd_sink(fileno(file));
+    lite3_json::write_json(buf, 0, fd_sink, 8192, options);
+    std::string back(whole.size() + 1, '\0');
+    std::rewind(file);
+    back.resize(std::fread(back.data(), 1, back.size(), file));
+    std::fclose(file);
+    EXPECT_EQ(back, whole);
+  }
+}
+
+TEST(JsonWriterTest, PrettyPrinting) {
+  Buffer buf = lite3_json::parse_json(
+      R"({"a":[1,{"b":null},[]],"c":{},"d":"x"})");
+  lite3_json::WriteOptions options;
+  options.indent = 2;
+  std::string pretty;
+  lite3_json::write_json(buf, 0, pretty, options);
+  // Member order follows the key hashes, so compare after a re-parse and
+  // check the layout of one nested container.
+  EXPECT_EQ(lite3_json::to_json_string(lite3_json::parse_json(pretty), 0),
+            lite3_json::to_json_string(buf, 0));
+  EXPECT_NE(pretty.find("\"a\": [\n    1,\n    {\n      \"b\": null\n    },"
+                        "\n    []\n  ]"),
+            std::string::npos)
+      << pretty;
+  EXPECT_NE(pretty.find("\"c\": {}"), std::string::npos);
+  EXPECT_EQ(pretty.back(), '}');
+
+  std::string streamed;
+  lite3_json::write_json(
+      buf, 0, [&](std::string_view piece) { streamed += piece; }, 16,
+      options);
+  EXPECT_EQ(streamed, pretty);
+}
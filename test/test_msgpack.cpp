@@ -0,0 +1,154 @@
+#include "buffer.hpp"
+#include "exception.hpp"
+#include "json.hpp"
+#include "msgpack.hpp"
+#include "test_util.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+TEST(MsgpackTest, DecodesKnownEncodings) {
+  // {"compact":true,"schema":0} from the MessagePack home page, then every
+  // scalar form in an array.
+  std::vector<uint8_t> map = {0x82, 0xa7, 'c', 'o', 'm', 'p', 'a', 'c', 't',
+                              0xc3, 0xa6, 's', 'c', 'h', 'e', 'm', 'a', 0x00};
+  Buffer buf = lite3_msgpack::parse_msgpack(map);
+  EXPECT_TRUE(buf.get_bool(0, "compact"));
+  EXPECT_EQ(buf.get_i64(0, "schema"), 0);
+
+  std::vector<uint8_t> arr = {
+      0xdc, 0x00, 0x0c,                               // array16, 12
+      0xc0, 0xc2,                                     // nil, false
+      0xe0,                                           // -32
+      0xcc, 0xff,                                     // uint8 255
+      0xd1, 0x80, 0x00,                               // int16 -32768
+      0xcf, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // INT64_MAX
+      0xca, 0x3f, 0xc0, 0x00, 0x00,                   // float32 1.5
+      0xcb, 0x40, 0x09, 0x21, 0xfb, 0x54, 0x44, 0x2d, 0x18, // pi
+      0xd9, 0x02, 'h', 'i',                           // str8
+      0xc4, 0x03, 0x00, 0x01, 0xff,                   // bin8
+      0x90,                                           // []
+      0x80};                                          // {}
+  buf = lite3_msgpack::parse_msgpack(arr);
+  EXPECT_EQ(buf.arr_get_type(0, 0), Type::Null);
+  EXPECT_FALSE(buf.arr_get_bool(0, 1));
+  EXPECT_EQ(buf.arr_get_i64(0, 2), -32);
+  EXPECT_EQ(buf.arr_get_i64(0, 3), 255);
+  EXPECT_EQ(buf.arr_get_i64(0, 4), -32768);
+  EXPECT_EQ(buf.arr_get_i64(0, 5), INT64_MAX);
+  EXPECT_EQ(buf.arr_get_f64(0, 6), 1.5);
+  EXPECT_EQ(buf.arr_get_f64(0, 7), 3.141592653589793);
+  EXPECT_EQ(buf.arr_get_str(0, 8), "hi");
+  auto bytes = buf.arr_get_bytes(0, 9);
+  ASSERT_EQ(bytes.size(), 3u);
+  EXPECT_EQ(bytes[2], std::byte{0xff});
+  EXPECT_EQ(buf.arr_get_type(0, 10), Type::Array);
+  EXPECT_EQ(buf.arr_get_type(0, 11), Type::Object);
+}
+
+TEST(MsgpackTest, RoundTripsWithShortestForms) {
+  Buffer buf;
+  buf.init_object();
+  size_t ints = buf.set_arr(0, "ints");
+  for (int64_t v : {int64_t(0), int64_t(127), int64_t(128), int64_t(-32),
+                    int64_t(-33), int64_t(-129), int64_t(65535),
+                    int64_t(65536), int64_t(-2147483649LL), INT64_MIN,
+                    INT64_MAX})
+    buf.arr_append_i64(ints, v);
+  for (size_t len : {31u, 32u, 255u, 256u, 70000u})
+    buf.set_str(0, "s" + std::to_string(len), std::string(len, 'x'));
+  std::vector<std::byte> blob(300, std::byte{7});
+  buf.set_bytes(0, "blob", blob);
+  buf.set_f64(0, "f", -0.25);
+  buf.set_null(0, "n");
+  size_t wide = buf.set_obj(0, "wide");
+  for (int i = 0; i < 40; ++i)
+    buf.set_i64(wide, "k" + std::to_string(i), i);
+
+  std::vector<uint8_t> packed = lite3_msgpack::to_msgpack(buf);
+  Buffer back = lite3_msgpack::parse_msgpack(packed);
+  EXPECT_EQ(content_digest(back), content_digest(buf));
+
+  // Shortest forms: {"ints":[0,127,128,...]} starts fixarray, fixint,
+  // fixint, uint8.
+  std::vector<uint8_t> arr = lite3_msgpack::to_msgpack(
+      buf, static_cast<size_t>(buf.get_arr(0, "ints")) - 1);
+  std::vector<uint8_t> head = {0x9b, 0x00, 0x7f, 0xcc, 0x80, 0xe0, 0xd0, 0xdf};
+  ASSERT_GE(arr.size(), head.size());
+  EXPECT_TRUE(std::equal(head.begin(), head.end(), arr.begin()));
+
+  // A span of the exact size works; one byte less throws.
+  std::vector<uint8_t> out(packed.size());
+  EXPECT_EQ(lite3_msgpack::write_msgpack(buf, 0, std::span<uint8_t>(out)),
+            packed.size());
+  EXPECT_EQ(out, packed);
+  EXPECT_THROW(lite3_msgpack::write_msgpack(
+                   buf, 0, std::span<uint8_t>(out.data(), out.size() - 1)),
+               lite3cpp::exception);
+
+  // Agrees with the JSON path on an ordinary document.
+  Buffer json = lite3_json::parse_json(
+      R"({"id":7,"tags":["a","b"],"geo":{"lat":1.25,"lon":-3.5},"ok":true})");
+  EXPECT_EQ(content_digest(
+                lite3_msgpack::parse_msgpack(lite3_msgpack::to_msgpack(json))),
+            content_digest(json));
+}
+
+TEST(MsgpackTest, ReadsConcatenatedStream) {
+  std::vector<uint8_t> stream;
+  for (int i = 0; i < 50; ++i) {
+    Buffer doc;
+    doc.init_object();
+    doc.set_i64(0, "seq", i);
+    doc.set_str(0, "pad", std::string(i, 'p'));
+    lite3_msgpack::write_msgpack(doc, 0, stream);
+  }
+  // Feed the stream in odd-sized pieces; a value split across pieces is
+  // retried once more bytes arrive.
+  std::vector<uint8_t> pending;
+  Buffer out;
+  int seen = 0;
+  for (size_t pos = 0; pos < stream.size(); pos += 37) {
+    size_t n = std::min<size_t>(37, stream.size() - pos);
+    pending.insert(pending.end(), stream.begin() + pos,
+                   stream.begin() + pos + n);
+    while (size_t used = lite3_msgpack::read_msgpack(pending, out)) {
+      EXPECT_EQ(out.get_i64(0, "seq"), seen);
+      ++seen;
+      pending.erase(pending.begin(), pending.begin() + used);
+    }
+  }
+  EXPECT_EQ(seen, 50);
+  EXPECT_TRUE(pending.empty());
+}
+
+TEST(MsgpackTest, RejectsMalformedInput) {
+  auto expect_error = [](std::vector<uint8_t> data, const char *what) {
+    Buffer out;
+    try {
+      lite3_msgpack::parse_msgpack(data, out);
+      FAIL() << what;
+    } catch (const lite3cpp::exception &e) {
+      EXPECT_NE(std::string(e.what()).find(what), std::string::npos)
+          << e.what();
+      EXPECT_EQ(out.size(), 0u);
+    }
+  };
+  expect_error({0x92, 0x01}, "Truncated MessagePack at offset 2");
+  expect_error({0x91, 0xc1}, "Invalid byte in MessagePack at offset 1");
+  expect_error({0x81, 0x01, 0x02}, "Map key is not a string");
+  expect_error({0x91, 0xd4, 0x01, 0x00}, "Unsupported ext type");
+  expect_error({0x91, 0xcf, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+               "Integer out of Int64 range in MessagePack at offset 1");
+  expect_error({0x90, 0x90}, "Trailing bytes after MessagePack at offset 1");
+  std::vector<uint8_t> deep(600, 0x91);
+  deep.push_back(0x90);
+  expect_error(deep, "Nesting too deep");
+
+  // A scalar root reads through to an empty buffer.
+  Buffer scalar = lite3_msgpack::parse_msgpack(std::vector<uint8_t>{0x2a});
+  EXPECT_EQ(scalar.size(), 0u);
+}
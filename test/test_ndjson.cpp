@@ -0,0 +1,127 @@
+#include "buffer.hpp"
+#include "exception.hpp"
+#include "ndjson.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+static std::string make_ndjson(int records) {
+  std::string text;
+  for (int i = 0; i < records; ++i) {
+    text += "{\"id\":" + std::to_string(i) + ",\"name\":\"n" +
+            std::to_string(i) + "\",\"tags\":[" + std::to_string(i % 3) +
+            "]}";
+    text += i % 10 == 0 ? "\r\n\n" : "\n";
+  }
+  return text;
+}
+
+TEST(NdjsonTest, OrderedDeliveryMatchesInput) {
+  std::string text = make_ndjson(2000);
+  lite3_json::IngestOptions options;
+  options.threads = 4;
+  options.chunk_size = 512;
+
+  std::vector<int64_t> ids;
+  std::vector<uint64_t> offsets;
+  auto stats = lite3_json::ingest_ndjson(
+      std::string_view(text),
+      [&](uint64_t offset, Buffer &doc) {
+        ids.push_back(doc.get_i64(0, "id"));
+        offsets.push_back(offset);
+      },
+      options);
+  EXPECT_EQ(stats.records, 2000u);
+  EXPECT_EQ(stats.bytes, text.size());
+  ASSERT_EQ(ids.size(), 2000u);
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_EQ(ids[i], i);
+    std::string prefix = "{\"id\":" + std::to_string(i) + ",";
+    ASSERT_EQ(text.compare(offsets[i], prefix.size(), prefix), 0);
+  }
+}
+
+TEST(NdjsonTest, UnorderedDeliversEveryRecord) {
+  std::string text = make_ndjson(3000);
+  lite3_json::IngestOptions options;
+  options.threads = 3;
+  options.chunk_size = 1000;
+  options.ordered = false;
+
+  std::mutex mutex;
+  std::vector<int64_t> ids;
+  lite3_json::ingest_ndjson(
+      std::string_view(text),
+      [&](uint64_t, Buffer &doc) {
+        int64_t id = doc.get_i64(0, "id");
+        std::lock_guard<std::mutex> lock(mutex);
+        ids.push_back(id);
+      },
+      options);
+  std::sort(ids.begin(), ids.end());
+  ASSERT_EQ(ids.size(), 3000u);
+  for (int i = 0; i < 3000; ++i)
+    ASSERT_EQ(ids[i], i);
+}
+
+TEST(NdjsonTest, ReadsFromFileDescriptor) {
+  // Lines longer than a chunk are carried over whole.
+  std::string text = make_ndjson(500) + "{\"long\":\"" + std::string(5000, 'x') +
+                     "\"}\n{\"id\":500}";
+  std::FILE *file = std::tmpfile();
+  ASSERT_NE(file, nullptr);
+  std::fwrite(text.data(), 1, text.size(), file);
+  std::fflush(file);
+  std::rewind(file);
+
+  lite3_json::IngestOptions options;
+  options.threads = 2;
+  options.chunk_size = 300;
+  Buffer folded = lite3_json::fold_ndjson(fileno(file), options);
+  std::fclose(file);
+
+  size_t count = 0;
+  for (auto it = folded.begin(0); it != folded.end(0); ++it)
+    ++count;
+  ASSERT_EQ(count, 502u);
+  for (uint32_t i = 0; i < 500; ++i)
+    ASSERT_EQ(folded.get_i64(folded.arr_get_obj(0, i), "id"), int64_t(i));
+  EXPECT_EQ(folded.get_str(folded.arr_get_obj(0, 500), "long").size(), 5000u);
+  EXPECT_EQ(folded.get_i64(folded.arr_get_obj(0, 501), "id"), 500);
+  size_t tags = folded.get_arr(folded.arr_get_obj(0, 7), "tags");
+  EXPECT_EQ(folded.arr_get_i64(tags, 0), 1);
+}
+
+TEST(NdjsonTest, ErrorsStopThePipeline) {
+  std::string text = make_ndjson(1000);
+  size_t bad = text.find("{\"id\":600");
+  text[bad + 1] = '?';
+
+  lite3_json::IngestOptions options;
+  options.threads = 4;
+  options.chunk_size = 256;
+  try {
+    lite3_json::ingest_ndjson(std::string_view(text),
+                              [](uint64_t, Buffer &) {}, options);
+    FAIL();
+  } catch (const lite3cpp::exception &e) {
+    EXPECT_NE(std::string(e.what()).find("offset " + std::to_string(bad)),
+              std::string::npos)
+        << e.what();
+  }
+
+  options.ordered = false;
+  EXPECT_THROW(lite3_json::ingest_ndjson(
+                   std::string_view(make_ndjson(100)),
+                   [](uint64_t, Buffer &doc) {
+                     if (doc.get_i64(0, "id") == 42)
+                       throw std::runtime_error("consumer");
+                   },
+                   options),
+               std::runtime_error);
+}
@@ -85,6 +85,12 @@ struct ObservabilityTest : public ::testing::Test {
     lite3cpp::set_logger(nullptr);
     lite3cpp::set_metrics(nullptr);
   }
+  // Tests install stack-allocated mocks; don't leave them dangling for
+  // suites that run afterwards.
+  void TearDown() override {
+    lite3cpp::set_logger(nullptr);
+    lite3cpp::set_metrics(nullptr);
+  }
 };
 
 TEST_F(ObservabilityTest, LoggingMetricsInvocation) {
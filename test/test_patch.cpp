@@ -0,0 +1,319 @@
+#include "buffer.hpp"
+#include "exception.hpp"
+#include "json.hpp"
+#include "patch.hpp"
+#include "test_util.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+static void expect_round_trip(const Buffer &from, const Buffer &to) {
+  Patch patch = diff(from, to);
+  Buffer target = from;
+  apply_merge_patch(target, patch);
+  EXPECT_EQ(content_digest(target), content_digest(to));
+  EXPECT_TRUE(diff(target, to).empty());
+}
+
+TEST(PatchTest, IdenticalBuffersGiveEmptyPatch) {
+  Buffer a;
+  a.init_object();
+  a.set_str(0, "name", "lite3");
+  size_t tags = a.set_arr(0, "tags");
+  a.arr_append_i64(tags, 1);
+  Buffer b = a;
+  ASSERT_TRUE(diff(a, b).empty());
+}
+
+TEST(PatchTest, SetsAndRemovesMembers) {
+  Buffer a;
+  a.init_object();
+  for (int i = 0; i < 40; ++i)
+    a.set_i64(0, "k" + std::to_string(i), i);
+  size_t user = a.set_obj(0, "user");
+  a.set_str(user, "name", "ada");
+  a.set_i64(user, "age", 36);
+
+  Buffer b = a;
+  b.set_i64(0, "k5", -5);
+  b.set_str(0, "new/key", "v");
+  ASSERT_TRUE(b.remove(0, "k12"));
+  ASSERT_TRUE(b.remove(b.get_obj(0, "user"), "age"));
+  b.set_bool(b.get_obj(0, "user"), "admin", true);
+
+  Patch patch = diff(a, b);
+  std::vector<std::string> paths;
+  for (const PatchOp &op : patch.ops)
+    paths.push_back((op.kind == PatchOp::Kind::Set ? "set " : "remove ") +
+                    op.path);
+  std::sort(paths.begin(), paths.end());
+  std::vector<std::string> expected = {"remove /k12", "remove /user/age",
+                                       "set /k5", "set /new~1key",
+                                       "set /user/admin"};
+  ASSERT_EQ(paths, expected);
+
+  Buffer target = a;
+  apply_merge_patch(target, patch);
+  EXPECT_EQ(target.get_i64(0, "k5"), -5);
+  EXPECT_EQ(target.get_str(0, "new/key"), "v");
+  EXPECT_EQ(target.get_type(0, "k12"), Type::Null);
+  EXPECT_TRUE(target.get_bool(target.get_obj(0, "user"), "admin"));
+  EXPECT_EQ(content_digest(target), content_digest(b));
+}
+
+TEST(PatchTest, ArraysAndTypeChanges) {
+  Buffer a;
+  a.init_object();
+  size_t items = a.set_arr(0, "items");
+  for (int i = 0; i < 20; ++i)
+    a.arr_append_i64(items, i);
+  size_t shrink = a.set_arr(0, "shrink");
+  a.arr_append_str(shrink, "x");
+  a.arr_append_str(shrink, "y");
+  a.set_str(0, "mode", "text");
+
+  Buffer b;
+  b.init_object();
+  items = b.set_arr(0, "items");
+  for (int i = 0; i < 25; ++i)
+    b.arr_append_i64(items, i == 7 ? 70 : i);
+  size_t nested = b.arr_append_obj(items);
+  b.set_f64(nested, "pi", 3.25);
+  shrink = b.set_arr(0, "shrink");
+  b.arr_append_str(shrink, "x");
+  size_t mode = b.set_obj(0, "mode");
+  b.set_i64(mode, "level", 2);
+
+  Patch patch = diff(a, b);
+  for (const PatchOp &op : patch.ops)
+    EXPECT_EQ(op.kind, PatchOp::Kind::Set) << op.path;
+  expect_round_trip(a, b);
+}
+
+TEST(PatchTest, WholeDocumentReplacement) {
+  Buffer a, b, empty;
+  a.init_object();
+  a.set_i64(0, "x", 1);
+  b.init_array();
+  b.set_str(b.arr_append_obj(0), "s", "v");
+  b.arr_append_str(0, "s");
+  expect_round_trip(a, b);
+  expect_round_trip(empty, a);
+
+  Patch patch = diff(a, empty);
+  ASSERT_EQ(patch.ops.size(), 1u);
+  EXPECT_EQ(patch.ops[0].kind, PatchOp::Kind::Remove);
+  Buffer target = a;
+  apply_merge_patch(target, patch);
+  EXPECT_EQ(target.size(), 0u);
+}
+
+TEST(PatchTest, RandomEditsRoundTripWithDigests) {
+  Buffer a;
+  a.init_object();
+  std::mt19937 rng(99);
+  for (int i = 0; i < 300; ++i)
+    a.set_i64(0, "k" + std::to_string(rng() % 400), i);
+  size_t sub = a.set_obj(0, "sub");
+  for (int i = 0; i < 50; ++i)
+    a.set_str(sub, "s" + std::to_string(i), std::string(i % 7, 'z'));
+  a.enable_digests();
+
+  Buffer b = a;
+  for (int step = 0; step < 400; ++step) {
+    std::string key = "k" + std::to_string(rng() % 400);
+    if (rng() % 3 == 0)
+      b.remove(0, key);
+    else
+      b.set_i64(0, key, -step);
+    if (step % 50 == 0)
+      b.remove(b.get_obj(0, "sub"), "s" + std::to_string(step / 50));
+  }
+  // remove() keeps digests current.
+  ASSERT_EQ(b.digest(), content_digest(b));
+  expect_round_trip(a, b);
+
+  Buffer target = a;
+  apply_merge_patch(target, diff(a, b));
+  ASSERT_EQ(target.digest(), b.digest());
+}
+
+TEST(PatchTest, RemoveKeepsRemainingKeysReachable) {
+  Buffer buf;
+  buf.init_object();
+  std::vector<std::string> keys;
+  for (int i = 0; i < 500; ++i) {
+    keys.push_back("key" + std::to_string(i));
+    buf.set_i64(0, keys.back(), i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(3));
+  for (size_t n = 0; n < keys.size(); ++n) {
+    ASSERT_TRUE(buf.remove(0, keys[n]));
+    ASSERT_FALSE(buf.remove(0, keys[n]));
+    if (n % 25 == 0) {
+      for (size_t m = n + 1; m < keys.size(); ++m)
+        ASSERT_EQ(buf.get_type(0, keys[m]), Type::Int64) << keys[m];
+    }
+  }
+  ASSERT_EQ(buf.begin(0), buf.end(0));
+  buf.set_i64(0, "again", 1);
+  ASSERT_EQ(buf.get_i64(0, "again"), 1);
+}
+
+TEST(PatchTest, ResolvesJsonPointers) {
+  Buffer buf = lite3_json::parse_json(
+      R"({"a":{"b~c":[1,{"d/e":"x"}]},"":5,"n":null})");
+  EXPECT_EQ(resolve_pointer(buf, ""), 0u);
+  std::optional<size_t> vo = resolve_pointer(buf, "/a/b~0c/1/d~1e");
+  ASSERT_TRUE(vo);
+  EXPECT_EQ(lite3_json::to_json_string(buf, *vo), "\"x\"");
+  vo = resolve_pointer(buf, "/a/b~0c");
+  ASSERT_TRUE(vo);
+  EXPECT_EQ(lite3_json::to_json_string(buf, *vo), "[1,{\"d/e\":\"x\"}]");
+  EXPECT_EQ(lite3_json::to_json_string(buf, *resolve_pointer(buf, "/")), "5");
+  EXPECT_TRUE(resolve_pointer(buf, "/n"));
+  EXPECT_FALSE(resolve_pointer(buf, "/a/b~0c/01"));
+  EXPECT_FALSE(resolve_pointer(buf, "/a/b~0c/2"));
+  EXPECT_FALSE(resolve_pointer(buf, "/a/b~0c/-"));
+  EXPECT_FALSE(resolve_pointer(buf, "/a/b~0c/0/x"));
+  EXPECT_FALSE(resolve_pointer(buf, "/missing"));
+  EXPECT_THROW(resolve_pointer(buf, "a"), lite3cpp::exception);
+}
+
+static void expect_json_patch(const char *doc, const char *patch,
+                              const char *expected) {
+  Buffer target = lite3_json::parse_json(doc);
+  target.enable_digests();
+  apply_json_patch(target, patch);
+  Buffer want = lite3_json::parse_json(expected);
+  EXPECT_EQ(content_digest(target), content_digest(want))
+      << patch << " gave " << lite3_json::to_json_string(target, 0);
+  EXPECT_EQ(target.digest(), content_digest(target)) << patch;
+}
+
+// Examples from RFC 6902 appendix A.
+TEST(PatchTest, JsonPatchOperations) {
+  expect_json_patch(R"({"foo":"bar"})",
+                    R"([{"op":"add","path":"/baz","value":"qux"}])",
+                    R"({"baz":"qux","foo":"bar"})");
+  expect_json_patch(R"({"foo":["bar","baz"]})",
+                    R"([{"op":"add","path":"/foo/1","value":"qux"}])",
+                    R"({"foo":["bar","qux","baz"]})");
+  expect_json_patch(R"({"baz":"qux","foo":"bar"})",
+                    R"([{"op":"remove","path":"/baz"}])", R"({"foo":"bar"})");
+  expect_json_patch(R"({"foo":["bar","qux","baz"]})",
+                    R"([{"op":"remove","path":"/foo/1"}])",
+                    R"({"foo":["bar","baz"]})");
+  expect_json_patch(R"({"baz":"qux","foo":"bar"})",
+                    R"([{"op":"replace","path":"/baz","value":"boo"}])",
+                    R"({"baz":"boo","foo":"bar"})");
+  expect_json_patch(
+      R"({"foo":{"bar":"baz","waldo":"fred"},"qux":{"corge":"grault"}})",
+      R"([{"op":"move","from":"/foo/waldo","path":"/qux/thud"}])",
+      R"({"foo":{"bar":"baz"},"qux":{"corge":"grault","thud":"fred"}})");
+  expect_json_patch(R"({"foo":["all","grass","cows","eat"]})",
+                    R"([{"op":"move","from":"/foo/1","path":"/foo/3"}])",
+                    R"({"foo":["all","cows","eat","grass"]})");
+  expect_json_patch(R"({"baz":"qux","foo":["a",2,"c"]})",
+                    R"([{"op":"test","path":"/baz","value":"qux"},)"
+                    R"({"op":"test","path":"/foo/1","value":2.0}])",
+                    R"({"baz":"qux","foo":["a",2,"c"]})");
+  expect_json_patch(R"({"foo":"bar"})",
+                    R"([{"op":"add","path":"/child","value":{"grand":{}}}])",
+                    R"({"foo":"bar","child":{"grand":{}}})");
+  expect_json_patch(R"({"foo":["bar"]})",
+                    R"([{"op":"add","path":"/foo/-","value":["abc","def"]}])",
+                    R"({"foo":["bar",["abc","def"]]})");
+  expect_json_patch(R"({"a":{"b":[1,{"c":2}]}})",
+                    R"([{"op":"copy","from":"/a","path":"/a/b/0"},)"
+                    R"({"op":"replace","path":"","value":{"x":[]}},)"
+                    R"({"op":"copy","from":"","path":"/x/0"}])",
+                    R"({"x":[{"x":[]}]})");
+
+  // Patch strings stay Strings by default, "" and hex-looking ones too.
+  Buffer buf;
+  buf.init_object();
+  buf.set_str(0, "s", "");
+  apply_json_patch(buf, R"([{"op":"test","path":"/s","value":""},)"
+                        R"({"op":"add","path":"/t","value":"abcd"}])");
+  EXPECT_EQ(buf.get_type(0, "t"), Type::String);
+  EXPECT_EQ(buf.get_str(0, "t"), "abcd");
+  lite3_json::ImportPolicy hex;
+  apply_json_patch(buf, R"([{"op":"add","path":"/t","value":"abcd"}])", hex);
+  EXPECT_EQ(buf.get_type(0, "t"), Type::Bytes);
+}
+
+TEST(PatchTest, JsonPatchRenumbersLargeArrays) {
+  Buffer buf;
+  buf.init_object();
+  size_t arr = buf.set_arr(0, "items");
+  std::vector<int> model;
+  for (int i = 0; i < 600; ++i) {
+    if (i % 7 == 0)
+      buf.set_i64(buf.arr_append_obj(arr), "v", i);
+    else
+      buf.arr_append_i64(arr, i);
+    model.push_back(i);
+  }
+  buf.enable_digests();
+
+  std::string patch = "[";
+  std::mt19937 rng(11);
+  for (int step = 0; step < 200; ++step) {
+    uint32_t at = rng() % model.size();
+    if (step)
+      patch += ',';
+    if (rng() % 2) {
+      patch += R"({"op":"remove","path":"/items/)" + std::to_string(at) + "\"}";
+      model.erase(model.begin() + at);
+    } else {
+      patch += R"({"op":"add","path":"/items/)" + std::to_string(at) +
+               R"(","value":)" + std::to_string(1000 + step) + "}";
+      model.insert(model.begin() + at, 1000 + step);
+    }
+  }
+  apply_json_patch(buf, patch + "]");
+
+  size_t items = buf.get_arr(0, "items");
+  for (uint32_t i = 0; i < model.size(); ++i) {
+    int v = model[i];
+    if (v < 1000 && v % 7 == 0)
+      ASSERT_EQ(buf.get_i64(buf.arr_get_obj(items, i), "v"), v) << i;
+    else
+      ASSERT_EQ(buf.arr_get_i64(items, i), v) << i;
+  }
+  EXPECT_FALSE(buf.arr_remove(items, static_cast<uint32_t>(model.size())));
+  EXPECT_EQ(buf.digest(), content_digest(buf));
+}
+
+TEST(PatchTest, JsonPatchErrorsNameTheOperation) {
+  Buffer buf = lite3_json::parse_json(R"({"a":[1,2],"o":{"k":true}})");
+  auto expect_error = [&](const char *patch, const char *what) {
+    try {
+      apply_json_patch(buf, patch);
+      FAIL() << patch;
+    } catch (const lite3cpp::exception &e) {
+      EXPECT_NE(std::string(e.what()).find(what), std::string::npos)
+          << e.what();
+    }
+  };
+  expect_error(R"([{"op":"test","path":"/a/0","value":1},)"
+               R"({"op":"test","path":"/o/k","value":false}])",
+               "operation 1: test failed at /o/k");
+  expect_error(R"([{"op":"remove","path":"/o/x"}])", "operation 0: no value");
+  expect_error(R"([{"op":"replace","path":"/a/2","value":3}])",
+               "index out of range");
+  expect_error(R"([{"op":"add","path":"/a/01","value":3}])",
+               "index out of range");
+  expect_error(R"([{"op":"add","path":"/x/y","value":3}])", "no container");
+  expect_error(R"([{"op":"move","from":"/o","path":"/o/k/z"}])",
+               "into itself");
+  expect_error(R"([{"op":"copy","from":"/z","path":"/y"}])", "no value at /z");
+  expect_error(R"([{"op":"frob","path":"/a"}])", "unknown op");
+  expect_error(R"([{"path":"/a"}])", "missing");
+  expect_error(R"({"op":"add"})", "must be an array");
+}
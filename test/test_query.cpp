@@ -0,0 +1,140 @@
+#include "buffer.hpp"
+#include "exception.hpp"
+#include "json.hpp"
+#include "query.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+namespace {
+
+const char *kRecords = R"([
+  {"id": 0, "status": "active", "score": 0.9, "tags": ["a"], "geo": {"cc": "NZ"}},
+  {"id": 1, "status": "idle", "score": 0.95, "geo": {"cc": "AU"}},
+  {"id": 2, "status": "active", "score": 0.5, "vip": true},
+  {"id": 3, "status": "active", "score": 1, "geo": {"cc": "NZ"}, "vip": false},
+  {"id": 4, "status": null, "score": "high"},
+  5,
+  {"id": 6, "status": "archived", "score": 0.71}
+])";
+
+std::vector<uint32_t> run(const Buffer &buf, const Filter &filter) {
+  return Query(filter).matches(buf, 0);
+}
+
+} // namespace
+
+TEST(QueryTest, EvaluatesComparisonsAndBooleanOps) {
+  Buffer buf = lite3_json::parse_json(kRecords);
+  using V = std::vector<uint32_t>;
+
+  EXPECT_EQ(run(buf, Filter::eq("/status", "active") &&
+                         Filter::gt("/score", 0.7)),
+            (V{0, 3}));
+  // Int64 and Float64 compare by value, strings only with strings.
+  EXPECT_EQ(run(buf, Filter::ge("/score", 1)), (V{3}));
+  EXPECT_EQ(run(buf, Filter::eq("/score", 1.0)), (V{3}));
+  EXPECT_EQ(run(buf, Filter::lt("/score", 0.71)), (V{2}));
+  EXPECT_EQ(run(buf, Filter::le("/id", 1) || Filter::eq("/vip", true)),
+            (V{0, 1, 2}));
+  EXPECT_EQ(run(buf, Filter::gt("/status", "b")), (V{1}));
+
+  // ne negates eq, so it holds for missing members and non-objects.
+  EXPECT_EQ(run(buf, Filter::ne("/status", "active")), (V{1, 4, 5, 6}));
+  EXPECT_EQ(run(buf, Filter::eq("/status", nullptr)), (V{4, 5}));
+  EXPECT_EQ(run(buf, !Filter::eq("/vip", false) &&
+                         Filter::eq("/geo/cc", "NZ")),
+            (V{0}));
+
+  EXPECT_EQ(run(buf, Filter::in("/geo/cc", {"AU", "NZ"})), (V{0, 1, 3}));
+  EXPECT_EQ(run(buf, Filter::in("/score", {1, 0.5, "high"})), (V{2, 3, 4}));
+  EXPECT_EQ(run(buf, Filter::in("/status", {nullptr, "idle"})),
+            (V{1, 4, 5}));
+  EXPECT_EQ(run(buf, Filter::in("/id", {})), V{});
+  EXPECT_EQ(run(buf, Filter::starts_with("/status", "a")), (V{0, 2, 3, 6}));
+  EXPECT_EQ(run(buf, Filter::starts_with("/tags", "a")), V{});
+}
+
+TEST(QueryTest, ComparesMixedNumbersExactly) {
+  Buffer buf = lite3_json::parse_json(
+      R"([{"n": 9007199254740993}, {"n": 9007199254740992.0}, {"n": -0.5}])");
+  using V = std::vector<uint32_t>;
+  // 2^53 + 1 is above the double 2^53, though it rounds to it.
+  EXPECT_EQ(run(buf, Filter::gt("/n", 9007199254740992.0)), (V{0}));
+  EXPECT_EQ(run(buf, Filter::eq("/n", int64_t{9007199254740992})), (V{1}));
+  EXPECT_EQ(run(buf, Filter::lt("/n", 0)), (V{2}));
+  EXPECT_EQ(run(buf, Filter::ge("/n", -1)), (V{0, 1, 2}));
+  EXPECT_EQ(run(buf, Filter::in("/n", {9007199254740992.0})), (V{1}));
+}
+
+TEST(QueryTest, ProjectsMatches) {
+  Buffer buf;
+  buf.init_object();
+  size_t arr = buf.set_arr(0, "rows");
+  for (int i = 0; i < 2000; ++i) {
+    size_t rec = buf.arr_append_obj(arr);
+    buf.set_i64(rec, "id", i);
+    buf.set_str(rec, "status", i % 3 ? "active" : "idle");
+    for (int k = 0; k < 20; ++k)
+      buf.set_i64(rec, "pad" + std::to_string(k), k);
+    size_t geo = buf.set_obj(rec, "geo");
+    buf.set_str(geo, "cc", i % 5 ? "NZ" : "AU");
+    if (i % 2)
+      buf.set_obj(geo, "pos");
+  }
+  size_t rows = buf.get_arr(0, "rows");
+
+  Query query(Filter::eq("/status", "active") && Filter::eq("/geo/cc", "AU"),
+              {"/id", "/geo/cc", "/geo/pos", "/missing"});
+  std::vector<uint32_t> hits = query.matches(buf, rows);
+  Buffer out = query.project(buf, rows);
+  ASSERT_EQ(NodeView(reinterpret_cast<const PackedNodeLayout *>(out.data()))
+                .size(),
+            hits.size());
+  size_t n = 0;
+  for (int i = 0; i < 2000; ++i) {
+    if (i % 3 == 0 || i % 5 != 0)
+      continue;
+    ASSERT_LT(n, hits.size());
+    EXPECT_EQ(hits[n], static_cast<uint32_t>(i));
+    size_t rec = out.arr_get_obj(0, static_cast<uint32_t>(n));
+    EXPECT_EQ(out.get_i64(rec, "id"), i);
+    EXPECT_EQ(out.get_str(rec, "cc"), "AU");
+    EXPECT_EQ(out.get_type(rec, "pos"), i % 2 ? Type::Object : Type::Null);
+    EXPECT_EQ(out.get_type(rec, "status"), Type::Null);
+    ++n;
+  }
+  EXPECT_EQ(n, hits.size());
+
+  // Without a selection whole elements are copied.
+  Buffer whole = Query(Filter::eq("/id", 5)).project(buf, rows);
+  size_t rec = whole.arr_get_obj(0, 0);
+  EXPECT_EQ(whole.get_i64(rec, "pad19"), 19);
+  EXPECT_EQ(whole.get_str(whole.get_obj(rec, "geo"), "cc"), "AU");
+}
+
+TEST(QueryTest, RejectsBadPaths) {
+  Buffer buf = lite3_json::parse_json(kRecords);
+  auto expect_error = [&](auto make, const char *what) {
+    try {
+      make().matches(buf, 0);
+      FAIL() << what;
+    } catch (const lite3cpp::exception &e) {
+      EXPECT_NE(std::string(e.what()).find(what), std::string::npos)
+          << e.what();
+    }
+  };
+  expect_error([] { return Query(Filter::eq("id", 1)); },
+               "Filter path must name a member: id");
+  expect_error([] { return Query(Filter::eq("/a~x", 1)); },
+               "Filter path has a bad escape");
+  expect_error(
+      [] { return Query(Filter::eq("/id", 1), {"/a/cc", "/b/cc"}); },
+      "Selected paths /a/cc and /b/cc share the name cc");
+
+  Buffer obj = lite3_json::parse_json(R"({"a": 1})");
+  EXPECT_THROW(Query(Filter::eq("/a", 1)).matches(obj, 0),
+               lite3cpp::exception);
+}
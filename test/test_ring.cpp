@@ -0,0 +1,228 @@
+#include "lite3/ring.hpp"
+#include "rebalance.hpp"
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using lite3::ConsistentHash;
+using lite3::NodeID;
+
+// The std::map ring the flat layout replaced; used as the routing oracle.
+struct ReferenceRing {
+  int replicas;
+  std::map<uint64_t, NodeID> ring;
+
+  void add_node(NodeID id) {
+    for (int i = 0; i < replicas; ++i)
+      ring[lite3::fnv1a_64(std::to_string(id) + ":" + std::to_string(i))] = id;
+  }
+  void remove_node(NodeID id) {
+    std::erase_if(ring, [&](const auto &kv) { return kv.second == id; });
+  }
+  NodeID get_node(std::string_view key) const {
+    if (ring.empty())
+      return 0;
+    auto it = ring.lower_bound(lite3::fnv1a_64(key));
+    return it == ring.end() ? ring.begin()->second : it->second;
+  }
+};
+
+static std::vector<std::string> make_keys(int count) {
+  std::vector<std::string> keys;
+  for (int i = 0; i < count; ++i)
+    keys.push_back("key" + std::to_string(i));
+  return keys;
+}
+
+class RingLayoutTest : public ::testing::TestWithParam<ConsistentHash::Layout> {
+};
+
+TEST_P(RingLayoutTest, MatchesMapRing) {
+  ConsistentHash ring(50, GetParam());
+  ReferenceRing ref{50, {}};
+  auto keys = make_keys(2000);
+
+  ASSERT_EQ(ring.get_node("anything"), 0u);
+  for (NodeID n = 1; n <= 37; ++n) {
+    ring.add_node(n);
+    ref.add_node(n);
+  }
+  ring.remove_node(5);
+  ref.remove_node(5);
+  ring.remove_node(36);
+  ref.remove_node(36);
+  ring.add_node(5);
+  ref.add_node(5);
+
+  ASSERT_EQ(ring.size(), ref.ring.size());
+  for (const auto &k : keys)
+    ASSERT_EQ(ring.get_node(k), ref.get_node(k)) << k;
+
+  // Hashes past the last position wrap to the first.
+  std::string_view probe = "";
+  for (const auto &k : keys)
+    if (lite3::fnv1a_64(k) > ref.ring.rbegin()->first)
+      probe = k;
+  if (!probe.empty()) {
+    ASSERT_EQ(ring.get_node(probe), ref.ring.begin()->second);
+  }
+}
+
+TEST_P(RingLayoutTest, BatchMatchesSingleLookups) {
+  ConsistentHash ring(100, GetParam());
+  for (NodeID n = 0; n < 13; ++n)
+    ring.add_node(n);
+
+  auto keys = make_keys(1003); // Not a multiple of the lane count
+  std::vector<std::string_view> views(keys.begin(), keys.end());
+  std::vector<NodeID> routed = ring.get_nodes(views);
+  ASSERT_EQ(routed.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); ++i)
+    ASSERT_EQ(routed[i], ring.get_node(keys[i]));
+}
+
+TEST_P(RingLayoutTest, SmallRings) {
+  for (int replicas = 1; replicas <= 9; ++replicas) {
+    ConsistentHash ring(replicas, GetParam());
+    ReferenceRing ref{replicas, {}};
+    ring.add_node(7);
+    ref.add_node(7);
+    ring.add_node(3);
+    ref.add_node(3);
+    for (const auto &k : make_keys(200))
+      ASSERT_EQ(ring.get_node(k), ref.get_node(k));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Layouts, RingLayoutTest,
+                         ::testing::Values(ConsistentHash::Layout::Sorted,
+                                           ConsistentHash::Layout::Eytzinger));
+
+// Every key whose owner changes must be covered by exactly the reported
+// move, and no other key may be covered.
+static void expect_diff_exact(const ConsistentHash &before,
+                              const ConsistentHash &after,
+                              const std::vector<lite3::RangeMove> &moves) {
+  for (size_t i = 1; i < moves.size(); ++i)
+    ASSERT_LT(moves[i - 1].last, moves[i].first);
+  for (const auto &k : make_keys(5000)) {
+    NodeID from = before.get_node(k), to = after.get_node(k);
+    const lite3::RangeMove *m = lite3::find_move(moves, lite3::fnv1a_64(k));
+    if (from == to) {
+      ASSERT_EQ(m, nullptr) << k;
+    } else {
+      ASSERT_NE(m, nullptr) << k;
+      ASSERT_EQ(m->from, from);
+      ASSERT_EQ(m->to, to);
+    }
+  }
+}
+
+TEST(RingDiffTest, AddAndRemoveMoveOnlyAffectedRanges) {
+  ConsistentHash ring(64);
+  for (NodeID n = 0; n < 8; ++n)
+    ring.add_node(n);
+
+  auto add_plan = ring.plan_add_node(8);
+  ASSERT_FALSE(add_plan.empty());
+  for (const auto &m : add_plan)
+    ASSERT_EQ(m.to, 8u); // A join only takes ranges, never shuffles others
+  ConsistentHash grown = ring;
+  grown.add_node(8);
+  expect_diff_exact(ring, grown, add_plan);
+
+  auto remove_plan = ring.plan_remove_node(3);
+  std::set<NodeID> receivers;
+  for (const auto &m : remove_plan) {
+    ASSERT_EQ(m.from, 3u);
+    receivers.insert(m.to);
+  }
+  ASSERT_GT(receivers.size(), 1u); // Load spreads over the survivors
+  ConsistentHash shrunk = ring;
+  shrunk.remove_node(3);
+  expect_diff_exact(ring, shrunk, remove_plan);
+
+  ASSERT_TRUE(ConsistentHash::diff(ring, ring).empty());
+  expect_diff_exact(ConsistentHash(64), ring,
+                    ConsistentHash::diff(ConsistentHash(64), ring));
+}
+
+TEST(RingDiffTest, MovedKeysOfObject) {
+  ConsistentHash ring(32);
+  for (NodeID n = 0; n < 4; ++n)
+    ring.add_node(n);
+  auto plan = ring.plan_add_node(4);
+
+  lite3cpp::Buffer buf;
+  buf.init_object();
+  auto keys = make_keys(300);
+  for (size_t i = 0; i < keys.size(); ++i)
+    buf.set_i64(0, keys[i], static_cast<int64_t>(i));
+
+  std::set<std::string> expected;
+  ConsistentHash grown = ring;
+  grown.add_node(4);
+  for (const auto &k : keys)
+    if (ring.get_node(k) != grown.get_node(k))
+      expected.insert(k);
+
+  std::set<std::string> seen;
+  lite3cpp::for_each_moved_key(buf, 0, plan, [&](const lite3cpp::MovedKey &m) {
+    ASSERT_EQ(m.to, 4u);
+    ASSERT_EQ(m.type, lite3cpp::Type::Int64);
+    seen.insert(std::string(m.key));
+  });
+  ASSERT_FALSE(expected.empty());
+  ASSERT_EQ(seen, expected);
+  ASSERT_EQ(lite3cpp::moved_keys(buf, 0, plan).size(), expected.size());
+}
+
+TEST(RingBoundedLoadTest, CapsLoadAndSpillsClockwise) {
+  ConsistentHash ring(100);
+  for (NodeID n = 0; n < 10; ++n)
+    ring.add_node(n);
+  auto keys = make_keys(10000);
+
+  // Unbounded acquire is plain routing.
+  for (int i = 0; i < 100; ++i)
+    ASSERT_EQ(ring.acquire(keys[i]), ring.get_node(keys[i]));
+  for (int i = 0; i < 100; ++i)
+    ring.release(ring.get_node(keys[i]));
+  ASSERT_EQ(ring.total_load(), 0u);
+
+  ring.set_load_bound(0.1);
+  std::vector<NodeID> placed;
+  for (const auto &k : keys)
+    placed.push_back(ring.acquire(k));
+  for (NodeID n = 0; n < 10; ++n)
+    ASSERT_LE(ring.load(n), 1100u); // ceil(1.1 * 10000 / 10)
+  ASSERT_EQ(ring.total_load(), keys.size());
+
+  for (NodeID n : placed)
+    ring.release(n);
+  ASSERT_EQ(ring.total_load(), 0u);
+  for (NodeID n = 0; n < 10; ++n)
+    ASSERT_EQ(ring.load(n), 0u);
+}
+
+TEST(RingBoundedLoadTest, CapacityFactorsWeightTheBound) {
+  ConsistentHash ring(100);
+  for (NodeID n = 0; n < 4; ++n)
+    ring.add_node(n);
+  ring.set_capacity(0, 3.0);
+  ring.set_load_bound(0.0);
+
+  auto keys = make_keys(6000);
+  for (const auto &k : keys)
+    ring.acquire(k);
+  // Capacities 3:1:1:1 give node 0 half of the units at most.
+  ASSERT_LE(ring.load(0), 3000u);
+  for (NodeID n = 1; n < 4; ++n)
+    ASSERT_LE(ring.load(n), 1000u);
+
+  ring.remove_node(0);
+  ASSERT_EQ(ring.load(0), 0u);
+  ASSERT_EQ(ring.total_load(), ring.load(1) + ring.load(2) + ring.load(3));
+}
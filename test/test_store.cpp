@@ -0,0 +1,103 @@
+#include "store.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace lite3cpp;
+
+static Buffer make_doc(int64_t id) {
+  Buffer doc;
+  doc.init_object();
+  doc.set_i64(0, "id", id);
+  return doc;
+}
+
+TEST(StoreTest, PutGetUpdateErase) {
+  Store store(8);
+  store.put("user:1", make_doc(1));
+
+  int64_t id = 0;
+  ASSERT_TRUE(store.get("user:1",
+                        [&](const Buffer &doc) { id = doc.get_i64(0, "id"); }));
+  ASSERT_EQ(id, 1);
+
+  ASSERT_TRUE(store.update("user:1",
+                           [](Buffer &doc) { doc.set_i64(0, "id", 99); }));
+  store.get("user:1", [&](const Buffer &doc) { id = doc.get_i64(0, "id"); });
+  ASSERT_EQ(id, 99);
+
+  ASSERT_TRUE(store.erase("user:1"));
+  ASSERT_FALSE(store.contains("user:1"));
+  ASSERT_FALSE(store.get("user:1", [](const Buffer &) {}));
+  ASSERT_FALSE(store.update("user:1", [](Buffer &) {}));
+}
+
+TEST(StoreTest, RoutingIsStableAcrossInstances) {
+  Store a(16), b(16);
+  for (int i = 0; i < 200; ++i) {
+    std::string key = "doc" + std::to_string(i);
+    ASSERT_LT(a.shard_of(key), 16u);
+    ASSERT_EQ(a.shard_of(key), b.shard_of(key));
+  }
+}
+
+TEST(StoreTest, BatchedOperationsAndMetrics) {
+  Store store(4);
+  std::vector<std::pair<std::string, Buffer>> docs;
+  for (int i = 0; i < 100; ++i)
+    docs.emplace_back("k" + std::to_string(i), make_doc(i));
+  store.put_batch(std::move(docs));
+
+  std::vector<std::string> names;
+  for (int i = 0; i < 110; ++i)
+    names.push_back("k" + std::to_string(i));
+  std::vector<std::string_view> keys(names.begin(), names.end());
+
+  store.update_batch(keys, [](size_t i, Buffer &doc) {
+    doc.set_i64(0, "id", static_cast<int64_t>(i) * 10);
+  });
+
+  size_t found = 0;
+  store.get_batch(keys, [&](size_t i, const Buffer *doc) {
+    if (!doc)
+      return;
+    ASSERT_EQ(doc->get_i64(0, "id"), static_cast<int64_t>(i) * 10);
+    ++found;
+  });
+  ASSERT_EQ(found, 100u);
+
+  ShardMetrics total;
+  for (const auto &m : store.metrics()) {
+    total.documents += m.documents;
+    total.gets += m.gets;
+    total.misses += m.misses;
+    total.puts += m.puts;
+    total.updates += m.updates;
+  }
+  ASSERT_EQ(total.documents, 100u);
+  ASSERT_EQ(total.puts, 100u);
+  ASSERT_EQ(total.updates, 100u);
+  ASSERT_EQ(total.gets, 110u);
+  ASSERT_EQ(total.misses, 20u); // 10 from update_batch, 10 from get_batch
+}
+
+TEST(StoreTest, ErasedBuffersAreRecycledPerShard) {
+  Store store(2);
+  Buffer doc = store.acquire("recycled");
+  doc.init_object();
+  for (int i = 0; i < 64; ++i)
+    doc.set_i64(0, "field" + std::to_string(i), i);
+  size_t capacity = doc.capacity();
+  store.put("recycled", std::move(doc));
+  ASSERT_TRUE(store.erase("recycled"));
+  ASSERT_EQ(store.shard_metrics(store.shard_of("recycled")).pooled_buffers,
+            1u);
+
+  Buffer reused = store.acquire("recycled");
+  ASSERT_EQ(reused.size(), 0u);
+  ASSERT_GE(reused.capacity(), capacity);
+  reused.init_object();
+  reused.set_i64(0, "fresh", 1);
+  ASSERT_EQ(reused.get_i64(0, "fresh"), 1);
+  ASSERT_EQ(reused.get_type(0, "field0"), Type::Null);
+}
@@ -0,0 +1,18 @@
+#ifndef LITE3CPP_TEST_UTIL_HPP
+#define LITE3CPP_TEST_UTIL_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "buffer.hpp"
+
+// Content digest, independent of the buffer's history: its bytes hashed
+// from scratch, so equal documents compare equal however they were built.
+inline uint64_t content_digest(const lite3cpp::Buffer &buf) {
+  lite3cpp::Buffer copy(
+      std::vector<uint8_t>(buf.data(), buf.data() + buf.size()));
+  copy.enable_digests();
+  return copy.digest();
+}
+
+#endif // LITE3CPP_TEST_UTIL_HPP